@@ -0,0 +1,168 @@
+#include "action_batcher.h"
+
+#include <cstring>
+#include <functional>
+
+#include "api_counters.h"
+
+namespace sc2
+{
+	void ActionBatcher::UnitCommand(const Unit* unit, AbilityID ability, bool queued_command)
+	{
+		Add({ unit, ability, TargetKind::None, Point2D(), nullptr, queued_command });
+	}
+
+	void ActionBatcher::UnitCommand(const Unit* unit, AbilityID ability, const Point2D& point, bool queued_command)
+	{
+		Add({ unit, ability, TargetKind::Point, point, nullptr, queued_command });
+	}
+
+	void ActionBatcher::UnitCommand(const Unit* unit, AbilityID ability, const Unit* target, bool queued_command)
+	{
+		Add({ unit, ability, TargetKind::Unit, Point2D(), target, queued_command });
+	}
+
+	void ActionBatcher::UnitCommand(const Units& units, AbilityID ability, bool queued_command)
+	{
+		for (const Unit* unit : units)
+		{
+			UnitCommand(unit, ability, queued_command);
+		}
+	}
+
+	void ActionBatcher::UnitCommand(const Units& units, AbilityID ability, const Point2D& point, bool queued_command)
+	{
+		for (const Unit* unit : units)
+		{
+			UnitCommand(unit, ability, point, queued_command);
+		}
+	}
+
+	void ActionBatcher::UnitCommand(const Units& units, AbilityID ability, const Unit* target, bool queued_command)
+	{
+		for (const Unit* unit : units)
+		{
+			UnitCommand(unit, ability, target, queued_command);
+		}
+	}
+
+	size_t ActionBatcher::Flush(ActionInterface* actions)
+	{
+		groups_.clear();
+		group_of_.clear();
+		last_group_.clear();
+
+		for (size_t i = 0; i < commands_.size(); i++)
+		{
+			const Command& command = commands_[i];
+			bool appends = !command.queued && command.kind == TargetKind::None;
+			auto replaced = replaced_before_.find(command.unit->tag);
+			if (!appends && replaced != replaced_before_.end() && i < replaced->second)
+			{
+				continue;
+			}
+
+			// Groups go out in the order they were opened, a unit only joins one opened after its last command's,
+			// so its commands reach the game in the order they were given. Training twice from one building
+			// is two commands this way too, one multi-unit command would only queue one.
+			Key key = KeyOf(command);
+			auto last = last_group_.find(command.unit->tag);
+			auto joins = [&](size_t group) { return last == last_group_.end() || last->second < group; };
+			size_t group;
+			if (!command.queued)
+			{
+				auto found = group_of_.emplace(key, groups_.size());
+				if (found.second || !joins(found.first->second))
+				{
+					found.first->second = groups_.size();
+					groups_.push_back({ command, Units() });
+				}
+				group = found.first->second;
+			}
+			// Queued commands only join the group right before them, so every unit's queue keeps its order.
+			else if (!groups_.empty() && KeyOf(groups_.back().command) == key && joins(groups_.size() - 1))
+			{
+				group = groups_.size() - 1;
+			}
+			else
+			{
+				group = groups_.size();
+				groups_.push_back({ command, Units() });
+			}
+			groups_[group].units.push_back(command.unit);
+			last_group_[command.unit->tag] = group;
+		}
+
+		for (const Group& group : groups_)
+		{
+			const Command& command = group.command;
+			switch (command.kind)
+			{
+			case TargetKind::None:
+				actions->UnitCommand(group.units, command.ability, command.queued);
+				break;
+			case TargetKind::Point:
+				actions->UnitCommand(group.units, command.ability, command.point, command.queued);
+				break;
+			case TargetKind::Unit:
+				actions->UnitCommand(group.units, command.ability, command.target, command.queued);
+				break;
+			}
+		}
+
+		Clear();
+		return groups_.size();
+	}
+
+	void ActionBatcher::Clear()
+	{
+		commands_.clear();
+		replaced_before_.clear();
+	}
+
+	void ActionBatcher::Add(const Command& command)
+	{
+		if (command.unit == nullptr)
+		{
+			return;
+		}
+		if (counters_)
+		{
+			counters_->CountUnitCommand(1);
+		}
+
+		if (!command.queued && command.kind != TargetKind::None)
+		{
+			replaced_before_[command.unit->tag] = commands_.size();
+		}
+		commands_.push_back(command);
+	}
+
+	ActionBatcher::Key ActionBatcher::KeyOf(const Command& command)
+	{
+		Key key;
+		key.ability = command.ability;
+		key.kind = command.kind;
+		// Adding zero folds -0 into 0 so equal keys also hash equal.
+		key.x = command.kind == TargetKind::Point ? command.point.x + 0.0f : 0.0f;
+		key.y = command.kind == TargetKind::Point ? command.point.y + 0.0f : 0.0f;
+		key.target = command.kind == TargetKind::Unit && command.target ? command.target->tag : NullTag;
+		key.queued = command.queued;
+		return key;
+	}
+
+	size_t ActionBatcher::KeyHash::operator()(const Key& key) const
+	{
+		uint32_t x_bits;
+		uint32_t y_bits;
+		std::memcpy(&x_bits, &key.x, sizeof(x_bits));
+		std::memcpy(&y_bits, &key.y, sizeof(y_bits));
+
+		size_t hash = std::hash<uint64_t>()(key.target);
+		hash = hash * 31 + key.ability;
+		hash = hash * 31 + x_bits;
+		hash = hash * 31 + y_bits;
+		hash = hash * 31 + static_cast<size_t>(key.kind) * 2 + (key.queued ? 1 : 0);
+		return hash;
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	class ApiCounters;
+
+	// Collects a step's unit commands and sends identical ones (same ability, target and queue flag)
+	// as one multi-unit UnitCommand. A later non-queued targeted command for a unit replaces its earlier ones.
+	// Untargeted commands (train, research, morph) add to a production queue in game, so they are never replaced.
+	// Whatever is kept reaches the game in the order each unit was given it.
+	class ActionBatcher
+	{
+	public:
+		void UnitCommand(const Unit* unit, AbilityID ability, bool queued_command = false);
+		void UnitCommand(const Unit* unit, AbilityID ability, const Point2D& point, bool queued_command = false);
+		void UnitCommand(const Unit* unit, AbilityID ability, const Unit* target, bool queued_command = false);
+		void UnitCommand(const Units& units, AbilityID ability, bool queued_command = false);
+		void UnitCommand(const Units& units, AbilityID ability, const Point2D& point, bool queued_command = false);
+		void UnitCommand(const Units& units, AbilityID ability, const Unit* target, bool queued_command = false);
+
+		// Sends everything collected this step, returns how many UnitCommand calls that took.
+		size_t Flush(ActionInterface* actions);
+
+		// Drops everything collected this step without sending it.
+		void Clear();
+
+		size_t Pending() const { return commands_.size(); }
+
+		// Counts each command as it is collected, under the caller's ApiCallSite. The calls Flush makes
+		// are counted where it is called from, so that site shows how few real calls they came to.
+		void SetCounters(ApiCounters* counters) { counters_ = counters; }
+
+	private:
+		enum class TargetKind : uint8_t { None, Point, Unit };
+
+		struct Command
+		{
+			const Unit* unit;
+			uint32_t ability;
+			TargetKind kind;
+			Point2D point;
+			const Unit* target;
+			bool queued;
+		};
+
+		struct Group
+		{
+			Command command; // Ability and target shared by the group, unit is the first one in it
+			Units units;
+		};
+
+		struct Key
+		{
+			uint32_t ability;
+			TargetKind kind;
+			float x;
+			float y;
+			Tag target;
+			bool queued;
+
+			bool operator==(const Key& other) const
+			{
+				return ability == other.ability && kind == other.kind && x == other.x && y == other.y &&
+					target == other.target && queued == other.queued;
+			}
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const;
+		};
+
+		void Add(const Command& command);
+		static Key KeyOf(const Command& command);
+
+		std::vector<Command> commands_;
+		// Index in commands_ of each unit's latest non-queued targeted command, earlier ones are dropped at flush.
+		std::unordered_map<Tag, size_t> replaced_before_;
+
+		std::vector<Group> groups_;
+		std::unordered_map<Key, size_t, KeyHash> group_of_;
+		std::unordered_map<Tag, size_t> last_group_; // Group of each unit's latest command so far
+
+		ApiCounters* counters_ = nullptr;
+	};
+}
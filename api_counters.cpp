@@ -0,0 +1,220 @@
+#include "api_counters.h"
+
+#include <algorithm>
+
+namespace sc2
+{
+	void ApiCounters::Counts::Add(const Counts& other)
+	{
+		query_round_trips += other.query_round_trips;
+		get_units_calls += other.get_units_calls;
+		units_returned += other.units_returned;
+		unit_commands += other.unit_commands;
+		units_commanded += other.units_commanded;
+	}
+
+	void ApiCounters::Counts::Max(const Counts& other)
+	{
+		query_round_trips = std::max(query_round_trips, other.query_round_trips);
+		get_units_calls = std::max(get_units_calls, other.get_units_calls);
+		units_returned = std::max(units_returned, other.units_returned);
+		unit_commands = std::max(unit_commands, other.unit_commands);
+		units_commanded = std::max(units_commanded, other.units_commanded);
+	}
+
+	ApiCounters::ApiCounters(size_t ring_steps) :
+		ring_(std::max<size_t>(ring_steps, 1))
+	{
+		// Calls made outside any marked function
+		Site(std::string("(unmarked)"));
+	}
+
+	size_t ApiCounters::Site(const char* literal)
+	{
+		auto found = literal_sites_.find(literal);
+		if (found != literal_sites_.end())
+		{
+			return found->second;
+		}
+		size_t site = Site(std::string(literal));
+		literal_sites_[literal] = site;
+		return site;
+	}
+
+	size_t ApiCounters::Site(const std::string& name)
+	{
+		auto found = string_sites_.find(name);
+		if (found != string_sites_.end())
+		{
+			return found->second;
+		}
+
+		size_t site = names_.size();
+		names_.push_back(name);
+		string_sites_[name] = site;
+		current_.resize(names_.size());
+		totals_.resize(names_.size());
+		peaks_.resize(names_.size());
+		return site;
+	}
+
+	void ApiCounters::CountGetUnits(size_t returned)
+	{
+		Counts& counts = Current();
+		counts.get_units_calls++;
+		counts.units_returned += static_cast<uint32_t>(returned);
+	}
+
+	void ApiCounters::CountUnitCommand(size_t units)
+	{
+		Counts& counts = Current();
+		counts.unit_commands++;
+		counts.units_commanded += static_cast<uint32_t>(units);
+	}
+
+	void ApiCounters::EndStep(uint32_t game_loop)
+	{
+		StepCounts& step = ring_[steps_ % ring_.size()];
+		step.game_loop = game_loop;
+		step.sites.assign(current_.begin(), current_.end());
+
+		for (size_t site = 0; site < current_.size(); site++)
+		{
+			totals_[site].Add(current_[site]);
+			peaks_[site].Max(current_[site]);
+		}
+		std::fill(current_.begin(), current_.end(), Counts());
+		steps_++;
+	}
+
+	const ApiCounters::StepCounts& ApiCounters::Recent(size_t age) const
+	{
+		return ring_[(steps_ - 1 - age) % ring_.size()];
+	}
+
+	//
+	// CountedObservation
+	//
+
+	Units CountedObservation::GetUnits() const
+	{
+		Units units = observation_->GetUnits();
+		counters_.CountGetUnits(units.size());
+		return units;
+	}
+
+	Units CountedObservation::GetUnits(Unit::Alliance alliance, Filter filter) const
+	{
+		Units units = observation_->GetUnits(alliance, filter);
+		counters_.CountGetUnits(units.size());
+		return units;
+	}
+
+	Units CountedObservation::GetUnits(Filter filter) const
+	{
+		Units units = observation_->GetUnits(filter);
+		counters_.CountGetUnits(units.size());
+		return units;
+	}
+
+	const std::vector<Effect>& CountedObservation::GetEffects() const
+	{
+		return optional_observation::EffectsOf(observation_, 0);
+	}
+
+	const Effects& CountedObservation::GetEffectData(bool force_refresh) const
+	{
+		return optional_observation::EffectDataOf(observation_, force_refresh, 0);
+	}
+
+	int32_t CountedObservation::GetLarvaCount() const
+	{
+		return optional_observation::LarvaCountOf(observation_, 0);
+	}
+
+	//
+	// CountedActions
+	//
+
+	void CountedActions::UnitCommand(const Unit* unit, AbilityID ability, bool queued_command)
+	{
+		counters_.CountUnitCommand(1);
+		actions_->UnitCommand(unit, ability, queued_command);
+	}
+
+	void CountedActions::UnitCommand(const Unit* unit, AbilityID ability, const Point2D& point, bool queued_command)
+	{
+		counters_.CountUnitCommand(1);
+		actions_->UnitCommand(unit, ability, point, queued_command);
+	}
+
+	void CountedActions::UnitCommand(const Unit* unit, AbilityID ability, const Unit* target, bool queued_command)
+	{
+		counters_.CountUnitCommand(1);
+		actions_->UnitCommand(unit, ability, target, queued_command);
+	}
+
+	void CountedActions::UnitCommand(const Units& units, AbilityID ability, bool queued_move)
+	{
+		counters_.CountUnitCommand(units.size());
+		actions_->UnitCommand(units, ability, queued_move);
+	}
+
+	void CountedActions::UnitCommand(const Units& units, AbilityID ability, const Point2D& point, bool queued_command)
+	{
+		counters_.CountUnitCommand(units.size());
+		actions_->UnitCommand(units, ability, point, queued_command);
+	}
+
+	void CountedActions::UnitCommand(const Units& units, AbilityID ability, const Unit* target, bool queued_command)
+	{
+		counters_.CountUnitCommand(units.size());
+		actions_->UnitCommand(units, ability, target, queued_command);
+	}
+
+	//
+	// CountedQuery
+	//
+
+	AvailableAbilities CountedQuery::GetAbilitiesForUnit(const Unit* unit, bool ignore_resource_requirements)
+	{
+		counters_.CountQuery();
+		return query_->GetAbilitiesForUnit(unit, ignore_resource_requirements);
+	}
+
+	std::vector<AvailableAbilities> CountedQuery::GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements)
+	{
+		counters_.CountQuery();
+		return query_->GetAbilitiesForUnits(units, ignore_resource_requirements);
+	}
+
+	float CountedQuery::PathingDistance(const Point2D& start, const Point2D& end)
+	{
+		counters_.CountQuery();
+		return query_->PathingDistance(start, end);
+	}
+
+	float CountedQuery::PathingDistance(const Unit* start, const Point2D& end)
+	{
+		counters_.CountQuery();
+		return query_->PathingDistance(start, end);
+	}
+
+	std::vector<float> CountedQuery::PathingDistance(const std::vector<PathingQuery>& queries)
+	{
+		counters_.CountQuery();
+		return query_->PathingDistance(queries);
+	}
+
+	bool CountedQuery::Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* unit)
+	{
+		counters_.CountQuery();
+		return query_->Placement(ability, target_pos, unit);
+	}
+
+	std::vector<bool> CountedQuery::Placement(const std::vector<PlacementQuery>& queries)
+	{
+		counters_.CountQuery();
+		return query_->Placement(queries);
+	}
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Counts calls into the game API per step, broken down by the bot function that made them.
+	// Functions mark themselves with ApiCallSite, the innermost marked function gets the count.
+	// The last steps are kept in a ring buffer, everything is also totalled for the end-of-game report.
+	class ApiCounters
+	{
+	public:
+		struct Counts
+		{
+			uint32_t query_round_trips = 0; // Each Query() call, batched or not, is one round trip
+			uint32_t get_units_calls = 0;
+			uint32_t units_returned = 0;
+			uint32_t unit_commands = 0;     // ActionInterface::UnitCommand calls, or commands collected by an ActionBatcher
+			uint32_t units_commanded = 0;
+
+			void Add(const Counts& other);
+			void Max(const Counts& other);
+		};
+
+		// A step as recorded in the ring, counts are indexed by site.
+		struct StepCounts
+		{
+			uint32_t game_loop = 0;
+			std::vector<Counts> sites;
+		};
+
+		explicit ApiCounters(size_t ring_steps = 256);
+
+		// Id for a call site name. The const char* overload caches by pointer, meant for string literals.
+		size_t Site(const char* literal);
+		size_t Site(const std::string& name);
+
+		void PushSite(size_t site) { site_stack_.push_back(site); }
+		void PopSite() { site_stack_.pop_back(); }
+
+		void CountQuery() { Current().query_round_trips++; }
+		void CountGetUnits(size_t returned);
+		void CountUnitCommand(size_t units);
+
+		// Closes the step: stores it in the ring and adds it to the totals.
+		void EndStep(uint32_t game_loop);
+
+		size_t Sites() const { return names_.size(); }
+		const std::string& SiteName(size_t site) const { return names_[site]; }
+		const Counts& Total(size_t site) const { return totals_[site]; }
+		const Counts& PeakPerStep(size_t site) const { return peaks_[site]; }
+		size_t Steps() const { return steps_; }
+
+		// Step recorded age steps ago, 0 is the latest. Only the last ring_steps are kept.
+		size_t RecentSteps() const { return std::min(steps_, ring_.size()); }
+		const StepCounts& Recent(size_t age) const;
+
+	private:
+		Counts& Current() { return current_[site_stack_.empty() ? 0 : site_stack_.back()]; }
+
+		std::vector<std::string> names_;
+		std::unordered_map<const char*, size_t> literal_sites_;
+		std::unordered_map<std::string, size_t> string_sites_;
+		std::vector<size_t> site_stack_;
+
+		std::vector<Counts> current_;
+		std::vector<Counts> totals_;
+		std::vector<Counts> peaks_;
+		std::vector<StepCounts> ring_;
+		size_t steps_ = 0;
+	};
+
+	// Attributes API calls made until the end of the scope to a call site.
+	class ApiCallSite
+	{
+	public:
+		ApiCallSite(ApiCounters& counters, const char* name) :
+			counters_(counters)
+		{
+			counters_.PushSite(counters_.Site(name));
+		}
+
+		ApiCallSite(ApiCounters& counters, size_t site) :
+			counters_(counters)
+		{
+			counters_.PushSite(site);
+		}
+
+		~ApiCallSite()
+		{
+			counters_.PopSite();
+		}
+
+	private:
+		ApiCounters& counters_;
+	};
+
+	// The ObservationInterface calls not present in every API release, for the decorators that forward them.
+	// Pass 0: picked when the wrapped interface has the call, the long overloads (nothing) otherwise.
+	namespace optional_observation
+	{
+		template <typename T>
+		auto EffectsOf(const T* observation, int) -> decltype(observation->GetEffects())
+		{
+			return observation->GetEffects();
+		}
+
+		template <typename T>
+		const std::vector<Effect>& EffectsOf(const T*, long)
+		{
+			static const std::vector<Effect> none;
+			return none;
+		}
+
+		template <typename T>
+		auto EffectDataOf(const T* observation, bool force_refresh, int) -> decltype(observation->GetEffectData(force_refresh))
+		{
+			return observation->GetEffectData(force_refresh);
+		}
+
+		template <typename T>
+		const Effects& EffectDataOf(const T*, bool, long)
+		{
+			static const Effects none;
+			return none;
+		}
+
+		template <typename T>
+		auto LarvaCountOf(const T* observation, int) -> decltype(observation->GetLarvaCount())
+		{
+			return observation->GetLarvaCount();
+		}
+
+		template <typename T>
+		int32_t LarvaCountOf(const T*, long)
+		{
+			return 0;
+		}
+	}
+
+	// Decorators that count the calls going through them, installed with MultiplayerBot::SetInterfaces.
+
+	class CountedObservation : public ObservationInterface
+	{
+	public:
+		CountedObservation(const ObservationInterface* observation, ApiCounters& counters) :
+			observation_(observation), counters_(counters)
+		{
+		}
+
+		Units GetUnits() const override;
+		Units GetUnits(Unit::Alliance alliance, Filter filter = {}) const override;
+		Units GetUnits(Filter filter) const override;
+
+		uint32_t GetPlayerID() const override { return observation_->GetPlayerID(); }
+		uint32_t GetGameLoop() const override { return observation_->GetGameLoop(); }
+		const Unit* GetUnit(Tag tag) const override { return observation_->GetUnit(tag); }
+		const RawActions& GetRawActions() const override { return observation_->GetRawActions(); }
+		const SpatialActions& GetFeatureLayerActions() const override { return observation_->GetFeatureLayerActions(); }
+		const SpatialActions& GetRenderedActions() const override { return observation_->GetRenderedActions(); }
+		const std::vector<ChatMessage>& GetChatMessages() const override { return observation_->GetChatMessages(); }
+		const std::vector<PowerSource>& GetPowerSources() const override { return observation_->GetPowerSources(); }
+		const std::vector<UpgradeID>& GetUpgrades() const override { return observation_->GetUpgrades(); }
+		const Score& GetScore() const override { return observation_->GetScore(); }
+		const Abilities& GetAbilityData(bool force_refresh = false) const override { return observation_->GetAbilityData(force_refresh); }
+		const UnitTypes& GetUnitTypeData(bool force_refresh = false) const override { return observation_->GetUnitTypeData(force_refresh); }
+		const Upgrades& GetUpgradeData(bool force_refresh = false) const override { return observation_->GetUpgradeData(force_refresh); }
+		const Buffs& GetBuffData(bool force_refresh = false) const override { return observation_->GetBuffData(force_refresh); }
+		const GameInfo& GetGameInfo() const override { return observation_->GetGameInfo(); }
+		int32_t GetMinerals() const override { return observation_->GetMinerals(); }
+		int32_t GetVespene() const override { return observation_->GetVespene(); }
+		int32_t GetFoodCap() const override { return observation_->GetFoodCap(); }
+		int32_t GetFoodUsed() const override { return observation_->GetFoodUsed(); }
+		int32_t GetFoodArmy() const override { return observation_->GetFoodArmy(); }
+		int32_t GetFoodWorkers() const override { return observation_->GetFoodWorkers(); }
+		int32_t GetIdleWorkerCount() const override { return observation_->GetIdleWorkerCount(); }
+		int32_t GetArmyCount() const override { return observation_->GetArmyCount(); }
+		int32_t GetWarpGateCount() const override { return observation_->GetWarpGateCount(); }
+		Point2D GetCameraPos() const override { return observation_->GetCameraPos(); }
+		Point3D GetStartLocation() const override { return observation_->GetStartLocation(); }
+		const std::vector<PlayerResult>& GetResults() const override { return observation_->GetResults(); }
+		bool HasCreep(const Point2D& point) const override { return observation_->HasCreep(point); }
+		Visibility GetVisibility(const Point2D& point) const override { return observation_->GetVisibility(point); }
+		bool IsPathable(const Point2D& point) const override { return observation_->IsPathable(point); }
+		bool IsPlacable(const Point2D& point) const override { return observation_->IsPlacable(point); }
+		float TerrainHeight(const Point2D& point) const override { return observation_->TerrainHeight(point); }
+		const SC2APIProtocol::Observation* GetRawObservation() const override { return observation_->GetRawObservation(); }
+
+		// Not present in every API release, see headless/headless_game.h. Forwarded when the wrapped one has them.
+		virtual const std::vector<Effect>& GetEffects() const;
+		virtual const Effects& GetEffectData(bool force_refresh = false) const;
+		virtual int32_t GetLarvaCount() const;
+
+	private:
+		const ObservationInterface* observation_;
+		ApiCounters& counters_;
+	};
+
+	class CountedActions : public ActionInterface
+	{
+	public:
+		CountedActions(ActionInterface* actions, ApiCounters& counters) :
+			actions_(actions), counters_(counters)
+		{
+		}
+
+		void UnitCommand(const Unit* unit, AbilityID ability, bool queued_command = false) override;
+		void UnitCommand(const Unit* unit, AbilityID ability, const Point2D& point, bool queued_command = false) override;
+		void UnitCommand(const Unit* unit, AbilityID ability, const Unit* target, bool queued_command = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, bool queued_move = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, const Point2D& point, bool queued_command = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, const Unit* target, bool queued_command = false) override;
+
+		const std::vector<Tag>& Commands() const override { return actions_->Commands(); }
+		void ToggleAutocast(Tag unit_tag, AbilityID ability) override { actions_->ToggleAutocast(unit_tag, ability); }
+		void ToggleAutocast(const std::vector<Tag>& unit_tags, AbilityID ability) override { actions_->ToggleAutocast(unit_tags, ability); }
+		void SendChat(const std::string& message, ChatChannel channel = ChatChannel::All) override { actions_->SendChat(message, channel); }
+		void SendActions() override { actions_->SendActions(); }
+
+	private:
+		ActionInterface* actions_;
+		ApiCounters& counters_;
+	};
+
+	class CountedQuery : public QueryInterface
+	{
+	public:
+		CountedQuery(QueryInterface* query, ApiCounters& counters) :
+			query_(query), counters_(counters)
+		{
+		}
+
+		AvailableAbilities GetAbilitiesForUnit(const Unit* unit, bool ignore_resource_requirements = false) override;
+		std::vector<AvailableAbilities> GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements = false) override;
+		float PathingDistance(const Point2D& start, const Point2D& end) override;
+		float PathingDistance(const Unit* start, const Point2D& end) override;
+		std::vector<float> PathingDistance(const std::vector<PathingQuery>& queries) override;
+		bool Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* unit = nullptr) override;
+		std::vector<bool> Placement(const std::vector<PlacementQuery>& queries) override;
+
+	private:
+		QueryInterface* query_;
+		ApiCounters& counters_;
+	};
+}
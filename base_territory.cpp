@@ -0,0 +1,134 @@
+#include "base_territory.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+namespace sc2
+{
+	void BaseTerritoryMap::Init(int map_width, int map_height, float radius, float cell_size)
+	{
+		cell_size_ = cell_size;
+		radius_ = radius;
+		width_ = static_cast<int>(ceil(map_width / cell_size));
+		height_ = static_cast<int>(ceil(map_height / cell_size));
+		cells_.assign(width_ * height_, { no_base, 255, Outside });
+		dirty_ = true;
+	}
+
+	void BaseTerritoryMap::Rebuild(const Units& town_halls)
+	{
+		dirty_ = false;
+		base_positions_.clear();
+		base_tags_.clear();
+		for (const Unit* town_hall : town_halls)
+		{
+			// Cells only have room for 254 base indices, which is far more than we will ever own.
+			if (base_tags_.size() >= no_base)
+			{
+				break;
+			}
+			base_positions_.push_back(town_hall->pos);
+			base_tags_.push_back(town_hall->tag);
+		}
+
+		// Any point in a cell is within half a diagonal of the cell centre.
+		float half_diagonal = cell_size_ * 0.7072f;
+
+		for (int y = 0; y < height_; y++)
+		{
+			for (int x = 0; x < width_; x++)
+			{
+				Point2D centre((x + 0.5f) * cell_size_, (y + 0.5f) * cell_size_);
+				Cell& cell = cells_[y * width_ + x];
+				cell = { no_base, 255, Outside };
+
+				float nearest_distance = std::numeric_limits<float>::max();
+				for (size_t i = 0; i < base_positions_.size(); i++)
+				{
+					float distance = Distance2D(centre, base_positions_[i]);
+					if (distance < nearest_distance)
+					{
+						nearest_distance = distance;
+						cell.nearest = static_cast<uint8_t>(i);
+					}
+				}
+
+				if (cell.nearest == no_base)
+				{
+					continue;
+				}
+
+				cell.distance = static_cast<uint8_t>(std::min(nearest_distance, 255.0f));
+				if (nearest_distance + half_diagonal < radius_)
+				{
+					cell.membership = Inside;
+				}
+				else if (nearest_distance - half_diagonal < radius_)
+				{
+					cell.membership = Boundary;
+				}
+			}
+		}
+	}
+
+	bool BaseTerritoryMap::IsNear(const Point2D& point) const
+	{
+		const Cell* cell = CellAt(point);
+		if (cell == nullptr)
+		{
+			return IsNearExact(point);
+		}
+
+		switch (cell->membership)
+		{
+		case Inside: return true;
+		case Outside: return false;
+		default: return IsNearExact(point);
+		}
+	}
+
+	Tag BaseTerritoryMap::NearestBase(const Point2D& point) const
+	{
+		const Cell* cell = CellAt(point);
+		if (cell == nullptr || cell->nearest == no_base)
+		{
+			return NullTag;
+		}
+		return base_tags_[cell->nearest];
+	}
+
+	uint8_t BaseTerritoryMap::DistanceBand(const Point2D& point) const
+	{
+		const Cell* cell = CellAt(point);
+		return cell == nullptr ? 255 : cell->distance;
+	}
+
+	const BaseTerritoryMap::Cell* BaseTerritoryMap::CellAt(const Point2D& point) const
+	{
+		if (point.x < 0 || point.y < 0)
+		{
+			return nullptr;
+		}
+
+		int x = static_cast<int>(point.x / cell_size_);
+		int y = static_cast<int>(point.y / cell_size_);
+		if (x >= width_ || y >= height_)
+		{
+			return nullptr;
+		}
+		return &cells_[y * width_ + x];
+	}
+
+	bool BaseTerritoryMap::IsNearExact(const Point2D& point) const
+	{
+		for (const Point2D& base : base_positions_)
+		{
+			if (Distance2D(point, base) < radius_)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Coarse raster of the map recording, per cell, the nearest of our town halls and whether the
+	// cell lies within a fixed radius of any of them. Only rebuilt when the set of town halls changes.
+	class BaseTerritoryMap
+	{
+	public:
+		void Init(int map_width, int map_height, float radius, float cell_size = 2.0f);
+
+		void Rebuild(const Units& town_halls);
+
+		// True if point is strictly within radius of any town hall given to the last Rebuild.
+		bool IsNear(const Point2D& point) const;
+
+		// Nearest town hall to the point's cell, or NullTag if there are none.
+		Tag NearestBase(const Point2D& point) const;
+
+		// Distance from the cell centre to its nearest town hall, clamped to 255.
+		uint8_t DistanceBand(const Point2D& point) const;
+
+		void MarkDirty() { dirty_ = true; }
+		bool IsDirty() const { return dirty_; }
+
+	private:
+		enum Membership : uint8_t { Inside, Boundary, Outside };
+
+		struct Cell
+		{
+			uint8_t nearest;
+			uint8_t distance;
+			uint8_t membership;
+		};
+
+		static const uint8_t no_base = 255;
+
+		const Cell* CellAt(const Point2D& point) const;
+		bool IsNearExact(const Point2D& point) const;
+
+		int width_ = 0;
+		int height_ = 0;
+		float cell_size_ = 2.0f;
+		float radius_ = 0.0f;
+		bool dirty_ = true;
+
+		std::vector<Cell> cells_;
+		std::vector<Point2D> base_positions_;
+		std::vector<Tag> base_tags_;
+	};
+}
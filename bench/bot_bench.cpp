@@ -0,0 +1,243 @@
+// Times Bot's hot functions against synthetic HeadlessGame populations of increasing size.
+// Reports ns and heap allocations per call at each size, and the scaling exponent fitted across sizes
+// (1 is linear in unit count, 2 quadratic).
+// Usage: bot_bench [--seed S] [--min-ms M] [--sizes 50,200,500,2000]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bot_examples.h"
+#include "headless/bot_hooks.h"
+#include "headless/headless_game.h"
+#include "utils.h"
+
+using namespace sc2;
+
+// Every heap allocation in the process goes through here, so a run's allocation count is the difference
+// of the counter before and after it.
+namespace
+{
+	size_t allocation_count = 0;
+}
+
+void* operator new(size_t size)
+{
+	allocation_count++;
+	void* memory = malloc(size ? size : 1);
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+namespace
+{
+	struct Measurement
+	{
+		double ns_per_call = 0.0;
+		double allocations_per_call = 0.0;
+	};
+
+	size_t Share(size_t total, size_t percent)
+	{
+		return std::max<size_t>(1, total * percent / 100);
+	}
+
+	// Roughly a mid-game fight at our natural: our army and workers around the main, a Zerg army close
+	// enough to trigger defense and siege checks. About 55% of the units are ours.
+	void Populate(HeadlessGame& game, size_t units)
+	{
+		Point2D base = game.GetStartLocation();
+		Point2D army(base.x + 10.0f, base.y + 10.0f);
+		Point2D enemy(base.x + 14.0f, base.y + 14.0f);
+		float spread = 8.0f + 0.3f * std::sqrt(static_cast<float>(units));
+
+		game.AddUnits(UNIT_TYPEID::TERRAN_SCV, Unit::Alliance::Self, Share(units, 15), base, 6.0f);
+		game.AddUnits(UNIT_TYPEID::TERRAN_MARINE, Unit::Alliance::Self, Share(units, 20), army, spread);
+		game.AddUnits(UNIT_TYPEID::TERRAN_MARAUDER, Unit::Alliance::Self, Share(units, 10), army, spread);
+		game.AddUnits(UNIT_TYPEID::TERRAN_SIEGETANK, Unit::Alliance::Self, Share(units, 4), army, spread);
+		game.AddUnits(UNIT_TYPEID::TERRAN_SIEGETANKSIEGED, Unit::Alliance::Self, Share(units, 3), army, spread);
+		game.AddUnits(UNIT_TYPEID::TERRAN_VIKINGFIGHTER, Unit::Alliance::Self, Share(units, 2), army, spread);
+		game.AddUnits(UNIT_TYPEID::TERRAN_VIKINGASSAULT, Unit::Alliance::Self, Share(units, 1), army, spread);
+
+		game.AddUnits(UNIT_TYPEID::ZERG_ZERGLING, Unit::Alliance::Enemy, Share(units, 25), enemy, spread);
+		game.AddUnits(UNIT_TYPEID::ZERG_ROACH, Unit::Alliance::Enemy, Share(units, 15), enemy, spread);
+		game.AddUnits(UNIT_TYPEID::ZERG_MUTALISK, Unit::Alliance::Enemy, Share(units, 5), enemy, spread);
+	}
+
+	Measurement Measure(const BotHotPath& path, HeadlessGame& game, double min_ms)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		// Warm up caches and let the containers the path touches reach their working size.
+		for (int i = 0; i < 3; i++)
+		{
+			path.run();
+			game.DropCommands();
+		}
+
+		// Grow the batch until one takes min_ms, then keep the median of five batches.
+		size_t iterations = 1;
+		std::vector<Measurement> batches;
+		while (batches.size() < 5)
+		{
+			size_t allocations_before = allocation_count;
+			Clock::time_point start = Clock::now();
+			for (size_t i = 0; i < iterations; i++)
+			{
+				path.run();
+				game.DropCommands();
+			}
+			double elapsed_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			size_t allocations = allocation_count - allocations_before;
+
+			if (elapsed_ms < min_ms && batches.empty())
+			{
+				iterations *= 2;
+				continue;
+			}
+			batches.push_back({ elapsed_ms * 1e6 / iterations, static_cast<double>(allocations) / iterations });
+		}
+
+		std::sort(batches.begin(), batches.end(), [](const Measurement& a, const Measurement& b) {
+			return a.ns_per_call < b.ns_per_call;
+		});
+		return batches[batches.size() / 2];
+	}
+
+	// Least squares slope of log(time) against log(units).
+	double ScalingExponent(const std::vector<size_t>& sizes, const std::vector<Measurement>& measurements)
+	{
+		size_t n = sizes.size();
+		if (n < 2)
+		{
+			return 0.0;
+		}
+
+		double sum_x = 0.0, sum_y = 0.0, sum_xx = 0.0, sum_xy = 0.0;
+		for (size_t i = 0; i < n; i++)
+		{
+			double x = std::log(static_cast<double>(sizes[i]));
+			double y = std::log(std::max(measurements[i].ns_per_call, 1e-3));
+			sum_x += x;
+			sum_y += y;
+			sum_xx += x * x;
+			sum_xy += x * y;
+		}
+		double denominator = n * sum_xx - sum_x * sum_x;
+		return denominator != 0.0 ? (n * sum_xy - sum_x * sum_y) / denominator : 0.0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t seed = 1;
+	double min_ms = 20.0;
+	std::vector<size_t> sizes = { 50, 200, 500, 2000 };
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (!strcmp(argv[i], "--seed") && has_value)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (!strcmp(argv[i], "--min-ms") && has_value)
+		{
+			min_ms = atof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--sizes") && has_value)
+		{
+			sizes.clear();
+			std::stringstream list(argv[++i]);
+			std::string size;
+			while (std::getline(list, size, ','))
+			{
+				sizes.push_back(strtoul(size.c_str(), nullptr, 10));
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--seed S] [--min-ms M] [--sizes 50,200,500,2000]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// results[path][size]
+	std::vector<std::string> names;
+	std::vector<std::vector<Measurement>> results;
+	std::vector<size_t> observed_units;
+
+	for (size_t size : sizes)
+	{
+		// A fresh game and bot per size, populated and stepped once so the bot has seen the units arrive.
+		HeadlessGame game(seed);
+		setRandomSeed(seed);
+		std::unique_ptr<MultiplayerBot> bot(CreateBot());
+		bot->SetInterfaces(&game, &game, &game);
+		bot->OnGameStart();
+
+		Populate(game, size);
+		game.Step();
+		game.DispatchEvents(*bot);
+		observed_units.push_back(game.GetUnits().size());
+
+		std::vector<BotHotPath> paths = BotHotPaths(bot.get());
+		if (names.empty())
+		{
+			for (const BotHotPath& path : paths)
+			{
+				names.push_back(path.name);
+			}
+			results.resize(paths.size());
+		}
+
+		for (size_t p = 0; p < paths.size(); p++)
+		{
+			results[p].push_back(Measure(paths[p], game, min_ms));
+		}
+	}
+
+	printf("%-30s", "units (observed)");
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		char heading[64];
+		snprintf(heading, sizeof(heading), "%zu (%zu)", sizes[i], observed_units[i]);
+		printf("%24s", heading);
+	}
+	printf("%10s\n", "exponent");
+
+	for (size_t p = 0; p < names.size(); p++)
+	{
+		printf("%-30s", names[p].c_str());
+		for (const Measurement& measurement : results[p])
+		{
+			char cell[64];
+			snprintf(cell, sizeof(cell), "%.0f ns %.1f alloc", measurement.ns_per_call, measurement.allocations_per_call);
+			printf("%24s", cell);
+		}
+		printf("%10.2f\n", ScalingExponent(sizes, results[p]));
+	}
+
+	return 0;
+}
@@ -0,0 +1,742 @@
+// Checks the bot's own containers against brute-force versions of them on random input.
+// Each check feeds the same stream of random operations to both and compares them after every one.
+// Prints a line per check and exits with 1 if any of them found a mismatch.
+// Usage: bot_check [--seed S]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "enemy_composition.h"
+#include "enemy_memory.h"
+#include "grid_pathfinder.h"
+#include "scouting_coverage.h"
+#include "utils.h"
+
+using namespace sc2;
+
+namespace
+{
+	struct Result
+	{
+		const char* name;
+		size_t operations;
+		size_t mismatches;
+	};
+
+	// EnemyMemory against std::unordered_map: updates (some as snapshots), removals, and evictions from a table
+	// with fewer slots than there are tags. Every operation gets a loop of its own, so the unit seen longest ago
+	// is never a tie.
+	Result CheckEnemyMemory(uint32_t seed)
+	{
+		struct Expected
+		{
+			UnitTypeID unit_type;
+			Point2D pos;
+			float health;
+			uint32_t last_seen;
+			bool structure;
+			bool snapshot;
+		};
+
+		const size_t capacity = 64;
+		const size_t operations = 200000;
+		const UNIT_TYPEID unit_types[] = { UNIT_TYPEID::ZERG_ZERGLING, UNIT_TYPEID::ZERG_ROACH, UNIT_TYPEID::ZERG_DRONE,
+			UNIT_TYPEID::ZERG_HATCHERY };
+
+		std::mt19937 generator(seed);
+
+		// Half the tags count up like the game's, half are random, so both short and long probe runs come up.
+		std::vector<Tag> tags;
+		for (size_t i = 0; i < capacity * 3 / 2; i++)
+		{
+			tags.push_back(0x100000001ull + i);
+			tags.push_back((static_cast<Tag>(generator()) << 32) | generator());
+		}
+
+		EnemyMemory memory;
+		memory.Init(capacity, 1000);
+		std::unordered_map<Tag, Expected> expected;
+		size_t mismatches = 0;
+
+		for (uint32_t loop = 1; loop <= operations; loop++)
+		{
+			Tag tag = tags[generator() % tags.size()];
+			if (generator() % 4 == 0)
+			{
+				memory.Remove(tag);
+				expected.erase(tag);
+				mismatches += memory.Find(tag) != nullptr;
+			}
+			else
+			{
+				Unit unit;
+				unit.tag = tag;
+				unit.unit_type = unit_types[generator() % 4];
+				unit.pos = Point2D(static_cast<float>(generator() % 200), static_cast<float>(generator() % 200));
+				unit.health = static_cast<float>(generator() % 100);
+				unit.display_type = generator() % 4 == 0 ? Unit::DisplayType::Snapshot : Unit::DisplayType::Visible;
+				bool structure = unit.unit_type == UNIT_TYPEID::ZERG_HATCHERY;
+				memory.Update(&unit, loop, structure);
+
+				auto known = expected.find(tag);
+				if (known == expected.end())
+				{
+					// Full: the unit seen longest ago goes, a structure only if there is nothing else.
+					if (expected.size() >= capacity)
+					{
+						auto oldest = expected.end();
+						for (auto it = expected.begin(); it != expected.end(); ++it)
+						{
+							if (oldest == expected.end() || (it->second.structure != oldest->second.structure ?
+								!it->second.structure : it->second.last_seen < oldest->second.last_seen))
+							{
+								oldest = it;
+							}
+						}
+						expected.erase(oldest);
+					}
+					expected[tag] = { unit.unit_type, unit.pos, unit.health, loop, structure, false };
+					known = expected.find(tag);
+				}
+				else if (unit.display_type != Unit::DisplayType::Snapshot)
+				{
+					known->second.pos = unit.pos;
+					known->second.health = unit.health;
+					known->second.last_seen = loop;
+				}
+				known->second.unit_type = unit.unit_type;
+				known->second.structure = structure;
+				known->second.snapshot = unit.display_type == Unit::DisplayType::Snapshot;
+			}
+
+			mismatches += memory.Size() != expected.size();
+			for (const auto& entry : expected)
+			{
+				const EnemyRecord* record = memory.Find(entry.first);
+				const Expected& want = entry.second;
+				if (record == nullptr || record->tag != entry.first || record->unit_type != want.unit_type ||
+					record->pos.x != want.pos.x || record->pos.y != want.pos.y || record->health != want.health ||
+					record->last_seen != want.last_seen || record->structure != want.structure || record->snapshot != want.snapshot)
+				{
+					mismatches++;
+				}
+			}
+		}
+
+		return { "EnemyMemory", operations, mismatches };
+	}
+
+	// ScoutingCoverage against a plain array of last-seen loops on a random map: sightings, takes and exclusions,
+	// with the oldest cell found by scanning every cell. A cell centre that lies on the edge of a sight circle,
+	// to within float rounding, may go either way, so there the array follows the grid.
+	Result CheckScoutingCoverage(uint32_t seed)
+	{
+		const int width = 120;
+		const int height = 100;
+		const float cell_size = 4.0f;
+		const int columns = 30;
+		const int rows = 25;
+		const uint32_t restamp_loops = 22;
+		const uint32_t operations = 20000;
+
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> along_x(0.0f, static_cast<float>(width));
+		std::uniform_real_distribution<float> along_y(0.0f, static_cast<float>(height));
+		std::uniform_real_distribution<float> sight(0.0f, 12.0f);
+
+		// One cell in five blocked, 8 bits per cell with 0 pathable.
+		ImageData pathing;
+		pathing.width = width;
+		pathing.height = height;
+		pathing.bits_per_pixel = 8;
+		pathing.data.resize(width * height);
+		for (char& cell : pathing.data)
+		{
+			cell = generator() % 5 ? 0 : static_cast<char>(255);
+		}
+		GridPathfinder grid;
+		grid.Init(pathing);
+
+		setRandomSeed(seed);
+		ScoutingCoverage coverage;
+		coverage.Init(grid, cell_size);
+
+		std::vector<uint32_t> last_seen(columns * rows, 0);
+		std::vector<bool> in_heap(columns * rows, false);
+		size_t heap_size = 0;
+		for (int cell = 0; cell < columns * rows; cell++)
+		{
+			in_heap[cell] = grid.IsTerrainPathable(static_cast<int>((cell % columns + 0.5f) * cell_size),
+				static_cast<int>((cell / columns + 0.5f) * cell_size));
+			heap_size += in_heap[cell];
+		}
+
+		auto centre = [&](int cell) {
+			return Point2D((cell % columns + 0.5f) * cell_size, (cell / columns + 0.5f) * cell_size);
+		};
+		auto cell_at = [&](const Point2D& point) {
+			int x = std::min(columns - 1, std::max(0, static_cast<int>(point.x / cell_size)));
+			int y = std::min(rows - 1, std::max(0, static_cast<int>(point.y / cell_size)));
+			return y * columns + x;
+		};
+		auto stamp = [&](int cell, uint32_t loop) {
+			if (last_seen[cell] == 0 || loop - last_seen[cell] >= restamp_loops)
+			{
+				last_seen[cell] = loop;
+			}
+		};
+
+		size_t mismatches = 0;
+		for (uint32_t loop = 1; loop <= operations; loop++)
+		{
+			uint32_t operation = generator() % 200;
+			if (operation < 100)
+			{
+				Point2D point(along_x(generator), along_y(generator));
+				float radius = sight(generator);
+				coverage.See(point, radius, loop);
+
+				std::vector<int> seen(1, cell_at(point));
+				for (int cell = 0; cell < columns * rows; cell++)
+				{
+					double distance = Distance2D(centre(cell), point);
+					if (std::fabs(distance - radius) < 1e-3)
+					{
+						last_seen[cell] = coverage.LastSeen(centre(cell));
+					}
+					else if (distance < radius && cell != seen[0])
+					{
+						seen.push_back(cell);
+					}
+				}
+				for (int cell : seen)
+				{
+					stamp(cell, loop);
+				}
+			}
+			else if (operation < 150 && !coverage.Empty())
+			{
+				int cell = cell_at(coverage.TakeOldest(loop));
+				uint32_t oldest = UINT32_MAX;
+				for (int other = 0; other < columns * rows; other++)
+				{
+					if (in_heap[other])
+					{
+						oldest = std::min(oldest, last_seen[other]);
+					}
+				}
+				mismatches += !in_heap[cell] || last_seen[cell] != oldest;
+				stamp(cell, loop);
+			}
+			else if (operation < 151)
+			{
+				Point2D point(along_x(generator), along_y(generator));
+				coverage.Exclude(point);
+				int cell = cell_at(point);
+				heap_size -= in_heap[cell];
+				in_heap[cell] = false;
+			}
+
+			mismatches += coverage.Empty() != (heap_size == 0);
+			for (int cell = 0; cell < columns * rows; cell++)
+			{
+				mismatches += coverage.LastSeen(centre(cell)) != last_seen[cell];
+			}
+		}
+
+		return { "ScoutingCoverage", operations, mismatches };
+	}
+
+	// GridPathfinder against a plain Dijkstra over the same cells, 8 ways with no diagonal past a blocked corner:
+	// 200 random 64x48 maps with a quarter of the cells blocked, and 50 searches between random open cells per
+	// map while structures are placed and lifted between them. A path must be found exactly when Dijkstra finds one, be as
+	// long as Dijkstra's unless it is a single straight line no longer than that, and no stretch of it may cross a
+	// blocked cell or pass between two blocked cells touching at a corner.
+	Result CheckGridPathfinder(uint32_t seed)
+	{
+		const int width = 64;
+		const int height = 48;
+		const int maps = 200;
+		const int searches = 50;
+		const double tolerance = 1e-3;
+
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> along_x(0.0f, static_cast<float>(width));
+		std::uniform_real_distribution<float> along_y(0.0f, static_cast<float>(height));
+		const float radii[] = { 0.5f, 1.0f, 1.375f, 1.8125f, 2.75f };
+
+		std::vector<bool> open(width * height);
+		std::vector<double> distance(width * height);
+		auto is_open = [&](int x, int y) { return x >= 0 && y >= 0 && x < width && y < height && open[y * width + x]; };
+
+		// Cell centres and the cell edges and corners between them are all whole numbers at twice the scale.
+		auto segment_clear = [&](const Point2D& from, const Point2D& to) {
+			int x0 = static_cast<int>(lround(from.x * 2.0f)), y0 = static_cast<int>(lround(from.y * 2.0f));
+			int x1 = static_cast<int>(lround(to.x * 2.0f)), y1 = static_cast<int>(lround(to.y * 2.0f));
+			int dx = x1 - x0, dy = y1 - y0;
+
+			// Every cell the line passes through, taking one point inside each stretch between edge crossings.
+			std::vector<double> crossings(1, 0.0);
+			crossings.push_back(1.0);
+			for (int x = std::min(x0, x1) + 1; x < std::max(x0, x1); x++)
+			{
+				if (x % 2 == 0)
+				{
+					crossings.push_back(static_cast<double>(x - x0) / dx);
+				}
+			}
+			for (int y = std::min(y0, y1) + 1; y < std::max(y0, y1); y++)
+			{
+				if (y % 2 == 0)
+				{
+					crossings.push_back(static_cast<double>(y - y0) / dy);
+				}
+			}
+			std::sort(crossings.begin(), crossings.end());
+			for (size_t i = 1; i < crossings.size(); i++)
+			{
+				if (crossings[i] - crossings[i - 1] < 1e-9)
+				{
+					continue;
+				}
+				double t = (crossings[i] + crossings[i - 1]) / 2.0;
+				if (!is_open(static_cast<int>(floor((x0 + dx * t) / 2.0)), static_cast<int>(floor((y0 + dy * t) / 2.0))))
+				{
+					return false;
+				}
+			}
+
+			// Every cell corner exactly on the line, the two cells beside it have to be open.
+			if (dx == 0 || dy == 0)
+			{
+				return true;
+			}
+			int steps = std::abs(dx);
+			for (int other = std::abs(dy); other; )
+			{
+				int rest = steps % other;
+				steps = other;
+				other = rest;
+			}
+			int sx = dx > 0 ? 1 : -1, sy = dy > 0 ? 1 : -1;
+			for (int k = 1; k < steps; k++)
+			{
+				int x = x0 + dx / steps * k, y = y0 + dy / steps * k;
+				if (x % 2 == 0 && y % 2 == 0)
+				{
+					int before_x = x / 2 - (sx > 0 ? 1 : 0), after_x = x / 2 - (sx > 0 ? 0 : 1);
+					int before_y = y / 2 - (sy > 0 ? 1 : 0), after_y = y / 2 - (sy > 0 ? 0 : 1);
+					if (!is_open(after_x, before_y) || !is_open(before_x, after_y))
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		};
+
+		size_t mismatches = 0;
+		for (int map = 0; map < maps; map++)
+		{
+			ImageData pathing;
+			pathing.width = width;
+			pathing.height = height;
+			pathing.bits_per_pixel = 8;
+			pathing.data.resize(width * height);
+			for (char& cell : pathing.data)
+			{
+				cell = generator() % 4 ? 0 : static_cast<char>(255);
+			}
+			GridPathfinder grid;
+			grid.Init(pathing);
+			grid.SetSearchBudget(width * height);
+
+			std::vector<Unit> structures(8);
+			std::vector<bool> placed(structures.size(), false);
+			for (size_t i = 0; i < structures.size(); i++)
+			{
+				structures[i].tag = i + 1;
+				structures[i].pos = Point3D(along_x(generator), along_y(generator), 0.0f);
+				structures[i].radius = radii[generator() % 5];
+			}
+
+			std::vector<int> open_cells;
+			for (int search = 0; search < searches; search++)
+			{
+				// Placing and lifting between searches, so the areas have to be relabelled when one splits or joins them.
+				if (search % 5 == 0)
+				{
+					size_t i = generator() % structures.size();
+					if (placed[i])
+					{
+						grid.RemoveStructure(structures[i].tag);
+					}
+					else
+					{
+						grid.AddStructure(&structures[i]);
+					}
+					placed[i] = !placed[i];
+
+					open_cells.clear();
+					for (int cell = 0; cell < width * height; cell++)
+					{
+						open[cell] = grid.IsPathable(Point2D(cell % width + 0.5f, cell / width + 0.5f));
+						if (open[cell])
+						{
+							open_cells.push_back(cell);
+						}
+					}
+				}
+				if (open_cells.empty())
+				{
+					continue;
+				}
+
+				int origin = open_cells[generator() % open_cells.size()];
+				int goal = open_cells[generator() % open_cells.size()];
+				Point2D start(origin % width + 0.5f, origin / width + 0.5f);
+				Point2D end(goal % width + 0.5f, goal / width + 0.5f);
+
+				std::fill(distance.begin(), distance.end(), std::numeric_limits<double>::infinity());
+				std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>, std::greater<std::pair<double, int>>> frontier;
+				distance[origin] = 0.0;
+				frontier.push(std::make_pair(0.0, origin));
+				while (!frontier.empty())
+				{
+					std::pair<double, int> next = frontier.top();
+					frontier.pop();
+					if (next.first > distance[next.second])
+					{
+						continue;
+					}
+					int x = next.second % width, y = next.second / width;
+					for (int dy = -1; dy <= 1; dy++)
+					{
+						for (int dx = -1; dx <= 1; dx++)
+						{
+							if ((!dx && !dy) || !is_open(x + dx, y + dy) || (dx && dy && (!is_open(x + dx, y) || !is_open(x, y + dy))))
+							{
+								continue;
+							}
+							int neighbour = (y + dy) * width + x + dx;
+							double through = next.first + (dx && dy ? sqrt(2.0) : 1.0);
+							if (through < distance[neighbour])
+							{
+								distance[neighbour] = through;
+								frontier.push(std::make_pair(through, neighbour));
+							}
+						}
+					}
+				}
+
+				float length = -1.0f;
+				std::vector<Point2D> waypoints;
+				GridPathfinder::Reach reach = grid.FindPath(start, end, &length, &waypoints);
+				bool reachable = distance[goal] != std::numeric_limits<double>::infinity();
+				if (reach != (reachable ? GridPathfinder::Reach::Reachable : GridPathfinder::Reach::Unreachable))
+				{
+					mismatches++;
+					continue;
+				}
+				if (!reachable)
+				{
+					continue;
+				}
+				if (waypoints.empty() || Distance2D(waypoints.back(), end) != 0.0f)
+				{
+					mismatches++;
+					continue;
+				}
+
+				bool wrong = false;
+				double walked = 0.0;
+				Point2D from = start;
+				for (const Point2D& to : waypoints)
+				{
+					wrong |= !segment_clear(from, to);
+					walked += Distance2D(from, to);
+					from = to;
+				}
+				double wanted = waypoints.size() == 1 ? Distance2D(start, end) : distance[goal];
+				wrong |= std::fabs(length - walked) > tolerance * std::max(1.0, walked);
+				wrong |= std::fabs(length - wanted) > tolerance * std::max(1.0, wanted);
+				wrong |= length > distance[goal] + tolerance * std::max(1.0, distance[goal]);
+				mismatches += wrong;
+			}
+		}
+
+		return { "GridPathfinder", static_cast<size_t>(maps * searches), mismatches };
+	}
+
+	// EnemyComposition against a recount of every unit it should hold, each faded from when it was last seen:
+	// sightings, observations and deaths over 300 tags with room for 200, and a half-life short enough to rebase
+	// every few thousand events. An observation lists units it leaves alone and at most one it counts afresh, so
+	// like every sighting that one gets a loop of its own and the unit seen longest ago is never a tie.
+	Result CheckEnemyComposition(uint32_t seed)
+	{
+		struct Kind
+		{
+			UNIT_TYPEID unit_type;
+			UnitTypeInfo info;
+			bool flying;
+		};
+
+		struct Expected
+		{
+			size_t kind;
+			uint32_t game_loop;
+		};
+
+		const uint32_t half_life = 100;
+		const size_t capacity = 200;
+		const size_t tags = 300;
+		const size_t operations = 300000;
+		const double tolerance = 1e-9;
+
+		auto attribute = [](Attribute attribute) { return 1u << static_cast<uint32_t>(attribute); };
+		std::vector<Kind> kinds(6);
+		kinds[0].unit_type = UNIT_TYPEID::ZERG_ZERGLING;
+		kinds[0].info.food_required = 0.5f;
+		kinds[0].info.attributes = attribute(Attribute::Light);
+		kinds[1].unit_type = UNIT_TYPEID::TERRAN_MARAUDER;
+		kinds[1].info.food_required = 2.0f;
+		kinds[1].info.attributes = attribute(Attribute::Armored);
+		kinds[2].unit_type = UNIT_TYPEID::TERRAN_SCV;
+		kinds[2].info.food_required = 1.0f;
+		kinds[2].info.attributes = attribute(Attribute::Light);
+		kinds[3].unit_type = UNIT_TYPEID::TERRAN_VIKINGFIGHTER;
+		kinds[3].info.food_required = 2.0f;
+		kinds[3].info.attributes = attribute(Attribute::Armored);
+		kinds[3].flying = true;
+		kinds[4].unit_type = UNIT_TYPEID::ZERG_MUTALISK;
+		kinds[4].info.food_required = 2.0f;
+		kinds[4].info.attributes = attribute(Attribute::Light);
+		kinds[4].flying = true;
+		kinds[5].unit_type = UNIT_TYPEID::ZERG_HATCHERY;
+		kinds[5].info.attributes = attribute(Attribute::Armored) | attribute(Attribute::Structure);
+
+		// Observe reads the same entries from a table built from game data.
+		UnitTypes type_data;
+		for (const Kind& kind : kinds)
+		{
+			UnitTypeData data = UnitTypeData();
+			data.unit_type_id = kind.unit_type;
+			data.food_required = kind.info.food_required;
+			for (uint32_t bit = 0; bit < 32; bit++)
+			{
+				if (kind.info.attributes & (1u << bit))
+				{
+					data.attributes.push_back(static_cast<Attribute>(bit));
+				}
+			}
+			type_data.push_back(data);
+		}
+		UnitTypeTable unit_types;
+		unit_types.Build(type_data);
+
+		// Four half-lives, worked out the way EnemyComposition does so the boundary loop agrees.
+		// Units in vision are counted afresh once their count is a second old.
+		double decay_per_loop = log(2.0) / half_life;
+		uint32_t stale_loops = static_cast<uint32_t>(4.0 * log(2.0) / decay_per_loop);
+		const uint32_t refresh_loops = 22;
+
+		std::mt19937 generator(seed);
+		EnemyComposition composition;
+		composition.Init(half_life, capacity);
+		std::unordered_map<Tag, Expected> expected;
+		size_t mismatches = 0;
+		uint32_t game_loop = 0;
+
+		auto differs = [&](double actual, double wanted) {
+			return std::fabs(actual - wanted) > tolerance * std::max(1.0, std::fabs(wanted));
+		};
+
+		auto make_unit = [&](Tag tag, size_t kind) {
+			Unit unit;
+			unit.tag = tag;
+			unit.unit_type = kinds[kind].unit_type;
+			unit.is_flying = kinds[kind].flying;
+			unit.display_type = Unit::DisplayType::Visible;
+			return unit;
+		};
+		auto sighted = [&](Tag tag, size_t kind) {
+			if (kinds[kind].info.HasAttribute(Attribute::Structure))
+			{
+				return;
+			}
+
+			// Full: everything stale goes, or failing that the unit seen longest ago.
+			if (expected.erase(tag) == 0 && expected.size() >= capacity)
+			{
+				auto oldest = expected.end();
+				for (auto it = expected.begin(); it != expected.end();)
+				{
+					if (game_loop - it->second.game_loop > stale_loops)
+					{
+						it = expected.erase(it);
+						continue;
+					}
+					if (oldest == expected.end() || it->second.game_loop < oldest->second.game_loop)
+					{
+						oldest = it;
+					}
+					++it;
+				}
+				if (expected.size() >= capacity)
+				{
+					expected.erase(oldest);
+				}
+			}
+			expected[tag] = { kind, game_loop };
+		};
+
+		for (size_t operation = 1; operation <= operations; operation++)
+		{
+			game_loop += 1 + generator() % 3;
+			Tag tag = 1 + generator() % tags;
+			uint32_t operation_kind = generator() % 3;
+			if (operation_kind == 0)
+			{
+				composition.OnDestroyed(tag);
+				expected.erase(tag);
+			}
+			else if (operation_kind == 1)
+			{
+				size_t kind = generator() % kinds.size();
+				Unit unit = make_unit(tag, kind);
+				composition.OnEnterVision(&unit, game_loop, kinds[kind].info);
+				sighted(tag, kind);
+			}
+			else
+			{
+				// Snapshots, structures and units counted less than a second ago are left as they are.
+				std::vector<Unit> seen;
+				std::vector<Tag> listed;
+				size_t recounts = 0;
+				for (int i = 0; i < 8; i++)
+				{
+					Tag other = 1 + generator() % tags;
+					size_t kind = generator() % kinds.size();
+					Unit unit = make_unit(other, kind);
+					if (generator() % 4 == 0)
+					{
+						unit.display_type = Unit::DisplayType::Snapshot;
+					}
+					auto known = expected.find(other);
+					bool recount = unit.display_type == Unit::DisplayType::Visible && !kinds[kind].info.HasAttribute(Attribute::Structure) &&
+						(known == expected.end() || game_loop - known->second.game_loop >= refresh_loops);
+					if (std::find(listed.begin(), listed.end(), other) != listed.end() || (recount && recounts > 0))
+					{
+						continue;
+					}
+					listed.push_back(other);
+					seen.push_back(unit);
+					if (recount)
+					{
+						recounts++;
+						sighted(other, kind);
+					}
+				}
+				Units units;
+				for (const Unit& unit : seen)
+				{
+					units.push_back(&unit);
+				}
+				composition.Observe(units, game_loop, unit_types);
+			}
+
+			if (operation % 100 != 0)
+			{
+				continue;
+			}
+
+			std::vector<double> counts(kinds.size(), 0.0);
+			double army = 0.0, air = 0.0, armored = 0.0, light = 0.0;
+			size_t army_units = 0;
+			for (const auto& entry : expected)
+			{
+				const Kind& kind = kinds[entry.second.kind];
+				double weight = exp(-decay_per_loop * (game_loop - entry.second.game_loop));
+				counts[entry.second.kind] += weight;
+				if (kind.unit_type == UNIT_TYPEID::TERRAN_SCV)
+				{
+					continue;
+				}
+				double supply = weight * kind.info.food_required;
+				army_units++;
+				army += supply;
+				air += kind.flying ? supply : 0.0;
+				armored += kind.info.HasAttribute(Attribute::Armored) ? supply : 0.0;
+				light += kind.info.HasAttribute(Attribute::Light) ? supply : 0.0;
+			}
+
+			mismatches += composition.Size() != expected.size();
+			for (size_t kind = 0; kind < kinds.size(); kind++)
+			{
+				mismatches += differs(composition.Count(kinds[kind].unit_type, game_loop), counts[kind]);
+			}
+			if (army_units == 0)
+			{
+				// Nothing left to fade, the totals must be exactly empty rather than rounding.
+				mismatches += composition.ArmySupply(game_loop) != 0.0 || composition.AirShare() != 0.0 ||
+					composition.ArmoredShare() != 0.0 || composition.LightShare() != 0.0;
+				continue;
+			}
+			mismatches += differs(composition.ArmySupply(game_loop), army);
+			mismatches += differs(composition.AirShare(), air / army);
+			mismatches += differs(composition.ArmoredShare(), armored / army);
+			mismatches += differs(composition.LightShare(), light / army);
+		}
+
+		// Then every unit dies, after hundreds of thousands of additions and removals the totals are still exactly empty.
+		for (Tag tag = 1; tag <= tags; tag++)
+		{
+			composition.OnDestroyed(tag);
+		}
+		mismatches += composition.Size() != 0 || composition.ArmySupply(game_loop) != 0.0 || composition.AirShare() != 0.0 ||
+			composition.ArmoredShare() != 0.0 || composition.LightShare() != 0.0;
+
+		return { "EnemyComposition", operations, mismatches };
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (!strcmp(argv[i], "--seed") && has_value)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--seed S]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<Result> results;
+	results.push_back(CheckEnemyMemory(seed));
+	results.push_back(CheckScoutingCoverage(seed));
+	results.push_back(CheckGridPathfinder(seed));
+	results.push_back(CheckEnemyComposition(seed));
+
+	bool failed = false;
+	for (const Result& result : results)
+	{
+		printf("%-20s%10zu operations%10zu mismatches\n", result.name, result.operations, result.mismatches);
+		failed |= result.mismatches > 0;
+	}
+	return failed ? 1 : 0;
+}
@@ -1,14 +1,32 @@
 #include <sc2api/sc2_api.h>
 
 #include <iostream>
-#include <queue>
 #include <algorithm>
 #include <math.h>
+#include <memory>
 #include <random>
 
+#include "action_batcher.h"
+#include "base_territory.h"
 #include "bot_examples.h"
+#include "construction_registry.h"
+#include "enemy_composition.h"
+#include "enemy_memory.h"
+#include "latency_histogram.h"
+#include "observation_recorder.h"
+#include "scouting_coverage.h"
+#include "sighting_buffer.h"
+#include "sighting_heatmap.h"
+#include "spatial_grid.h"
+#include "task_scheduler.h"
+#include "traced_query.h"
+#include "unit_index.h"
 #include "utils.h"
 
+#ifdef BOT_HEADLESS
+#include "headless/bot_hooks.h"
+#endif
+
 using namespace sc2;
 
 
@@ -30,20 +48,13 @@ struct IsTownHall {
 };
 
 struct IsStructure {
-	IsStructure(const ObservationInterface* obs) : observation_(obs) {};
+	IsStructure(const UnitTypeTable& unit_types) : unit_types_(unit_types) {};
 
 	bool operator()(const Unit& unit) {
-		auto& attributes = observation_->GetUnitTypeData().at(unit.unit_type).attributes;
-		bool is_structure = false;
-		for (const auto& attribute : attributes) {
-			if (attribute == Attribute::Structure) {
-				is_structure = true;
-			}
-		}
-		return is_structure;
+		return unit_types_.IsStructure(unit.unit_type);
 	}
 
-	const ObservationInterface* observation_;
+	const UnitTypeTable& unit_types_;
 };
 
 
@@ -55,107 +66,460 @@ private: // Bot Global Variables
 	size_t step_count = 0;
 
 	int target_worker_count;
-	double marine_to_maruader_ratio = 2.7; // Used By Barracks To Determine What To Produce
-
-
-	// Queue of Enemy Sightings - Flushed Periodically
-	std::queue<Point2D> enemy_unit_locations;
+	double marine_to_maruader_ratio = 2.7; // Used By Barracks To Determine What To Produce, Before The Enemy Army Is Known
+
+	// What The Enemy Army Is Made Of, From Vision And Death Events - Production And Siege Adapt To It
+	EnemyComposition enemy_composition_;
+	const uint32_t composition_half_life = 2688;  // Game loops, two minutes
+	const size_t composition_capacity = 1024;
+	const double min_known_army_supply = 8.0;     // Below this the estimate is too thin to act on
+
+	// Enemy Units By Tag, Remembered After They Leave Vision - Brought Up To Date Every Step
+	EnemyMemory enemy_memory_;
+	const size_t enemy_memory_capacity = 1024;
+	const uint32_t enemy_forget_after = 2688; // Game loops, two minutes
+
+	// Where Enemies Were Seen, Fading With Time - Attack Targets Are Drawn From It
+	SightingHeatmap enemy_sightings_;
+	const float sighting_cell_size = 8.0f;
+	const uint32_t sighting_half_life = 720; // Game loops, about what the old flush of 90% every 2400 steps kept
+	const double min_sighting_weight = 0.1;  // Below this the sightings are too old to attack
+
+	// When Each Part Of The Map Was Last In Our Sight - Late Game Scouts Go Where It Is Oldest
+	ScoutingCoverage scouting_coverage_;
+	const float scouting_cell_size = 4.0f;
+	const int scout_target_attempts = 4; // Unreachable targets are dropped and the next oldest tried
+
+	// Sightings From Events Merge Here First - A Cell Seen Again Within The Window Only Adds Weight
+	SightingBuffer sighting_buffer_;
+	const size_t sighting_buffer_capacity = 256;
+	const uint32_t sighting_merge_window = 112; // Game loops, five seconds
 
     // Enemy unit quantity threshold for siege mode
-    int siege_threshold = 5;
+    size_t siege_threshold = 5;
 
     // Enemy Base Location
     Point2D enemy_base_loc;
     bool found_enemy_base = false;
 
+	// Per-Step Index Of Observed Units - Read Through Index()
+	UnitIndex unit_index_;
+	size_t town_hall_group_;
+	size_t barracks_group_;
+	size_t factory_group_;
+	size_t starport_group_;
+
+	// Spatial Hash Of Enemy Positions - Read Through EnemyGrid()
+	SpatialGrid enemy_grid_;
+	uint32_t enemy_grid_loop_ = 0;
+	bool enemy_grid_built_ = false;
+
+	// Raster Of Cells Within Base Radius Of Our Town Halls - Read Through BaseTerritory()
+	BaseTerritoryMap base_territory_;
+	size_t town_hall_signature_ = 0;
+	const float base_radius = 25.0f; // Temporary value until something more accurate can be found.
+
+	// Build Orders Issued Whose Structure Has Not Appeared Yet
+	ConstructionRegistry construction_;
+	const uint32_t construction_timeout = 1000; // Game loops, ~45 seconds
+	const int placement_attempts = 8;           // Random spots tried per structure before waiting for the next step
+
+	// Runs The Managers Below, Keeping Each Step Inside A Time Budget
+	TaskScheduler scheduler_;
+	const double step_budget_ms = 10.0; // Realtime games get ~44ms per game loop, leave most of it to the engine
+
+	// This Step's Unit Commands, Sent As Multi-Unit Commands At The End Of OnStep
+	ActionBatcher action_batch_;
+
+	// Event Handler Timings By Game Phase, Reported With The Manager Timings At Game End
+	static const size_t game_phases = 3;
+	const char* game_phase_names[game_phases] = { "early", "mid", "late" };
+	LatencyHistogram on_unit_idle_latency_[game_phases];
+	LatencyHistogram on_unit_enter_vision_latency_[game_phases];
+
+	// Opt-In Trace Of Steps, Managers, Events And Queries - Enabled By Setting BOT_TRACE To An Output Path
+	TraceWriter tracer_;
+	std::unique_ptr<TracedQuery> traced_query_;
+
+	// Every Observation, Action And Query Call Goes Through These, Counted Into api_counters_ By Call Site
+	std::unique_ptr<CountedObservation> counted_observation_;
+	std::unique_ptr<CountedActions> counted_actions_;
+	std::unique_ptr<CountedQuery> counted_query_;
+
+	// Opt-In Recording Of What The Bot Sees, For Offline Replays - Enabled By Setting BOT_RECORD To An Output Path
+	ObservationRecorder recorder_;
+	std::unique_ptr<RecordingObservation> recording_observation_;
+	std::unique_ptr<RecordingQuery> recording_query_;
+
 	// Constants Inherited
 	// staging_location_ : Point2D location used for rallying created troops
 
 public: // Public Functions Of Bot - On Event Handles Provided By Interface
 
 	virtual void OnGameStart() final {
+		// Restart The Random Sequence, A Replay Sets The Recorded Seed Before Calling Us
+		setRandomSeed(randomSeed());
+
+		// Start Recording Before Setup, Setup's Queries Have To Be In The Recording Too, Map Cache Or Not
+		std::string record_path;
+		if (getEnvironment("BOT_RECORD", record_path) && recorder_.Open(record_path, Observation(), randomSeed()))
+		{
+			recording_observation_.reset(new RecordingObservation(Observation(), recorder_));
+			recording_query_.reset(new RecordingQuery(Query(), recorder_));
+			SetInterfaces(recording_observation_.get(), Actions(), recording_query_.get());
+			DisableMapCache();
+			PrintStatus("recording to " + record_path);
+		}
+
 		// Call Setup Function of Multiplayer Bot -  Sets up Many Helpful constants
 		MultiplayerBot::OnGameStart();
+
+		// Register The Type Groups Managers Ask The Unit Index For
+		town_hall_group_ = unit_index_.AddGroup(town_hall_types);
+		barracks_group_ = unit_index_.AddGroup(barrack_types);
+		factory_group_ = unit_index_.AddGroup(factory_types);
+		starport_group_ = unit_index_.AddGroup(starport_types);
+
+		base_territory_.Init(game_info_.width, game_info_.height, base_radius);
+		enemy_sightings_.Init(game_info_.width, game_info_.height, sighting_cell_size, sighting_half_life);
+		sighting_buffer_.Init(game_info_.width, game_info_.height, sighting_cell_size, sighting_buffer_capacity, sighting_merge_window);
+		enemy_memory_.Init(enemy_memory_capacity, enemy_forget_after);
+		enemy_composition_.Init(composition_half_life, composition_capacity);
+		scouting_coverage_.Init(pathfinder_, scouting_cell_size);
+
+		// Register Managers With The Scheduler
+		// Periods are in steps, priority decides who runs first when a step gets crowded.
+		// The last value is the per-run time budget (ms), runs over it are counted as overruns.
+		scheduler_.SetFrameBudget(step_budget_ms);
+		AddManager("BuildOrder", &Bot::BuildOrder, 3, 3, 2.0);
+		AddManager("ManageWorkers", &Bot::ManageWorkers, 3, 3, 2.0);
+		AddManager("ManageCombatAbilities", &Bot::ManageCombatAbilities, 19, 4, 2.0);
+		AddManager("UpdateScoutingCoverage", &Bot::UpdateScoutingCoverage, 7, 1, 1.0);
+		AddManager("ManageRallyPoints", &Bot::ManageRallyPoints, 103, 1, 1.0);
+		AddManager("ManageDefense", &Bot::ManageDefense, 103, 3, 2.0);
+		AddManager("ManageIdleArmyUnits", &Bot::ManageIdleArmyUnits, 367, 1, 2.0);
+		AddManager("ManageUpgrades", &Bot::ManageUpgrades, 891, 1, 1.0);
+		AddManager("ManageScouts", &Bot::ManageScouts, 1200, 2, 1.0);
+		AddManager("ManageAttack", &Bot::ManageAttack, 1200, 2, 2.0);
+
+		// Start Tracing If Asked To, Queries Go Through A Wrapper That Records Each Call
+		std::string trace_path;
+		if (getEnvironment("BOT_TRACE", trace_path) && tracer_.Open(trace_path))
+		{
+			traced_query_.reset(new TracedQuery(Query(), tracer_));
+			SetInterfaces(Observation(), Actions(), traced_query_.get());
+			scheduler_.SetTracer(&tracer_);
+			PrintStatus("tracing to " + trace_path);
+		}
+
+		// Count API Traffic On Top Of Whatever Interfaces Are In Place (Traced Or Not)
+		counted_observation_.reset(new CountedObservation(Observation(), api_counters_));
+		counted_actions_.reset(new CountedActions(Actions(), api_counters_));
+		counted_query_.reset(new CountedQuery(Query(), api_counters_));
+		SetInterfaces(counted_observation_.get(), counted_actions_.get(), counted_query_.get());
+		action_batch_.SetCounters(&api_counters_);
+
+		// Frame 0 Of The Recording Is What Setup Saw
+		if (recorder_.Enabled())
+		{
+			unit_index_.Update(Observation());
+			recorder_.EndFrame(Observation(), unit_index_.GetUnits());
+		}
 	}
 
-	virtual void OnStep() final {
-		step_count++;
-		const ObservationInterface* observation = Observation();
+	// Registers A Manager With The Scheduler, API Calls Made While It Runs Are Counted Under Its Name
+	void AddManager(const char* name, void (Bot::*manager)(), size_t period, int priority, double budget_ms)
+	{
+		size_t site = api_counters_.Site(name);
+		scheduler_.Add(name, [this, manager, site] {
+			ApiCallSite call_site(api_counters_, site);
+			(this->*manager)();
+		}, period, priority, budget_ms);
+	}
+
+	virtual void OnGameEnd() final {
+		// Report How The Managers Fit Into Their Budgets
+		for (size_t i = 0; i < scheduler_.Size(); i++)
+		{
+			const TaskScheduler::TaskStats& stats = scheduler_.Stats(i);
+			PrintStatus(stats.name + ": runs " + std::to_string(stats.runs) +
+				", overruns " + std::to_string(stats.overruns) +
+				", deferrals " + std::to_string(stats.deferrals) +
+				", avg " + std::to_string(stats.average_ms) + "ms, max " + std::to_string(stats.max_ms) + "ms");
+		}
+		PrintStatus("steps over budget: " + std::to_string(scheduler_.FrameOverruns()));
 
+		// Latency Percentiles By Game Phase As One JSON Line
+		auto phases_json = [this](const LatencyHistogram* histograms) {
+			std::string json = "{";
+			for (size_t phase = 0; phase < game_phases; phase++)
+			{
+				json += std::string(phase ? "," : "") + "\"" + game_phase_names[phase] + "\":" + histograms[phase].ToJson();
+			}
+			return json + "}";
+		};
 
-		// Try To Avoid Doing Too Much Per Step Here
-		// Using Prime Numbers Between 0-1200 (1 In-game minute) to offload some work..
+		std::string json = "{\"managers\":{";
+		for (size_t i = 0; i < scheduler_.Size(); i++)
+		{
+			const TaskScheduler::TaskStats& stats = scheduler_.Stats(i);
+			json += (i ? ",\"" : "\"") + stats.name + "\":" + phases_json(stats.latency);
+		}
+		json += "},\"handlers\":{\"OnUnitIdle\":" + phases_json(on_unit_idle_latency_) +
+			",\"OnUnitEnterVision\":" + phases_json(on_unit_enter_vision_latency_) + "}}";
+		PrintStatus("latency " + json);
 
-		if (step_count % 3 == 0)
+		// API Round Trips And Action Volume By Call Site, Busiest Sites Show Where Batching Pays Off
+		size_t steps = std::max<size_t>(api_counters_.Steps(), 1);
+		for (size_t site = 0; site < api_counters_.Sites(); site++)
 		{
-			BuildOrder();
-			ManageWorkers();
+			const ApiCounters::Counts& total = api_counters_.Total(site);
+			const ApiCounters::Counts& peak = api_counters_.PeakPerStep(site);
+			if (!total.query_round_trips && !total.get_units_calls && !total.unit_commands)
+			{
+				continue;
+			}
+			PrintStatus("api " + api_counters_.SiteName(site) +
+				": queries " + std::to_string(total.query_round_trips) + " (peak " + std::to_string(peak.query_round_trips) + "/step)" +
+				", GetUnits " + std::to_string(total.get_units_calls) + " returning " + std::to_string(total.units_returned) +
+				" units (" + std::to_string(total.units_returned / steps) + "/step)" +
+				", commands " + std::to_string(total.unit_commands) + " for " + std::to_string(total.units_commanded) +
+				" units (peak " + std::to_string(peak.unit_commands) + "/step)");
 		}
 
-        if (step_count % 19 == 0) {
-            ManageCombatAbilities();
-        }
+		// What Batching Saved - Without The Broker Every Check Would Have Been Its Own Round Trip
+		PrintStatus("query broker: " + std::to_string(query_broker_.QueriesSent()) + " checks for " +
+			std::to_string(query_broker_.RequestsAnswered()) + " requests in " + std::to_string(query_broker_.RoundTrips()) + " round trips");
+
+		PrintStatus("pathfinder: searches left to the game " + std::to_string(pathfinder_.Inconclusive()));
+		PrintStatus("placement: spots rejected without a query " + std::to_string(placement_.Rejected()));
+		PrintStatus("sightings: merged " + std::to_string(sighting_buffer_.Merged()) + ", flushed early " + std::to_string(sighting_buffer_.FlushedEarly()));
+		PrintStatus("enemy army: supply " + std::to_string(enemy_composition_.ArmySupply(Observation()->GetGameLoop())) +
+			", air " + std::to_string(enemy_composition_.AirShare()) + ", armored " + std::to_string(enemy_composition_.ArmoredShare()) +
+			", light " + std::to_string(enemy_composition_.LightShare()));
+
+		// The Ring Holds The Last Steps Only, Summed Over All Sites - The Batcher's Calls Apart, They Carry Commands Already Counted
+		size_t flush_site = api_counters_.Site("ActionBatcher::Flush");
+		ApiCounters::Counts recent;
+		ApiCounters::Counts flushed;
+		for (size_t age = 0; age < api_counters_.RecentSteps(); age++)
+		{
+			const std::vector<ApiCounters::Counts>& sites = api_counters_.Recent(age).sites;
+			for (size_t site = 0; site < sites.size(); site++)
+			{
+				(site == flush_site ? flushed : recent).Add(sites[site]);
+			}
+		}
+		PrintStatus("api last " + std::to_string(api_counters_.RecentSteps()) + " steps: queries " +
+			std::to_string(recent.query_round_trips) + ", GetUnits " + std::to_string(recent.get_units_calls) +
+			", commands " + std::to_string(recent.unit_commands) + " sent in " + std::to_string(flushed.unit_commands) + " calls");
 
-		if (step_count % 103 == 0)
+		if (tracer_.Enabled())
 		{
-			ManageRallyPoints();
-			ManageDefense();
+			tracer_.Close();
+			PrintStatus("trace written, spans dropped: " + std::to_string(tracer_.Dropped()));
 		}
 
-		if (step_count % 367 == 0)
+		if (recorder_.Enabled())
 		{
-			ManageIdleArmyUnits();
+			recorder_.Close();
+			PrintStatus("recording written: " + std::to_string(recorder_.Frames()) + " frames, " +
+				std::to_string(recorder_.BytesWritten()) + " bytes");
 		}
-		
+	}
 
-		if (step_count % 891 == 0)
+	// Early Game Is The First Six Minutes, Late Game After Fifteen - The Same Marks The Managers Use
+	size_t GamePhase() const
+	{
+		if (step_count <= 1200 * 6)
 		{
-			ManageUpgrades();
+			return 0;
 		}
+		return step_count < 1200 * 15 ? 1 : 2;
+	}
+
+	virtual void OnStep() final {
+		TraceSpan trace(tracer_, "OnStep", TraceWriter::Category::Step);
+		step_count++;
+		const ObservationInterface* observation = Observation();
+
+		// Build The Unit Index Once Up Front, Every Manager Below Reads From It
+		{
+			ApiCallSite call_site(api_counters_, "UnitIndex::Update");
+			unit_index_.Update(observation);
+		}
+		enemy_memory_.Observe(unit_index_.GetUnits(Unit::Enemy), observation->GetGameLoop(), unit_type_table_);
+		enemy_composition_.Observe(unit_index_.GetUnits(Unit::Enemy), observation->GetGameLoop(), unit_type_table_);
+		sighting_buffer_.FlushInto(enemy_sightings_, observation->GetGameLoop());
 
+		// Spans From Here On (And The Next Step's Events) Are Tagged With This Step's State
+		if (tracer_.Enabled())
+		{
+			tracer_.SetContext(observation->GetGameLoop(), static_cast<uint32_t>(unit_index_.GetUnits(Unit::Self).size()),
+				static_cast<uint32_t>(unit_index_.GetUnits(Unit::Enemy).size()));
+		}
 
-		if (step_count % 1200 == 0)
+		// Town Halls Lifting Off Or Flying Do Not Raise Events, Catch Them Here
+		size_t town_hall_signature = TownHallSignature();
+		if (town_hall_signature != town_hall_signature_)
 		{
-			ManageScouts();
-			ManageAttack();
+			town_hall_signature_ = town_hall_signature;
+			base_territory_.MarkDirty();
 		}
 
-		if (step_count % 2400 == 0)
+		// Run Whichever Managers Are Due, Spread Out So No Single Step Goes Over Budget
+		scheduler_.SetPhase(GamePhase());
+		scheduler_.Step(step_count);
+
+		// Answer This Step's Placement And Pathing Checks In One Batch, The Orders Waiting On Them Join The Batch Below
+		FlushQueries();
+
+		// Send Everything The Managers (And The Events Before Them) Ordered This Step
 		{
-			FlushKnownEnemyLocations();
+			ApiCallSite call_site(api_counters_, "ActionBatcher::Flush");
+			action_batch_.Flush(Actions());
 		}
+
+		// Record What This Step Saw, With The Events And Queries That Led Up To It
+		if (recorder_.Enabled())
+		{
+			ApiCallSite call_site(api_counters_, "ObservationRecorder");
+			recorder_.EndFrame(observation, unit_index_.GetUnits());
+		}
+		api_counters_.EndStep(observation->GetGameLoop());
 	}
 
     bool isCloseToBase(const Unit* unit)
     {
-        const ObservationInterface* observation = Observation();
-
-        Units bases = observation->GetUnits(Unit::Self, IsTownHall());
-
         // Check to see if the unit is near any of our bases.
-        for (const Unit* base : bases)
-        {
-            if (Distance2D(unit->pos, base->pos) < 25) // Temporary value until something more accurate can be found.
-            {
-                return true;
-            }
-        }
-        return false;
+        return BaseTerritory().IsNear(unit->pos);
     }
 
+#ifdef BOT_HEADLESS
+	// Replays Run Every Manager When Due, Deferrals Would Depend On How Fast The Machine Is
+	void DisableStepBudget()
+	{
+		scheduler_.SetFrameBudget(std::numeric_limits<double>::infinity());
+	}
+
+	/*
+	Hot Paths
+
+	The Functions The Benchmarks Time In Isolation, See bench/bot_bench.cpp
+
+	- Moves the step count past the six minute mark so ManageAttack does its full work
+	- Each run drops the commands and query checks it queued so repeated runs see the same state
+	*/
+	std::vector<BotHotPath> HotPaths()
+	{
+		step_count = std::max<size_t>(step_count, 1200 * 6 + 1);
+
+		auto hot_path = [this](const std::string& name, std::function<void()> function) {
+			return BotHotPath{ name, [this, function] { function(); action_batch_.Clear(); query_broker_.Clear(); } };
+		};
+
+		// Mineral lookups and paths go to a spread of points, one lookup from one point would only measure a cache hit.
+		Point2D map_min = game_info_.playable_min;
+		Point2D map_max = game_info_.playable_max;
+
+		return {
+			hot_path("ManageDefense", [this] { ManageDefense(); }),
+			hot_path("ManageSiegeOn", [this] { ManageSiegeOn(); }),
+			hot_path("ManageSiegeOff", [this] { ManageSiegeOff(); }),
+			hot_path("ManageVikingAssaultOn", [this] { ManageVikingAssaultOn(); }),
+			hot_path("ManageVikingAssaultOff", [this] { ManageVikingAssaultOff(); }),
+			hot_path("ManageAttack", [this] { ManageAttack(); }),
+			hot_path("BuildOrder", [this] { BuildOrder(); }),
+			hot_path("FindNearestMineralPatch", [this, map_min, map_max, i = size_t(0)]() mutable {
+				i++;
+				float fx = (i * 37 % 101) / 100.0f;
+				float fy = (i * 59 % 103) / 102.0f;
+				FindNearestMineralPatch(Point2D(map_min.x + fx * (map_max.x - map_min.x), map_min.y + fy * (map_max.y - map_min.y)));
+			}),
+			hot_path("GridPathfinder::FindPath", [this, map_min, map_max, path = std::vector<Point2D>(), i = size_t(0)]() mutable {
+				i++;
+				float fx = (i * 37 % 101) / 100.0f;
+				float fy = (i * 59 % 103) / 102.0f;
+				float gx = (i * 71 % 107) / 106.0f;
+				float gy = (i * 13 % 97) / 96.0f;
+				float length;
+				pathfinder_.FindPath(Point2D(map_min.x + gx * (map_max.x - map_min.x), map_min.y + gy * (map_max.y - map_min.y)),
+					Point2D(map_min.x + fx * (map_max.x - map_min.x), map_min.y + fy * (map_max.y - map_min.y)), &length, &path);
+			}),
+			hot_path("PlacementValidator::CanPlace", [this, map_min, map_max, i = size_t(0)]() mutable {
+				i++;
+				float fx = (i * 37 % 101) / 100.0f;
+				float fy = (i * 59 % 103) / 102.0f;
+				placement_.CanPlace(ABILITY_ID::BUILD_BARRACKS, Point2D(map_min.x + fx * (map_max.x - map_min.x), map_min.y + fy * (map_max.y - map_min.y)));
+			}),
+			hot_path("DistanceFields::Distance", [this, map_min, map_max, i = size_t(0)]() mutable {
+				i++;
+				float fx = (i * 37 % 101) / 100.0f;
+				float fy = (i * 59 % 103) / 102.0f;
+				Point2D base = expansions_.empty() ? Point2D(startLocation_) : Point2D(expansions_[i % expansions_.size()]);
+				GroundDistance(base, Point2D(map_min.x + fx * (map_max.x - map_min.x), map_min.y + fy * (map_max.y - map_min.y)));
+			}),
+			hot_path("MultiplayerBot::ManageWorkers", [this] {
+				MultiplayerBot::ManageWorkers(UNIT_TYPEID::TERRAN_SCV, ABILITY_ID::HARVEST_GATHER, UNIT_TYPEID::TERRAN_REFINERY);
+			}),
+		};
+	}
+#endif
+
 	virtual void OnUnitEnterVision(const sc2::Unit *unit)
 	{
-		// On sighting an enemy, record its position in the locations list.
+		ScopedLatency timer(on_unit_enter_vision_latency_[GamePhase()]);
+		TraceSpan trace(tracer_, "OnUnitEnterVision", TraceWriter::Category::Event);
+		ApiCallSite call_site(api_counters_, "OnUnitEnterVision");
+		recorder_.RecordEvent(RecordedEvent::Kind::UnitEnterVision, unit);
+		MultiplayerBot::OnUnitEnterVision(unit);
+
+		if (unit->alliance == Unit::Enemy)
+		{
+			enemy_memory_.Update(unit, Observation()->GetGameLoop(), unit_type_table_.IsStructure(unit->unit_type));
+			enemy_composition_.OnEnterVision(unit, Observation()->GetGameLoop(), unit_type_table_.Get(unit->unit_type));
+		}
+
+		// On sighting an enemy, record its position for the heatmap.
 		if (unit->alliance == Unit::Enemy && !isCloseToBase(unit))
 		{
-			enemy_unit_locations.push(unit->pos);
+			sighting_buffer_.Add(unit->pos, Observation()->GetGameLoop(), enemy_sightings_);
 		}
 	}
 
-	virtual void OnBuildingConstructionComplete(const sc2::Unit* unit) {}
+	virtual void OnBuildingConstructionComplete(const sc2::Unit* unit)
+	{
+		TraceSpan trace(tracer_, "OnBuildingConstructionComplete", TraceWriter::Category::Event);
+		ApiCallSite call_site(api_counters_, "OnBuildingConstructionComplete");
+		recorder_.RecordEvent(RecordedEvent::Kind::BuildingConstructionComplete, unit);
+		MultiplayerBot::OnBuildingConstructionComplete(unit);
+		construction_.OnStructureStarted(unit_type_table_.Get(unit->unit_type).build_ability, unit->pos);
+		construction_.OnStructureFinished(unit->pos);
+
+		if (IsTownHall()(*unit))
+		{
+			base_territory_.MarkDirty();
+		}
+	}
 
 	virtual void OnUnitCreated(const sc2::Unit *unit)
 	{
+		TraceSpan trace(tracer_, "OnUnitCreated", TraceWriter::Category::Event);
+		ApiCallSite call_site(api_counters_, "OnUnitCreated");
+		recorder_.RecordEvent(RecordedEvent::Kind::UnitCreated, unit);
+		MultiplayerBot::OnUnitCreated(unit);
+
+		// Once the structure is placed the unit counts take over from the pending order.
+		if (unit_type_table_.IsStructure(unit->unit_type))
+		{
+			construction_.OnStructureStarted(unit_type_table_.Get(unit->unit_type).build_ability, unit->pos);
+		}
+
+		if (IsTownHall()(*unit))
+		{
+			base_territory_.MarkDirty();
+		}
+
 		// On Construction Of Combat Units, Rally Them To Staging Location.
 		switch (unit->unit_type.ToType())
 		{
@@ -194,6 +558,19 @@ public: // Public Functions Of Bot - On Event Handles Provided By Interface
 
 	virtual void OnUnitDestroyed(const sc2::Unit *unit)
 	{
+		TraceSpan trace(tracer_, "OnUnitDestroyed", TraceWriter::Category::Event);
+		ApiCallSite call_site(api_counters_, "OnUnitDestroyed");
+		recorder_.RecordEvent(RecordedEvent::Kind::UnitDestroyed, unit);
+		MultiplayerBot::OnUnitDestroyed(unit);
+		construction_.OnBuilderLost(unit->tag);
+		enemy_memory_.Remove(unit->tag);
+		enemy_composition_.OnDestroyed(unit->tag);
+
+		if (unit->alliance == Unit::Self && IsTownHall()(*unit))
+		{
+			base_territory_.MarkDirty();
+		}
+
         // Unit could have been killed by something outside its LOS, consider this a hostile location.
         if (!isCloseToBase(unit))
         {
@@ -204,15 +581,25 @@ public: // Public Functions Of Bot - On Event Handles Provided By Interface
             }
             else
             {
-                enemy_unit_locations.push(unit->pos);
+                sighting_buffer_.Add(unit->pos, Observation()->GetGameLoop(), enemy_sightings_);
             }
         }
 	}
 
 	virtual void OnUnitIdle(const Unit* unit) {
+		ScopedLatency timer(on_unit_idle_latency_[GamePhase()]);
+		TraceSpan trace(tracer_, "OnUnitIdle", TraceWriter::Category::Event);
+		ApiCallSite call_site(api_counters_, "OnUnitIdle");
+		recorder_.RecordEvent(RecordedEvent::Kind::UnitIdle, unit);
+
+		// Morphs (siege, viking modes, orbital) finish with the unit going idle under its new type.
+		unit_counter_.OnUnitChanged(unit);
+
 		// On Worker Idle, Assign Workers to Mineral Patch
 		switch (unit->unit_type.ToType()) {
 		    case UNIT_TYPEID::TERRAN_SCV: {
+			    // A builder going idle has either finished or failed to place its structure.
+			    construction_.OnBuilderLost(unit->tag);
 			    OnWorkerIdle(unit);
 			    break;
 		    }
@@ -265,28 +652,19 @@ private: // Private Functions of Bot
     - Morphs to assault mode if none are flying
     */
     void ManageVikingAssaultOn() {
-        const ObservationInterface* observation = Observation();
-
-        Units vikings = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_VIKINGFIGHTER));
+        const Units& vikings = Index().GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_VIKINGFIGHTER);
 
-        Units enemyUnits = observation->GetUnits(Unit::Enemy);
+        const SpatialGrid& enemies = EnemyGrid();
+        float vision_range = unit_type_table_.Get(UNIT_TYPEID::TERRAN_VIKINGFIGHTER).sight_range;
 
         for (const Unit* viking : vikings)
         {
-            bool nearby = false;
-            bool nearbyFlying = false;
+            // Check for enemy units within viking vision range
+            bool nearbyGround = enemies.AnyInRadius(viking->pos, vision_range, SpatialGrid::Layer::Ground);
+            bool nearbyFlying = enemies.AnyInRadius(viking->pos, vision_range, SpatialGrid::Layer::Air); // Flying enemies nearby, stay in AA mode
 
-            // Count enemy units within range
-            for (const Unit* enemy : enemyUnits)
-            {
-                if (Distance2D(viking->pos, enemy->pos) < 11) // Viking vision range is 11
-                {
-                    nearby = true;
-                    if (enemy->is_flying) { nearbyFlying = true; } // Flying enemies nearby, stay in AA mode
-                }
-            }
-            if (nearby && !nearbyFlying) {
-                Actions()->UnitCommand(viking, ABILITY_ID::MORPH_VIKINGASSAULTMODE);
+            if (nearbyGround && !nearbyFlying) {
+                action_batch_.UnitCommand(viking, ABILITY_ID::MORPH_VIKINGASSAULTMODE);
             }
         }
     }
@@ -298,28 +676,19 @@ private: // Private Functions of Bot
     - If there are none, or there are nearby flying enemies, return to fighter mode
     */
     void ManageVikingAssaultOff() {
-        const ObservationInterface* observation = Observation();
-
-        Units vikings = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_VIKINGASSAULT));
+        const Units& vikings = Index().GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_VIKINGASSAULT);
 
-        Units enemyUnits = observation->GetUnits(Unit::Enemy);
+        const SpatialGrid& enemies = EnemyGrid();
+        float vision_range = unit_type_table_.Get(UNIT_TYPEID::TERRAN_VIKINGASSAULT).sight_range;
 
         for (const Unit* viking : vikings)
         {
-            bool nearby = false;
-            bool nearbyFlying = false;
+            // Check for enemy units within viking vision range
+            bool nearbyGround = enemies.AnyInRadius(viking->pos, vision_range, SpatialGrid::Layer::Ground);
+            bool nearbyFlying = enemies.AnyInRadius(viking->pos, vision_range, SpatialGrid::Layer::Air); // Flying enemies nearby, stay in AA mode
 
-            // Count enemy units within range
-            for (const Unit* enemy : enemyUnits)
-            {
-                if (Distance2D(viking->pos, enemy->pos) < 11) // Viking vision range is 11
-                {
-                    nearby = true;
-                    if (enemy->is_flying) { nearbyFlying = true; } // Flying enemies nearby, stay in AA mode
-                }
-            }
-            if (!nearby || nearbyFlying) {
-                Actions()->UnitCommand(viking, ABILITY_ID::MORPH_VIKINGFIGHTERMODE);
+            if (!nearbyGround || nearbyFlying) {
+                action_batch_.UnitCommand(viking, ABILITY_ID::MORPH_VIKINGFIGHTERMODE);
             }
         }
     }
@@ -332,29 +701,21 @@ private: // Private Functions of Bot
     */
     void ManageSiegeOn()
     {
-        const ObservationInterface* observation = Observation();
+        const Units& tanks = Index().GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_SIEGETANK);
 
-        Units tanks = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_SIEGETANK));
-
-        Units enemyUnits = observation->GetUnits(Unit::Enemy);
+        const SpatialGrid& enemies = EnemyGrid();
+        float siege_range = unit_type_table_.Get(UNIT_TYPEID::TERRAN_SIEGETANKSIEGED).ground_range;
+        size_t threshold = SiegeThreshold();
 
         for (const Unit* tank : tanks)
         {
-            int total = 0;
-
-            // Count enemy units within range
-            for (const Unit* enemy : enemyUnits)
-            {
-                if (Distance2D(tank->pos, enemy->pos) < 13) // Tank range when sieged is 13
-                {
-                    total += 1;
-                }
-            }
+            // Count enemy units within sieged tank range
+            size_t total = enemies.CountInRadius(tank->pos, siege_range, SpatialGrid::Layer::Any, threshold);
 
             // Siege if there are enough enemy units within range
-            if (total >= siege_threshold)
+            if (total >= threshold)
             {
-                Actions()->UnitCommand(tank, ABILITY_ID::MORPH_SIEGEMODE);
+                action_batch_.UnitCommand(tank, ABILITY_ID::MORPH_SIEGEMODE);
             }
         }
 
@@ -368,19 +729,15 @@ private: // Private Functions of Bot
     */
     void ManageSiegeOff()
     {
-        const ObservationInterface* observation = Observation();
-
-        Units tanks = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_SIEGETANKSIEGED));
+        const Units& tanks = Index().GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_SIEGETANKSIEGED);
 
-        Units enemyUnits = observation->GetUnits(Unit::Enemy);
+        const SpatialGrid& enemies = EnemyGrid();
+        float siege_range = unit_type_table_.Get(UNIT_TYPEID::TERRAN_SIEGETANKSIEGED).ground_range;
 
         for (const Unit* tank : tanks) {
             //If no enemy units are within range of the sieged tank, unsiege it
-            if (std::none_of(begin(enemyUnits), end(enemyUnits),
-                [&](const Unit* a) {
-                    return Distance2D(a->pos, tank->pos) < 13; // Tank range when sieged is 13
-                })) {
-                Actions()->UnitCommand(tank, ABILITY_ID::MORPH_UNSIEGE);
+            if (!enemies.AnyInRadius(tank->pos, siege_range)) {
+                action_batch_.UnitCommand(tank, ABILITY_ID::MORPH_UNSIEGE);
             }
         }
     }
@@ -393,12 +750,12 @@ private: // Private Functions of Bot
 	*/
 	void ManageAttack()
 	{
-		const ObservationInterface* observation = Observation();
+		const UnitIndex& index = Index();
 		// Setup - Get Army Units, new unit types must be added here for them to be included.
-		Units marines = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_MARINE));
-		Units maruaders = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_MARAUDER));
-		Units tanks = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_SIEGETANK));
-        Units vikings = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_VIKINGFIGHTER));
+		const Units& marines = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_MARINE);
+		const Units& maruaders = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_MARAUDER);
+		const Units& tanks = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_SIEGETANK);
+        const Units& vikings = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_VIKINGFIGHTER);
 
 		bool past_six_minutes = step_count > 1200 * 6;
 		bool significant_army = marines.size() + maruaders.size() > 25;
@@ -409,39 +766,25 @@ private: // Private Functions of Bot
 			// Select Attack Location
 			Point2D attack_location;
 
-            // Prioritze enemy structures;
-            Units enemy_units = observation->GetUnits(Unit::Enemy);
-            bool found_structure = false;
-            for (auto unit : enemy_units) {
-                if (unit->display_type == Unit::DisplayType::Snapshot) // Structures show up in FOW as snapshots
-                {
-                    attack_location = unit->pos;
-                    found_structure = true;
-                }
+            // Prioritze enemy structures, the closest one we know of to where the army gathers
+            const EnemyRecord* structure = enemy_memory_.NearestStructure(staging_location_);
+            bool found_structure = structure != nullptr;
+            if (found_structure) {
+                attack_location = structure->pos;
             }
 
-			if (enemy_unit_locations.size() > 0 || found_structure || found_enemy_base)
+			bool recent_sightings = enemy_sightings_.Weight(Observation()->GetGameLoop()) >= min_sighting_weight;
+			if (recent_sightings || found_structure || found_enemy_base)
 			{
                 if (!found_structure) {
                     // If we havent seen any units recently but we know where their base is, attack that.
-                    if (enemy_unit_locations.size() == 0) {
+                    if (!recent_sightings) {
                         attack_location = enemy_base_loc;
                     }
-                    // If there is only one unit location in the queue, attack there
-                    else if (enemy_unit_locations.size() == 1)
-                    {
-                        attack_location = enemy_unit_locations.front();
-                    }
-                    // If there are multiple unit location in the queue, pick one at random
+                    // Otherwise pick a sighting at random, recent and busy places more likely
                     else
                     {
-                        size_t skip = GetRandomInteger(0, enemy_unit_locations.size() - 1);
-
-                        for (size_t i = 0; i < skip; i++)
-                        {
-                            enemy_unit_locations.pop();
-                        }
-                        attack_location = enemy_unit_locations.front();
+                        attack_location = enemy_sightings_.Sample(randomFraction());
                     }
                 }
 
@@ -497,16 +840,15 @@ private: // Private Functions of Bot
 		MultiplayerBot::ManageWorkers(UNIT_TYPEID::TERRAN_SCV, ABILITY_ID::HARVEST_GATHER, UNIT_TYPEID::TERRAN_REFINERY);
 
 		// Try To Use The Mule Call Down Whenever Possible On Orbital Command Centers
-		const ObservationInterface* observation = Observation();
-		Units orbitals = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_ORBITALCOMMAND));
+		const Units& orbitals = Index().GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_ORBITALCOMMAND);
 		for (auto &unit : orbitals)
 		{
 			if (unit->energy > 50)
 			{
-				float rx = GetRandomScalar();
-				float ry = GetRandomScalar();
+				float rx = randomScalar();
+				float ry = randomScalar();
 
-				Actions()->UnitCommand(unit, ABILITY_ID::EFFECT_CALLDOWNMULE, Point2D(unit->pos.x + rx * 2, unit->pos.y + ry * 2));
+				action_batch_.UnitCommand(unit, ABILITY_ID::EFFECT_CALLDOWNMULE, Point2D(unit->pos.x + rx * 2, unit->pos.y + ry * 2));
 			}
 		}
 
@@ -528,19 +870,17 @@ private: // Private Functions of Bot
 	*/
 	void ManageUpgrades()
 	{
-		const ObservationInterface* observation = Observation();
+		const UnitIndex& index = Index();
 		// Setup - Get Upgrades Buildings and Unit Counts
-		Units engineering_bays = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_ENGINEERINGBAY));
-		Units armories = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_ARMORY));
-		Units barracks_tech = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_BARRACKSTECHLAB));
-		Units factorys_tech = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_FACTORYTECHLAB));
+		const Units& engineering_bays = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_ENGINEERINGBAY);
+		const Units& barracks_tech = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_BARRACKSTECHLAB);
 
-		Units marines = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_MARINE));
-		Units maruaders = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_MARAUDER));
+		size_t marine_count = index.Count(Unit::Self, UNIT_TYPEID::TERRAN_MARINE);
+		size_t maruader_count = index.Count(Unit::Self, UNIT_TYPEID::TERRAN_MARAUDER);
 
 
 		bool past_five_minutes = step_count > 1200 * 5;
-		size_t marine_maruader_count = marines.size() + maruaders.size();
+		size_t marine_maruader_count = marine_count + maruader_count;
 		bool significant_bio_force = marine_maruader_count > 25;
 
 		// Try To Build Upgrades If Army Is Sufficent And Game Has Progressed Far Enough
@@ -549,15 +889,15 @@ private: // Private Functions of Bot
 			if (engineering_bays.size() > 0 && significant_bio_force)
 			{
 				const Unit* engineering_bay = engineering_bays.front();
-				Actions()->UnitCommand(engineering_bay, ABILITY_ID::RESEARCH_TERRANINFANTRYWEAPONS);
-				Actions()->UnitCommand(engineering_bay, ABILITY_ID::RESEARCH_TERRANINFANTRYARMOR);
+				action_batch_.UnitCommand(engineering_bay, ABILITY_ID::RESEARCH_TERRANINFANTRYWEAPONS);
+				action_batch_.UnitCommand(engineering_bay, ABILITY_ID::RESEARCH_TERRANINFANTRYARMOR);
 			}
 
 			if (barracks_tech.size() > 0 && significant_bio_force)
 			{
 				const Unit* barracks_tech_lab = barracks_tech.front();
-				Actions()->UnitCommand(barracks_tech, ABILITY_ID::RESEARCH_COMBATSHIELD);
-				Actions()->UnitCommand(barracks_tech, ABILITY_ID::RESEARCH_CONCUSSIVESHELLS);
+				action_batch_.UnitCommand(barracks_tech, ABILITY_ID::RESEARCH_COMBATSHIELD);
+				action_batch_.UnitCommand(barracks_tech, ABILITY_ID::RESEARCH_CONCUSSIVESHELLS);
 			}
 		}
 	}
@@ -573,19 +913,17 @@ private: // Private Functions of Bot
 	*/
 	void BuildOrder() {
 		const ObservationInterface* observation = Observation();
+		const UnitIndex& index = Index();
 		// Setup - Get Building Counts
-		Units bases = observation->GetUnits(Unit::Self, IsTownHall());
-		Units barracks = observation->GetUnits(Unit::Self, IsUnits(barrack_types));
-		Units factorys = observation->GetUnits(Unit::Self, IsUnits(factory_types));
-		Units starports = observation->GetUnits(Unit::Self, IsUnits(starport_types));
-		Units barracks_tech = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_BARRACKSTECHLAB));
-		Units factorys_tech = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_FACTORYTECHLAB));
-		Units starports_tech = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_STARPORTTECHLAB));
-		Units supply_depots = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_SUPPLYDEPOT));
-		Units refinerys = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_REFINERY));
-		Units engineering_bays = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_ENGINEERINGBAY));
-		Units armories = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_ARMORY));
-		Units orbitals = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_ORBITALCOMMAND));
+		const Units& bases = index.GetGroup(Unit::Self, town_hall_group_);
+		const Units& barracks = index.GetGroup(Unit::Self, barracks_group_);
+		const Units& factorys = index.GetGroup(Unit::Self, factory_group_);
+		const Units& starports = index.GetGroup(Unit::Self, starport_group_);
+		const Units& supply_depots = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_SUPPLYDEPOT);
+		const Units& refinerys = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_REFINERY);
+		const Units& engineering_bays = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_ENGINEERINGBAY);
+		const Units& armories = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_ARMORY);
+		const Units& orbitals = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_ORBITALCOMMAND);
 
 		// Setup - Get Building Count Targets
 		size_t barracks_count_target = std::min<size_t>(2 * bases.size(), 8);
@@ -602,7 +940,7 @@ private: // Private Functions of Bot
 		{
 			for (const auto& base : bases) {
 				if (base->unit_type == UNIT_TYPEID::TERRAN_COMMANDCENTER && observation->GetMinerals() > 150) {
-					Actions()->UnitCommand(base, ABILITY_ID::MORPH_ORBITALCOMMAND);
+					action_batch_.UnitCommand(base, ABILITY_ID::MORPH_ORBITALCOMMAND);
 				}
 			}
 		}
@@ -616,7 +954,7 @@ private: // Private Functions of Bot
 
 			if (observation->GetMinerals() > 250 && observation->GetFoodUsed() == observation->GetFoodCap())
 			{
-				TryBuildStructure(ABILITY_ID::BUILD_SUPPLYDEPOT);
+				TryBuildStructure(ABILITY_ID::BUILD_SUPPLYDEPOT, UNIT_TYPEID::TERRAN_SCV, 2);
 			}
 		}
 
@@ -678,13 +1016,13 @@ private: // Private Functions of Bot
 
 	Manages The Staging Point Location Used To Rally Newly Created Troops
 
-	- Tries to place the rally point to the closest expansion to the middle of the map
+	- Tries to place the rally point to the base closest to the middle of the map by ground
 	- Shifts units slightly such that they are in front of the base, closer to the map center.
 	*/
 	void ManageRallyPoints()
 	{
 		const ObservationInterface* observation = Observation();
-		Units bases = observation->GetUnits(Unit::Self, IsTownHall());
+		const Units& bases = Index().GetGroup(Unit::Self, town_hall_group_);
 
 		if (bases.size() == 1)
 		{
@@ -694,12 +1032,16 @@ private: // Private Functions of Bot
 		if (bases.size() > 1)
 		{
 			const Unit* base_closest_to_mid = bases.front();
+			Point2D map_center = getMapCenter(observation);
+			float closest_distance = GroundDistance(base_closest_to_mid->pos, map_center);
 
 			for (const Unit *u : bases)
 			{
-				if (Distance2D(u->pos, getMapCenter(observation)) < (Distance2D(base_closest_to_mid->pos, getMapCenter(observation))))
+				float distance = GroundDistance(u->pos, map_center);
+				if (distance < closest_distance)
 				{
 					base_closest_to_mid = u;
+					closest_distance = distance;
 				}
 			}
 
@@ -718,14 +1060,19 @@ private: // Private Functions of Bot
 	Sends Scouts To Scout The Map
 
 	- Tries to scout potentical enemy spawns if the game is relatively early.
-	- Tries to scout random pathable locations if the game has gone on for sometime.
+	- Tries to scout the places we have not seen for the longest if the game has gone on for sometime.
 	- If a game has gone on for some time, we likely have constant contact with the enemy already
-	or their original base may have been destroyed. Hence we use randomness here to help uncover more area.
+	or their original base may have been destroyed. Hence we go wherever our knowledge is stalest to uncover more area.
 
 	*/
 	void ManageScouts()
 	{
-		const ObservationInterface* observation = Observation();
+		const Units& marines = Index().GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_MARINE);
+
+		if (marines.empty())
+		{
+			return;
+		}
 
 		bool in_first_15_minutes = step_count < 1200 * 15;
 
@@ -733,12 +1080,11 @@ private: // Private Functions of Bot
 		{
 			for (Point2D point : game_info_.enemy_start_locations)
 			{
-				const Unit* unit;
-				GetRandomUnit(unit, observation, UNIT_TYPEID::TERRAN_MARINE);
+				const Unit* unit = randomEntry(marines);
 
-				if (unit && unit->orders.empty())
+				if (unit->orders.empty())
 				{
-					Actions()->UnitCommand(unit, ABILITY_ID::SMART, point);
+					action_batch_.UnitCommand(unit, ABILITY_ID::SMART, point);
 				}
 			}
 		}
@@ -746,12 +1092,11 @@ private: // Private Functions of Bot
 		{
 			for (int i = 0; i < 3; i++)
 			{
-				const Unit* unit;
-				GetRandomUnit(unit, observation, UNIT_TYPEID::TERRAN_MARINE);
+				const Unit* unit = randomEntry(marines);
 
-				if (unit && unit->orders.empty())
+				if (unit->orders.empty())
 				{
-					ScoutWithUnit(unit, observation);
+					ScoutOldestArea(unit);
 				}
 
 			}
@@ -760,6 +1105,37 @@ private: // Private Functions of Bot
 
 	}
 
+	// Marks What Our Units Can See Now - A Few Steps Apart Is Plenty, Ages Only Matter In Seconds
+	void UpdateScoutingCoverage()
+	{
+		uint32_t game_loop = Observation()->GetGameLoop();
+		for (const Unit* unit : Index().GetUnits(Unit::Self))
+		{
+			scouting_coverage_.See(unit->pos, unit_type_table_.Get(unit->unit_type).sight_range, game_loop);
+		}
+	}
+
+	// Sends The Unit To The Pathable Area Seen Longest Ago, Reachability Comes From Our Own Grid - No Query
+	void ScoutOldestArea(const Unit* unit)
+	{
+		for (int attempt = 0; attempt < scout_target_attempts && !scouting_coverage_.Empty(); attempt++)
+		{
+			Point2D target = scouting_coverage_.TakeOldest(Observation()->GetGameLoop());
+			if (pathfinder_.FindPath(unit, target) == GridPathfinder::Reach::Unreachable)
+			{
+				// Structures can stand on the cell or wall it off for a while, it has been stamped and ages back in.
+				// Only ground the terrain itself keeps us from goes for good.
+				if (pathfinder_.TerrainReach(unit->pos, target) == GridPathfinder::Reach::Unreachable)
+				{
+					scouting_coverage_.Exclude(target);
+				}
+				continue;
+			}
+			action_batch_.UnitCommand(unit, ABILITY_ID::SMART, target);
+			return;
+		}
+	}
+
 	/*
 	Mange Idle Army Units
 
@@ -768,12 +1144,12 @@ private: // Private Functions of Bot
 	*/
 	void ManageIdleArmyUnits()
 	{
-		const ObservationInterface* observation = Observation();
+		const UnitIndex& index = Index();
 
-		Units marines = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_MARINE));
-		Units maruaders = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_MARAUDER));
-		Units tanks = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_SIEGETANK));
-        Units vikings = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_VIKINGFIGHTER));
+		const Units& marines = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_MARINE);
+		const Units& maruaders = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_MARAUDER);
+		const Units& tanks = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_SIEGETANK);
+        const Units& vikings = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_VIKINGFIGHTER);
 
 		for (const Unit* unit : marines)
 		{
@@ -818,16 +1194,14 @@ private: // Private Functions of Bot
 	*/
 	void ManageDefense()
 	{
-		const ObservationInterface* observation = Observation();
+		const UnitIndex& index = Index();
 
-		Units bases = observation->GetUnits(Unit::Self, IsTownHall());
+		const Units& marines = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_MARINE);
+		const Units& maruaders = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_MARAUDER);
+		const Units& tanks = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_SIEGETANK);
+        const Units& vikings = index.GetUnits(Unit::Self, UNIT_TYPEID::TERRAN_VIKINGFIGHTER);
 
-		Units marines = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_MARINE));
-		Units maruaders = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_MARAUDER));
-		Units tanks = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_SIEGETANK));
-        Units vikings = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_VIKINGFIGHTER));
-
-		Units enemy_units = observation->GetUnits(Unit::Enemy);
+		const Units& enemy_units = index.GetUnits(Unit::Enemy);
 
 		for (const Unit* enemy_unit : enemy_units)
 		{
@@ -890,14 +1264,14 @@ private: // Private Functions of Bot
 			TryBuildAddOn(ABILITY_ID::BUILD_REACTOR_BARRACKS, unit->tag);
 		}
 
-		if (marine_count / maruader_count > marine_to_maruader_ratio)
+		if (marine_count / maruader_count > MarineToMarauderRatio())
 		{
-			Actions()->UnitCommand(unit, ABILITY_ID::TRAIN_MARAUDER);
+			action_batch_.UnitCommand(unit, ABILITY_ID::TRAIN_MARAUDER);
 		}
 
 		if (unit->orders.empty())
 		{
-			Actions()->UnitCommand(unit, ABILITY_ID::TRAIN_MARINE);
+			action_batch_.UnitCommand(unit, ABILITY_ID::TRAIN_MARINE);
 		}
 
 	}
@@ -905,19 +1279,19 @@ private: // Private Functions of Bot
 	void HandleFactory(const Unit* unit)
 	{
 		TryBuildAddOn(ABILITY_ID::BUILD_TECHLAB_FACTORY, unit->tag);
-		Actions()->UnitCommand(unit, ABILITY_ID::TRAIN_SIEGETANK);
+		action_batch_.UnitCommand(unit, ABILITY_ID::TRAIN_SIEGETANK);
 	}
 
     void HandleStarport(const Unit* unit)
     {
-        Actions()->UnitCommand(unit, ABILITY_ID::TRAIN_VIKINGFIGHTER);
+        action_batch_.UnitCommand(unit, ABILITY_ID::TRAIN_VIKINGFIGHTER);
     }
 
 	// Per Unit Functions
 
 	void GoToPoint(const Unit* unit, Point2D point)
 	{
-		Actions()->UnitCommand(unit, ABILITY_ID::ATTACK_ATTACK, point);
+		action_batch_.UnitCommand(unit, ABILITY_ID::ATTACK_ATTACK, point);
 	}
 
 	void OnWorkerIdle(const Unit* unit)
@@ -926,66 +1300,93 @@ private: // Private Functions of Bot
 		if (!mineral_target)
 			return;
 
-		Actions()->UnitCommand(unit, ABILITY_ID::SMART, mineral_target);
+		action_batch_.UnitCommand(unit, ABILITY_ID::SMART, mineral_target);
 	}
 
 	// Helper Functions
-	const Unit* FindNearestMineralPatch(const Point2D& start) {
-		Units units = Observation()->GetUnits(Unit::Alliance::Neutral);
-		float distance = std::numeric_limits<float>::max();
-		const Unit* target = nullptr;
-		for (const auto& u : units) {
-			if (u->unit_type == UNIT_TYPEID::NEUTRAL_MINERALFIELD) {
-				float d = DistanceSquared2D(u->pos, start);
-				if (d < distance) {
-					distance = d;
-					target = u;
-				}
-			}
+
+	// Marauders Answer Armored Armies, Marines Light Ones - The Base Ratio Holds Until The Enemy Army Is Known
+	double MarineToMarauderRatio() const
+	{
+		if (enemy_composition_.ArmySupply(Observation()->GetGameLoop()) < min_known_army_supply)
+		{
+			return marine_to_maruader_ratio;
+		}
+		double ratio = marine_to_maruader_ratio * (0.5 + enemy_composition_.LightShare()) / (0.5 + enemy_composition_.ArmoredShare());
+		return std::min(2.0 * marine_to_maruader_ratio, std::max(1.0, ratio));
+	}
+
+	// Sieged Tanks Hit Armored Ground Hard And Air Not At All, Siege Sooner Or Later To Match
+	size_t SiegeThreshold() const
+	{
+		if (enemy_composition_.ArmySupply(Observation()->GetGameLoop()) < min_known_army_supply)
+		{
+			return siege_threshold;
 		}
-		return target;
+		double threshold = siege_threshold * (1.0 - 0.5 * enemy_composition_.ArmoredShare() + enemy_composition_.AirShare());
+		return std::max<size_t>(2, static_cast<size_t>(threshold + 0.5));
 	}
+	// Note: FindNearestMineralPatch is inherited, it reads the mineral field KD-tree built at game start.
 
 	size_t CountUnitType(UNIT_TYPEID unit_type) {
-		return Observation()->GetUnits(Unit::Alliance::Self, IsUnit(unit_type)).size();
+		return MultiplayerBot::CountUnitType(Observation(), unit_type);
 	}
 
-	bool TryBuildStructure(ABILITY_ID ability_type_for_structure, UNIT_TYPEID unit_type = UNIT_TYPEID::TERRAN_SCV) {
-		const ObservationInterface* observation = Observation();
+	bool TryBuildStructure(ABILITY_ID ability_type_for_structure, UNIT_TYPEID unit_type = UNIT_TYPEID::TERRAN_SCV, size_t max_pending = 1) {
+		ApiCallSite call_site(api_counters_, "Bot::TryBuildStructure");
+		uint32_t game_loop = Observation()->GetGameLoop();
 
-		// If a unit already is building a supply structure of this type, do nothing.
-		// Also get an scv to build the structure.
-		const Unit* unit_to_build = nullptr;
-		Units units = observation->GetUnits(Unit::Alliance::Self);
-		for (const auto& unit : units) {
-			for (const auto& order : unit->orders) {
-				if (order.ability_id == ability_type_for_structure) {
-					continue;
-				}
-			}
+		// If enough units are already heading out to build a structure of this type, do nothing.
+		construction_.Expire(game_loop, construction_timeout);
+		if (construction_.CountPending(ability_type_for_structure) >= max_pending) {
+			return false;
+		}
 
-			if (unit->unit_type == unit_type) {
+		// Get an scv that is not already assigned to build something.
+		const Unit* unit_to_build = nullptr;
+		for (const auto& unit : Index().GetUnits(Unit::Alliance::Self, unit_type)) {
+			if (!construction_.IsBuilder(unit->tag)) {
 				unit_to_build = unit;
 			}
 		}
 
-		float rx = GetRandomScalar();
-		float ry = GetRandomScalar();
-
-		if (unit_to_build)
-		{
-			Actions()->UnitCommand(unit_to_build,
-				ability_type_for_structure,
-				Point2D(unit_to_build->pos.x + rx * 10.0f, unit_to_build->pos.y + ry * 10.0f));
+		if (!unit_to_build) {
+			return false;
 		}
 
+		// Random Spots Around The SCV, The First One The Placement Grid Allows Is Confirmed With The Game
+		Point2D build_location;
+		bool found = false;
+		for (int attempt = 0; attempt < placement_attempts && !found; attempt++) {
+			float rx = randomScalar();
+			float ry = randomScalar();
+			build_location = Point2D(unit_to_build->pos.x + rx * 10.0f, unit_to_build->pos.y + ry * 10.0f);
+			found = placement_.CanPlace(ability_type_for_structure, build_location);
+		}
+		if (!found) {
+			return false;
+		}
 
+		// The Builder Is Booked Now So This Step Sends No Second One, And Let Go If The Game Refuses The Spot
+		construction_.Add(ability_type_for_structure, unit_to_build->tag, build_location, game_loop);
+		QueryBroker::Request request;
+		request.Placement(ability_type_for_structure, build_location);
+		query_broker_.Submit(request, [this, unit_to_build, ability_type_for_structure, build_location](const QueryBroker::Results& results) {
+			ApiCallSite call_site(api_counters_, "Bot::TryBuildStructure");
+			if (unit_to_build->is_alive && results.placeable[0]) {
+				action_batch_.UnitCommand(unit_to_build, ability_type_for_structure, build_location);
+			}
+			else {
+				construction_.OnBuilderLost(unit_to_build->tag);
+			}
+		});
 		return true;
 	}
 
 	bool TryBuildAddOn(AbilityID ability_type_for_structure, Tag base_structure) {
-		float rx = GetRandomScalar();
-		float ry = GetRandomScalar();
+		ApiCallSite call_site(api_counters_, "Bot::TryBuildAddOn");
+		float rx = randomScalar();
+		float ry = randomScalar();
 		const Unit* unit = Observation()->GetUnit(base_structure);
 
 		if (unit->build_progress != 1) {
@@ -994,46 +1395,97 @@ private: // Private Functions of Bot
 
 		Point2D build_location = Point2D(unit->pos.x + rx * 15, unit->pos.y + ry * 15);
 
-		Units units = Observation()->GetUnits(Unit::Self, IsStructure(Observation()));
-
-		if (Query()->Placement(ability_type_for_structure, unit->pos, unit)) {
-			Actions()->UnitCommand(unit, ability_type_for_structure);
-			return true;
-		}
+		const Units& units = Index().GetUnits(Unit::Self);
+		IsStructure is_structure(unit_type_table_);
 
+		// Moving Is Only An Option Away From Other Structures
 		float distance = std::numeric_limits<float>::max();
 		for (const auto& u : units) {
+			if (!is_structure(*u)) {
+				continue;
+			}
 			float d = Distance2D(u->pos, build_location);
 			if (d < distance) {
 				distance = d;
 			}
 		}
-		if (distance < 6) {
+
+		// Spots The Placement Grid Rules Out Are Not Asked About, The Rest Go In The Step's Query Batch
+		// The Moved Structure Needs Its Own Footprint Free As Well As The Add-On's
+		bool in_place = placement_.CanPlaceAddOn(unit->pos);
+		bool moved = distance >= 6 && placement_.CanPlace(unit_type_table_.Get(unit->unit_type).build_ability, build_location);
+		if (!in_place && !moved) {
 			return false;
 		}
-
-		if (Query()->Placement(ability_type_for_structure, build_location, unit)) {
-			Actions()->UnitCommand(unit, ability_type_for_structure, build_location);
-			return true;
+		QueryBroker::Request request;
+		if (in_place) {
+			request.Placement(ability_type_for_structure, unit->pos, unit);
+		}
+		if (moved) {
+			request.Placement(ability_type_for_structure, build_location, unit);
 		}
-		return false;
+
+		// The Add-On Goes In Place If It Fits There
+		query_broker_.Submit(request, [this, unit, ability_type_for_structure, build_location, in_place, moved](const QueryBroker::Results& results) {
+			ApiCallSite call_site(api_counters_, "Bot::TryBuildAddOn");
+			if (!unit->is_alive) {
+				return;
+			}
+			if (in_place && results.placeable[0]) {
+				action_batch_.UnitCommand(unit, ability_type_for_structure);
+			}
+			else if (moved && results.placeable[in_place ? 1 : 0]) {
+				action_batch_.UnitCommand(unit, ability_type_for_structure, build_location);
+			}
+		});
+		return true;
 
 	}
 
-	void FlushKnownEnemyLocations()
+	const UnitIndex& Index()
 	{
-		size_t number_of_positions_to_flush = floor(enemy_unit_locations.size() * 0.9);
+		unit_index_.Update(Observation());
+		return unit_index_;
+	}
 
-		for (size_t i = 0; i < number_of_positions_to_flush; i++)
+	const SpatialGrid& EnemyGrid()
+	{
+		// Rebuilt at most once per game loop, however many managers query it.
+		uint32_t game_loop = Observation()->GetGameLoop();
+		if (!enemy_grid_built_ || game_loop != enemy_grid_loop_)
 		{
-			if (!enemy_unit_locations.empty())
-			{
-				enemy_unit_locations.pop();
-			}
+			enemy_grid_.Build(Index().GetUnits(Unit::Enemy));
+			enemy_grid_loop_ = game_loop;
+			enemy_grid_built_ = true;
+		}
+		return enemy_grid_;
+	}
+
+	const BaseTerritoryMap& BaseTerritory()
+	{
+		if (base_territory_.IsDirty())
+		{
+			base_territory_.Rebuild(Index().GetGroup(Unit::Self, town_hall_group_));
+		}
+		return base_territory_;
+	}
+
+	size_t TownHallSignature()
+	{
+		size_t signature = 0;
+		for (const Unit* base : Index().GetGroup(Unit::Self, town_hall_group_))
+		{
+			signature = signature * 31 + std::hash<Tag>()(base->tag);
+			signature = signature * 31 + static_cast<uint32_t>(base->unit_type);
+			signature = signature * 31 + static_cast<size_t>(base->pos.x) * 1024 + static_cast<size_t>(base->pos.y);
 		}
+		return signature;
 	}
 
 
+	// Same Types As IsTownHall, Used For The Unit Index Town Hall Group
+	std::vector<UNIT_TYPEID> town_hall_types = { UNIT_TYPEID::ZERG_HATCHERY, UNIT_TYPEID::ZERG_LAIR, UNIT_TYPEID::ZERG_HIVE, UNIT_TYPEID::TERRAN_COMMANDCENTER, UNIT_TYPEID::TERRAN_ORBITALCOMMAND, UNIT_TYPEID::TERRAN_ORBITALCOMMANDFLYING, UNIT_TYPEID::TERRAN_PLANETARYFORTRESS, UNIT_TYPEID::PROTOSS_NEXUS };
+
 	// Constant Types From Example Terran Bot
 	std::vector<UNIT_TYPEID> barrack_types = { UNIT_TYPEID::TERRAN_BARRACKSFLYING, UNIT_TYPEID::TERRAN_BARRACKS };
 	std::vector<UNIT_TYPEID> factory_types = { UNIT_TYPEID::TERRAN_FACTORYFLYING, UNIT_TYPEID::TERRAN_FACTORY };
@@ -1046,6 +1498,7 @@ private: // Private Functions of Bot
 	std::vector<UNIT_TYPEID> hellion_types = { UNIT_TYPEID::TERRAN_HELLION, UNIT_TYPEID::TERRAN_HELLIONTANK };
 };
 
+#ifndef BOT_HEADLESS
 int main(int argc, char* argv[]) {
 	Coordinator coordinator;
 	coordinator.LoadSettings(argc, argv);
@@ -1063,3 +1516,17 @@ int main(int argc, char* argv[]) {
 
 	return 0;
 }
+#else
+// The headless runner (headless/main.cpp) and the benchmarks have their own main and only need the bot.
+MultiplayerBot* CreateBot() {
+	return new Bot();
+}
+
+std::vector<BotHotPath> BotHotPaths(MultiplayerBot* bot) {
+	return static_cast<Bot*>(bot)->HotPaths();
+}
+
+void DisableStepBudget(MultiplayerBot* bot) {
+	static_cast<Bot*>(bot)->DisableStepBudget();
+}
+#endif
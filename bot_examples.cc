@@ -10,6 +10,8 @@
 #include "sc2api/sc2_api.h"
 #include "sc2lib/sc2_lib.h"
 
+#include "utils.h"
+
 namespace sc2 {
     
 static int TargetSCVCount = 15;
@@ -33,14 +35,11 @@ struct IsFlying {
 
 //Ignores Overlords, workers, and structures
 struct IsArmy {
-    IsArmy(const ObservationInterface* obs) : observation_(obs) {}
+    IsArmy(const UnitTypeTable& unit_types) : unit_types_(unit_types) {}
 
     bool operator()(const Unit& unit) {
-        auto attributes = observation_->GetUnitTypeData().at(unit.unit_type).attributes;
-        for (const auto& attribute : attributes) {
-            if (attribute == Attribute::Structure) {
-                return false;
-            }
+        if (unit_types_.IsStructure(unit.unit_type)) {
+            return false;
         }
         switch (unit.unit_type.ToType()) {
             case UNIT_TYPEID::ZERG_OVERLORD: return false;
@@ -56,7 +55,7 @@ struct IsArmy {
         }
     }
 
-    const ObservationInterface* observation_;
+    const UnitTypeTable& unit_types_;
 };
 
 struct IsTownHall {
@@ -87,20 +86,13 @@ struct IsVespeneGeyser {
 };
 
 struct IsStructure {
-    IsStructure(const ObservationInterface* obs) : observation_(obs) {};
+    IsStructure(const UnitTypeTable& unit_types) : unit_types_(unit_types) {};
 
     bool operator()(const Unit& unit) {
-        auto& attributes = observation_->GetUnitTypeData().at(unit.unit_type).attributes;
-        bool is_structure = false;
-        for (const auto& attribute : attributes) {
-            if (attribute == Attribute::Structure) {
-                is_structure = true;
-            }
-        }
-        return is_structure;
+        return unit_types_.IsStructure(unit.unit_type);
     }
 
-    const ObservationInterface* observation_;
+    const UnitTypeTable& unit_types_;
 };
 
 int CountUnitType(const ObservationInterface* observation, UnitTypeID unit_type) {
@@ -145,37 +137,140 @@ void MultiplayerBot::PrintStatus(std::string msg) {
     std::cout << std::to_string(bot_identifier) << ": " << msg << std::endl;
 }
 
+const ObservationInterface* MultiplayerBot::Observation() const {
+    return observation_override_ ? observation_override_ : Agent::Observation();
+}
+
+ActionInterface* MultiplayerBot::Actions() {
+    return actions_override_ ? actions_override_ : Agent::Actions();
+}
+
+QueryInterface* MultiplayerBot::Query() {
+    return query_override_ ? query_override_ : Agent::Query();
+}
+
+void MultiplayerBot::SetInterfaces(const ObservationInterface* observation, ActionInterface* actions, QueryInterface* query) {
+    observation_override_ = observation;
+    actions_override_ = actions;
+    query_override_ = query;
+}
+
 void MultiplayerBot::OnGameStart() {
     game_info_ = Observation()->GetGameInfo();
+    unit_type_table_.Build(Observation()->GetUnitTypeData());
     PrintStatus("game started.");
-    expansions_ = search::CalculateExpansionLocations(Observation(), Query());
 
-    //Temporary, we can replace this with observation->GetStartLocation() once implemented
+    // Expansions take a round of queries to work out, from the cache they are a file away.
     startLocation_ = Observation()->GetStartLocation();
+    std::string cache_directory;
+    bool use_cache = map_cache_enabled_ && getEnvironment("BOT_MAP_CACHE", cache_directory);
+    uint64_t map_key = MapCache::Key(game_info_, startLocation_);
+    std::string cache_path = MapCache::Path(cache_directory, map_key);
+    bool cached = use_cache && map_cache_.Open(cache_path, map_key);
+    if (cached) {
+        expansions_ = map_cache_.Expansions();
+    }
+    else {
+        expansions_ = search::CalculateExpansionLocations(Observation(), Query());
+    }
+    mineral_fields_.Build(Observation()->GetUnits(Unit::Alliance::Neutral, IsUnit(UNIT_TYPEID::NEUTRAL_MINERALFIELD)));
+
+    // The starting town halls are laid over the pathing grid, later structures as they appear.
+    // The placement grid leaves out minerals and geysers as well, so they go over it too.
+    pathfinder_.Init(game_info_.pathing_grid);
+    placement_.Init(game_info_.placement_grid);
+    for (const auto& unit : Observation()->GetUnits()) {
+        if (!unit_type_table_.IsStructure(unit->unit_type)) {
+            continue;
+        }
+        if (unit->alliance != Unit::Alliance::Neutral) {
+            pathfinder_.AddStructure(unit);
+        }
+        placement_.AddStructure(unit);
+    }
+
     staging_location_ = startLocation_;
+
+    std::vector<Point2D> bases(1, startLocation_);
+    bases.insert(bases.end(), expansions_.begin(), expansions_.end());
+    if (cached && map_cache_.FieldCount() == bases.size() && map_cache_.FieldWidth() == pathfinder_.Width() &&
+        map_cache_.FieldHeight() == pathfinder_.Height()) {
+        distance_fields_.Attach(pathfinder_, bases, map_cache_.Fields());
+        PrintStatus("map analysis loaded from " + cache_path);
+    }
+    else {
+        distance_fields_.Build(pathfinder_, bases);
+        if (use_cache && !cached && MapCache::Write(cache_path, map_key, expansions_, game_info_.start_locations, distance_fields_)) {
+            PrintStatus("map analysis saved to " + cache_path);
+        }
+    }
+
+    // Seed the counters with the starting units.
+    unit_counter_.Verify(Observation());
+    last_unit_count_verify_ = Observation()->GetGameLoop();
 };
 
-size_t MultiplayerBot::CountUnitType(const ObservationInterface* observation, UnitTypeID unit_type) {
-    return observation->GetUnits(Unit::Alliance::Self, IsUnit(unit_type)).size();
+void MultiplayerBot::OnUnitDestroyed(const Unit* unit) {
+    // Depleted mineral fields are reported as destroyed neutral units.
+    if (unit->alliance == Unit::Alliance::Neutral) {
+        mineral_fields_.Remove(unit->tag);
+    }
+    unit_counter_.OnUnitDestroyed(unit);
+    pathfinder_.RemoveStructure(unit->tag);
+    placement_.RemoveStructure(unit->tag);
 }
 
-size_t MultiplayerBot::CountUnitTypeBuilding(const ObservationInterface* observation, UNIT_TYPEID production_building, ABILITY_ID ability) {
-    int building_count = 0;
-    Units buildings = observation->GetUnits(Unit::Self, IsUnit(production_building));
+void MultiplayerBot::OnUnitCreated(const Unit* unit) {
+    unit_counter_.OnUnitCreated(unit);
+    if (unit_type_table_.IsStructure(unit->unit_type)) {
+        pathfinder_.AddStructure(unit);
+        placement_.AddStructure(unit);
+    }
+}
 
-    for (const auto& building : buildings) {
-        if (building->orders.empty()) {
-            continue;
-        }
+void MultiplayerBot::OnUnitEnterVision(const Unit* unit) {
+    if (unit->alliance == Unit::Alliance::Enemy && unit_type_table_.IsStructure(unit->unit_type)) {
+        pathfinder_.AddStructure(unit);
+        placement_.AddStructure(unit);
+    }
+}
 
-        for (const auto order : building->orders) {
-            if (order.ability_id == ability) {
-                building_count++;
-            }
-        }
+void MultiplayerBot::OnBuildingConstructionComplete(const Unit* unit) {
+    unit_counter_.OnBuildingConstructionComplete(unit);
+}
+
+void MultiplayerBot::FlushQueries() {
+    ApiCallSite call_site(api_counters_, "QueryBroker::Flush");
+    query_broker_.Flush(Query());
+}
+
+float MultiplayerBot::GroundDistance(const Point2D& base, const Point2D& point) const {
+    int source = distance_fields_.SourceAt(base);
+    float distance = source >= 0 ? distance_fields_.Distance(source, point) : -1.0f;
+    return distance >= 0.0f ? distance : Distance2D(base, point);
+}
+
+void MultiplayerBot::VerifyUnitCounts(const ObservationInterface* observation) {
+    uint32_t game_loop = observation->GetGameLoop();
+    if (game_loop - last_unit_count_verify_ < unit_count_verify_period_) {
+        return;
     }
+    last_unit_count_verify_ = game_loop;
 
-    return building_count;
+    size_t drift = unit_counter_.Verify(observation);
+    if (drift > 0) {
+        PrintStatus("unit counts drifted by " + std::to_string(drift) + " entries, corrected.");
+    }
+}
+
+size_t MultiplayerBot::CountUnitType(const ObservationInterface* observation, UnitTypeID unit_type) {
+    VerifyUnitCounts(observation);
+    return unit_counter_.Alive(unit_type) + unit_counter_.UnderConstruction(unit_type);
+}
+
+size_t MultiplayerBot::CountUnitTypeBuilding(const ObservationInterface* observation, UNIT_TYPEID production_building, ABILITY_ID ability) {
+    unit_counter_.UpdateProduction(observation);
+    return unit_counter_.InProduction(production_building, ability);
 }
 
 size_t MultiplayerBot::CountUnitTypeTotal(const ObservationInterface* observation, UNIT_TYPEID unit_type, UNIT_TYPEID production, ABILITY_ID ability) {
@@ -193,30 +288,41 @@ size_t MultiplayerBot::CountUnitTypeTotal(const ObservationInterface* observatio
 bool MultiplayerBot::GetRandomUnit(const Unit*& unit_out, const ObservationInterface* observation, UnitTypeID unit_type) {
     Units my_units = observation->GetUnits(Unit::Alliance::Self, IsUnit(unit_type));
     if (!my_units.empty()) {
-        unit_out = GetRandomEntry(my_units);
+        unit_out = randomEntry(my_units);
         return true;
     }
     return false;
 }
 
 const Unit* MultiplayerBot::FindNearestMineralPatch(const Point2D& start) {
-    Units units = Observation()->GetUnits(Unit::Alliance::Neutral);
-    float distance = std::numeric_limits<float>::max();
-    const Unit* target = nullptr;
-    for (const auto& u : units) {
-        if (u->unit_type == UNIT_TYPEID::NEUTRAL_MINERALFIELD) {
-            float d = DistanceSquared2D(u->pos, start);
-            if (d < distance) {
-                distance = d;
-                target = u;
+    Units patches = FindNearestMineralPatches(start, 1);
+    //If we never found one return nullptr;
+    if (patches.empty()) {
+        return nullptr;
+    }
+    return patches.front();
+}
+
+Units MultiplayerBot::FindNearestMineralPatches(const Point2D& start, size_t k) {
+    Units patches;
+    while (patches.size() < k && mineral_fields_.Size() > 0) {
+        patches.clear();
+        bool stale = false;
+        for (Tag tag : mineral_fields_.KNearest(start, k)) {
+            // A patch can vanish without a destroyed event reaching us, drop it and search again.
+            const Unit* patch = Observation()->GetUnit(tag);
+            if (patch == nullptr || !patch->is_alive) {
+                mineral_fields_.Remove(tag);
+                stale = true;
+                continue;
             }
+            patches.push_back(patch);
+        }
+        if (!stale) {
+            break;
         }
     }
-    //If we never found one return false;
-    if (distance == std::numeric_limits<float>::max()) {
-        return target;
-    }
-    return target;
+    return patches;
 }
 
 // Tries to find a random location that can be pathed to on the map.
@@ -230,8 +336,8 @@ bool MultiplayerBot::FindEnemyPosition(Point2D& target_pos) {
     return true;
 }
 
-bool MultiplayerBot::TryFindRandomPathableLocation(const Unit* unit, Point2D& target_pos) {
-    // First, find a random point inside the playable area of the map.
+void MultiplayerBot::TryFindRandomPathableLocation(const Unit* unit, std::function<void(bool found, const Point2D& location)> then) {
+    // First, find random points inside the playable area of the map.
     float playable_w = game_info_.playable_max.x - game_info_.playable_min.x;
     float playable_h = game_info_.playable_max.y - game_info_.playable_min.y;
 
@@ -241,16 +347,43 @@ bool MultiplayerBot::TryFindRandomPathableLocation(const Unit* unit, Point2D& ta
         playable_h = 228;
     }
 
-    target_pos.x = playable_w * GetRandomFraction() + game_info_.playable_min.x;
-    target_pos.y = playable_h * GetRandomFraction() + game_info_.playable_min.y;
+    const int candidates = 4;
+    std::vector<Point2D> candidate_locations;
+    for (int i = 0; i < candidates; ++i) {
+        candidate_locations.push_back(Point2D(playable_w * randomFraction() + game_info_.playable_min.x, playable_h * randomFraction() + game_info_.playable_min.y));
+    }
 
-    // Now send a pathing query from the unit to that point. Can also query from point to point,
-    // but using a unit tag wherever possible will be more accurate.
-    // Note: This query must communicate with the game to get a result which affects performance.
-    // Ideally batch up the queries (using PathingDistanceBatched) and do many at once.
-    float distance = Query()->PathingDistance(unit, target_pos);
+    // Most points are settled on our own pathing grid. The rest are queued as pathing queries from the unit,
+    // they go to the game in the same batch as the step's other checks.
+    std::vector<Point2D> locations;
+    QueryBroker::Request request;
+    for (const auto& location : candidate_locations) {
+        switch (pathfinder_.FindPath(unit, location)) {
+        case GridPathfinder::Reach::Reachable:
+            then(true, location);
+            return;
+        case GridPathfinder::Reach::Unknown:
+            locations.push_back(location);
+            request.PathingDistance(unit, location);
+            break;
+        default:
+            break;
+        }
+    }
+    if (locations.empty()) {
+        then(false, Point2D());
+        return;
+    }
 
-    return distance > 0.1f;
+    query_broker_.Submit(request, [locations, then](const QueryBroker::Results& results) {
+        for (size_t i = 0; i < locations.size(); ++i) {
+            if (results.distances[i] > 0.1f) {
+                then(true, locations[i]);
+                return;
+            }
+        }
+        then(false, Point2D());
+    });
 }
 
 void MultiplayerBot::AttackWithUnitType(UnitTypeID unit_type, const ObservationInterface* observation) {
@@ -294,10 +427,13 @@ void MultiplayerBot::ScoutWithUnit(const Unit* unit, const ObservationInterface*
 
     if (FindEnemyPosition(target_pos)) {
         if (Distance2D(unit->pos, target_pos) < 20 && enemy_units.empty()) {
-            if (TryFindRandomPathableLocation(unit, target_pos)) {
-                Actions()->UnitCommand(unit, ABILITY_ID::SMART, target_pos);
-                return;
-            }
+            // Nothing here, scout somewhere random. Stays on the enemy position if no random spot can be reached.
+            TryFindRandomPathableLocation(unit, [this, unit, target_pos](bool found, const Point2D& location) {
+                if (unit->is_alive) {
+                    Actions()->UnitCommand(unit, ABILITY_ID::SMART, found ? location : target_pos);
+                }
+            });
+            return;
         }
         else if (!enemy_units.empty())
         {
@@ -307,39 +443,44 @@ void MultiplayerBot::ScoutWithUnit(const Unit* unit, const ObservationInterface*
         Actions()->UnitCommand(unit, ABILITY_ID::SMART, target_pos);
     }
     else {
-        if (TryFindRandomPathableLocation(unit, target_pos)) {
-            Actions()->UnitCommand(unit, ABILITY_ID::SMART, target_pos);
-        }
+        TryFindRandomPathableLocation(unit, [this, unit](bool found, const Point2D& location) {
+            if (found && unit->is_alive) {
+                Actions()->UnitCommand(unit, ABILITY_ID::SMART, location);
+            }
+        });
     }
 }
 
-//Try build structure given a location. This is used most of the time
-bool MultiplayerBot::TryBuildStructure(AbilityID ability_type_for_structure, UnitTypeID unit_type, Point2D location, bool isExpansion = false) {
-
-    const ObservationInterface* observation = Observation();
-    Units workers = observation->GetUnits(Unit::Alliance::Self, IsUnit(unit_type));
+const Unit* MultiplayerBot::FindBuilder(AbilityID ability_type_for_structure, UnitTypeID worker_type) {
+    Units workers = Observation()->GetUnits(Unit::Alliance::Self, IsUnit(worker_type));
 
     //if we have no workers Don't build
     if (workers.empty()) {
-        return false;
+        return nullptr;
     }
 
     // Check to see if there is already a worker heading out to build it
     for (const auto& worker : workers) {
         for (const auto& order : worker->orders) {
             if (order.ability_id == ability_type_for_structure) {
-                return false;
+                return nullptr;
             }
         }
     }
 
     // If no worker is already building one, get a random worker to build one
-    const Unit* unit = GetRandomEntry(workers);
+    return randomEntry(workers);
+}
 
-    // Check to see if unit can make it there
-    if (Query()->PathingDistance(unit, location) < 0.1f) {
+//Try build structure given a location. This is used most of the time
+bool MultiplayerBot::TryBuildStructure(AbilityID ability_type_for_structure, UnitTypeID unit_type, Point2D location, bool isExpansion = false) {
+    ApiCallSite call_site(api_counters_, "TryBuildStructure");
+
+    const Unit* unit = FindBuilder(ability_type_for_structure, unit_type);
+    if (!unit) {
         return false;
     }
+
     if (!isExpansion) {
         for (const auto& expansion : expansions_) {
             if (Distance2D(location, Point2D(expansion.x, expansion.y)) < 7) {
@@ -347,97 +488,168 @@ bool MultiplayerBot::TryBuildStructure(AbilityID ability_type_for_structure, Uni
             }
         }
     }
-    // Check to see if unit can build there
-    if (Query()->Placement(ability_type_for_structure, location)) {
-        Actions()->UnitCommand(unit, ability_type_for_structure, location);
-        return true;
+
+    // Spots the placement grid already rules out are not worth a query
+    if (!placement_.CanPlace(ability_type_for_structure, location)) {
+        return false;
     }
-    return false;
+
+    // Check to see if unit can make it there, the game is only asked if our grid cannot tell
+    GridPathfinder::Reach reach = pathfinder_.FindPath(unit, location);
+    if (reach == GridPathfinder::Reach::Unreachable) {
+        return false;
+    }
+
+    // Check to see if unit can build there
+    QueryBroker::Request request;
+    if (reach == GridPathfinder::Reach::Unknown) {
+        request.PathingDistance(unit, location);
+    }
+    request.Placement(ability_type_for_structure, location);
+    query_broker_.Submit(request, [this, unit, ability_type_for_structure, location](const QueryBroker::Results& results) {
+        ApiCallSite call_site(api_counters_, "TryBuildStructure");
+        bool reachable = results.distances.empty() || results.distances[0] >= 0.1f;
+        if (unit->is_alive && reachable && results.placeable[0]) {
+            Actions()->UnitCommand(unit, ability_type_for_structure, location);
+        }
+    });
+    return true;
 
 }
 
 //Try to build a structure based on tag, Used mostly for Vespene, since the pathing check will fail even though the geyser is "Pathable"
 bool MultiplayerBot::TryBuildStructure(AbilityID ability_type_for_structure, UnitTypeID unit_type, Tag location_tag) {
-    const ObservationInterface* observation = Observation();
-    Units workers = observation->GetUnits(Unit::Alliance::Self, IsUnit(unit_type));
-    const Unit* target = observation->GetUnit(location_tag);
-
-    if (workers.empty()) {
+    ApiCallSite call_site(api_counters_, "TryBuildStructure");
+    const Unit* target = Observation()->GetUnit(location_tag);
+    if (!target) {
         return false;
     }
 
-    // Check to see if there is already a worker heading out to build it
-    for (const auto& worker : workers) {
-        for (const auto& order : worker->orders) {
-            if (order.ability_id == ability_type_for_structure) {
-                return false;
-            }
-        }
+    const Unit* unit = FindBuilder(ability_type_for_structure, unit_type);
+    if (!unit) {
+        return false;
     }
 
-    // If no worker is already building one, get a random worker to build one
-    const Unit* unit = GetRandomEntry(workers);
-
     // Check to see if unit can build there
-    if (Query()->Placement(ability_type_for_structure, target->pos)) {
-        Actions()->UnitCommand(unit, ability_type_for_structure, target);
-        return true;
-    }
-    return false;
+    QueryBroker::Request request;
+    request.Placement(ability_type_for_structure, target->pos);
+    query_broker_.Submit(request, [this, unit, ability_type_for_structure, target](const QueryBroker::Results& results) {
+        ApiCallSite call_site(api_counters_, "TryBuildStructure");
+        if (unit->is_alive && results.placeable[0]) {
+            Actions()->UnitCommand(unit, ability_type_for_structure, target);
+        }
+    });
+    return true;
 
 }
 
 //Expands to nearest location and updates the start location to be between the new location and old bases.
 bool MultiplayerBot::TryExpand(AbilityID build_ability, UnitTypeID worker_type) {
-    const ObservationInterface* observation = Observation();
-    float minimum_distance = std::numeric_limits<float>::max();
-    Point3D closest_expansion;
+    ApiCallSite call_site(api_counters_, "TryExpand");
+    const Unit* unit = FindBuilder(build_ability, worker_type);
+    if (!unit) {
+        return false;
+    }
+
+    // Every expansion is checked in the one batch, the closest free one the worker can reach gets the town hall.
+    // Reachability comes from our grid, expansions it cannot settle are queued as pathing queries.
+    std::vector<Point3D> candidates;
+    std::vector<int> pathing_index; // Index into the pathing answers, -1 if the grid said reachable
+    QueryBroker::Request request;
     for (const auto& expansion : expansions_) {
-        float current_distance = Distance2D(startLocation_, expansion);
-        if (current_distance < .01f) {
+        if (Distance2D(startLocation_, expansion) < .01f) {
             continue;
         }
+        if (!placement_.CanPlace(build_ability, expansion)) {
+            continue;
+        }
+        GridPathfinder::Reach reach = pathfinder_.FindPath(unit, expansion);
+        if (reach == GridPathfinder::Reach::Unreachable) {
+            continue;
+        }
+        candidates.push_back(expansion);
+        request.Placement(build_ability, expansion);
+        if (reach == GridPathfinder::Reach::Unknown) {
+            pathing_index.push_back(static_cast<int>(request.pathing.size()));
+            request.PathingDistance(unit, expansion);
+        }
+        else {
+            pathing_index.push_back(-1);
+        }
+    }
+    if (candidates.empty()) {
+        return false;
+    }
 
-        if (current_distance < minimum_distance) {
-            if (Query()->Placement(build_ability, expansion)) {
-                closest_expansion = expansion;
+    query_broker_.Submit(request, [this, unit, build_ability, candidates, pathing_index](const QueryBroker::Results& results) {
+        ApiCallSite call_site(api_counters_, "TryExpand");
+        float minimum_distance = std::numeric_limits<float>::max();
+        const Point3D* closest_expansion = nullptr;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            float current_distance = GroundDistance(startLocation_, candidates[i]);
+            bool reachable = pathing_index[i] < 0 || results.distances[pathing_index[i]] >= 0.1f;
+            if (current_distance < minimum_distance && results.placeable[i] && reachable) {
+                closest_expansion = &candidates[i];
                 minimum_distance = current_distance;
             }
         }
-    }
-    //only update staging location up till 3 bases.
-    if (TryBuildStructure(build_ability, worker_type, closest_expansion, true) && observation->GetUnits(Unit::Self, IsTownHall()).size() < 4) {
-        staging_location_ = Point3D(((staging_location_.x + closest_expansion.x) / 2), ((staging_location_.y + closest_expansion.y) / 2),
-            ((staging_location_.z + closest_expansion.z) / 2));
-        return true;
-    }
-    return false;
+        if (!closest_expansion || !unit->is_alive) {
+            return;
+        }
+
+        Actions()->UnitCommand(unit, build_ability, *closest_expansion);
+        //only update staging location up till 3 bases.
+        if (Observation()->GetUnits(Unit::Self, IsTownHall()).size() < 4) {
+            staging_location_ = Point3D(((staging_location_.x + closest_expansion->x) / 2), ((staging_location_.y + closest_expansion->y) / 2),
+                ((staging_location_.z + closest_expansion->z) / 2));
+        }
+    });
+    return true;
 
 }
 
 //Tries to build a geyser for a base
 bool MultiplayerBot::TryBuildGas(AbilityID build_ability, UnitTypeID worker_type, Point2D base_location) {
+    ApiCallSite call_site(api_counters_, "TryBuildGas");
     const ObservationInterface* observation = Observation();
     Units geysers = observation->GetUnits(Unit::Alliance::Neutral, IsVespeneGeyser());
 
     //only search within this radius
-    float minimum_distance = 15.0f;
-    Tag closestGeyser = 0;
+    Units candidates;
+    QueryBroker::Request request;
     for (const auto& geyser : geysers) {
-        float current_distance = Distance2D(base_location, geyser->pos);
-        if (current_distance < minimum_distance) {
-            if (Query()->Placement(build_ability, geyser->pos)) {
-                minimum_distance = current_distance;
-                closestGeyser = geyser->tag;
-            }
+        if (Distance2D(base_location, geyser->pos) < 15.0f) {
+            candidates.push_back(geyser);
+            request.Placement(build_ability, geyser->pos);
         }
     }
 
     // In the case where there are no more available geysers nearby
-    if (closestGeyser == 0) {
+    if (candidates.empty()) {
+        return false;
+    }
+
+    const Unit* unit = FindBuilder(build_ability, worker_type);
+    if (!unit) {
         return false;
     }
-    return TryBuildStructure(build_ability, worker_type, closestGeyser);
+
+    query_broker_.Submit(request, [this, unit, build_ability, base_location, candidates](const QueryBroker::Results& results) {
+        ApiCallSite call_site(api_counters_, "TryBuildGas");
+        float minimum_distance = std::numeric_limits<float>::max();
+        const Unit* closest_geyser = nullptr;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            float current_distance = Distance2D(base_location, candidates[i]->pos);
+            if (current_distance < minimum_distance && results.placeable[i]) {
+                minimum_distance = current_distance;
+                closest_geyser = candidates[i];
+            }
+        }
+        if (closest_geyser && unit->is_alive) {
+            Actions()->UnitCommand(unit, build_ability, closest_geyser);
+        }
+    });
+    return true;
 
 }
 
@@ -501,7 +713,7 @@ void MultiplayerBot::MineIdleWorkers(const Unit* worker, AbilityID worker_gather
     }
 
     //If all workers are spots are filled just go to any base.
-    const Unit* random_base = GetRandomEntry(bases);
+    const Unit* random_base = randomEntry(bases);
     valid_mineral_patch = FindNearestMineralPatch(random_base->pos);
     Actions()->UnitCommand(worker, worker_gather_command, valid_mineral_patch);
 }
@@ -634,7 +846,7 @@ void MultiplayerBot::OnNuclearLaunchDetected() {
 void ProtossMultiplayerBot::ManageArmy() {
     const ObservationInterface* observation = Observation();
     Units enemy_units = observation->GetUnits(Unit::Alliance::Enemy);
-    Units army = observation->GetUnits(Unit::Alliance::Self, IsArmy(observation));
+    Units army = observation->GetUnits(Unit::Alliance::Self, IsArmy(unit_type_table_));
     int wait_til_supply = 100;
 
     //There are no enemies yet, and we don't have a big army
@@ -1071,10 +1283,10 @@ bool ProtossMultiplayerBot::TryWarpInUnit(ABILITY_ID ability_type_for_unit) {
         return false;
     }
 
-    const PowerSource& random_power_source = GetRandomEntry(power_sources);
+    const PowerSource& random_power_source = randomEntry(power_sources);
     float radius = random_power_source.radius;
-    float rx = GetRandomScalar();
-    float ry = GetRandomScalar();
+    float rx = randomScalar();
+    float ry = randomScalar();
     Point2D build_location = Point2D(random_power_source.position.x + rx * radius, random_power_source.position.y + ry * radius);
 
     // If the warp location is walled off, don't warp there.
@@ -1119,7 +1331,7 @@ bool ProtossMultiplayerBot::TryBuildStructureNearPylon(AbilityID ability_type_fo
         return false;
     }
 
-    const PowerSource& random_power_source = GetRandomEntry(power_sources);
+    const PowerSource& random_power_source = randomEntry(power_sources);
     if (observation->GetUnit(random_power_source.tag) != nullptr) {
         if (observation->GetUnit(random_power_source.tag)->unit_type == UNIT_TYPEID::PROTOSS_WARPPRISM) {
             return false;
@@ -1129,8 +1341,8 @@ bool ProtossMultiplayerBot::TryBuildStructureNearPylon(AbilityID ability_type_fo
         return false;
     }
     float radius = random_power_source.radius;
-    float rx = GetRandomScalar();
-    float ry = GetRandomScalar();
+    float rx = randomScalar();
+    float ry = randomScalar();
     Point2D build_location = Point2D(random_power_source.position.x + rx * radius, random_power_source.position.y + ry * radius);
     return TryBuildStructure(ability_type_for_structure, UNIT_TYPEID::PROTOSS_PROBE, build_location);
 }
@@ -1158,8 +1370,8 @@ bool ProtossMultiplayerBot::TryBuildPylon() {
     }
 
     // Try and build a pylon. Find a random Probe and give it the order.
-    float rx = GetRandomScalar();
-    float ry = GetRandomScalar();
+    float rx = randomScalar();
+    float ry = randomScalar();
     Point2D build_location = Point2D(staging_location_.x + rx * 15, staging_location_.y + ry * 15);
     return TryBuildStructure(ABILITY_ID::BUILD_PYLON, UNIT_TYPEID::PROTOSS_PROBE, build_location);
 }
@@ -1232,6 +1444,9 @@ bool ProtossMultiplayerBot::TryBuildProbe() {
 
 void ProtossMultiplayerBot::OnStep() {
 
+    // The checks this step queues are sent on the way out, whichever return it leaves by.
+    QueryFlush flush_queries(*this);
+
     const ObservationInterface* observation = Observation();
 
     //Throttle some behavior that can wait to avoid duplicate orders.
@@ -1251,7 +1466,7 @@ void ProtossMultiplayerBot::OnStep() {
         if (nuke_detected_frame + 400 < observation->GetGameLoop()) {
             nuke_detected = false;
         }
-        Units units = observation->GetUnits(Unit::Self, IsArmy(observation));
+        Units units = observation->GetUnits(Unit::Self, IsArmy(unit_type_table_));
         for (const auto& unit : units) {
             RetreatWithUnit(unit, startLocation_);
         }
@@ -1265,13 +1480,10 @@ void ProtossMultiplayerBot::OnStep() {
 
     BuildOrder();
 
-    if (TryBuildPylon()) {
-        return;
-    }
+    // Structures only queue a placement check here, whether they get built is settled when the queries are flushed.
+    TryBuildPylon();
 
-    if (TryBuildAssimilator()) {
-        return;
-    }
+    TryBuildAssimilator();
 
     if (TryBuildProbe()) {
         return;
@@ -1281,9 +1493,7 @@ void ProtossMultiplayerBot::OnStep() {
         return;
     }
 
-    if (TryBuildExpansionNexus()) {
-        return;
-    }
+    TryBuildExpansionNexus();
 }
 
 void ProtossMultiplayerBot::OnGameEnd() {
@@ -1362,8 +1572,8 @@ bool ZergMultiplayerBot::TryBuildDrone() {
 }
 
 bool ZergMultiplayerBot::TryBuildOnCreep(AbilityID ability_type_for_structure, UnitTypeID unit_type) {
-    float rx = GetRandomScalar();
-    float ry = GetRandomScalar();
+    float rx = randomScalar();
+    float ry = randomScalar();
     const ObservationInterface* observation = Observation();
     Point2D build_location = Point2D(startLocation_.x + rx * 15, startLocation_.y + ry * 15);
 
@@ -1478,7 +1688,7 @@ void ZergMultiplayerBot::ManageArmy() {
     const ObservationInterface* observation = Observation();
 
     Units enemy_units = observation->GetUnits(Unit::Alliance::Enemy);
-    Units army = observation->GetUnits(Unit::Alliance::Self, IsArmy(observation));
+    Units army = observation->GetUnits(Unit::Alliance::Self, IsArmy(unit_type_table_));
     int wait_til_supply = 100;
 
     if (enemy_units.empty() && observation->GetFoodArmy() < wait_til_supply) {
@@ -1508,11 +1718,8 @@ void ZergMultiplayerBot::ManageArmy() {
                     }
                     const Unit* enemy_unit = observation->GetUnit(closest_unit);
 
-                    auto attributes = observation->GetUnitTypeData().at(enemy_unit->unit_type).attributes;
-                    for (const auto& attribute : attributes) {
-                        if (attribute == Attribute::Structure) {
-                            Actions()->UnitCommand(unit, ABILITY_ID::EFFECT_CAUSTICSPRAY, enemy_unit);
-                        }
+                    if (unit_type_table_.IsStructure(enemy_unit->unit_type)) {
+                        Actions()->UnitCommand(unit, ABILITY_ID::EFFECT_CAUSTICSPRAY, enemy_unit);
                     }
                     if (!unit->orders.empty()) {
                         if (unit->orders.front().ability_id == ABILITY_ID::EFFECT_CAUSTICSPRAY) {
@@ -1629,14 +1836,7 @@ void ZergMultiplayerBot::ManageArmy() {
                     bool is_flying = false;
                     float distance = std::numeric_limits<float>::max();
                     for (const auto& u : enemy_units) {
-                        auto attributes = observation->GetUnitTypeData().at(u->unit_type).attributes;
-                        bool is_structure = false;
-                        for (const auto& attribute : attributes) {
-                            if (attribute == Attribute::Structure) {
-                                is_structure = true;
-                            }
-                        }
-                        if (is_structure) {
+                        if (unit_type_table_.IsStructure(u->unit_type)) {
                             continue;
                         }
                         float d = Distance2D(u->pos, unit->pos);
@@ -2026,6 +2226,9 @@ bool ZergMultiplayerBot::BuildExtractor() {
 
 void ZergMultiplayerBot::OnStep() {
 
+    // The checks this step queues are sent on the way out, whichever return it leaves by.
+    QueryFlush flush_queries(*this);
+
     const ObservationInterface* observation = Observation();
     Units base = observation->GetUnits(Unit::Alliance::Self, IsTownHall());
 
@@ -2046,7 +2249,7 @@ void ZergMultiplayerBot::OnStep() {
         if (nuke_detected_frame + 400 < observation->GetGameLoop()) {
             nuke_detected = false;
         }
-        Units units = observation->GetUnits(Unit::Self, IsArmy(observation));
+        Units units = observation->GetUnits(Unit::Self, IsArmy(unit_type_table_));
         for (const auto& unit : units) {
             RetreatWithUnit(unit, startLocation_);
         }
@@ -2070,13 +2273,10 @@ void ZergMultiplayerBot::OnStep() {
         BuildArmy();
     }
 
-    if (BuildExtractor()) {
-        return;
-    }
+    // Structures only queue a placement check here, whether they get built is settled when the queries are flushed.
+    BuildExtractor();
 
-    if (TryBuildExpansionHatch()) {
-        return;
-    }
+    TryBuildExpansionHatch();
 }
 
 void ZergMultiplayerBot::OnUnitIdle(const Unit* unit) {
@@ -2148,8 +2348,8 @@ bool TerranMultiplayerBot::TryBuildSupplyDepot()  {
     }
 
     // Try and build a supply depot. Find a random SCV and give it the order.
-    float rx = GetRandomScalar();
-    float ry = GetRandomScalar();
+    float rx = randomScalar();
+    float ry = randomScalar();
     Point2D build_location = Point2D(staging_location_.x + rx * 15, staging_location_.y + ry * 15);
     return TryBuildStructure(ABILITY_ID::BUILD_SUPPLYDEPOT, UNIT_TYPEID::TERRAN_SCV, build_location);
 }
@@ -2500,8 +2700,8 @@ void TerranMultiplayerBot::BuildOrder() {
 }
 
 bool TerranMultiplayerBot::TryBuildAddOn(AbilityID ability_type_for_structure, Tag base_structure) {
-    float rx = GetRandomScalar();
-    float ry = GetRandomScalar();
+    float rx = randomScalar();
+    float ry = randomScalar();
     const Unit* unit = Observation()->GetUnit(base_structure);
 
     if (unit->build_progress != 1) {
@@ -2510,7 +2710,7 @@ bool TerranMultiplayerBot::TryBuildAddOn(AbilityID ability_type_for_structure, T
 
     Point2D build_location = Point2D(unit->pos.x + rx * 15, unit->pos.y + ry * 15);
  
-    Units units = Observation()->GetUnits(Unit::Self, IsStructure(Observation()));
+    Units units = Observation()->GetUnits(Unit::Self, IsStructure(unit_type_table_));
 
     if (Query()->Placement(ability_type_for_structure, unit->pos, unit)) {
         Actions()->UnitCommand(unit, ability_type_for_structure);
@@ -2537,11 +2737,11 @@ bool TerranMultiplayerBot::TryBuildAddOn(AbilityID ability_type_for_structure, T
 }
 
 bool TerranMultiplayerBot::TryBuildStructureRandom(AbilityID ability_type_for_structure, UnitTypeID unit_type) {
-    float rx = GetRandomScalar();
-    float ry = GetRandomScalar();
+    float rx = randomScalar();
+    float ry = randomScalar();
     Point2D build_location = Point2D(staging_location_.x + rx * 15, staging_location_.y + ry * 15);
 
-    Units units = Observation()->GetUnits(Unit::Self, IsStructure(Observation()));
+    Units units = Observation()->GetUnits(Unit::Self, IsStructure(unit_type_table_));
     float distance = std::numeric_limits<float>::max();
     for (const auto& u : units) {
         if (u->unit_type == UNIT_TYPEID::TERRAN_SUPPLYDEPOTLOWERED) {
@@ -2631,7 +2831,7 @@ void TerranMultiplayerBot::ManageArmy() {
 
     Units enemy_units = observation->GetUnits(Unit::Alliance::Enemy);
 
-    Units army = observation->GetUnits(Unit::Alliance::Self, IsArmy(observation));
+    Units army = observation->GetUnits(Unit::Alliance::Self, IsArmy(unit_type_table_));
     int wait_til_supply = 100;
     if (mech_build_) {
         wait_til_supply = 110;
@@ -2923,9 +3123,11 @@ bool TerranMultiplayerBot::BuildRefinery() {
 }
 void TerranMultiplayerBot::OnStep() {
 
+    // The checks this step queues are sent on the way out, whichever return it leaves by.
+    QueryFlush flush_queries(*this);
 
     const ObservationInterface* observation = Observation();
-    Units units = observation->GetUnits(Unit::Self, IsArmy(observation));
+    Units units = observation->GetUnits(Unit::Self, IsArmy(unit_type_table_));
     Units nukes = observation->GetUnits(Unit::Self, IsUnit(UNIT_TYPEID::TERRAN_NUKE));
 
     //Throttle some behavior that can wait to avoid duplicate orders.
@@ -2959,18 +3161,14 @@ void TerranMultiplayerBot::OnStep() {
     if (TryBuildSCV())
         return;
 
-    if (TryBuildSupplyDepot())
-        return;
+    // Structures only queue a placement check here, whether they get built is settled when the queries are flushed.
+    TryBuildSupplyDepot();
 
     BuildArmy();
 
-    if (BuildRefinery()) {
-        return;
-    }
+    BuildRefinery();
 
-    if (TryBuildExpansionCom()) {
-        return;
-    }
+    TryBuildExpansionCom();
 }
 
 void TerranMultiplayerBot::OnUnitIdle(const Unit* unit) {
@@ -3062,8 +3260,8 @@ bool TerranBot::TryBuildStructure(AbilityID ability_type_for_structure, UnitType
     if (!GetRandomUnit(unit, observation, unit_type))
         return false;
 
-    float rx = GetRandomScalar();
-    float ry = GetRandomScalar();
+    float rx = randomScalar();
+    float ry = randomScalar();
 
     Actions()->UnitCommand(unit, ability_type_for_structure, unit->pos + Point2D(rx, ry) * 15.0f);
     return true;
@@ -4,6 +4,16 @@
 #include "sc2api/sc2_agent.h"
 #include "sc2api/sc2_map_info.h"
 
+#include "api_counters.h"
+#include "distance_fields.h"
+#include "grid_pathfinder.h"
+#include "kd_tree.h"
+#include "map_cache.h"
+#include "placement_validator.h"
+#include "query_broker.h"
+#include "unit_counter.h"
+#include "unit_type_table.h"
+
 namespace sc2 {
 
 class MarineMicroBot : public Agent {
@@ -57,8 +67,29 @@ public:
 
     void PrintStatus(std::string msg);
 
+    // These shadow Agent's accessors so a headless run can hand the bot its own interfaces.
+    // Without SetInterfaces they return Agent's.
+    const ObservationInterface* Observation() const;
+    ActionInterface* Actions();
+    QueryInterface* Query();
+    void SetInterfaces(const ObservationInterface* observation, ActionInterface* actions, QueryInterface* query);
+
+    // With BOT_MAP_CACHE set to a directory, OnGameStart loads the map's expansions and distance fields from there,
+    // or saves them for the next game. Recordings and replays turn it off, setup's queries have to be in them.
+    void DisableMapCache() { map_cache_enabled_ = false; }
+
     virtual void OnGameStart();
 
+    virtual void OnUnitDestroyed(const Unit* unit) override;
+
+    virtual void OnUnitCreated(const Unit* unit) override;
+
+    virtual void OnBuildingConstructionComplete(const Unit* unit) override;
+
+    // Enemy structures coming into sight are laid over pathfinder_ and placement_.
+    virtual void OnUnitEnterVision(const Unit* unit) override;
+
+    // Unit counts are read from unit_counter_, the observation is only used for the periodic consistency check.
     size_t CountUnitType(const ObservationInterface* observation, UnitTypeID unit_type);
 
     size_t CountUnitTypeBuilding(const ObservationInterface* observation, UNIT_TYPEID production_building, ABILITY_ID ability);
@@ -71,11 +102,17 @@ public:
 
     const Unit* FindNearestMineralPatch(const Point2D& start);
 
+    // Up to k mineral patches closest to start, closest first.
+    Units FindNearestMineralPatches(const Point2D& start, size_t k);
+
     // Tries to find a random location that can be pathed to on the map.
     // Returns 'true' if a new, random location has been found that is pathable by the unit.
     bool FindEnemyPosition(Point2D& target_pos);
 
-    bool TryFindRandomPathableLocation(const Unit* unit, Point2D& target_pos);
+    // Checks a few random locations with pathfinder_, the ones it cannot settle in one batch on query_broker_.
+    // then is called with found set and a location the unit can path to, or with found false if none of them were;
+    // right away if pathfinder_ found one, otherwise once query_broker_ is flushed.
+    void TryFindRandomPathableLocation(const Unit* unit, std::function<void(bool found, const Point2D& location)> then);
 
     void AttackWithUnitType(UnitTypeID unit_type, const ObservationInterface* observation);
 
@@ -89,6 +126,14 @@ public:
 
     void RetreatWithUnit(const Unit* unit, Point2D retreat_position);
 
+    // The TryBuild functions and TryExpand drop spots placement_ rejects, then check placement through query_broker_,
+    // and pathing through it where pathfinder_ cannot tell. The build command goes out when it is flushed.
+    // They return true if a check was queued, which is no promise the order goes out: callers should not take it as
+    // the step's spending being done.
+
+    // A random worker of worker_type to build with, nullptr if there is none or one is already on its way to build this.
+    const Unit* FindBuilder(AbilityID ability_type_for_structure, UnitTypeID worker_type);
+
     //Try build structure given a location. This is used most of the time
     bool TryBuildStructure(AbilityID ability_type_for_structure, UnitTypeID unit_type, Point2D location, bool isExpansion);
     //Try to build a structure based on tag, Used mostly for Vespene, since the pathing check will fail even though the geyser is "Pathable"
@@ -113,6 +158,24 @@ public:
     // To ensure that we do not over or under saturate any base.
     void ManageWorkers(UNIT_TYPEID worker_type, AbilityID worker_gather_command, UNIT_TYPEID vespene_building_type);
 
+    // Sends the checks queued on query_broker_ and runs the decisions waiting on them.
+    void FlushQueries();
+
+    // Calls FlushQueries when it goes out of scope, so every return from OnStep sends the step's checks
+    // and the orders waiting on them go out in the same step, before FindBuilder looks for a worker again.
+    class QueryFlush {
+    public:
+        explicit QueryFlush(MultiplayerBot& bot) : bot_(bot) {}
+        ~QueryFlush() { bot_.FlushQueries(); }
+
+    private:
+        MultiplayerBot& bot_;
+    };
+
+    // Ground distance from a base, the start location or an expansion, to the point, from distance_fields_.
+    // Straight-line distance if base is neither or the point cannot be walked to.
+    float GroundDistance(const Point2D& base, const Point2D& point) const;
+
     virtual void OnNuclearLaunchDetected() final;
 
     uint32_t current_game_loop_ = 0;
@@ -125,9 +188,46 @@ public:
     Point3D startLocation_;
     Point3D staging_location_;
 
+    // Attributes, ranges and costs per unit type, built at game start.
+    UnitTypeTable unit_type_table_;
+
+    // Per-type unit counts kept current from unit events.
+    UnitCounter unit_counter_;
+    // Game loops between consistency checks of unit_counter_ against a full scan.
+    uint32_t unit_count_verify_period_ = 224;
+
+    // Query round trips, GetUnits calls and unit commands per call site, see ApiCallSite.
+    ApiCounters api_counters_;
+
+    // Placement and pathing checks of this step, sent as one batch by FlushQueries.
+    QueryBroker query_broker_;
+
+    // Ground reachability on the map's pathing grid with our own and seen enemy structures laid over it.
+    GridPathfinder pathfinder_;
+
+    // Map analysis from an earlier game on this map, distance_fields_ reads from it when it was found.
+    MapCache map_cache_;
+    bool map_cache_enabled_ = true;
+
+    // Ground distance fields from startLocation_ and each of expansions_, in that order.
+    DistanceFields distance_fields_;
+
+    // Building placement on the map's placement grid with our own, seen enemy and neutral structures laid over it.
+    PlacementValidator placement_;
+
 private:
     std::string last_action_text_;
 
+    // Mineral fields never move, so they are indexed once at game start and only removed as they deplete.
+    PointKDTree mineral_fields_;
+
+    void VerifyUnitCounts(const ObservationInterface* observation);
+    uint32_t last_unit_count_verify_ = 0;
+
+    const ObservationInterface* observation_override_ = nullptr;
+    ActionInterface* actions_override_ = nullptr;
+    QueryInterface* query_override_ = nullptr;
+
 };
 
 
@@ -0,0 +1,105 @@
+#include "construction_registry.h"
+
+#include <limits>
+
+namespace sc2
+{
+	void ConstructionRegistry::Add(AbilityID ability, Tag builder, const Point2D& location, uint32_t game_loop)
+	{
+		// A builder only carries one construction order at a time.
+		OnBuilderLost(builder);
+
+		pending_[ability].push_back({ builder, location, game_loop });
+		builders_[builder] = ability;
+	}
+
+	size_t ConstructionRegistry::CountPending(AbilityID ability) const
+	{
+		auto found = pending_.find(ability);
+		return found == pending_.end() ? 0 : found->second.size();
+	}
+
+	void ConstructionRegistry::OnStructureStarted(AbilityID ability, const Point2D& position)
+	{
+		auto found = pending_.find(ability);
+		if (found == pending_.end() || found->second.empty())
+		{
+			return;
+		}
+
+		const std::vector<PendingConstruction>& entries = found->second;
+		size_t closest = 0;
+		float closest_distance = std::numeric_limits<float>::max();
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			float distance = DistanceSquared2D(entries[i].location, position);
+			if (distance < closest_distance)
+			{
+				closest_distance = distance;
+				closest = i;
+			}
+		}
+		constructing_[entries[closest].builder] = position;
+		Erase(ability, closest);
+	}
+
+	void ConstructionRegistry::OnStructureFinished(const Point2D& position)
+	{
+		// Same unit, same position, the margin only covers the structure having been seen from a different frame.
+		const float same_structure = 1.0f;
+		for (auto it = constructing_.begin(); it != constructing_.end(); ++it)
+		{
+			if (DistanceSquared2D(it->second, position) < same_structure * same_structure)
+			{
+				constructing_.erase(it);
+				return;
+			}
+		}
+	}
+
+	void ConstructionRegistry::OnBuilderLost(Tag builder)
+	{
+		constructing_.erase(builder);
+
+		auto found = builders_.find(builder);
+		if (found == builders_.end())
+		{
+			return;
+		}
+
+		uint32_t ability = found->second;
+		std::vector<PendingConstruction>& entries = pending_[ability];
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].builder == builder)
+			{
+				Erase(ability, i);
+				return;
+			}
+		}
+		builders_.erase(found);
+	}
+
+	void ConstructionRegistry::Expire(uint32_t game_loop, uint32_t timeout)
+	{
+		for (auto& entry : pending_)
+		{
+			std::vector<PendingConstruction>& entries = entry.second;
+			for (size_t i = entries.size(); i > 0; i--)
+			{
+				if (game_loop - entries[i - 1].issued_loop > timeout)
+				{
+					Erase(entry.first, i - 1);
+				}
+			}
+		}
+	}
+
+	void ConstructionRegistry::Erase(uint32_t ability, size_t index)
+	{
+		std::vector<PendingConstruction>& entries = pending_[ability];
+		builders_.erase(entries[index].builder);
+		entries[index] = entries.back();
+		entries.pop_back();
+	}
+}
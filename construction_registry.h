@@ -0,0 +1,48 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// A build order we have issued whose structure has not shown up yet.
+	struct PendingConstruction
+	{
+		Tag builder;
+		Point2D location;
+		uint32_t issued_loop;
+	};
+
+	// Registry of pending construction keyed by build ability, so duplicate-build checks are a lookup
+	// instead of a walk over every unit's orders. A builder stays booked while it constructs the structure.
+	class ConstructionRegistry
+	{
+	public:
+		void Add(AbilityID ability, Tag builder, const Point2D& location, uint32_t game_loop);
+
+		size_t CountPending(AbilityID ability) const;
+		bool IsBuilder(Tag unit) const { return builders_.count(unit) > 0 || constructing_.count(unit) > 0; }
+
+		// The structure built by ability appeared at position, clears the closest pending entry.
+		// Its builder stays booked until the structure is finished or the builder is lost.
+		void OnStructureStarted(AbilityID ability, const Point2D& position);
+
+		// The structure at position is finished, lets its builder go.
+		void OnStructureFinished(const Point2D& position);
+
+		// The builder died or gave up (went idle), its order will never be placed.
+		void OnBuilderLost(Tag builder);
+
+		// Drops entries issued more than timeout game loops ago.
+		void Expire(uint32_t game_loop, uint32_t timeout);
+
+	private:
+		void Erase(uint32_t ability, size_t index);
+
+		std::unordered_map<uint32_t, std::vector<PendingConstruction>> pending_;
+		std::unordered_map<Tag, uint32_t> builders_;
+		std::unordered_map<Tag, Point2D> constructing_; // Builder to the position of the structure it is building
+	};
+}
@@ -0,0 +1,201 @@
+#include "distance_fields.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace sc2
+{
+	namespace
+	{
+		// Cells no source reaches, also where a distance would no longer fit.
+		const uint16_t unreached = 0xFFFF;
+
+		// Step costs in tenths of a cell.
+		const uint32_t straight_cost = 10;
+		const uint32_t diagonal_cost = 14;
+
+		// Open cells this far around a blocked source or point are tried instead, enough to step out of a town hall.
+		const int search_radius = 4;
+
+		// Queued distances never run further ahead than the costliest seed, which the ring has to cover.
+		const uint32_t bucket_count = 128;
+	}
+
+	void DistanceFields::Build(const GridPathfinder& grid, const std::vector<Point2D>& sources)
+	{
+		if (!Prepare(grid, sources))
+		{
+			return;
+		}
+		size_t cells = static_cast<size_t>(width_) * height_;
+		storage_.resize(sources.size() * cells);
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			Flood(grid, sources[i], &storage_[i * cells]);
+		}
+		data_ = storage_.data();
+	}
+
+	void DistanceFields::Attach(const GridPathfinder& grid, const std::vector<Point2D>& sources, const uint16_t* data)
+	{
+		if (!Prepare(grid, sources))
+		{
+			return;
+		}
+		storage_.clear();
+		data_ = data;
+	}
+
+	bool DistanceFields::Prepare(const GridPathfinder& grid, const std::vector<Point2D>& sources)
+	{
+		sources_.clear();
+		storage_.clear();
+		data_ = nullptr;
+		if (!grid.Ready())
+		{
+			return false;
+		}
+
+		width_ = grid.Width();
+		height_ = grid.Height();
+		terrain_.resize(static_cast<size_t>(width_) * height_);
+		for (int y = 0; y < height_; y++)
+		{
+			for (int x = 0; x < width_; x++)
+			{
+				terrain_[y * width_ + x] = grid.IsTerrainPathable(x, y);
+			}
+		}
+		sources_ = sources;
+		return true;
+	}
+
+	void DistanceFields::Flood(const GridPathfinder& grid, const Point2D& source, uint16_t* field)
+	{
+		std::fill_n(field, static_cast<size_t>(width_) * height_, unreached);
+		buckets_.resize(bucket_count);
+		size_t queued = 0;
+
+		// The source's own cell if it is open, otherwise every open cell around it at its distance from the source.
+		int source_x = static_cast<int>(floor(source.x));
+		int source_y = static_cast<int>(floor(source.y));
+		int radius = grid.IsTerrainPathable(source_x, source_y) ? 0 : search_radius;
+		for (int y = source_y - radius; y <= source_y + radius; y++)
+		{
+			for (int x = source_x - radius; x <= source_x + radius; x++)
+			{
+				if (!grid.IsTerrainPathable(x, y))
+				{
+					continue;
+				}
+				uint32_t cost = static_cast<uint32_t>(lround(Distance2D(source, Point2D(x + 0.5f, y + 0.5f)) * straight_cost));
+				int cell = y * width_ + x;
+				field[cell] = static_cast<uint16_t>(cost);
+				buckets_[cost % bucket_count].push_back(cell);
+				queued++;
+			}
+		}
+
+		// Dijkstra with a bucket per distance, a step never costs a whole ring so a bucket only fills with its own distance.
+		for (uint32_t distance = 0; queued > 0; distance++)
+		{
+			std::vector<int>& bucket = buckets_[distance % bucket_count];
+			for (size_t i = 0; i < bucket.size(); i++)
+			{
+				int cell = bucket[i];
+				queued--;
+				if (field[cell] != distance)
+				{
+					continue;
+				}
+				int x = cell % width_;
+				int y = cell / width_;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int nx = x + dx;
+						int ny = y + dy;
+						if ((!dx && !dy) || !grid.IsTerrainPathable(nx, ny))
+						{
+							continue;
+						}
+						// Same moves as the pathfinder, no squeezing diagonally between two blocked cells.
+						if (dx && dy && (!grid.IsTerrainPathable(nx, y) || !grid.IsTerrainPathable(x, ny)))
+						{
+							continue;
+						}
+						uint32_t next_distance = distance + (dx && dy ? diagonal_cost : straight_cost);
+						int next = ny * width_ + nx;
+						if (next_distance < field[next])
+						{
+							field[next] = static_cast<uint16_t>(next_distance);
+							buckets_[next_distance % bucket_count].push_back(next);
+							queued++;
+						}
+					}
+				}
+			}
+			bucket.clear();
+		}
+	}
+
+	int DistanceFields::SourceAt(const Point2D& point, float max_offset) const
+	{
+		int closest = -1;
+		float closest_distance = max_offset;
+		for (size_t i = 0; i < sources_.size(); i++)
+		{
+			float distance = Distance2D(sources_[i], point);
+			if (distance <= closest_distance)
+			{
+				closest = static_cast<int>(i);
+				closest_distance = distance;
+			}
+		}
+		return closest;
+	}
+
+	float DistanceFields::Distance(size_t source, const Point2D& point) const
+	{
+		if (source >= sources_.size() || !data_)
+		{
+			return -1.0f;
+		}
+		const uint16_t* field = data_ + source * width_ * height_;
+		int point_x = static_cast<int>(floor(point.x));
+		int point_y = static_cast<int>(floor(point.y));
+		if (point_x < 0 || point_y < 0 || point_x >= width_ || point_y >= height_)
+		{
+			return -1.0f;
+		}
+		int cell = point_y * width_ + point_x;
+		if (terrain_[cell])
+		{
+			return field[cell] == unreached ? -1.0f : field[cell] / static_cast<float>(straight_cost);
+		}
+
+		float closest = -1.0f;
+		for (int radius = 1; radius <= search_radius && closest < 0.0f; radius++)
+		{
+			for (int y = point_y - radius; y <= point_y + radius; y++)
+			{
+				for (int x = point_x - radius; x <= point_x + radius; x++)
+				{
+					// Only the ring at this radius, the inside was tried already.
+					bool on_ring = abs(x - point_x) == radius || abs(y - point_y) == radius;
+					if (!on_ring || x < 0 || y < 0 || x >= width_ || y >= height_ || field[y * width_ + x] == unreached)
+					{
+						continue;
+					}
+					float distance = field[y * width_ + x] / static_cast<float>(straight_cost) + Distance2D(point, Point2D(x + 0.5f, y + 0.5f));
+					if (closest < 0.0f || distance < closest)
+					{
+						closest = distance;
+					}
+				}
+			}
+		}
+		return closest;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+#include "grid_pathfinder.h"
+
+namespace sc2
+{
+	// Ground distance from a few fixed points, the start location and the expansions, to every cell of the map.
+	// Each field is a Dijkstra flood over the bare terrain done once at game start, so asking how far a base is
+	// from a point by ground is a lookup. Distances are kept in tenths of a cell in 16 bits, a field is 2 bytes a cell.
+	// Structures are not in the fields, they follow the terrain only.
+	class DistanceFields
+	{
+	public:
+		// Floods a field from each source over the grid's terrain. Sources standing on blocked cells, a town hall
+		// on the starting grid, are flooded from the open cells around them.
+		void Build(const GridPathfinder& grid, const std::vector<Point2D>& sources);
+
+		// Takes fields built before for the same grid and sources, laid out as Data() gives them, see MapCache.
+		// The memory is used where it is, it has to outlive these fields.
+		void Attach(const GridPathfinder& grid, const std::vector<Point2D>& sources, const uint16_t* data);
+
+		size_t Size() const { return sources_.size(); }
+
+		// Every field one after another, Width() * Height() values each and row 0 at the bottom.
+		const uint16_t* Data() const { return data_; }
+		int Width() const { return width_; }
+		int Height() const { return height_; }
+
+		// The source within max_offset of point, -1 if there is none.
+		int SourceAt(const Point2D& point, float max_offset = 1.0f) const;
+
+		// Ground distance from the source to the point, negative if it cannot be walked. A point on a blocked cell,
+		// a base's own town hall say, is measured to the nearest reached cell around it.
+		float Distance(size_t source, const Point2D& point) const;
+
+	private:
+		bool Prepare(const GridPathfinder& grid, const std::vector<Point2D>& sources);
+		void Flood(const GridPathfinder& grid, const Point2D& source, uint16_t* field);
+
+		int width_ = 0;
+		int height_ = 0;
+		std::vector<uint8_t> terrain_; // 1 where pathable, to tell blocked cells from open ones no source reaches
+		std::vector<Point2D> sources_;
+		std::vector<uint16_t> storage_; // The fields when built here, empty when attached
+		const uint16_t* data_ = nullptr;
+
+		// Kept between floods for their capacity
+		std::vector<std::vector<int>> buckets_;
+	};
+}
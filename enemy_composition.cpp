@@ -0,0 +1,219 @@
+#include "enemy_composition.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace sc2
+{
+	namespace
+	{
+		// Stored counts are rebased before a fresh unit would weigh more than this.
+		const double max_scale = 1e30;
+
+		// When the table is full, units last seen this many half-lives ago count for little and go first.
+		const double stale_half_lives = 4.0;
+
+		// A unit in vision is counted afresh once a second rather than every step. At the bot's two minute
+		// half-life it fades by under 1% in between, and the step pays for a recount of a few units only.
+		const uint32_t refresh_loops = 22;
+
+		bool IsWorker(UnitTypeID unit_type)
+		{
+			switch (unit_type.ToType())
+			{
+			case UNIT_TYPEID::TERRAN_SCV:
+			case UNIT_TYPEID::TERRAN_MULE:
+			case UNIT_TYPEID::PROTOSS_PROBE:
+			case UNIT_TYPEID::ZERG_DRONE:
+				return true;
+			default:
+				return false;
+			}
+		}
+	}
+
+	void EnemyComposition::Init(uint32_t half_life_loops, size_t capacity)
+	{
+		decay_per_loop_ = log(2.0) / std::max<uint32_t>(1, half_life_loops);
+		capacity_ = std::max<size_t>(1, capacity);
+		Clear();
+	}
+
+	void EnemyComposition::Clear()
+	{
+		counted_.clear();
+		type_counts_.clear();
+		base_loop_ = 0;
+		army_units_ = 0;
+		army_supply_ = 0.0;
+		air_supply_ = 0.0;
+		armored_supply_ = 0.0;
+		light_supply_ = 0.0;
+	}
+
+	double EnemyComposition::Scale(uint32_t game_loop) const
+	{
+		return exp(decay_per_loop_ * (static_cast<double>(game_loop) - base_loop_));
+	}
+
+	double EnemyComposition::Fade(uint32_t game_loop) const
+	{
+		return exp(-decay_per_loop_ * (game_loop > base_loop_ ? game_loop - base_loop_ : 0));
+	}
+
+	void EnemyComposition::OnEnterVision(const Unit* unit, uint32_t game_loop, const UnitTypeInfo& info)
+	{
+		if (info.HasAttribute(Attribute::Structure))
+		{
+			return;
+		}
+
+		auto known = counted_.find(unit->tag);
+		if (known != counted_.end())
+		{
+			Apply(known->second, -1.0);
+			counted_.erase(known);
+		}
+		else if (counted_.size() >= capacity_)
+		{
+			MakeRoom(game_loop);
+		}
+
+		if (Scale(game_loop) > max_scale)
+		{
+			Rebase(game_loop);
+		}
+
+		Counted counted;
+		counted.unit_type = unit->unit_type;
+		counted.game_loop = game_loop;
+		counted.army_supply = IsWorker(unit->unit_type) ? 0.0f : info.food_required;
+		counted.air = unit->is_flying;
+		counted.armored = info.HasAttribute(Attribute::Armored);
+		counted.light = info.HasAttribute(Attribute::Light);
+		counted_[unit->tag] = counted;
+		Apply(counted, 1.0);
+	}
+
+	void EnemyComposition::Observe(const Units& enemies, uint32_t game_loop, const UnitTypeTable& unit_types)
+	{
+		for (const Unit* unit : enemies)
+		{
+			if (unit->display_type != Unit::DisplayType::Visible)
+			{
+				continue;
+			}
+			auto known = counted_.find(unit->tag);
+			if (known != counted_.end() && game_loop - known->second.game_loop < refresh_loops)
+			{
+				continue;
+			}
+			OnEnterVision(unit, game_loop, unit_types.Get(unit->unit_type));
+		}
+	}
+
+	void EnemyComposition::OnDestroyed(Tag tag)
+	{
+		auto known = counted_.find(tag);
+		if (known == counted_.end())
+		{
+			return;
+		}
+		Apply(known->second, -1.0);
+		counted_.erase(known);
+	}
+
+	void EnemyComposition::Apply(const Counted& counted, double sign)
+	{
+		double weight = sign * Scale(counted.game_loop);
+		uint32_t id = counted.unit_type;
+		if (id >= type_counts_.size())
+		{
+			type_counts_.resize(id + 1, 0.0);
+		}
+		type_counts_[id] += weight;
+
+		if (counted.army_supply <= 0.0f)
+		{
+			return;
+		}
+		double supply = weight * counted.army_supply;
+		army_supply_ += supply;
+		air_supply_ += counted.air ? supply : 0.0;
+		armored_supply_ += counted.armored ? supply : 0.0;
+		light_supply_ += counted.light ? supply : 0.0;
+
+		// Removals leave rounding behind, with no army left the shares would be rounding over rounding.
+		if (sign > 0.0)
+		{
+			army_units_++;
+		}
+		else if (--army_units_ == 0)
+		{
+			army_supply_ = 0.0;
+			air_supply_ = 0.0;
+			armored_supply_ = 0.0;
+			light_supply_ = 0.0;
+		}
+	}
+
+	void EnemyComposition::Rebase(uint32_t game_loop)
+	{
+		double fade = Fade(game_loop);
+		base_loop_ = game_loop;
+		for (double& count : type_counts_)
+		{
+			count *= fade;
+		}
+		army_supply_ *= fade;
+		air_supply_ *= fade;
+		armored_supply_ *= fade;
+		light_supply_ *= fade;
+	}
+
+	void EnemyComposition::MakeRoom(uint32_t game_loop)
+	{
+		// Everything gone stale, or failing that the unit seen longest ago.
+		uint32_t stale_loops = static_cast<uint32_t>(stale_half_lives * log(2.0) / decay_per_loop_);
+		auto oldest = counted_.end();
+		for (auto it = counted_.begin(); it != counted_.end();)
+		{
+			if (game_loop - it->second.game_loop > stale_loops)
+			{
+				Apply(it->second, -1.0);
+				it = counted_.erase(it);
+				continue;
+			}
+			if (oldest == counted_.end() || it->second.game_loop < oldest->second.game_loop)
+			{
+				oldest = it;
+			}
+			++it;
+		}
+		if (counted_.size() >= capacity_ && oldest != counted_.end())
+		{
+			Apply(oldest->second, -1.0);
+			counted_.erase(oldest);
+		}
+	}
+
+	double EnemyComposition::Count(UnitTypeID unit_type, uint32_t game_loop) const
+	{
+		uint32_t id = unit_type;
+		return id < type_counts_.size() ? std::max(0.0, type_counts_[id]) * Fade(game_loop) : 0.0;
+	}
+
+	double EnemyComposition::ArmySupply(uint32_t game_loop) const
+	{
+		return std::max(0.0, army_supply_) * Fade(game_loop);
+	}
+
+	double EnemyComposition::Share(double supply) const
+	{
+		if (army_supply_ <= 0.0)
+		{
+			return 0.0;
+		}
+		return std::min(1.0, std::max(0.0, supply / army_supply_));
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+#include "unit_type_table.h"
+
+namespace sc2
+{
+	// A running estimate of what the enemy fields, kept up from vision, the step's observation and death events.
+	// Each unit counts 1 while in vision and fades with a half-life from when it was last seen, so old
+	// sightings weigh less than fresh ones. Fading is never applied unit by unit: as in SightingHeatmap, counts are
+	// stored grown by the time since a base loop and scaled down on the way out, so every query is O(1).
+	// Army totals leave out workers and anything that costs no supply.
+	class EnemyComposition
+	{
+	public:
+		void Init(uint32_t half_life_loops, size_t capacity);
+
+		void Clear();
+
+		// An enemy unit came into vision. Seen before, its old count is replaced. Structures are not counted.
+		void OnEnterVision(const Unit* unit, uint32_t game_loop, const UnitTypeInfo& info);
+
+		// Counts every visible enemy in this step's observation afresh, units that stay in vision do not fade.
+		// A unit is recounted at most once every 22 game loops, about a second.
+		void Observe(const Units& enemies, uint32_t game_loop, const UnitTypeTable& unit_types);
+
+		void OnDestroyed(Tag tag);
+
+		// Units of the type, faded as of game_loop.
+		double Count(UnitTypeID unit_type, uint32_t game_loop) const;
+
+		// Army supply, faded as of game_loop.
+		double ArmySupply(uint32_t game_loop) const;
+
+		// Shares of army supply from 0 to 1, every unit fades alike so these need no loop.
+		double AirShare() const { return Share(air_supply_); }
+		double ArmoredShare() const { return Share(armored_supply_); }
+		double LightShare() const { return Share(light_supply_); }
+
+		size_t Size() const { return counted_.size(); }
+
+	private:
+		struct Counted
+		{
+			UnitTypeID unit_type;
+			uint32_t game_loop;   // When it was last seen
+			float army_supply;    // 0 for workers
+			bool air;
+			bool armored;
+			bool light;
+		};
+
+		double Scale(uint32_t game_loop) const;
+		double Fade(uint32_t game_loop) const;
+		double Share(double supply) const;
+		void Apply(const Counted& counted, double sign);
+		void Rebase(uint32_t game_loop);
+		void MakeRoom(uint32_t game_loop);
+
+		double decay_per_loop_ = 0.0; // ln 2 / half-life
+		size_t capacity_ = 0;
+		uint32_t base_loop_ = 0;      // Stored counts are as of this loop
+
+		std::unordered_map<Tag, Counted> counted_;
+		std::vector<double> type_counts_; // By unit type id
+		size_t army_units_ = 0;           // Counted units with army supply
+		double army_supply_ = 0.0;
+		double air_supply_ = 0.0;
+		double armored_supply_ = 0.0;
+		double light_supply_ = 0.0;
+	};
+}
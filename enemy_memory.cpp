@@ -0,0 +1,222 @@
+#include "enemy_memory.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace sc2
+{
+	namespace
+	{
+		const int32_t empty = -1;
+	}
+
+	void EnemyMemory::Init(size_t capacity, uint32_t forget_after_loops)
+	{
+		capacity_ = capacity > 0 ? capacity : 1;
+		forget_after_ = forget_after_loops;
+
+		// At most half full, probes stay short.
+		size_t slots = 1;
+		while (slots < capacity_ * 2)
+		{
+			slots *= 2;
+		}
+		mask_ = slots - 1;
+		slots_.assign(slots, empty);
+		records_.clear();
+		records_.reserve(capacity_);
+		observed_.clear();
+		observed_.reserve(capacity_);
+	}
+
+	void EnemyMemory::Clear()
+	{
+		std::fill(slots_.begin(), slots_.end(), empty);
+		records_.clear();
+		observed_.clear();
+	}
+
+	size_t EnemyMemory::Home(Tag tag) const
+	{
+		// Tags count up in their low bits, a multiplicative hash spreads them over the table.
+		return static_cast<size_t>((tag * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+	}
+
+	size_t EnemyMemory::FindSlot(Tag tag) const
+	{
+		size_t slot = Home(tag);
+		while (slots_[slot] != empty && records_[slots_[slot]].tag != tag)
+		{
+			slot = (slot + 1) & mask_;
+		}
+		return slot;
+	}
+
+	const EnemyRecord* EnemyMemory::Find(Tag tag) const
+	{
+		if (slots_.empty())
+		{
+			return nullptr;
+		}
+		size_t slot = FindSlot(tag);
+		return slots_[slot] != empty ? &records_[slots_[slot]] : nullptr;
+	}
+
+	void EnemyMemory::Update(const Unit* unit, uint32_t game_loop, bool structure)
+	{
+		if (slots_.empty())
+		{
+			return;
+		}
+
+		size_t slot = FindSlot(unit->tag);
+		if (slots_[slot] == empty)
+		{
+			if (records_.size() >= capacity_)
+			{
+				MakeRoom();
+				slot = FindSlot(unit->tag);
+			}
+			slots_[slot] = static_cast<int32_t>(records_.size());
+			EnemyRecord record;
+			record.tag = unit->tag;
+			record.last_seen = game_loop;
+			records_.push_back(record);
+			observed_.push_back(game_loop);
+		}
+
+		EnemyRecord& record = records_[slots_[slot]];
+		observed_[slots_[slot]] = game_loop;
+		record.unit_type = unit->unit_type;
+		record.structure = structure;
+		record.snapshot = unit->display_type == Unit::DisplayType::Snapshot;
+		if (!record.snapshot)
+		{
+			record.pos = unit->pos;
+			record.health = unit->health;
+			record.last_seen = game_loop;
+		}
+		else if (record.last_seen == game_loop)
+		{
+			// First heard of as a snapshot, that is all there is to go on.
+			record.pos = unit->pos;
+			record.health = unit->health;
+		}
+	}
+
+	void EnemyMemory::Observe(const Units& enemies, uint32_t game_loop, const UnitTypeTable& unit_types)
+	{
+		for (const Unit* unit : enemies)
+		{
+			Update(unit, game_loop, unit_types.IsStructure(unit->unit_type));
+		}
+
+		// Backwards, removal moves the last record into the hole.
+		for (size_t i = records_.size(); i-- > 0;)
+		{
+			const EnemyRecord& record = records_[i];
+			bool gone = record.structure ? observed_[i] != game_loop : game_loop - record.last_seen > forget_after_;
+			if (gone)
+			{
+				RemoveAt(FindSlot(record.tag));
+			}
+		}
+	}
+
+	void EnemyMemory::Remove(Tag tag)
+	{
+		if (slots_.empty())
+		{
+			return;
+		}
+		size_t slot = FindSlot(tag);
+		if (slots_[slot] != empty)
+		{
+			RemoveAt(slot);
+		}
+	}
+
+	void EnemyMemory::RemoveAt(size_t slot)
+	{
+		int32_t index = slots_[slot];
+
+		// Shift later entries of the probe run back into the hole, unless that would move one before its home slot.
+		size_t hole = slot;
+		size_t next = (hole + 1) & mask_;
+		while (slots_[next] != empty)
+		{
+			size_t home = Home(records_[slots_[next]].tag);
+			if (((next - home) & mask_) >= ((next - hole) & mask_))
+			{
+				slots_[hole] = slots_[next];
+				hole = next;
+			}
+			next = (next + 1) & mask_;
+		}
+		slots_[hole] = empty;
+
+		// Keep the records dense, the last one moves into the freed index.
+		int32_t last = static_cast<int32_t>(records_.size()) - 1;
+		if (index != last)
+		{
+			records_[index] = records_[last];
+			observed_[index] = observed_[last];
+			slots_[FindSlot(records_[index].tag)] = index;
+		}
+		records_.pop_back();
+		observed_.pop_back();
+	}
+
+	void EnemyMemory::MakeRoom()
+	{
+		// The unit seen longest ago, a structure only if there are no units.
+		size_t oldest = 0;
+		bool oldest_structure = true;
+		uint32_t oldest_seen = std::numeric_limits<uint32_t>::max();
+		for (size_t i = 0; i < records_.size(); i++)
+		{
+			const EnemyRecord& record = records_[i];
+			bool better = record.structure != oldest_structure ? !record.structure : record.last_seen < oldest_seen;
+			if (better)
+			{
+				oldest = i;
+				oldest_structure = record.structure;
+				oldest_seen = record.last_seen;
+			}
+		}
+		if (!records_.empty())
+		{
+			RemoveAt(FindSlot(records_[oldest].tag));
+		}
+	}
+
+	const EnemyRecord* EnemyMemory::NearestStructure(const Point2D& point) const
+	{
+		const EnemyRecord* nearest = nullptr;
+		float nearest_distance = std::numeric_limits<float>::max();
+		for (const EnemyRecord& record : records_)
+		{
+			if (!record.structure)
+			{
+				continue;
+			}
+			float distance = DistanceSquared2D(record.pos, point);
+			if (distance < nearest_distance)
+			{
+				nearest = &record;
+				nearest_distance = distance;
+			}
+		}
+		return nearest;
+	}
+
+	size_t EnemyMemory::Count(UnitTypeID unit_type) const
+	{
+		size_t count = 0;
+		for (const EnemyRecord& record : records_)
+		{
+			count += record.unit_type == unit_type;
+		}
+		return count;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+#include "unit_type_table.h"
+
+namespace sc2
+{
+	// What we last knew of an enemy unit.
+	struct EnemyRecord
+	{
+		Tag tag;
+		UnitTypeID unit_type;
+		Point2D pos;
+		uint32_t last_seen; // Game loop it was last seen, rather than remembered as a snapshot
+		float health;
+		bool structure;
+		bool snapshot;      // Only the game's memory of it in the fog
+	};
+
+	// Enemy units by tag, kept after they leave vision. An open-addressing table (linear probing, removal by
+	// shifting back, so no tombstones) points into a dense array of records, which stays compact for walks.
+	// Structures stay until they die or drop out of the observation, the game keeps their snapshots in the fog.
+	// Units are forgotten some time after they were last seen, and when the table is full the unit seen longest
+	// ago makes room. Structures only go to make room when there is nothing else.
+	class EnemyMemory
+	{
+	public:
+		void Init(size_t capacity, uint32_t forget_after_loops);
+
+		void Clear();
+
+		// Records the unit as it is now.
+		void Update(const Unit* unit, uint32_t game_loop, bool structure);
+
+		// Updates every enemy in this step's observation, then drops the structures that were not in it
+		// and the units not seen for the forget time.
+		void Observe(const Units& enemies, uint32_t game_loop, const UnitTypeTable& unit_types);
+
+		void Remove(Tag tag);
+
+		const EnemyRecord* Find(Tag tag) const;
+
+		const std::vector<EnemyRecord>& Records() const { return records_; }
+		size_t Size() const { return records_.size(); }
+
+		// The remembered structure closest to point, nullptr if there is none.
+		const EnemyRecord* NearestStructure(const Point2D& point) const;
+
+		size_t Count(UnitTypeID unit_type) const;
+
+	private:
+		size_t Home(Tag tag) const;
+		size_t FindSlot(Tag tag) const; // Slot holding tag, or the empty slot it would go in
+		void RemoveAt(size_t slot);
+		void MakeRoom();
+
+		size_t capacity_ = 0;
+		uint32_t forget_after_ = 0;
+		size_t mask_ = 0;
+		std::vector<int32_t> slots_;        // Index into records_, or empty
+		std::vector<EnemyRecord> records_;
+		std::vector<uint32_t> observed_;    // Per record, the loop it was last in the observation
+	};
+}
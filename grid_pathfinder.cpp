@@ -0,0 +1,539 @@
+#include "grid_pathfinder.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <math.h>
+
+namespace sc2
+{
+	namespace
+	{
+		const float diagonal_cost = 1.41421356f;
+
+		// Cost of the cheapest 8-way path between two cells on an open grid.
+		float Octile(int from_x, int from_y, int to_x, int to_y)
+		{
+			int dx = abs(to_x - from_x);
+			int dy = abs(to_y - from_y);
+			return std::max(dx, dy) + (diagonal_cost - 1.0f) * std::min(dx, dy);
+		}
+
+		int Sign(int value)
+		{
+			return (value > 0) - (value < 0);
+		}
+	}
+
+	void GridPathfinder::Init(const ImageData& pathing_grid)
+	{
+		width_ = 0;
+		height_ = 0;
+		footprints_.clear();
+		inconclusive_ = 0;
+
+		int width = pathing_grid.width;
+		int height = pathing_grid.height;
+		bool packed = pathing_grid.bits_per_pixel == 1;
+		if (width <= 0 || height <= 0 || (!packed && pathing_grid.bits_per_pixel != 8))
+		{
+			return;
+		}
+		size_t cells = static_cast<size_t>(width) * height;
+		if (pathing_grid.data.size() < (packed ? (cells + 7) / 8 : cells))
+		{
+			return;
+		}
+
+		// The image's first row is the top of the map. One bit per cell is set where pathable,
+		// the older byte-per-cell grids mark blocked cells with 255.
+		grid_.assign(cells, 0);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				size_t index = static_cast<size_t>(height - 1 - y) * width + x;
+				uint8_t value = static_cast<uint8_t>(pathing_grid.data[packed ? index / 8 : index]);
+				grid_[y * width + x] = packed ? (value >> (7 - index % 8)) & 1 : value != 255;
+			}
+		}
+
+		width_ = width;
+		height_ = height;
+		overlay_.assign(cells, 0);
+		open_ = grid_;
+		components_dirty_ = true;
+		Label(grid_, terrain_component_);
+		seen_.assign(cells, 0);
+		closed_.assign(cells, 0);
+		g_.assign(cells, 0.0f);
+		parent_.assign(cells, -1);
+		search_ = 0;
+	}
+
+	void GridPathfinder::LabelComponents()
+	{
+		components_dirty_ = false;
+		Label(open_, component_);
+	}
+
+	void GridPathfinder::Label(const std::vector<uint8_t>& cells, std::vector<int32_t>& labels) const
+	{
+		// Flood fill of the cells with the same moves the search makes, cells in different areas never connect.
+		auto open = [&](int x, int y) { return InBounds(x, y) && cells[y * width_ + x]; };
+		labels.assign(cells.size(), 0);
+		std::vector<int> frontier;
+		int32_t label = 0;
+		for (int seed = 0; seed < static_cast<int>(cells.size()); seed++)
+		{
+			if (!cells[seed] || labels[seed])
+			{
+				continue;
+			}
+			label++;
+			labels[seed] = label;
+			frontier.assign(1, seed);
+			while (!frontier.empty())
+			{
+				int cell = frontier.back();
+				frontier.pop_back();
+				int x = cell % width_;
+				int y = cell / width_;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int nx = x + dx;
+						int ny = y + dy;
+						if ((!dx && !dy) || !open(nx, ny))
+						{
+							continue;
+						}
+						if (dx && dy && (!open(nx, y) || !open(x, ny)))
+						{
+							continue;
+						}
+						int next = ny * width_ + nx;
+						if (!labels[next])
+						{
+							labels[next] = label;
+							frontier.push_back(next);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void GridPathfinder::AddStructure(const Unit* unit)
+	{
+		if (!Ready() || unit->is_flying || footprints_.count(unit->tag))
+		{
+			return;
+		}
+
+		// Footprints are whole cells, a 2.75 radius command centre covers 5x5 and a 1.375 supply depot 2x2.
+		float half = floor(unit->radius * 2.0f) / 2.0f;
+		if (half <= 0.0f)
+		{
+			return;
+		}
+		Footprint footprint;
+		footprint.min_x = std::max(0, static_cast<int>(lround(unit->pos.x - half)));
+		footprint.min_y = std::max(0, static_cast<int>(lround(unit->pos.y - half)));
+		footprint.max_x = std::min(width_ - 1, static_cast<int>(lround(unit->pos.x + half)) - 1);
+		footprint.max_y = std::min(height_ - 1, static_cast<int>(lround(unit->pos.y + half)) - 1);
+
+		SetOverlay(footprint, 1);
+		footprints_[unit->tag] = footprint;
+	}
+
+	void GridPathfinder::RemoveStructure(Tag tag)
+	{
+		auto found = footprints_.find(tag);
+		if (found == footprints_.end())
+		{
+			return;
+		}
+		SetOverlay(found->second, -1);
+		footprints_.erase(found);
+	}
+
+	void GridPathfinder::SetOverlay(const Footprint& footprint, int change)
+	{
+		for (int y = footprint.min_y; y <= footprint.max_y; y++)
+		{
+			for (int x = footprint.min_x; x <= footprint.max_x; x++)
+			{
+				size_t cell = y * width_ + x;
+				overlay_[cell] = static_cast<uint8_t>(overlay_[cell] + change);
+				open_[cell] = grid_[cell] && !overlay_[cell];
+			}
+		}
+		components_dirty_ = true;
+	}
+
+	bool GridPathfinder::IsPathable(const Point2D& point) const
+	{
+		return Open(static_cast<int>(floor(point.x)), static_cast<int>(floor(point.y)));
+	}
+
+	GridPathfinder::Reach GridPathfinder::FindPath(const Unit* start, const Point2D& end, float* length, std::vector<Point2D>* waypoints)
+	{
+		if (!start->is_flying)
+		{
+			return FindPath(start->pos, end, length, waypoints);
+		}
+		if (length)
+		{
+			*length = Distance2D(start->pos, end);
+		}
+		if (waypoints)
+		{
+			waypoints->assign(1, end);
+		}
+		return Reach::Reachable;
+	}
+
+	GridPathfinder::Reach GridPathfinder::TerrainReach(const Point2D& start, const Point2D& end) const
+	{
+		if (!Ready())
+		{
+			return Reach::Unknown;
+		}
+		int end_x = static_cast<int>(floor(end.x));
+		int end_y = static_cast<int>(floor(end.y));
+		if (!IsTerrainPathable(end_x, end_y))
+		{
+			return Reach::Unreachable;
+		}
+		int start_x = static_cast<int>(floor(start.x));
+		int start_y = static_cast<int>(floor(start.y));
+		if (!IsTerrainPathable(start_x, start_y))
+		{
+			return Reach::Unknown;
+		}
+		bool joined = terrain_component_[start_y * width_ + start_x] == terrain_component_[end_y * width_ + end_x];
+		return joined ? Reach::Reachable : Reach::Unreachable;
+	}
+
+	GridPathfinder::Reach GridPathfinder::FindPath(const Point2D& start, const Point2D& end, float* length, std::vector<Point2D>* waypoints)
+	{
+		if (!Ready())
+		{
+			return Reach::Unknown;
+		}
+
+		// A destination off the grid or under one of the structures cannot be stood on.
+		int end_x = static_cast<int>(floor(end.x));
+		int end_y = static_cast<int>(floor(end.y));
+		if (!Open(end_x, end_y))
+		{
+			return Reach::Unreachable;
+		}
+		int goal = end_y * width_ + end_x;
+
+		// Units standing against a wall or a building can be centred on a blocked cell, start from an open one beside it.
+		int start_x = static_cast<int>(floor(start.x));
+		int start_y = static_cast<int>(floor(start.y));
+		if (!Open(start_x, start_y))
+		{
+			bool moved = false;
+			for (int dy = -1; dy <= 1 && !moved; dy++)
+			{
+				for (int dx = -1; dx <= 1 && !moved; dx++)
+				{
+					if (Open(start_x + dx, start_y + dy))
+					{
+						start_x += dx;
+						start_y += dy;
+						moved = true;
+					}
+				}
+			}
+			if (!moved)
+			{
+				inconclusive_++;
+				return Reach::Unknown;
+			}
+		}
+		int origin = start_y * width_ + start_x;
+
+		// Whether it can be reached at all is settled by the areas, the search is only for the way there.
+		if (components_dirty_)
+		{
+			LabelComponents();
+		}
+		if (component_[origin] != component_[goal])
+		{
+			return Reach::Unreachable;
+		}
+		if (!length && !waypoints)
+		{
+			return Reach::Reachable;
+		}
+
+		// In the open most destinations are in plain sight.
+		if (origin == (static_cast<int>(floor(start.y)) * width_ + static_cast<int>(floor(start.x))) && ClearLine(start, end))
+		{
+			if (length)
+			{
+				*length = Distance2D(start, end);
+			}
+			if (waypoints)
+			{
+				waypoints->assign(1, end);
+			}
+			return Reach::Reachable;
+		}
+
+		if (++search_ == 0)
+		{
+			std::fill(seen_.begin(), seen_.end(), 0);
+			std::fill(closed_.begin(), closed_.end(), 0);
+			search_ = 1;
+		}
+		heap_.clear();
+		Visit(origin, -1, 0.0f, goal);
+
+		size_t expansions = 0;
+		bool found = false;
+		while (!heap_.empty())
+		{
+			std::pop_heap(heap_.begin(), heap_.end(), std::greater<OpenNode>());
+			int cell = heap_.back().cell;
+			heap_.pop_back();
+			if (closed_[cell] == search_)
+			{
+				continue;
+			}
+			closed_[cell] = search_;
+			if (cell == goal)
+			{
+				found = true;
+				break;
+			}
+			if (++expansions > search_budget_)
+			{
+				inconclusive_++;
+				return Reach::Unknown;
+			}
+
+			// Only the directions the jump point rules leave open: straight on and around whatever forced the turn.
+			int x = cell % width_;
+			int y = cell / width_;
+			int directions[8][2];
+			int count = 0;
+			auto add = [&](int dx, int dy) { directions[count][0] = dx; directions[count][1] = dy; count++; };
+
+			int parent = parent_[cell];
+			int px = parent < 0 ? x : parent % width_;
+			int py = parent < 0 ? y : parent / width_;
+			int dx = Sign(x - px);
+			int dy = Sign(y - py);
+			if (parent < 0)
+			{
+				for (int ny = -1; ny <= 1; ny++)
+				{
+					for (int nx = -1; nx <= 1; nx++)
+					{
+						if (nx || ny)
+						{
+							add(nx, ny);
+						}
+					}
+				}
+			}
+			else if (dx && dy)
+			{
+				add(dx, 0);
+				add(0, dy);
+				add(dx, dy);
+			}
+			else if (dx)
+			{
+				add(dx, 0);
+				add(0, 1);
+				add(0, -1);
+				add(dx, 1);
+				add(dx, -1);
+			}
+			else
+			{
+				add(0, dy);
+				add(1, 0);
+				add(-1, 0);
+				add(1, dy);
+				add(-1, dy);
+			}
+
+			for (int i = 0; i < count; i++)
+			{
+				int jump = directions[i][0] && directions[i][1] ?
+					JumpDiagonal(x, y, directions[i][0], directions[i][1], goal) :
+					JumpStraight(x, y, directions[i][0], directions[i][1], goal);
+				if (jump >= 0)
+				{
+					Visit(jump, cell, g_[cell] + Octile(x, y, jump % width_, jump / width_), goal);
+				}
+			}
+		}
+
+		if (!found)
+		{
+			return Reach::Unreachable;
+		}
+
+		if (length || waypoints)
+		{
+			std::vector<Point2D> points;
+			for (int cell = goal; cell != origin; cell = parent_[cell])
+			{
+				points.push_back(Point2D(cell % width_ + 0.5f, cell / width_ + 0.5f));
+			}
+			std::reverse(points.begin(), points.end());
+			if (points.empty())
+			{
+				points.push_back(end);
+			}
+			points.back() = end;
+
+			if (length)
+			{
+				*length = Distance2D(start, points.front());
+				for (size_t i = 1; i < points.size(); i++)
+				{
+					*length += Distance2D(points[i - 1], points[i]);
+				}
+			}
+			if (waypoints)
+			{
+				waypoints->swap(points);
+			}
+		}
+		return Reach::Reachable;
+	}
+
+	bool GridPathfinder::ClearLine(const Point2D& start, const Point2D& end) const
+	{
+		// Steps cell to cell along the line, crossing whichever cell edge comes first.
+		int x = static_cast<int>(floor(start.x));
+		int y = static_cast<int>(floor(start.y));
+		int end_x = static_cast<int>(floor(end.x));
+		int end_y = static_cast<int>(floor(end.y));
+		float dx = end.x - start.x;
+		float dy = end.y - start.y;
+		int step_x = dx > 0.0f ? 1 : -1;
+		int step_y = dy > 0.0f ? 1 : -1;
+		float delta_x = dx != 0.0f ? fabs(1.0f / dx) : std::numeric_limits<float>::max();
+		float delta_y = dy != 0.0f ? fabs(1.0f / dy) : std::numeric_limits<float>::max();
+		float next_x = dx != 0.0f ? ((step_x > 0 ? x + 1 - start.x : start.x - x) * delta_x) : std::numeric_limits<float>::max();
+		float next_y = dy != 0.0f ? ((step_y > 0 ? y + 1 - start.y : start.y - y) * delta_y) : std::numeric_limits<float>::max();
+
+		// The crossings add up in floats, two that should meet exactly at a corner can come out a little apart.
+		const float corner = 1e-4f;
+		int steps = abs(end_x - x) + abs(end_y - y);
+		for (int i = 0; i < steps && (x != end_x || y != end_y); i++)
+		{
+			if (next_x < next_y - corner)
+			{
+				x += step_x;
+				next_x += delta_x;
+			}
+			else if (next_y < next_x - corner)
+			{
+				y += step_y;
+				next_y += delta_y;
+			}
+			else
+			{
+				// Through a corner or close enough to one, both cells beside it have to be open.
+				if (!Open(x + step_x, y) || !Open(x, y + step_y))
+				{
+					return false;
+				}
+				x += step_x;
+				y += step_y;
+				next_x += delta_x;
+				next_y += delta_y;
+				i++;
+			}
+			if (!Open(x, y))
+			{
+				return false;
+			}
+		}
+		return x == end_x && y == end_y;
+	}
+
+	void GridPathfinder::Visit(int cell, int parent, float g, int goal)
+	{
+		if (seen_[cell] == search_ && g >= g_[cell])
+		{
+			return;
+		}
+		seen_[cell] = search_;
+		g_[cell] = g;
+		parent_[cell] = parent;
+		heap_.push_back({ g + Octile(cell % width_, cell / width_, goal % width_, goal / width_), cell });
+		std::push_heap(heap_.begin(), heap_.end(), std::greater<OpenNode>());
+	}
+
+	int GridPathfinder::JumpStraight(int x, int y, int dx, int dy, int goal) const
+	{
+		for (;;)
+		{
+			x += dx;
+			y += dy;
+			if (!Open(x, y))
+			{
+				return -1;
+			}
+			int cell = y * width_ + x;
+			if (cell == goal)
+			{
+				return cell;
+			}
+
+			// A wall ending beside the scan opens a way round it, the search has to be able to turn here.
+			if (dx)
+			{
+				if ((Open(x, y - 1) && !Open(x - dx, y - 1)) || (Open(x, y + 1) && !Open(x - dx, y + 1)))
+				{
+					return cell;
+				}
+			}
+			else if ((Open(x - 1, y) && !Open(x - 1, y - dy)) || (Open(x + 1, y) && !Open(x + 1, y - dy)))
+			{
+				return cell;
+			}
+		}
+	}
+
+	int GridPathfinder::JumpDiagonal(int x, int y, int dx, int dy, int goal) const
+	{
+		for (;;)
+		{
+			// Units do not squeeze between two blocked cells touching at a corner.
+			if (!Open(x + dx, y) || !Open(x, y + dy))
+			{
+				return -1;
+			}
+			x += dx;
+			y += dy;
+			if (!Open(x, y))
+			{
+				return -1;
+			}
+			int cell = y * width_ + x;
+			if (cell == goal)
+			{
+				return cell;
+			}
+			if (JumpStraight(x, y, dx, 0, goal) >= 0 || JumpStraight(x, y, 0, dy, goal) >= 0)
+			{
+				return cell;
+			}
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Ground pathfinding on the map's pathing grid, in process: A* over jump points with an octile heuristic.
+	// Structures are laid over the grid as they appear and lifted when they die, so answers follow the base layout.
+	// Connected areas are labelled whenever the layout changes, so whether a point can be reached at all is a lookup;
+	// only a caller asking for the length or the waypoints pays for a search, and not even that with a clear line.
+	// Where the grid cannot be sure (a start inside something, a search over budget) the answer is Unknown and
+	// the caller asks the game instead.
+	class GridPathfinder
+	{
+	public:
+		enum class Reach { Reachable, Unreachable, Unknown };
+
+		// Unpacks the grid, 1 or 8 bits per cell with the top row first as the game sends it.
+		// A grid that does not match its size leaves the pathfinder empty, every answer is then Unknown.
+		void Init(const ImageData& pathing_grid);
+
+		bool Ready() const { return width_ > 0; }
+
+		// Blocks the cells under a structure's footprint, or frees them. Other units are ignored.
+		void AddStructure(const Unit* unit);
+		void RemoveStructure(Tag tag);
+
+		// Whether a ground unit could stand at the point, structures included.
+		bool IsPathable(const Point2D& point) const;
+
+		// The bare terrain the grid was built from, structures left out.
+		int Width() const { return width_; }
+		int Height() const { return height_; }
+		bool IsTerrainPathable(int x, int y) const { return InBounds(x, y) && grid_[y * width_ + x]; }
+
+		// Whether end can be walked to from start and, if so, the length of the path and its turning points.
+		// A searched path follows cell centres, it runs a little longer than the game's smoothed one.
+		Reach FindPath(const Point2D& start, const Point2D& end, float* length = nullptr, std::vector<Point2D>* waypoints = nullptr);
+
+		// As above from where the unit stands, flying units go in a straight line.
+		Reach FindPath(const Unit* start, const Point2D& end, float* length = nullptr, std::vector<Point2D>* waypoints = nullptr);
+
+		// Whether the bare terrain joins the two points, as if no structure stood anywhere. Unreachable only when end is
+		// not pathable terrain or lies in another area; Unknown when start is not on pathable terrain.
+		Reach TerrainReach(const Point2D& start, const Point2D& end) const;
+
+		// Jump points a search may expand before giving up with Unknown.
+		void SetSearchBudget(size_t expansions) { search_budget_ = expansions; }
+
+		// Searches that had to give up, since Init.
+		size_t Inconclusive() const { return inconclusive_; }
+
+	private:
+		struct Footprint
+		{
+			int min_x;
+			int min_y;
+			int max_x;
+			int max_y;
+		};
+
+		struct OpenNode
+		{
+			float f;
+			int cell;
+
+			bool operator>(const OpenNode& other) const { return f > other.f; }
+		};
+
+		bool InBounds(int x, int y) const { return x >= 0 && y >= 0 && x < width_ && y < height_; }
+		bool Open(int x, int y) const { return InBounds(x, y) && open_[y * width_ + x]; }
+
+		void SetOverlay(const Footprint& footprint, int change);
+		void LabelComponents();
+		void Label(const std::vector<uint8_t>& cells, std::vector<int32_t>& labels) const;
+
+		// Whether a walk in a straight line stays on open cells, without squeezing between corners.
+		bool ClearLine(const Point2D& start, const Point2D& end) const;
+
+		// Scans from a cell in one direction, returns the first jump point or -1 if the scan runs into a wall.
+		int JumpStraight(int x, int y, int dx, int dy, int goal) const;
+		int JumpDiagonal(int x, int y, int dx, int dy, int goal) const;
+
+		void Visit(int cell, int parent, float g, int goal);
+
+		int width_ = 0;
+		int height_ = 0;
+		std::vector<uint8_t> grid_;      // 1 where the game's grid is pathable, row 0 at the bottom like map y
+		std::vector<uint8_t> overlay_;   // Structures covering the cell
+		std::vector<uint8_t> open_;      // Pathable and not covered
+		std::vector<int32_t> component_; // Connected area of open cells, 0 for blocked cells
+		bool components_dirty_ = true;
+		std::vector<int32_t> terrain_component_; // As component_ for the bare terrain, labelled once
+		std::unordered_map<Tag, Footprint> footprints_;
+
+		// Per-search state, stamped with the search number instead of cleared
+		std::vector<uint32_t> seen_;
+		std::vector<uint32_t> closed_;
+		std::vector<float> g_;
+		std::vector<int32_t> parent_;
+		std::vector<OpenNode> heap_;
+		uint32_t search_ = 0;
+
+		size_t search_budget_ = 4096;
+		size_t inconclusive_ = 0;
+	};
+}
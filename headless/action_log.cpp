@@ -0,0 +1,86 @@
+#include "action_log.h"
+
+#include <cstdio>
+#include <string>
+
+namespace sc2
+{
+	ActionLog::ActionLog(ActionInterface* actions, const ObservationInterface* observation, std::ostream* out) :
+		actions_(actions), observation_(observation), out_(out)
+	{
+	}
+
+	void ActionLog::UnitCommand(const Unit* unit, AbilityID ability, bool queued_command)
+	{
+		Log({ unit }, ability, nullptr, nullptr, queued_command);
+		actions_->UnitCommand(unit, ability, queued_command);
+	}
+
+	void ActionLog::UnitCommand(const Unit* unit, AbilityID ability, const Point2D& point, bool queued_command)
+	{
+		Log({ unit }, ability, &point, nullptr, queued_command);
+		actions_->UnitCommand(unit, ability, point, queued_command);
+	}
+
+	void ActionLog::UnitCommand(const Unit* unit, AbilityID ability, const Unit* target, bool queued_command)
+	{
+		Log({ unit }, ability, nullptr, target, queued_command);
+		actions_->UnitCommand(unit, ability, target, queued_command);
+	}
+
+	void ActionLog::UnitCommand(const Units& units, AbilityID ability, bool queued_move)
+	{
+		Log(units, ability, nullptr, nullptr, queued_move);
+		actions_->UnitCommand(units, ability, queued_move);
+	}
+
+	void ActionLog::UnitCommand(const Units& units, AbilityID ability, const Point2D& point, bool queued_command)
+	{
+		Log(units, ability, &point, nullptr, queued_command);
+		actions_->UnitCommand(units, ability, point, queued_command);
+	}
+
+	void ActionLog::UnitCommand(const Units& units, AbilityID ability, const Unit* target, bool queued_command)
+	{
+		Log(units, ability, nullptr, target, queued_command);
+		actions_->UnitCommand(units, ability, target, queued_command);
+	}
+
+	void ActionLog::Log(const Units& units, AbilityID ability, const Point2D* point, const Unit* target, bool queued)
+	{
+		// %.9g round-trips a float, so two lines only match when the commands do.
+		char field[64];
+		snprintf(field, sizeof(field), "%u %u", observation_->GetGameLoop(), static_cast<uint32_t>(ability));
+		std::string line = field;
+		for (const Unit* unit : units)
+		{
+			snprintf(field, sizeof(field), " %llu", static_cast<unsigned long long>(unit ? unit->tag : NullTag));
+			line += field;
+		}
+		if (point != nullptr)
+		{
+			snprintf(field, sizeof(field), " @ %.9g %.9g", point->x, point->y);
+			line += field;
+		}
+		if (target != nullptr)
+		{
+			snprintf(field, sizeof(field), " -> %llu", static_cast<unsigned long long>(target->tag));
+			line += field;
+		}
+		if (queued)
+		{
+			line += " queued";
+		}
+		line += '\n';
+
+		for (char c : line)
+		{
+			hash_ = (hash_ ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+		}
+		if (out_ != nullptr)
+		{
+			*out_ << line;
+		}
+		commands_++;
+	}
+}
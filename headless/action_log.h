@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Forwards unit commands to another ActionInterface and writes each as a line of text, so the commands of
+	// two runs (or two builds of the bot) can be diffed. Lines read "game_loop ability tags [@ x y | -> tag] [queued]".
+	// A hash of every line is kept as well, equal hashes mean equal command streams.
+	class ActionLog : public ActionInterface
+	{
+	public:
+		// out may be null to only keep the hash.
+		ActionLog(ActionInterface* actions, const ObservationInterface* observation, std::ostream* out);
+
+		size_t CommandCount() const { return commands_; }
+		uint64_t Hash() const { return hash_; }
+
+		void UnitCommand(const Unit* unit, AbilityID ability, bool queued_command = false) override;
+		void UnitCommand(const Unit* unit, AbilityID ability, const Point2D& point, bool queued_command = false) override;
+		void UnitCommand(const Unit* unit, AbilityID ability, const Unit* target, bool queued_command = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, bool queued_move = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, const Point2D& point, bool queued_command = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, const Unit* target, bool queued_command = false) override;
+
+		const std::vector<Tag>& Commands() const override { return actions_->Commands(); }
+		void ToggleAutocast(Tag unit_tag, AbilityID ability) override { actions_->ToggleAutocast(unit_tag, ability); }
+		void ToggleAutocast(const std::vector<Tag>& unit_tags, AbilityID ability) override { actions_->ToggleAutocast(unit_tags, ability); }
+		void SendChat(const std::string& message, ChatChannel channel = ChatChannel::All) override { actions_->SendChat(message, channel); }
+		void SendActions() override { actions_->SendActions(); }
+
+	private:
+		void Log(const Units& units, AbilityID ability, const Point2D* point, const Unit* target, bool queued);
+
+		ActionInterface* actions_;
+		const ObservationInterface* observation_;
+		std::ostream* out_;
+		size_t commands_ = 0;
+		uint64_t hash_ = 14695981039346656037ull; // FNV-1a
+	};
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sc2
+{
+	class MultiplayerBot;
+}
+
+// Entry points bot.cc exports when built with BOT_HEADLESS, for the headless runner and the benchmarks.
+
+sc2::MultiplayerBot* CreateBot();
+
+// One of the bot's hot functions, run discards whatever commands it queued so repeated runs stay comparable.
+struct BotHotPath
+{
+	std::string name;
+	std::function<void()> run;
+};
+
+std::vector<BotHotPath> BotHotPaths(sc2::MultiplayerBot* bot);
+
+// Stops the scheduler deferring managers to stay inside the step budget, so which managers run on a step depends
+// on the step alone. Call after OnGameStart, replays use it to stay deterministic.
+void DisableStepBudget(sc2::MultiplayerBot* bot);
@@ -0,0 +1,1816 @@
+#include "headless_game.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+namespace sc2
+{
+	namespace
+	{
+		const float loops_per_second = 22.4f;
+		const float speed_per_loop = 1.0f / 16.0f; // Unit speeds are per normal-speed second, games run at faster
+
+		const int map_size = 144;
+		const float playable_border = 8.0f;
+		const float town_hall_resource_gap = 6.0f; // Town halls cannot be placed closer than this to resources
+
+		const uint32_t mineral_mine_loops = 64;
+		const uint32_t vespene_mine_loops = 45;
+		const int mineral_trip = 5;
+		const int mule_trip = 25;
+		const int vespene_trip = 4;
+		const uint32_t mule_lifetime = static_cast<uint32_t>(64 * loops_per_second);
+		const float orbital_energy_per_loop = 0.7875f / loops_per_second;
+
+		const uint32_t first_wave_loop = static_cast<uint32_t>(180 * loops_per_second);
+		const uint32_t wave_period = static_cast<uint32_t>(120 * loops_per_second);
+		const size_t enemy_army_cap = 120;
+
+		UnitOrder Order(AbilityID ability, Tag target = NullTag, const Point2D& point = Point2D())
+		{
+			UnitOrder order;
+			order.ability_id = ability;
+			order.target_unit_tag = target;
+			order.target_pos = point;
+			order.progress = 0.0f;
+			return order;
+		}
+
+		bool IsTownHallType(UnitTypeID type)
+		{
+			return type == UNIT_TYPEID::TERRAN_COMMANDCENTER || type == UNIT_TYPEID::TERRAN_ORBITALCOMMAND ||
+				type == UNIT_TYPEID::ZERG_HATCHERY;
+		}
+
+		bool IsWorkerType(UnitTypeID type)
+		{
+			return type == UNIT_TYPEID::TERRAN_SCV || type == UNIT_TYPEID::TERRAN_MULE || type == UNIT_TYPEID::ZERG_DRONE;
+		}
+
+		bool IsHarvestAbility(AbilityID ability)
+		{
+			return ability == ABILITY_ID::HARVEST_GATHER || ability == ABILITY_ID::HARVEST_RETURN;
+		}
+	}
+
+	HeadlessGame::HeadlessGame(uint32_t seed) :
+		random_(seed)
+	{
+		BuildUnitTypeData();
+		BuildMap();
+
+		// Our main, a town hall with twelve workers already mining like a ladder start.
+		Spawn(UNIT_TYPEID::TERRAN_COMMANDCENTER, Unit::Alliance::Self, start_location_);
+		for (int i = 0; i < 12; i++)
+		{
+			Point2D position(start_location_.x + (i % 4) - 1.5f, start_location_.y - 3.5f - (i / 4));
+			Entity* worker = Spawn(UNIT_TYPEID::TERRAN_SCV, Unit::Alliance::Self, position);
+			const Entity* mineral = NearestMineral(position, 15.0f);
+			worker->harvest_target = mineral->unit.tag;
+			worker->unit.orders.push_back(Order(ABILITY_ID::HARVEST_GATHER, mineral->unit.tag));
+		}
+
+		// Their main, which only ever sends attack waves.
+		Spawn(UNIT_TYPEID::ZERG_HATCHERY, Unit::Alliance::Enemy, enemy_location_);
+		for (int i = 0; i < 12; i++)
+		{
+			Spawn(UNIT_TYPEID::ZERG_DRONE, Unit::Alliance::Enemy,
+				Point2D(enemy_location_.x + (i % 4) - 1.5f, enemy_location_.y + 3.5f + (i / 4)));
+		}
+
+		UpdateEconomy();
+		UpdateVision();
+		for (size_t index : alive_)
+		{
+			entities_[index].was_idle = entities_[index].unit.orders.empty();
+		}
+
+		// Starting units raise no events, the bot reads them in OnGameStart.
+		created_.clear();
+		entered_vision_.clear();
+	}
+
+	void HeadlessGame::Step()
+	{
+		game_loop_++;
+
+		commanded_.clear();
+		for (const Command& command : pending_)
+		{
+			ApplyCommand(command);
+		}
+		pending_.clear();
+
+		// Units spawned during the loop start moving on the next one.
+		size_t count = alive_.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			Entity& entity = entities_[alive_[i]];
+			if (entity.unit.alliance != Unit::Alliance::Self)
+			{
+				continue;
+			}
+			if (entity.unit.build_progress < 1.0f)
+			{
+				UpdateConstruction(entity);
+			}
+			else if (!entity.unit.orders.empty())
+			{
+				UpdateProduction(entity);
+			}
+			if (entity.unit.energy_max > 0.0f)
+			{
+				entity.unit.energy = std::min(entity.unit.energy_max, entity.unit.energy + orbital_energy_per_loop);
+			}
+		}
+
+		UpdateCombat();
+
+		for (size_t i = 0; i < count; i++)
+		{
+			UpdateMovement(entities_[alive_[i]]);
+		}
+
+		RemoveDead();
+		UpdateEnemyScript();
+		UpdateVision();
+		UpdateEconomy();
+
+		for (size_t index : alive_)
+		{
+			Entity& entity = entities_[index];
+			if (entity.unit.alliance != Unit::Alliance::Self)
+			{
+				continue;
+			}
+			bool idle = entity.unit.orders.empty() && entity.unit.build_progress >= 1.0f;
+			if (idle && !entity.was_idle)
+			{
+				idle_.push_back(&entity.unit);
+			}
+			entity.was_idle = idle;
+		}
+	}
+
+	void HeadlessGame::DispatchEvents(Client& client)
+	{
+		for (const Unit* unit : destroyed_)
+		{
+			client.OnUnitDestroyed(unit);
+		}
+		for (const Unit* unit : created_)
+		{
+			client.OnUnitCreated(unit);
+		}
+		for (const Unit* unit : idle_)
+		{
+			client.OnUnitIdle(unit);
+		}
+		for (UpgradeID upgrade : upgrades_completed_)
+		{
+			client.OnUpgradeCompleted(upgrade);
+		}
+		for (const Unit* unit : completed_)
+		{
+			client.OnBuildingConstructionComplete(unit);
+		}
+		for (const Unit* unit : entered_vision_)
+		{
+			client.OnUnitEnterVision(unit);
+		}
+
+		destroyed_.clear();
+		created_.clear();
+		idle_.clear();
+		upgrades_completed_.clear();
+		completed_.clear();
+		entered_vision_.clear();
+	}
+
+	void HeadlessGame::AddUnits(UNIT_TYPEID type, Unit::Alliance alliance, size_t count, const Point2D& center, float radius)
+	{
+		std::uniform_real_distribution<float> unit_interval(0.0f, 1.0f);
+		for (size_t i = 0; i < count; i++)
+		{
+			// Square root keeps the disc evenly filled instead of bunched at the centre.
+			float angle = unit_interval(random_) * 6.2831853f;
+			float distance = sqrt(unit_interval(random_)) * radius;
+			Point2D position(center.x + cos(angle) * distance, center.y + sin(angle) * distance);
+			position.x = std::min(std::max(position.x, playable_border), map_size - playable_border);
+			position.y = std::min(std::max(position.y, playable_border), map_size - playable_border);
+
+			Entity* entity = Spawn(type, alliance, position);
+			const Entity* mineral = alliance == Unit::Alliance::Self && IsWorkerType(type) ? NearestMineral(position, 15.0f) : nullptr;
+			if (mineral != nullptr)
+			{
+				entity->harvest_target = mineral->unit.tag;
+				entity->unit.orders.push_back(Order(ABILITY_ID::HARVEST_GATHER, mineral->unit.tag));
+			}
+		}
+	}
+
+	bool HeadlessGame::IsOver() const
+	{
+		bool own_town_hall = false;
+		bool enemy_town_hall = false;
+		for (size_t index : alive_)
+		{
+			const Unit& unit = entities_[index].unit;
+			if (IsTownHallType(unit.unit_type))
+			{
+				own_town_hall |= unit.alliance == Unit::Alliance::Self;
+				enemy_town_hall |= unit.alliance == Unit::Alliance::Enemy;
+			}
+		}
+		return !own_town_hall || !enemy_town_hall;
+	}
+
+	//
+	// ObservationInterface
+	//
+
+	Units HeadlessGame::GetUnits() const
+	{
+		return GetUnits(Filter());
+	}
+
+	Units HeadlessGame::GetUnits(Unit::Alliance alliance, Filter filter) const
+	{
+		Units units;
+		for (size_t index : alive_)
+		{
+			const Entity& entity = entities_[index];
+			if (entity.unit.alliance == alliance && Observable(entity) && (!filter || filter(entity.unit)))
+			{
+				units.push_back(&entity.unit);
+			}
+		}
+		return units;
+	}
+
+	Units HeadlessGame::GetUnits(Filter filter) const
+	{
+		Units units;
+		for (size_t index : alive_)
+		{
+			const Entity& entity = entities_[index];
+			if (Observable(entity) && (!filter || filter(entity.unit)))
+			{
+				units.push_back(&entity.unit);
+			}
+		}
+		return units;
+	}
+
+	const Unit* HeadlessGame::GetUnit(Tag tag) const
+	{
+		const Entity* entity = Find(tag);
+		if (entity == nullptr || (entity->unit.alliance == Unit::Alliance::Enemy && !entity->seen))
+		{
+			return nullptr;
+		}
+		return &entity->unit;
+	}
+
+	int32_t HeadlessGame::GetIdleWorkerCount() const
+	{
+		int32_t count = 0;
+		for (size_t index : alive_)
+		{
+			const Unit& unit = entities_[index].unit;
+			if (unit.alliance == Unit::Alliance::Self && unit.unit_type == UNIT_TYPEID::TERRAN_SCV && unit.orders.empty())
+			{
+				count++;
+			}
+		}
+		return count;
+	}
+
+	int32_t HeadlessGame::GetArmyCount() const
+	{
+		int32_t count = 0;
+		for (size_t index : alive_)
+		{
+			const Unit& unit = entities_[index].unit;
+			const Spec* spec = SpecOf(unit.unit_type);
+			if (unit.alliance == Unit::Alliance::Self && spec != nullptr && spec->footprint == 0.0f && !IsWorkerType(unit.unit_type))
+			{
+				count++;
+			}
+		}
+		return count;
+	}
+
+	Visibility HeadlessGame::GetVisibility(const Point2D& point) const
+	{
+		int x = static_cast<int>(point.x / vision_cell_);
+		int y = static_cast<int>(point.y / vision_cell_);
+		if (x < 0 || y < 0 || x >= vision_width_ || y >= vision_width_)
+		{
+			return Visibility::Hidden;
+		}
+		if (visible_[y * vision_width_ + x])
+		{
+			return Visibility::Visible;
+		}
+		return explored_[y * vision_width_ + x] ? Visibility::Fogged : Visibility::Hidden;
+	}
+
+	bool HeadlessGame::IsPathable(const Point2D& point) const
+	{
+		int x = static_cast<int>(point.x);
+		int y = static_cast<int>(point.y);
+		return x >= 0 && y >= 0 && x < map_size && y < map_size && pathable_[y * map_size + x];
+	}
+
+	bool HeadlessGame::IsPlacable(const Point2D& point) const
+	{
+		int x = static_cast<int>(point.x);
+		int y = static_cast<int>(point.y);
+		return x >= 0 && y >= 0 && x < map_size && y < map_size && placeable_[y * map_size + x];
+	}
+
+	//
+	// ActionInterface, commands are applied at the start of the next Step like the real game.
+	//
+
+	void HeadlessGame::UnitCommand(const Unit* unit, AbilityID ability, bool queued_command)
+	{
+		if (unit != nullptr)
+		{
+			pending_.push_back({ unit->tag, ability, false, Point2D(), NullTag, queued_command });
+		}
+	}
+
+	void HeadlessGame::UnitCommand(const Unit* unit, AbilityID ability, const Point2D& point, bool queued_command)
+	{
+		if (unit != nullptr)
+		{
+			pending_.push_back({ unit->tag, ability, true, point, NullTag, queued_command });
+		}
+	}
+
+	void HeadlessGame::UnitCommand(const Unit* unit, AbilityID ability, const Unit* target, bool queued_command)
+	{
+		if (unit != nullptr && target != nullptr)
+		{
+			pending_.push_back({ unit->tag, ability, false, Point2D(), target->tag, queued_command });
+		}
+	}
+
+	void HeadlessGame::UnitCommand(const Units& units, AbilityID ability, bool queued_move)
+	{
+		for (const Unit* unit : units)
+		{
+			UnitCommand(unit, ability, queued_move);
+		}
+	}
+
+	void HeadlessGame::UnitCommand(const Units& units, AbilityID ability, const Point2D& point, bool queued_command)
+	{
+		for (const Unit* unit : units)
+		{
+			UnitCommand(unit, ability, point, queued_command);
+		}
+	}
+
+	void HeadlessGame::UnitCommand(const Units& units, AbilityID ability, const Unit* target, bool queued_command)
+	{
+		for (const Unit* unit : units)
+		{
+			UnitCommand(unit, ability, target, queued_command);
+		}
+	}
+
+	//
+	// QueryInterface
+	//
+
+	AvailableAbilities HeadlessGame::GetAbilitiesForUnit(const Unit* unit, bool ignore_resource_requirements)
+	{
+		AvailableAbilities available;
+		if (unit == nullptr)
+		{
+			return available;
+		}
+
+		for (const Spec& spec : specs_)
+		{
+			if ((unit->unit_type == spec.producer || unit->unit_type == spec.producer_alt) &&
+				(ignore_resource_requirements || Afford(spec)))
+			{
+				AvailableAbility ability;
+				ability.ability_id = spec.ability;
+				ability.requires_point = spec.kind == SpecKind::Structure;
+				available.abilities.push_back(ability);
+			}
+		}
+		return available;
+	}
+
+	std::vector<AvailableAbilities> HeadlessGame::GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements)
+	{
+		std::vector<AvailableAbilities> available;
+		for (const Unit* unit : units)
+		{
+			available.push_back(GetAbilitiesForUnit(unit, ignore_resource_requirements));
+		}
+		return available;
+	}
+
+	// There are no ramps or chokes in the stand-in, a reachable point is a straight line away.
+	float HeadlessGame::PathingDistance(const Point2D& start, const Point2D& end)
+	{
+		return IsPathable(start) && IsPathable(end) ? Distance2D(start, end) : 0.0f;
+	}
+
+	float HeadlessGame::PathingDistance(const Unit* start, const Point2D& end)
+	{
+		if (start == nullptr)
+		{
+			return 0.0f;
+		}
+		return start->is_flying || IsPathable(end) ? Distance2D(start->pos, end) : 0.0f;
+	}
+
+	std::vector<float> HeadlessGame::PathingDistance(const std::vector<PathingQuery>& queries)
+	{
+		std::vector<float> distances;
+		distances.reserve(queries.size());
+		for (const PathingQuery& query : queries)
+		{
+			const Entity* start = query.start_unit_tag_ != NullTag ? Find(query.start_unit_tag_) : nullptr;
+			distances.push_back(start != nullptr ? PathingDistance(&start->unit, query.end_) : PathingDistance(query.start_, query.end_));
+		}
+		return distances;
+	}
+
+	bool HeadlessGame::Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* /*unit*/)
+	{
+		const Spec* spec = SpecOfAbility(ability);
+		if (spec == nullptr || (spec->kind != SpecKind::Structure && spec->kind != SpecKind::AddOn))
+		{
+			return false;
+		}
+
+		// Refineries go on top of a geyser that does not have one yet.
+		if (spec->type == UNIT_TYPEID::TERRAN_REFINERY)
+		{
+			bool geyser = false;
+			for (size_t index : alive_)
+			{
+				const Unit& other = entities_[index].unit;
+				if (DistanceSquared2D(other.pos, target_pos) > 1.0f)
+				{
+					continue;
+				}
+				if (other.unit_type == UNIT_TYPEID::TERRAN_REFINERY)
+				{
+					return false;
+				}
+				geyser |= other.unit_type == UNIT_TYPEID::NEUTRAL_VESPENEGEYSER;
+			}
+			return geyser;
+		}
+
+		return FootprintFree(*spec, Snap(*spec, target_pos));
+	}
+
+	std::vector<bool> HeadlessGame::Placement(const std::vector<PlacementQuery>& queries)
+	{
+		std::vector<bool> results;
+		results.reserve(queries.size());
+		for (const PlacementQuery& query : queries)
+		{
+			results.push_back(Placement(query.ability, query.target_pos));
+		}
+		return results;
+	}
+
+	//
+	// World setup
+	//
+
+	HeadlessGame::Spec& HeadlessGame::Add(SpecKind kind, UNIT_TYPEID type, ABILITY_ID ability, UNIT_TYPEID producer,
+		int minerals, int vespene, float food_required, float build_seconds)
+	{
+		specs_.emplace_back();
+		Spec& spec = specs_.back();
+		spec.kind = kind;
+		spec.type = type;
+		spec.ability = ability;
+		spec.producer = producer;
+		spec.minerals = minerals;
+		spec.vespene = vespene;
+		spec.food_required = food_required;
+		spec.build_seconds = build_seconds;
+		return spec;
+	}
+
+	void HeadlessGame::BuildUnitTypeData()
+	{
+		typedef UNIT_TYPEID U;
+		typedef ABILITY_ID A;
+		typedef Weapon::TargetType T;
+		const std::vector<Attribute> light_bio = { Attribute::Light, Attribute::Biological };
+		const std::vector<Attribute> armored_bio = { Attribute::Armored, Attribute::Biological };
+		const std::vector<Attribute> armored_mech = { Attribute::Armored, Attribute::Mechanical };
+		const std::vector<Attribute> structure = { Attribute::Armored, Attribute::Mechanical, Attribute::Structure };
+
+		// Terran units, times and cooldowns in faster-speed seconds, speeds in normal-speed units.
+		Add(SpecKind::Unit, U::TERRAN_SCV, A::TRAIN_SCV, U::TERRAN_COMMANDCENTER, 50, 0, 1, 12).Alt(U::TERRAN_ORBITALCOMMAND)
+			.Body(0.375f, 45, 2.81f, 8).Arms(T::Ground, 0.1f, 5, 1.07f).Attributes({ Attribute::Light, Attribute::Biological, Attribute::Mechanical });
+		Add(SpecKind::Unit, U::TERRAN_MULE, A::EFFECT_CALLDOWNMULE, U::TERRAN_ORBITALCOMMAND, 0, 0, 0, 0)
+			.Body(0.375f, 60, 2.81f, 8).Attributes({ Attribute::Light, Attribute::Mechanical, Attribute::Summoned });
+		Add(SpecKind::Unit, U::TERRAN_MARINE, A::TRAIN_MARINE, U::TERRAN_BARRACKS, 50, 0, 1, 18)
+			.Body(0.375f, 45, 2.25f, 9).Arms(T::Any, 5, 6, 0.61f).Attributes(light_bio);
+		Add(SpecKind::Unit, U::TERRAN_MARAUDER, A::TRAIN_MARAUDER, U::TERRAN_BARRACKS, 100, 25, 2, 21).Needs(U::TERRAN_BARRACKSTECHLAB)
+			.Body(0.5625f, 125, 2.25f, 10).Arms(T::Ground, 6, 10, 1.07f).Attributes(armored_bio);
+		Add(SpecKind::Unit, U::TERRAN_SIEGETANK, A::TRAIN_SIEGETANK, U::TERRAN_FACTORY, 150, 125, 3, 32).Needs(U::TERRAN_FACTORYTECHLAB)
+			.Body(0.875f, 175, 2.25f, 11).Arms(T::Ground, 7, 15, 1.04f).Attributes(armored_mech);
+		Add(SpecKind::InstantMorph, U::TERRAN_SIEGETANKSIEGED, A::MORPH_SIEGEMODE, U::TERRAN_SIEGETANK, 150, 125, 3, 0)
+			.Body(0.875f, 175, 0, 11).Arms(T::Ground, 13, 40, 2.14f).Attributes(armored_mech);
+		Add(SpecKind::InstantMorph, U::TERRAN_SIEGETANK, A::MORPH_UNSIEGE, U::TERRAN_SIEGETANKSIEGED, 150, 125, 3, 0);
+		Add(SpecKind::Unit, U::TERRAN_VIKINGFIGHTER, A::TRAIN_VIKINGFIGHTER, U::TERRAN_STARPORT, 150, 75, 2, 30)
+			.Body(0.75f, 135, 2.75f, 10).Arms(T::Air, 9, 20, 2.0f).Attributes(armored_mech).Flying();
+		Add(SpecKind::InstantMorph, U::TERRAN_VIKINGASSAULT, A::MORPH_VIKINGASSAULTMODE, U::TERRAN_VIKINGFIGHTER, 150, 75, 2, 0)
+			.Body(0.75f, 135, 2.25f, 10).Arms(T::Ground, 6, 12, 0.71f).Attributes(armored_mech);
+		Add(SpecKind::InstantMorph, U::TERRAN_VIKINGFIGHTER, A::MORPH_VIKINGFIGHTERMODE, U::TERRAN_VIKINGASSAULT, 150, 75, 2, 0);
+
+		// Terran structures
+		Add(SpecKind::Structure, U::TERRAN_COMMANDCENTER, A::BUILD_COMMANDCENTER, U::TERRAN_SCV, 400, 0, 0, 71)
+			.Building(5, 15).Body(2.75f, 1500, 0, 11).Attributes(structure);
+		Add(SpecKind::Morph, U::TERRAN_ORBITALCOMMAND, A::MORPH_ORBITALCOMMAND, U::TERRAN_COMMANDCENTER, 150, 0, 0, 25)
+			.Building(5, 15).Body(2.75f, 1500, 0, 11).Attributes(structure);
+		Add(SpecKind::Structure, U::TERRAN_SUPPLYDEPOT, A::BUILD_SUPPLYDEPOT, U::TERRAN_SCV, 100, 0, 0, 21)
+			.Building(2, 8).Body(1.25f, 400, 0, 9).Attributes(structure);
+		Add(SpecKind::Structure, U::TERRAN_REFINERY, A::BUILD_REFINERY, U::TERRAN_SCV, 75, 0, 0, 21)
+			.Building(3).Body(1.75f, 500, 0, 9).Attributes(structure);
+		Add(SpecKind::Structure, U::TERRAN_BARRACKS, A::BUILD_BARRACKS, U::TERRAN_SCV, 150, 0, 0, 46)
+			.Building(3).Body(1.75f, 1000, 0, 9).Attributes(structure);
+		Add(SpecKind::Structure, U::TERRAN_ENGINEERINGBAY, A::BUILD_ENGINEERINGBAY, U::TERRAN_SCV, 125, 0, 0, 25)
+			.Building(3).Body(1.75f, 850, 0, 9).Attributes(structure);
+		Add(SpecKind::Structure, U::TERRAN_FACTORY, A::BUILD_FACTORY, U::TERRAN_SCV, 150, 100, 0, 43)
+			.Building(3).Body(1.75f, 1250, 0, 9).Attributes(structure);
+		Add(SpecKind::Structure, U::TERRAN_STARPORT, A::BUILD_STARPORT, U::TERRAN_SCV, 150, 100, 0, 36)
+			.Building(3).Body(1.75f, 1300, 0, 9).Attributes(structure);
+		Add(SpecKind::Structure, U::TERRAN_ARMORY, A::BUILD_ARMORY, U::TERRAN_SCV, 150, 100, 0, 46)
+			.Building(3).Body(1.75f, 750, 0, 9).Attributes(structure);
+		Add(SpecKind::AddOn, U::TERRAN_BARRACKSTECHLAB, A::BUILD_TECHLAB_BARRACKS, U::TERRAN_BARRACKS, 50, 25, 0, 18)
+			.Building(2).Body(1.0f, 400, 0, 9).Attributes(structure);
+		Add(SpecKind::AddOn, U::TERRAN_BARRACKSREACTOR, A::BUILD_REACTOR_BARRACKS, U::TERRAN_BARRACKS, 50, 50, 0, 36)
+			.Building(2).Body(1.0f, 400, 0, 9).Attributes(structure);
+		Add(SpecKind::AddOn, U::TERRAN_FACTORYTECHLAB, A::BUILD_TECHLAB_FACTORY, U::TERRAN_FACTORY, 50, 25, 0, 18)
+			.Building(2).Body(1.0f, 400, 0, 9).Attributes(structure);
+
+		// Researches
+		Add(SpecKind::Research, U::INVALID, A::RESEARCH_TERRANINFANTRYWEAPONS, U::TERRAN_ENGINEERINGBAY, 100, 100, 0, 114)
+			.upgrade = UPGRADE_ID::TERRANINFANTRYWEAPONSLEVEL1;
+		Add(SpecKind::Research, U::INVALID, A::RESEARCH_TERRANINFANTRYARMOR, U::TERRAN_ENGINEERINGBAY, 100, 100, 0, 114)
+			.upgrade = UPGRADE_ID::TERRANINFANTRYARMORSLEVEL1;
+		Add(SpecKind::Research, U::INVALID, A::RESEARCH_COMBATSHIELD, U::TERRAN_BARRACKSTECHLAB, 100, 100, 0, 79)
+			.upgrade = UPGRADE_ID::SHIELDWALL;
+		Add(SpecKind::Research, U::INVALID, A::RESEARCH_CONCUSSIVESHELLS, U::TERRAN_BARRACKSTECHLAB, 50, 50, 0, 43)
+			.upgrade = UPGRADE_ID::PUNISHERGRENADES;
+
+		// Zerg, only ever spawned by the wave script
+		Add(SpecKind::Structure, U::ZERG_HATCHERY, A::INVALID, U::INVALID, 300, 0, 0, 71)
+			.Building(5, 6).Body(2.75f, 1500, 0, 12).Attributes({ Attribute::Armored, Attribute::Biological, Attribute::Structure });
+		Add(SpecKind::Unit, U::ZERG_DRONE, A::INVALID, U::INVALID, 50, 0, 1, 12)
+			.Body(0.375f, 40, 2.81f, 8).Arms(T::Ground, 0.1f, 5, 1.07f).Attributes(light_bio);
+		Add(SpecKind::Unit, U::ZERG_ZERGLING, A::INVALID, U::INVALID, 25, 0, 0.5f, 17)
+			.Body(0.375f, 35, 4.13f, 8).Arms(T::Ground, 0.1f, 5, 0.497f).Attributes(light_bio);
+		Add(SpecKind::Unit, U::ZERG_ROACH, A::INVALID, U::INVALID, 75, 25, 2, 19)
+			.Body(0.625f, 145, 3.15f, 9).Arms(T::Ground, 4, 16, 1.43f).Attributes(armored_bio);
+		Add(SpecKind::Unit, U::ZERG_MUTALISK, A::INVALID, U::INVALID, 100, 100, 2, 24)
+			.Body(0.5f, 120, 5.6f, 11).Arms(T::Any, 3, 9, 1.09f).Attributes(light_bio).Flying();
+
+		// Resources
+		Add(SpecKind::Resource, U::NEUTRAL_MINERALFIELD, A::INVALID, U::INVALID, 0, 0, 0, 0)
+			.Building(2).Body(1.125f, 1, 0, 0);
+		Add(SpecKind::Resource, U::NEUTRAL_VESPENEGEYSER, A::INVALID, U::INVALID, 0, 0, 0, 0)
+			.Building(3).Body(1.75f, 1, 0, 0);
+
+		// Index the table and mirror it into the UnitTypeData the bot reads at game start.
+		uint32_t type_count = 2000;
+		for (const Spec& spec : specs_)
+		{
+			type_count = std::max<uint32_t>(type_count, static_cast<uint32_t>(spec.type) + 1);
+		}
+		spec_of_type_.assign(type_count, -1);
+		unit_type_data_.resize(type_count);
+		for (uint32_t id = 0; id < type_count; id++)
+		{
+			unit_type_data_[id].unit_type_id = id;
+		}
+
+		for (size_t i = 0; i < specs_.size(); i++)
+		{
+			const Spec& spec = specs_[i];
+			if (spec.ability != ABILITY_ID::INVALID && spec_of_ability_.count(static_cast<uint32_t>(spec.ability)) == 0)
+			{
+				spec_of_ability_[static_cast<uint32_t>(spec.ability)] = i;
+			}
+
+			uint32_t id = static_cast<uint32_t>(spec.type);
+			if (spec.type == UNIT_TYPEID::INVALID || spec_of_type_[id] >= 0)
+			{
+				continue;
+			}
+			spec_of_type_[id] = static_cast<int>(i);
+
+			UnitTypeData& data = unit_type_data_[id];
+			data.available = true;
+			data.mineral_cost = spec.minerals;
+			data.vespene_cost = spec.vespene;
+			data.food_required = spec.food_required;
+			data.food_provided = spec.food_provided;
+			data.ability_id = spec.ability;
+			data.race = spec.producer == UNIT_TYPEID::INVALID && spec.kind != SpecKind::Resource ? Race::Zerg : Race::Terran;
+			data.build_time = spec.build_seconds * loops_per_second;
+			data.has_minerals = spec.type == UNIT_TYPEID::NEUTRAL_MINERALFIELD;
+			data.has_vespene = spec.type == UNIT_TYPEID::NEUTRAL_VESPENEGEYSER;
+			data.sight_range = spec.sight;
+			data.movement_speed = spec.speed;
+			data.attributes = spec.attributes;
+			data.tech_requirement = spec.requires_add_on;
+			data.require_attached = spec.requires_add_on != UNIT_TYPEID::INVALID;
+			if (spec.damage > 0.0f)
+			{
+				Weapon weapon;
+				weapon.type = spec.weapon_type;
+				weapon.damage_ = spec.damage;
+				weapon.attacks = 1;
+				weapon.range = spec.range;
+				weapon.speed = spec.cooldown;
+				data.weapons.push_back(weapon);
+			}
+		}
+	}
+
+	void HeadlessGame::BuildMap()
+	{
+		// Four bases a side, mirrored through the centre so neither start is favoured.
+		std::vector<Point2D> bases = {
+			Point2D(30.5f, 30.5f), Point2D(30.5f, 64.5f), Point2D(64.5f, 28.5f), Point2D(36.5f, 104.5f) };
+		size_t half = bases.size();
+		for (size_t i = 0; i < half; i++)
+		{
+			bases.push_back(Point2D(map_size - bases[i].x, map_size - bases[i].y));
+		}
+		start_location_ = Point3D(bases[0].x, bases[0].y, 0.0f);
+		enemy_location_ = bases[half];
+
+		pathable_.assign(map_size * map_size, 0);
+		for (int y = static_cast<int>(playable_border); y < map_size - playable_border; y++)
+		{
+			for (int x = static_cast<int>(playable_border); x < map_size - playable_border; x++)
+			{
+				pathable_[y * map_size + x] = 1;
+			}
+		}
+
+		// Scatter some impassable rocks between the bases, mirrored like the bases.
+		std::uniform_int_distribution<int> coordinate(static_cast<int>(playable_border), map_size - static_cast<int>(playable_border));
+		std::uniform_int_distribution<int> extent(3, 9);
+		for (int placed = 0, attempts = 0; placed < 8 && attempts < 1000; attempts++)
+		{
+			int x0 = coordinate(random_);
+			int y0 = coordinate(random_);
+			int w = extent(random_);
+			int h = extent(random_);
+			Point2D centre(x0 + w * 0.5f, y0 + h * 0.5f);
+
+			bool clear = true;
+			for (const Point2D& base : bases)
+			{
+				clear &= Distance2D(base, centre) > 22.0f;
+			}
+			if (!clear)
+			{
+				continue;
+			}
+
+			for (int y = y0; y < y0 + h && y < map_size; y++)
+			{
+				for (int x = x0; x < x0 + w && x < map_size; x++)
+				{
+					pathable_[y * map_size + x] = 0;
+					pathable_[(map_size - 1 - y) * map_size + (map_size - 1 - x)] = 0;
+				}
+			}
+			placed++;
+		}
+		placeable_ = pathable_;
+
+		// Grids the bot reads, packed one bit per cell with the top row first like the game sends them.
+		game_info_.width = map_size;
+		game_info_.height = map_size;
+		game_info_.playable_min = Point2D(playable_border, playable_border);
+		game_info_.playable_max = Point2D(map_size - playable_border, map_size - playable_border);
+		game_info_.start_locations = { start_location_, enemy_location_ };
+		game_info_.enemy_start_locations = { enemy_location_ };
+		game_info_.map_name = "Headless";
+
+		ImageData* grids[] = { &game_info_.pathing_grid, &game_info_.placement_grid };
+		const std::vector<uint8_t>* sources[] = { &pathable_, &placeable_ };
+		for (int g = 0; g < 2; g++)
+		{
+			ImageData& grid = *grids[g];
+			grid.width = map_size;
+			grid.height = map_size;
+			grid.bits_per_pixel = 1;
+			grid.data.assign(map_size * map_size / 8, '\0');
+			for (int y = 0; y < map_size; y++)
+			{
+				for (int x = 0; x < map_size; x++)
+				{
+					if ((*sources[g])[y * map_size + x])
+					{
+						int bit = (map_size - 1 - y) * map_size + x;
+						grid.data[bit / 8] |= static_cast<char>(0x80 >> (bit % 8));
+					}
+				}
+			}
+		}
+
+		// Flat terrain, the height image encodes -16..16 in 0..255.
+		const uint8_t height_value = 160;
+		terrain_height_ = -16.0f + 32.0f * height_value / 255.0f;
+		start_location_.z = terrain_height_;
+		game_info_.terrain_height.width = map_size;
+		game_info_.terrain_height.height = map_size;
+		game_info_.terrain_height.bits_per_pixel = 8;
+		game_info_.terrain_height.data.assign(map_size * map_size, static_cast<char>(height_value));
+
+		vision_width_ = static_cast<int>(ceil(map_size / vision_cell_));
+		visible_.assign(vision_width_ * vision_width_, 0);
+		explored_.assign(vision_width_ * vision_width_, 0);
+
+		cell_columns_ = static_cast<int>(ceil(map_size / combat_cell_));
+		for (auto& cells : cells_)
+		{
+			cells.assign(cell_columns_ * cell_columns_, std::vector<size_t>());
+		}
+
+		for (const Point2D& base : bases)
+		{
+			AddBase(base);
+		}
+	}
+
+	void HeadlessGame::AddBase(const Point2D& position)
+	{
+		// Resources sit in an arc on the side facing away from the middle of the map.
+		Point2D centre(map_size * 0.5f, map_size * 0.5f);
+		float facing = atan2(position.y - centre.y, position.x - centre.x);
+
+		for (int i = 0; i < 8; i++)
+		{
+			float angle = facing + (i - 3.5f) * 0.26f;
+			float distance = i % 2 == 0 ? 7.0f : 8.0f;
+			Point2D patch(position.x + cos(angle) * distance, position.y + sin(angle) * distance);
+			patch = Point2D(floor(patch.x * 2.0f + 0.5f) * 0.5f, floor(patch.y * 2.0f + 0.5f) * 0.5f);
+
+			Entity* mineral = Spawn(UNIT_TYPEID::NEUTRAL_MINERALFIELD, Unit::Alliance::Neutral, patch);
+			mineral->unit.mineral_contents = i < 4 ? 1800 : 900;
+		}
+
+		for (int side = -1; side <= 1; side += 2)
+		{
+			float angle = facing + side * 1.45f;
+			Point2D spot(floor(position.x + cos(angle) * 7.5f) + 0.5f, floor(position.y + sin(angle) * 7.5f) + 0.5f);
+
+			Entity* geyser = Spawn(UNIT_TYPEID::NEUTRAL_VESPENEGEYSER, Unit::Alliance::Neutral, spot);
+			geyser->unit.vespene_contents = 2250;
+		}
+	}
+
+	HeadlessGame::Entity* HeadlessGame::Spawn(UNIT_TYPEID type, Unit::Alliance alliance, const Point2D& position, float build_progress)
+	{
+		size_t index = entities_.size();
+		entities_.emplace_back();
+		Entity& entity = entities_.back();
+
+		Unit& unit = entity.unit;
+		unit.tag = next_tag_++;
+		unit.alliance = alliance;
+		unit.owner = alliance == Unit::Alliance::Self ? 1 : (alliance == Unit::Alliance::Enemy ? 2 : 16);
+		unit.display_type = alliance == Unit::Alliance::Enemy ? Unit::DisplayType::Hidden : Unit::DisplayType::Visible;
+		unit.cloak = Unit::CloakState::NotCloaked;
+		unit.pos = Point3D(position.x, position.y, terrain_height_);
+		unit.build_progress = build_progress;
+		unit.add_on_tag = NullTag;
+		unit.engaged_target_tag = NullTag;
+		unit.is_alive = true;
+		unit.last_seen_game_loop = game_loop_;
+
+		SetType(entity, type);
+		unit.health = build_progress < 1.0f ? std::max(1.0f, unit.health_max * 0.1f) : unit.health_max;
+
+		index_[unit.tag] = index;
+		alive_.push_back(index);
+		if (alliance == Unit::Alliance::Self)
+		{
+			created_.push_back(&unit);
+		}
+		return &entity;
+	}
+
+	HeadlessGame::Entity* HeadlessGame::Find(Tag tag)
+	{
+		auto found = index_.find(tag);
+		return found == index_.end() ? nullptr : &entities_[found->second];
+	}
+
+	const HeadlessGame::Entity* HeadlessGame::Find(Tag tag) const
+	{
+		auto found = index_.find(tag);
+		return found == index_.end() ? nullptr : &entities_[found->second];
+	}
+
+	const HeadlessGame::Spec* HeadlessGame::SpecOf(UnitTypeID type) const
+	{
+		uint32_t id = type;
+		return id < spec_of_type_.size() && spec_of_type_[id] >= 0 ? &specs_[spec_of_type_[id]] : nullptr;
+	}
+
+	const HeadlessGame::Spec* HeadlessGame::SpecOfAbility(AbilityID ability) const
+	{
+		auto found = spec_of_ability_.find(ability);
+		return found == spec_of_ability_.end() ? nullptr : &specs_[found->second];
+	}
+
+	void HeadlessGame::SetType(Entity& entity, UNIT_TYPEID type)
+	{
+		Unit& unit = entity.unit;
+		float health_fraction = unit.health_max > 0.0f ? unit.health / unit.health_max : 1.0f;
+
+		unit.unit_type = type;
+		const Spec* spec = SpecOf(type);
+		if (spec != nullptr)
+		{
+			unit.radius = spec->radius;
+			unit.health_max = spec->health;
+			unit.is_flying = spec->flying;
+		}
+		unit.health = unit.health_max * health_fraction;
+	}
+
+	//
+	// Simulation
+	//
+
+	void HeadlessGame::ApplyCommand(const Command& command)
+	{
+		Entity* entity = Find(command.unit);
+		if (entity == nullptr || !entity->unit.is_alive || entity->unit.alliance != Unit::Alliance::Self)
+		{
+			return;
+		}
+		Unit& unit = entity->unit;
+		commanded_.push_back(unit.tag);
+
+		Entity* target = command.target != NullTag ? Find(command.target) : nullptr;
+		const Spec* unit_spec = SpecOf(unit.unit_type);
+		bool mobile = unit_spec != nullptr && unit_spec->speed > 0.0f;
+
+		switch (command.ability.ToType())
+		{
+		case ABILITY_ID::STOP:
+			unit.orders.clear();
+			return;
+
+		case ABILITY_ID::EFFECT_CALLDOWNMULE: {
+			if (unit.unit_type != UNIT_TYPEID::TERRAN_ORBITALCOMMAND || unit.energy < 50.0f)
+			{
+				return;
+			}
+			unit.energy -= 50.0f;
+			Point2D drop = target != nullptr ? Point2D(target->unit.pos) : command.point;
+			Entity* mule = Spawn(UNIT_TYPEID::TERRAN_MULE, Unit::Alliance::Self, drop);
+			mule->expires = game_loop_ + mule_lifetime;
+			const Entity* mineral = NearestMineral(drop, 10.0f);
+			if (mineral != nullptr)
+			{
+				mule->harvest_target = mineral->unit.tag;
+				mule->unit.orders.push_back(Order(ABILITY_ID::HARVEST_GATHER, mineral->unit.tag));
+			}
+			return;
+		}
+
+		case ABILITY_ID::MOVE:
+		case ABILITY_ID::SMART:
+		case ABILITY_ID::ATTACK:
+		case ABILITY_ID::ATTACK_ATTACK:
+		case ABILITY_ID::HARVEST_GATHER: {
+			// Rally points are not simulated, structures ignore these.
+			if (!mobile)
+			{
+				return;
+			}
+
+			UnitOrder order = Order(command.ability, command.target, command.point);
+			bool resource = target != nullptr && (target->unit.unit_type == UNIT_TYPEID::NEUTRAL_MINERALFIELD ||
+				(target->unit.unit_type == UNIT_TYPEID::TERRAN_REFINERY && target->unit.alliance == Unit::Alliance::Self));
+
+			if (command.ability == ABILITY_ID::HARVEST_GATHER || (command.ability == ABILITY_ID::SMART && resource))
+			{
+				if (!resource || !IsWorkerType(unit.unit_type))
+				{
+					return;
+				}
+				order.ability_id = ABILITY_ID::HARVEST_GATHER;
+				entity->harvest_target = target->unit.tag;
+				entity->timer = 0;
+			}
+			else if (command.ability == ABILITY_ID::SMART)
+			{
+				order.ability_id = target != nullptr && Hostile(*entity, *target) ? ABILITY_ID::ATTACK_ATTACK : ABILITY_ID::MOVE;
+			}
+			else if (command.ability == ABILITY_ID::ATTACK)
+			{
+				order.ability_id = ABILITY_ID::ATTACK_ATTACK;
+			}
+
+			if (!command.queued)
+			{
+				unit.orders.clear();
+			}
+			unit.orders.push_back(order);
+			return;
+		}
+
+		default:
+			break;
+		}
+
+		const Spec* spec = SpecOfAbility(command.ability);
+		if (spec == nullptr || unit.build_progress < 1.0f ||
+			(unit.unit_type != spec->producer && unit.unit_type != spec->producer_alt))
+		{
+			return;
+		}
+
+		switch (spec->kind)
+		{
+		case SpecKind::InstantMorph:
+			SetType(*entity, spec->type);
+			unit.orders.clear();
+			return;
+
+		case SpecKind::Structure: {
+			// The game rejects orders it cannot pay for up front, but only charges once the worker places it.
+			if (!Afford(*spec))
+			{
+				return;
+			}
+			if (!command.queued)
+			{
+				unit.orders.clear();
+			}
+			unit.orders.push_back(Order(command.ability, command.target, command.point));
+			return;
+		}
+
+		case SpecKind::AddOn: {
+			Point2D site(unit.pos.x + 2.5f, unit.pos.y - 0.5f);
+			if (!unit.orders.empty() || unit.add_on_tag != NullTag || !FootprintFree(*spec, site) || !Afford(*spec))
+			{
+				return;
+			}
+			Pay(*spec);
+			Entity* add_on = Spawn(spec->type, Unit::Alliance::Self, site, 0.0f);
+			add_on->builder = unit.tag;
+			unit.orders.push_back(Order(command.ability, add_on->unit.tag));
+			return;
+		}
+
+		case SpecKind::Unit:
+		case SpecKind::Research:
+		case SpecKind::Morph: {
+			if (unit.orders.size() >= 5 || !Afford(*spec))
+			{
+				return;
+			}
+			if (spec->requires_add_on != UNIT_TYPEID::INVALID)
+			{
+				const Entity* add_on = Find(unit.add_on_tag);
+				if (add_on == nullptr || !add_on->unit.is_alive || add_on->unit.unit_type != spec->requires_add_on)
+				{
+					return;
+				}
+			}
+			if (spec->kind == SpecKind::Morph && (!unit.orders.empty() || unit.add_on_tag != NullTag))
+			{
+				return;
+			}
+			if (spec->kind == SpecKind::Unit && food_used_ + spec->food_required > food_cap_)
+			{
+				return;
+			}
+			if (spec->kind == SpecKind::Research)
+			{
+				if (std::find(upgrades_.begin(), upgrades_.end(), UpgradeID(spec->upgrade)) != upgrades_.end())
+				{
+					return;
+				}
+				for (size_t index : alive_)
+				{
+					for (const UnitOrder& order : entities_[index].unit.orders)
+					{
+						if (order.ability_id == command.ability && entities_[index].unit.alliance == Unit::Alliance::Self)
+						{
+							return;
+						}
+					}
+				}
+			}
+
+			Pay(*spec);
+			food_used_ += static_cast<int32_t>(spec->food_required);
+			unit.orders.push_back(Order(command.ability));
+			return;
+		}
+
+		default:
+			return;
+		}
+	}
+
+	void HeadlessGame::UpdateConstruction(Entity& entity)
+	{
+		Unit& unit = entity.unit;
+		const Spec* spec = SpecOf(unit.unit_type);
+		if (spec == nullptr || spec->build_seconds <= 0.0f)
+		{
+			unit.build_progress = 1.0f;
+			return;
+		}
+
+		float step = 1.0f / (spec->build_seconds * loops_per_second);
+		unit.build_progress = std::min(1.0f, unit.build_progress + step);
+		unit.health = std::min(unit.health_max, unit.health + unit.health_max * step);
+		if (unit.build_progress < 1.0f)
+		{
+			return;
+		}
+
+		completed_.push_back(&unit);
+
+		// Release whoever was building it: the worker's order, or the host structure's add-on order.
+		Entity* builder = Find(entity.builder);
+		if (builder == nullptr || !builder->unit.is_alive)
+		{
+			return;
+		}
+		if (spec->kind == SpecKind::AddOn)
+		{
+			builder->unit.add_on_tag = unit.tag;
+		}
+		std::vector<UnitOrder>& orders = builder->unit.orders;
+		if (!orders.empty() && orders.front().target_unit_tag == unit.tag)
+		{
+			orders.erase(orders.begin());
+		}
+	}
+
+	void HeadlessGame::UpdateProduction(Entity& entity)
+	{
+		Unit& unit = entity.unit;
+		UnitOrder& order = unit.orders.front();
+		const Spec* spec = SpecOfAbility(order.ability_id);
+		if (spec == nullptr || (spec->kind != SpecKind::Unit && spec->kind != SpecKind::Research && spec->kind != SpecKind::Morph) ||
+			(unit.unit_type != spec->producer && unit.unit_type != spec->producer_alt))
+		{
+			return;
+		}
+
+		order.progress += 1.0f / (spec->build_seconds * loops_per_second);
+		if (order.progress < 1.0f)
+		{
+			return;
+		}
+		unit.orders.erase(unit.orders.begin());
+
+		switch (spec->kind)
+		{
+		case SpecKind::Unit: {
+			float offset = unit.radius + 1.0f;
+			Spawn(spec->type, Unit::Alliance::Self, Point2D(unit.pos.x + offset, unit.pos.y - offset));
+			break;
+		}
+		case SpecKind::Research:
+			upgrades_.push_back(spec->upgrade);
+			upgrades_completed_.push_back(spec->upgrade);
+			break;
+		case SpecKind::Morph:
+			SetType(entity, spec->type);
+			unit.energy = 50.0f;
+			unit.energy_max = 200.0f;
+			break;
+		default:
+			break;
+		}
+	}
+
+	void HeadlessGame::UpdateMovement(Entity& entity)
+	{
+		Unit& unit = entity.unit;
+		if (!unit.is_alive || unit.build_progress < 1.0f)
+		{
+			return;
+		}
+		const Spec* spec = SpecOf(unit.unit_type);
+		if (spec == nullptr || spec->speed <= 0.0f)
+		{
+			return;
+		}
+
+		if (unit.orders.empty())
+		{
+			// Idle units step up to fight anything that wanders into sight.
+			const Entity* chase = entity.engaged ? nullptr : Find(entity.chase);
+			if (chase != nullptr && !IsWorkerType(unit.unit_type))
+			{
+				MoveToward(entity, chase->unit.pos, spec->range + unit.radius + chase->unit.radius);
+			}
+			return;
+		}
+
+		UnitOrder& order = unit.orders.front();
+		if (IsHarvestAbility(order.ability_id))
+		{
+			UpdateHarvest(entity);
+			return;
+		}
+
+		const Spec* order_spec = SpecOfAbility(order.ability_id);
+		if (order_spec != nullptr && order_spec->kind == SpecKind::Structure)
+		{
+			UpdateBuild(entity);
+			return;
+		}
+
+		if (order.ability_id == ABILITY_ID::ATTACK_ATTACK)
+		{
+			if (entity.engaged)
+			{
+				return;
+			}
+			const Entity* chase = Find(entity.chase);
+			if (chase != nullptr)
+			{
+				MoveToward(entity, chase->unit.pos, spec->range + unit.radius + chase->unit.radius);
+				return;
+			}
+		}
+
+		Point2D destination = order.target_pos;
+		if (order.target_unit_tag != NullTag)
+		{
+			const Entity* target = Find(order.target_unit_tag);
+			if (target == nullptr || !target->unit.is_alive)
+			{
+				unit.orders.erase(unit.orders.begin());
+				return;
+			}
+			destination = target->unit.pos;
+		}
+
+		if (MoveToward(entity, destination, order.target_unit_tag != NullTag ? spec->range + 1.0f : 0.5f))
+		{
+			unit.orders.erase(unit.orders.begin());
+		}
+	}
+
+	void HeadlessGame::UpdateHarvest(Entity& entity)
+	{
+		Unit& unit = entity.unit;
+		UnitOrder& order = unit.orders.front();
+
+		if (order.ability_id == ABILITY_ID::HARVEST_GATHER)
+		{
+			Entity* resource = Find(entity.harvest_target);
+			bool refinery = resource != nullptr && resource->unit.unit_type == UNIT_TYPEID::TERRAN_REFINERY;
+			if (resource == nullptr || !resource->unit.is_alive || (refinery && resource->unit.vespene_contents <= 0))
+			{
+				const Entity* other = refinery ? nullptr : NearestMineral(unit.pos, 15.0f);
+				if (other == nullptr)
+				{
+					unit.orders.erase(unit.orders.begin());
+					return;
+				}
+				entity.harvest_target = other->unit.tag;
+				order.target_unit_tag = other->unit.tag;
+				return;
+			}
+
+			if (!MoveToward(entity, resource->unit.pos, resource->unit.radius + unit.radius + 0.2f))
+			{
+				return;
+			}
+			if (++entity.timer < (refinery ? vespene_mine_loops : mineral_mine_loops))
+			{
+				return;
+			}
+			entity.timer = 0;
+
+			if (refinery)
+			{
+				entity.carrying_vespene = std::min(vespene_trip, resource->unit.vespene_contents);
+				resource->unit.vespene_contents -= entity.carrying_vespene;
+			}
+			else
+			{
+				int trip = unit.unit_type == UNIT_TYPEID::TERRAN_MULE ? mule_trip : mineral_trip;
+				entity.carrying_minerals = std::min(trip, resource->unit.mineral_contents);
+				resource->unit.mineral_contents -= entity.carrying_minerals;
+				if (resource->unit.mineral_contents <= 0)
+				{
+					resource->unit.health = 0.0f;
+				}
+			}
+
+			const Entity* town_hall = NearestTownHall(unit.pos);
+			if (town_hall == nullptr)
+			{
+				unit.orders.erase(unit.orders.begin());
+				return;
+			}
+			order = Order(ABILITY_ID::HARVEST_RETURN, town_hall->unit.tag);
+			return;
+		}
+
+		const Entity* town_hall = Find(order.target_unit_tag);
+		if (town_hall == nullptr || !town_hall->unit.is_alive)
+		{
+			town_hall = NearestTownHall(unit.pos);
+			if (town_hall == nullptr)
+			{
+				unit.orders.erase(unit.orders.begin());
+				return;
+			}
+			order.target_unit_tag = town_hall->unit.tag;
+		}
+
+		if (!MoveToward(entity, town_hall->unit.pos, town_hall->unit.radius + unit.radius + 0.2f))
+		{
+			return;
+		}
+		minerals_ += entity.carrying_minerals;
+		vespene_ += entity.carrying_vespene;
+		entity.carrying_minerals = 0;
+		entity.carrying_vespene = 0;
+		order = Order(ABILITY_ID::HARVEST_GATHER, entity.harvest_target);
+	}
+
+	void HeadlessGame::UpdateBuild(Entity& entity)
+	{
+		Unit& unit = entity.unit;
+		UnitOrder& order = unit.orders.front();
+		const Spec* spec = SpecOfAbility(order.ability_id);
+
+		// Once placed, the worker stays on the structure until UpdateConstruction releases it.
+		const Entity* target = Find(order.target_unit_tag);
+		if (target != nullptr && target->unit.alliance == Unit::Alliance::Self)
+		{
+			if (!target->unit.is_alive)
+			{
+				unit.orders.erase(unit.orders.begin());
+			}
+			return;
+		}
+
+		bool refinery = spec->type == UNIT_TYPEID::TERRAN_REFINERY;
+		if (refinery && (target == nullptr || !target->unit.is_alive))
+		{
+			unit.orders.erase(unit.orders.begin());
+			return;
+		}
+		Point2D site = refinery ? Point2D(target->unit.pos) : Snap(*spec, order.target_pos);
+
+		if (!MoveToward(entity, site, spec->footprint * 0.5f + unit.radius + 0.5f))
+		{
+			return;
+		}
+
+		bool placeable = refinery ? Placement(order.ability_id, site) : FootprintFree(*spec, site);
+		if (!placeable || !Afford(*spec))
+		{
+			unit.orders.erase(unit.orders.begin());
+			return;
+		}
+
+		Pay(*spec);
+		Entity* structure = Spawn(spec->type, Unit::Alliance::Self, site, 0.0f);
+		structure->builder = unit.tag;
+		if (refinery)
+		{
+			structure->unit.vespene_contents = target->unit.vespene_contents;
+		}
+		order.target_unit_tag = structure->unit.tag;
+	}
+
+	void HeadlessGame::UpdateCombat()
+	{
+		for (auto& side : cells_)
+		{
+			for (auto& cell : side)
+			{
+				cell.clear();
+			}
+		}
+		for (size_t index : alive_)
+		{
+			const Unit& unit = entities_[index].unit;
+			if (unit.alliance == Unit::Alliance::Self)
+			{
+				AddToCells(0, index);
+			}
+			else if (unit.alliance == Unit::Alliance::Enemy)
+			{
+				AddToCells(1, index);
+			}
+		}
+
+		for (size_t index : alive_)
+		{
+			Entity& entity = entities_[index];
+			Unit& unit = entity.unit;
+			entity.engaged = false;
+			entity.chase = NullTag;
+			if (unit.alliance == Unit::Alliance::Neutral)
+			{
+				continue;
+			}
+
+			unit.weapon_cooldown = std::max(0.0f, unit.weapon_cooldown - 1.0f);
+			const Spec* spec = SpecOf(unit.unit_type);
+			if (spec == nullptr || spec->damage <= 0.0f || unit.build_progress < 1.0f)
+			{
+				continue;
+			}
+
+			// Workers only fight when told to, and nothing fights while moving or working.
+			bool enemy = unit.alliance == Unit::Alliance::Enemy;
+			AbilityID ability = unit.orders.empty() ? AbilityID(ABILITY_ID::INVALID) : unit.orders.front().ability_id;
+			if (ability != ABILITY_ID::INVALID && ability != ABILITY_ID::ATTACK_ATTACK)
+			{
+				continue;
+			}
+			if (IsWorkerType(unit.unit_type) && (enemy || ability != ABILITY_ID::ATTACK_ATTACK))
+			{
+				continue;
+			}
+
+			const std::vector<std::vector<size_t>>& hostile_cells = cells_[enemy ? 0 : 1];
+			float reach = std::max(spec->range + unit.radius + 3.0f, spec->sight);
+			int x0 = std::max(0, static_cast<int>((unit.pos.x - reach) / combat_cell_));
+			int y0 = std::max(0, static_cast<int>((unit.pos.y - reach) / combat_cell_));
+			int x1 = std::min(cell_columns_ - 1, static_cast<int>((unit.pos.x + reach) / combat_cell_));
+			int y1 = std::min(cell_columns_ - 1, static_cast<int>((unit.pos.y + reach) / combat_cell_));
+
+			Entity* in_range = nullptr;
+			float in_range_distance = std::numeric_limits<float>::max();
+			const Entity* in_sight = nullptr;
+			float in_sight_distance = spec->sight * spec->sight;
+			for (int y = y0; y <= y1; y++)
+			{
+				for (int x = x0; x <= x1; x++)
+				{
+					for (size_t other_index : hostile_cells[y * cell_columns_ + x])
+					{
+						Entity& other = entities_[other_index];
+						bool air = other.unit.is_flying;
+						bool hits = spec->weapon_type == Weapon::TargetType::Any ||
+							(air ? spec->weapon_type == Weapon::TargetType::Air : spec->weapon_type == Weapon::TargetType::Ground);
+						// We only shoot what we can see, they see everything.
+						if (!hits || other.unit.health <= 0.0f || (!enemy && !other.visible))
+						{
+							continue;
+						}
+
+						float distance = DistanceSquared2D(unit.pos, other.unit.pos);
+						float range = spec->range + unit.radius + other.unit.radius;
+						if (distance <= range * range && distance < in_range_distance)
+						{
+							in_range = &other;
+							in_range_distance = distance;
+						}
+						if (distance < in_sight_distance)
+						{
+							in_sight = &other;
+							in_sight_distance = distance;
+						}
+					}
+				}
+			}
+
+			if (in_range == nullptr)
+			{
+				entity.chase = in_sight != nullptr ? in_sight->unit.tag : NullTag;
+				continue;
+			}
+
+			entity.engaged = true;
+			unit.engaged_target_tag = in_range->unit.tag;
+			if (unit.weapon_cooldown <= 0.0f)
+			{
+				in_range->unit.health -= spec->damage;
+				unit.weapon_cooldown = spec->cooldown * loops_per_second;
+			}
+		}
+	}
+
+	void HeadlessGame::UpdateEnemyScript()
+	{
+		if (game_loop_ < first_wave_loop || (game_loop_ - first_wave_loop) % wave_period != 0)
+		{
+			return;
+		}
+
+		const Entity* hatchery = nullptr;
+		size_t army = 0;
+		for (size_t index : alive_)
+		{
+			const Entity& entity = entities_[index];
+			if (entity.unit.alliance != Unit::Alliance::Enemy)
+			{
+				continue;
+			}
+			if (entity.unit.unit_type == UNIT_TYPEID::ZERG_HATCHERY)
+			{
+				hatchery = &entity;
+			}
+			else if (entity.unit.unit_type != UNIT_TYPEID::ZERG_DRONE)
+			{
+				army++;
+			}
+		}
+		if (hatchery == nullptr || army >= enemy_army_cap)
+		{
+			return;
+		}
+
+		// Each wave is bigger than the last and brings air from the third on.
+		waves_sent_++;
+		size_t lings = 4 + 4 * waves_sent_;
+		size_t roaches = waves_sent_;
+		size_t mutas = waves_sent_ > 2 ? waves_sent_ - 2 : 0;
+
+		std::uniform_real_distribution<float> offset(-6.0f, 6.0f);
+		Point2D rally = hatchery->unit.pos;
+		auto spawn_wave = [&](UNIT_TYPEID type, size_t count) {
+			for (size_t i = 0; i < count; i++)
+			{
+				Point2D position(rally.x + offset(random_), rally.y + offset(random_));
+				Entity* unit = Spawn(type, Unit::Alliance::Enemy, position);
+				unit->unit.orders.push_back(Order(ABILITY_ID::ATTACK_ATTACK, NullTag, start_location_));
+			}
+		};
+		spawn_wave(UNIT_TYPEID::ZERG_ZERGLING, lings);
+		spawn_wave(UNIT_TYPEID::ZERG_ROACH, roaches);
+		spawn_wave(UNIT_TYPEID::ZERG_MUTALISK, mutas);
+	}
+
+	void HeadlessGame::UpdateVision()
+	{
+		std::fill(visible_.begin(), visible_.end(), 0);
+		for (size_t index : alive_)
+		{
+			const Unit& unit = entities_[index].unit;
+			const Spec* spec = SpecOf(unit.unit_type);
+			if (unit.alliance != Unit::Alliance::Self || spec == nullptr)
+			{
+				continue;
+			}
+
+			float sight = spec->sight;
+			int x0 = std::max(0, static_cast<int>((unit.pos.x - sight) / vision_cell_));
+			int y0 = std::max(0, static_cast<int>((unit.pos.y - sight) / vision_cell_));
+			int x1 = std::min(vision_width_ - 1, static_cast<int>((unit.pos.x + sight) / vision_cell_));
+			int y1 = std::min(vision_width_ - 1, static_cast<int>((unit.pos.y + sight) / vision_cell_));
+			for (int y = y0; y <= y1; y++)
+			{
+				for (int x = x0; x <= x1; x++)
+				{
+					Point2D centre((x + 0.5f) * vision_cell_, (y + 0.5f) * vision_cell_);
+					if (DistanceSquared2D(centre, unit.pos) <= sight * sight)
+					{
+						visible_[y * vision_width_ + x] = 1;
+						explored_[y * vision_width_ + x] = 1;
+					}
+				}
+			}
+		}
+
+		for (size_t index : alive_)
+		{
+			Entity& entity = entities_[index];
+			Unit& unit = entity.unit;
+			if (unit.alliance != Unit::Alliance::Enemy)
+			{
+				continue;
+			}
+
+			int x = static_cast<int>(unit.pos.x / vision_cell_);
+			int y = static_cast<int>(unit.pos.y / vision_cell_);
+			bool visible = x >= 0 && y >= 0 && x < vision_width_ && y < vision_width_ && visible_[y * vision_width_ + x];
+			if (visible)
+			{
+				if (!entity.visible)
+				{
+					entered_vision_.push_back(&unit);
+				}
+				entity.seen = true;
+				unit.display_type = Unit::DisplayType::Visible;
+				unit.last_seen_game_loop = game_loop_;
+			}
+			else
+			{
+				const Spec* spec = SpecOf(unit.unit_type);
+				bool structure = spec != nullptr && spec->footprint > 0.0f;
+				unit.display_type = entity.seen && structure ? Unit::DisplayType::Snapshot : Unit::DisplayType::Hidden;
+			}
+			entity.visible = visible;
+		}
+	}
+
+	void HeadlessGame::UpdateEconomy()
+	{
+		float food_cap = 0.0f;
+		float food_used = 0.0f;
+		int32_t workers = 0;
+
+		for (size_t index : alive_)
+		{
+			Unit& unit = entities_[index].unit;
+			if (unit.alliance != Unit::Alliance::Self)
+			{
+				continue;
+			}
+			const Spec* spec = SpecOf(unit.unit_type);
+			if (spec != nullptr && unit.build_progress >= 1.0f)
+			{
+				food_cap += spec->food_provided;
+				food_used += spec->footprint > 0.0f ? 0.0f : spec->food_required;
+			}
+			workers += unit.unit_type == UNIT_TYPEID::TERRAN_SCV ? 1 : 0;
+
+			// Supply is held from the moment a unit is queued.
+			for (const UnitOrder& order : unit.orders)
+			{
+				const Spec* order_spec = SpecOfAbility(order.ability_id);
+				if (order_spec != nullptr && order_spec->kind == SpecKind::Unit && spec != nullptr && spec->footprint > 0.0f)
+				{
+					food_used += order_spec->food_required;
+				}
+			}
+
+			if (IsTownHallType(unit.unit_type) || unit.unit_type == UNIT_TYPEID::TERRAN_REFINERY)
+			{
+				unit.assigned_harvesters = 0;
+				unit.ideal_harvesters = 0;
+			}
+		}
+		food_cap_ = static_cast<int32_t>(std::min(200.0f, food_cap));
+		food_used_ = static_cast<int32_t>(food_used);
+		food_workers_ = workers;
+
+		// Ideal harvesters: two per mineral patch near a town hall, three per refinery with gas left.
+		for (size_t index : alive_)
+		{
+			const Unit& resource = entities_[index].unit;
+			if (resource.unit_type != UNIT_TYPEID::NEUTRAL_MINERALFIELD)
+			{
+				continue;
+			}
+			const Entity* town_hall = NearestTownHall(resource.pos);
+			if (town_hall != nullptr && Distance2D(town_hall->unit.pos, resource.pos) < 10.0f)
+			{
+				Find(town_hall->unit.tag)->unit.ideal_harvesters += 2;
+			}
+		}
+
+		for (size_t index : alive_)
+		{
+			const Entity& worker = entities_[index];
+			const Unit& unit = worker.unit;
+			if (unit.alliance == Unit::Alliance::Self && unit.unit_type == UNIT_TYPEID::TERRAN_REFINERY)
+			{
+				Find(unit.tag)->unit.ideal_harvesters = unit.build_progress >= 1.0f && unit.vespene_contents > 0 ? 3 : 0;
+			}
+			if (unit.alliance != Unit::Alliance::Self || unit.unit_type != UNIT_TYPEID::TERRAN_SCV ||
+				unit.orders.empty() || !IsHarvestAbility(unit.orders.front().ability_id))
+			{
+				continue;
+			}
+
+			Entity* resource = Find(worker.harvest_target);
+			if (resource == nullptr || !resource->unit.is_alive)
+			{
+				continue;
+			}
+			if (resource->unit.unit_type == UNIT_TYPEID::TERRAN_REFINERY)
+			{
+				resource->unit.assigned_harvesters++;
+				continue;
+			}
+			const Entity* town_hall = NearestTownHall(resource->unit.pos);
+			if (town_hall != nullptr && Distance2D(town_hall->unit.pos, resource->unit.pos) < 10.0f)
+			{
+				Find(town_hall->unit.tag)->unit.assigned_harvesters++;
+			}
+		}
+	}
+
+	void HeadlessGame::RemoveDead()
+	{
+		size_t kept = 0;
+		for (size_t index : alive_)
+		{
+			Entity& entity = entities_[index];
+			Unit& unit = entity.unit;
+			bool expired = entity.expires != 0 && game_loop_ >= entity.expires;
+			if (unit.health > 0.0f && !expired)
+			{
+				alive_[kept++] = index;
+				continue;
+			}
+
+			unit.is_alive = false;
+			unit.health = 0.0f;
+			unit.orders.clear();
+
+			// Deaths are only reported for what we own or can see.
+			if (unit.alliance == Unit::Alliance::Self)
+			{
+				own_units_lost_ += expired ? 0 : 1;
+				destroyed_.push_back(&unit);
+			}
+			else if (unit.alliance == Unit::Alliance::Enemy)
+			{
+				enemy_units_killed_++;
+				if (entity.visible)
+				{
+					destroyed_.push_back(&unit);
+				}
+			}
+			else
+			{
+				destroyed_.push_back(&unit);
+			}
+		}
+		alive_.resize(kept);
+	}
+
+	//
+	// Helpers
+	//
+
+	bool HeadlessGame::MoveToward(Entity& entity, const Point2D& target, float stop_distance)
+	{
+		Unit& unit = entity.unit;
+		Point2D delta(target.x - unit.pos.x, target.y - unit.pos.y);
+		float distance = sqrt(delta.x * delta.x + delta.y * delta.y);
+		if (distance <= stop_distance)
+		{
+			return true;
+		}
+
+		const Spec* spec = SpecOf(unit.unit_type);
+		float step = spec != nullptr ? spec->speed * speed_per_loop : 0.0f;
+		if (step <= 0.0f)
+		{
+			return false;
+		}
+
+		float travel = std::min(step, distance - stop_distance);
+		unit.pos.x += delta.x / distance * travel;
+		unit.pos.y += delta.y / distance * travel;
+		unit.facing = atan2(delta.y, delta.x);
+		return distance - travel <= stop_distance;
+	}
+
+	const HeadlessGame::Entity* HeadlessGame::NearestTownHall(const Point2D& point) const
+	{
+		const Entity* nearest = nullptr;
+		float nearest_distance = std::numeric_limits<float>::max();
+		for (size_t index : alive_)
+		{
+			const Entity& entity = entities_[index];
+			if (entity.unit.alliance != Unit::Alliance::Self || !IsTownHallType(entity.unit.unit_type) ||
+				entity.unit.build_progress < 1.0f)
+			{
+				continue;
+			}
+			float distance = DistanceSquared2D(entity.unit.pos, point);
+			if (distance < nearest_distance)
+			{
+				nearest = &entity;
+				nearest_distance = distance;
+			}
+		}
+		return nearest;
+	}
+
+	const HeadlessGame::Entity* HeadlessGame::NearestMineral(const Point2D& point, float max_distance) const
+	{
+		const Entity* nearest = nullptr;
+		float nearest_distance = max_distance * max_distance;
+		for (size_t index : alive_)
+		{
+			const Entity& entity = entities_[index];
+			if (entity.unit.unit_type != UNIT_TYPEID::NEUTRAL_MINERALFIELD)
+			{
+				continue;
+			}
+			float distance = DistanceSquared2D(entity.unit.pos, point);
+			if (distance < nearest_distance)
+			{
+				nearest = &entity;
+				nearest_distance = distance;
+			}
+		}
+		return nearest;
+	}
+
+	bool HeadlessGame::Afford(const Spec& spec) const
+	{
+		return minerals_ >= spec.minerals && vespene_ >= spec.vespene;
+	}
+
+	void HeadlessGame::Pay(const Spec& spec)
+	{
+		minerals_ -= spec.minerals;
+		vespene_ -= spec.vespene;
+	}
+
+	bool HeadlessGame::FootprintFree(const Spec& spec, const Point2D& center) const
+	{
+		float half = spec.footprint * 0.5f;
+		for (int y = static_cast<int>(floor(center.y - half)); y < center.y + half; y++)
+		{
+			for (int x = static_cast<int>(floor(center.x - half)); x < center.x + half; x++)
+			{
+				if (x < 0 || y < 0 || x >= map_size || y >= map_size || !placeable_[y * map_size + x])
+				{
+					return false;
+				}
+			}
+		}
+
+		bool town_hall = IsTownHallType(spec.type);
+		for (size_t index : alive_)
+		{
+			const Unit& other = entities_[index].unit;
+			const Spec* other_spec = SpecOf(other.unit_type);
+			if (other_spec == nullptr || other_spec->footprint <= 0.0f)
+			{
+				continue;
+			}
+
+			float reach = half + other_spec->footprint * 0.5f;
+			if (fabs(other.pos.x - center.x) < reach && fabs(other.pos.y - center.y) < reach)
+			{
+				return false;
+			}
+			if (town_hall && other_spec->kind == SpecKind::Resource && Distance2D(other.pos, center) < town_hall_resource_gap)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	Point2D HeadlessGame::Snap(const Spec& spec, const Point2D& point) const
+	{
+		// Odd footprints centre on a cell, even ones on a cell corner.
+		if (static_cast<int>(spec.footprint) % 2 == 1)
+		{
+			return Point2D(floor(point.x) + 0.5f, floor(point.y) + 0.5f);
+		}
+		return Point2D(floor(point.x + 0.5f), floor(point.y + 0.5f));
+	}
+
+	bool HeadlessGame::Hostile(const Entity& a, const Entity& b) const
+	{
+		return (a.unit.alliance == Unit::Alliance::Self && b.unit.alliance == Unit::Alliance::Enemy) ||
+			(a.unit.alliance == Unit::Alliance::Enemy && b.unit.alliance == Unit::Alliance::Self);
+	}
+
+	bool HeadlessGame::Observable(const Entity& entity) const
+	{
+		return entity.unit.alliance != Unit::Alliance::Enemy || entity.unit.display_type != Unit::DisplayType::Hidden;
+	}
+
+	void HeadlessGame::AddToCells(size_t side, size_t index)
+	{
+		const Unit& unit = entities_[index].unit;
+		int x = std::min(cell_columns_ - 1, std::max(0, static_cast<int>(unit.pos.x / combat_cell_)));
+		int y = std::min(cell_columns_ - 1, std::max(0, static_cast<int>(unit.pos.y / combat_cell_)));
+		cells_[side][y * cell_columns_ + x].push_back(index);
+	}
+}
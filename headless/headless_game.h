@@ -0,0 +1,291 @@
+#pragma once
+
+#include <deque>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Offline stand-in for the game, implements the observation, action and query calls Bot makes so
+	// OnStep can be profiled without the StarCraft II binary.
+	// The world is a small scripted Terran-vs-Zerg match: workers mine, structures and units are built
+	// from a cost/time table, and the enemy sends attack waves on a timer. Movement is straight-line and
+	// combat is plain damage-per-shot, good enough to drive the bot's managers, not to judge its play.
+	// Everything random comes from the seed, so the same seed replays the same game.
+	class HeadlessGame : public ObservationInterface, public ActionInterface, public QueryInterface
+	{
+	public:
+		explicit HeadlessGame(uint32_t seed);
+
+		// Advances the world one game loop, applying the commands received since the last call.
+		void Step();
+
+		// Hands this loop's events to the client in the order the real client raises them.
+		void DispatchEvents(Client& client);
+
+		// Either side has lost all of its town halls.
+		bool IsOver() const;
+
+		// Places count units of a type in a disc around center, our workers start mining the nearest patch.
+		// Used to build benchmark populations on top of the scripted start.
+		void AddUnits(UNIT_TYPEID type, Unit::Alliance alliance, size_t count, const Point2D& center, float radius);
+
+		// Forgets the commands received since the last Step, for benchmarks that rerun the bot on one loop.
+		void DropCommands() { pending_.clear(); }
+
+		size_t EnemyUnitsKilled() const { return enemy_units_killed_; }
+		size_t OwnUnitsLost() const { return own_units_lost_; }
+
+		// ObservationInterface
+		uint32_t GetPlayerID() const override { return 1; }
+		uint32_t GetGameLoop() const override { return game_loop_; }
+		Units GetUnits() const override;
+		Units GetUnits(Unit::Alliance alliance, Filter filter = {}) const override;
+		Units GetUnits(Filter filter) const override;
+		const Unit* GetUnit(Tag tag) const override;
+		const RawActions& GetRawActions() const override { return raw_actions_; }
+		const SpatialActions& GetFeatureLayerActions() const override { return spatial_actions_; }
+		const SpatialActions& GetRenderedActions() const override { return spatial_actions_; }
+		const std::vector<ChatMessage>& GetChatMessages() const override { return chat_messages_; }
+		const std::vector<PowerSource>& GetPowerSources() const override { return power_sources_; }
+		const std::vector<UpgradeID>& GetUpgrades() const override { return upgrades_; }
+		const Score& GetScore() const override { return score_; }
+		const Abilities& GetAbilityData(bool /*force_refresh*/ = false) const override { return ability_data_; }
+		const UnitTypes& GetUnitTypeData(bool /*force_refresh*/ = false) const override { return unit_type_data_; }
+		const Upgrades& GetUpgradeData(bool /*force_refresh*/ = false) const override { return upgrade_data_; }
+		const Buffs& GetBuffData(bool /*force_refresh*/ = false) const override { return buff_data_; }
+		const GameInfo& GetGameInfo() const override { return game_info_; }
+		int32_t GetMinerals() const override { return minerals_; }
+		int32_t GetVespene() const override { return vespene_; }
+		int32_t GetFoodCap() const override { return food_cap_; }
+		int32_t GetFoodUsed() const override { return food_used_; }
+		int32_t GetFoodArmy() const override { return food_used_ - food_workers_; }
+		int32_t GetFoodWorkers() const override { return food_workers_; }
+		int32_t GetIdleWorkerCount() const override;
+		int32_t GetArmyCount() const override;
+		int32_t GetWarpGateCount() const override { return 0; }
+		Point2D GetCameraPos() const override { return start_location_; }
+		Point3D GetStartLocation() const override { return start_location_; }
+		const std::vector<PlayerResult>& GetResults() const override { return results_; }
+		bool HasCreep(const Point2D& /*point*/) const override { return false; }
+		Visibility GetVisibility(const Point2D& point) const override;
+		bool IsPathable(const Point2D& point) const override;
+		bool IsPlacable(const Point2D& point) const override;
+		float TerrainHeight(const Point2D& /*point*/) const override { return terrain_height_; }
+		const SC2APIProtocol::Observation* GetRawObservation() const override { return nullptr; }
+
+		// Not present in every API release, declared without override so either header compiles.
+		virtual const std::vector<Effect>& GetEffects() const { return effects_; }
+		virtual const Effects& GetEffectData(bool /*force_refresh*/ = false) const { return effect_data_; }
+		virtual int32_t GetLarvaCount() const { return 0; }
+
+		// ActionInterface
+		void UnitCommand(const Unit* unit, AbilityID ability, bool queued_command = false) override;
+		void UnitCommand(const Unit* unit, AbilityID ability, const Point2D& point, bool queued_command = false) override;
+		void UnitCommand(const Unit* unit, AbilityID ability, const Unit* target, bool queued_command = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, bool queued_move = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, const Point2D& point, bool queued_command = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, const Unit* target, bool queued_command = false) override;
+		const std::vector<Tag>& Commands() const override { return commanded_; }
+		void ToggleAutocast(Tag /*unit_tag*/, AbilityID /*ability*/) override {}
+		void ToggleAutocast(const std::vector<Tag>& /*unit_tags*/, AbilityID /*ability*/) override {}
+		void SendChat(const std::string& /*message*/, ChatChannel /*channel*/ = ChatChannel::All) override {}
+		void SendActions() override {}
+
+		// QueryInterface
+		AvailableAbilities GetAbilitiesForUnit(const Unit* unit, bool ignore_resource_requirements = false) override;
+		std::vector<AvailableAbilities> GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements = false) override;
+		float PathingDistance(const Point2D& start, const Point2D& end) override;
+		float PathingDistance(const Unit* start, const Point2D& end) override;
+		std::vector<float> PathingDistance(const std::vector<PathingQuery>& queries) override;
+		bool Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* unit = nullptr) override;
+		std::vector<bool> Placement(const std::vector<PlacementQuery>& queries) override;
+
+	private:
+		enum class SpecKind { Unit, Structure, AddOn, Morph, InstantMorph, Research, Resource };
+
+		// One row of the cost/time table, units, structures, morphs and researches alike.
+		// Rows are written as Add(...).Body(...).Arms(...) chains in BuildUnitTypeData.
+		struct Spec
+		{
+			SpecKind kind = SpecKind::Unit;
+			UNIT_TYPEID type = UNIT_TYPEID::INVALID;     // Type produced (or morphed into), INVALID for researches
+			ABILITY_ID ability = ABILITY_ID::INVALID;    // Ability that produces it
+			UNIT_TYPEID producer = UNIT_TYPEID::INVALID; // Who uses the ability
+			UNIT_TYPEID producer_alt = UNIT_TYPEID::INVALID;
+			UNIT_TYPEID requires_add_on = UNIT_TYPEID::INVALID;
+			UPGRADE_ID upgrade = UPGRADE_ID::INVALID;    // Researches only
+			int minerals = 0;
+			int vespene = 0;
+			float food_required = 0.0f;
+			float food_provided = 0.0f;
+			float build_seconds = 0.0f;
+			float footprint = 0.0f; // Side of the square a structure covers
+			float radius = 0.5f;
+			float health = 1.0f;
+			float speed = 0.0f;     // Distance per game second
+			float sight = 0.0f;
+			Weapon::TargetType weapon_type = Weapon::TargetType::Invalid;
+			float range = 0.0f;
+			float damage = 0.0f;
+			float cooldown = 0.0f;  // Game seconds between shots
+			bool flying = false;
+			std::vector<Attribute> attributes;
+
+			Spec& Body(float radius_, float health_, float speed_, float sight_)
+			{
+				radius = radius_; health = health_; speed = speed_; sight = sight_;
+				return *this;
+			}
+			Spec& Arms(Weapon::TargetType type_, float range_, float damage_, float cooldown_)
+			{
+				weapon_type = type_; range = range_; damage = damage_; cooldown = cooldown_;
+				return *this;
+			}
+			Spec& Building(float footprint_, float food_provided_ = 0.0f)
+			{
+				footprint = footprint_; food_provided = food_provided_;
+				return *this;
+			}
+			Spec& Attributes(std::vector<Attribute> attributes_)
+			{
+				attributes = attributes_;
+				return *this;
+			}
+			Spec& Alt(UNIT_TYPEID producer_) { producer_alt = producer_; return *this; }
+			Spec& Needs(UNIT_TYPEID add_on) { requires_add_on = add_on; return *this; }
+			Spec& Flying() { flying = true; return *this; }
+		};
+
+		// What the simulation tracks per unit that Unit has no field for.
+		struct Entity
+		{
+			Unit unit = Unit();
+			Tag harvest_target = NullTag;
+			Tag builder = NullTag;        // Structures, the unit constructing it
+			Tag chase = NullTag;          // Nearest hostile in sight, set by UpdateCombat
+			uint32_t timer = 0;           // Mining time so far
+			uint32_t expires = 0;         // MULEs, game loop they time out
+			int carrying_minerals = 0;
+			int carrying_vespene = 0;
+			bool engaged = false;         // Fired or is in range this loop, holds position
+			bool was_idle = false;
+			bool seen = false;            // Enemies, has ever been in our vision
+			bool visible = false;
+		};
+
+		struct Command
+		{
+			Tag unit;
+			AbilityID ability;
+			bool has_point;
+			Point2D point;
+			Tag target;
+			bool queued;
+		};
+
+		Spec& Add(SpecKind kind, UNIT_TYPEID type, ABILITY_ID ability, UNIT_TYPEID producer,
+			int minerals, int vespene, float food_required, float build_seconds);
+		void BuildUnitTypeData();
+		void BuildMap();
+		void AddBase(const Point2D& position);
+
+		Entity* Spawn(UNIT_TYPEID type, Unit::Alliance alliance, const Point2D& position, float build_progress = 1.0f);
+		Entity* Find(Tag tag);
+		const Entity* Find(Tag tag) const;
+		const Spec* SpecOf(UnitTypeID type) const;
+		const Spec* SpecOfAbility(AbilityID ability) const;
+		void SetType(Entity& entity, UNIT_TYPEID type);
+
+		void ApplyCommand(const Command& command);
+		void UpdateConstruction(Entity& entity);
+		void UpdateProduction(Entity& entity);
+		void UpdateMovement(Entity& entity);
+		void UpdateHarvest(Entity& entity);
+		void UpdateBuild(Entity& entity);
+		void UpdateCombat();
+		void UpdateEnemyScript();
+		void UpdateVision();
+		void UpdateEconomy();
+		void RemoveDead();
+
+		// Moves toward target, returns true once within stop_distance.
+		bool MoveToward(Entity& entity, const Point2D& target, float stop_distance);
+		const Entity* NearestTownHall(const Point2D& point) const;
+		const Entity* NearestMineral(const Point2D& point, float max_distance) const;
+		bool Afford(const Spec& spec) const;
+		void Pay(const Spec& spec);
+		bool FootprintFree(const Spec& spec, const Point2D& center) const;
+		Point2D Snap(const Spec& spec, const Point2D& point) const;
+		bool Hostile(const Entity& a, const Entity& b) const;
+		bool Observable(const Entity& entity) const;
+		void AddToCells(size_t side, size_t index);
+
+		std::mt19937 random_;
+		uint32_t game_loop_ = 0;
+		Tag next_tag_ = 0x100000001ull;
+
+		// Deque so Unit pointers handed to the bot stay valid as units are added, like the real unit pool.
+		std::deque<Entity> entities_;
+		std::unordered_map<Tag, size_t> index_;
+		std::vector<size_t> alive_;
+
+		std::vector<Spec> specs_;
+		std::vector<int> spec_of_type_;
+		std::unordered_map<uint32_t, size_t> spec_of_ability_;
+		UnitTypes unit_type_data_; // Built from specs_ by BuildUnitTypeData, the bot's UnitTypeTable reads it
+
+		std::vector<Command> pending_;
+		std::vector<Tag> commanded_;
+
+		// Events raised this loop
+		std::vector<const Unit*> destroyed_;
+		std::vector<const Unit*> created_;
+		std::vector<const Unit*> idle_;
+		std::vector<const Unit*> completed_;
+		std::vector<const Unit*> entered_vision_;
+		std::vector<UpgradeID> upgrades_completed_;
+
+		// Map
+		GameInfo game_info_;
+		std::vector<uint8_t> pathable_;
+		std::vector<uint8_t> placeable_;
+		std::vector<uint8_t> visible_;  // Coarse cells, vision_cell_ units a side
+		std::vector<uint8_t> explored_;
+		std::vector<std::vector<size_t>> cells_[2]; // Combat buckets per side, combat_cell_ units a side
+		int cell_columns_ = 0;
+		const float combat_cell_ = 8.0f;
+		int vision_width_ = 0;
+		const float vision_cell_ = 2.0f;
+		float terrain_height_ = 0.0f;
+		Point3D start_location_;
+		Point2D enemy_location_;
+
+		// Economy
+		int32_t minerals_ = 50;
+		int32_t vespene_ = 0;
+		int32_t food_cap_ = 0;
+		int32_t food_used_ = 0;
+		int32_t food_workers_ = 0;
+		std::vector<UpgradeID> upgrades_;
+		size_t enemy_units_killed_ = 0;
+		size_t own_units_lost_ = 0;
+		size_t waves_sent_ = 0;
+
+		// Data the bot never reads but the interfaces hand out by reference
+		Abilities ability_data_;
+		Upgrades upgrade_data_;
+		Buffs buff_data_;
+		Effects effect_data_;
+		RawActions raw_actions_;
+		SpatialActions spatial_actions_;
+		std::vector<ChatMessage> chat_messages_;
+		std::vector<PowerSource> power_sources_;
+		std::vector<Effect> effects_;
+		std::vector<PlayerResult> results_;
+		Score score_;
+	};
+}
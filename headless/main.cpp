@@ -0,0 +1,146 @@
+// Runs Bot against HeadlessGame for a fixed number of game loops and reports how long each OnStep took.
+// Usage: bot_headless [--frames N] [--seed S] [--csv path] [--actions path]
+// --actions writes every command the bot issued, in the same format as bot_replay's.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "action_log.h"
+#include "bot_examples.h"
+#include "bot_hooks.h"
+#include "headless_game.h"
+#include "utils.h"
+
+using namespace sc2;
+
+namespace
+{
+	double Percentile(const std::vector<double>& sorted, double fraction)
+	{
+		if (sorted.empty())
+		{
+			return 0.0;
+		}
+		size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+		return sorted[std::min(index, sorted.size() - 1)];
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t frames = 20000;
+	uint32_t seed = 1;
+	std::string csv_path;
+	std::string actions_path;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (!strcmp(argv[i], "--frames") && has_value)
+		{
+			frames = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (!strcmp(argv[i], "--seed") && has_value)
+		{
+			seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (!strcmp(argv[i], "--csv") && has_value)
+		{
+			csv_path = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--actions") && has_value)
+		{
+			actions_path = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--frames N] [--seed S] [--csv path] [--actions path]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::ofstream actions_file;
+	if (!actions_path.empty())
+	{
+		actions_file.open(actions_path);
+	}
+
+	// The bot's own random choices come from the same seed, so a run can be repeated exactly.
+	HeadlessGame game(seed);
+	setRandomSeed(seed);
+	std::unique_ptr<MultiplayerBot> bot(CreateBot());
+	ActionLog actions(&game, &game, actions_file.is_open() ? &actions_file : nullptr);
+	bot->SetInterfaces(&game, &actions, &game);
+	bot->OnGameStart();
+
+	std::ofstream csv;
+	if (!csv_path.empty())
+	{
+		csv.open(csv_path);
+		csv << "game_loop,bot_us,world_us,units,minerals,food_used" << std::endl;
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	std::vector<double> step_us;
+	step_us.reserve(frames);
+	double world_us = 0.0;
+
+	Clock::time_point run_start = Clock::now();
+	for (uint32_t frame = 0; frame < frames && !game.IsOver(); frame++)
+	{
+		Clock::time_point world_start = Clock::now();
+		game.Step();
+		Clock::time_point bot_start = Clock::now();
+
+		// Events and OnStep together are what the real client spends in the bot each loop.
+		game.DispatchEvents(*bot);
+		bot->OnStep();
+
+		Clock::time_point bot_end = Clock::now();
+		double world = std::chrono::duration<double, std::micro>(bot_start - world_start).count();
+		double step = std::chrono::duration<double, std::micro>(bot_end - bot_start).count();
+		world_us += world;
+		step_us.push_back(step);
+
+		if (csv.is_open())
+		{
+			csv << game.GetGameLoop() << ',' << step << ',' << world << ',' << game.GetUnits(Unit::Alliance::Self).size() << ','
+				<< game.GetMinerals() << ',' << game.GetFoodUsed() << '\n';
+		}
+	}
+	double run_seconds = std::chrono::duration<double>(Clock::now() - run_start).count();
+
+	bot->OnGameEnd();
+
+	std::vector<double> sorted = step_us;
+	std::sort(sorted.begin(), sorted.end());
+	double total_us = 0.0;
+	for (double us : step_us)
+	{
+		total_us += us;
+	}
+	size_t steps = step_us.size();
+
+	std::cout << "seed " << seed << ", " << steps << " steps in " << run_seconds << " s ("
+		<< (run_seconds > 0.0 ? steps / run_seconds : 0.0) << " steps/s)" << std::endl;
+	std::cout << "OnStep us: mean " << (steps ? total_us / steps : 0.0)
+		<< ", p50 " << Percentile(sorted, 0.50)
+		<< ", p90 " << Percentile(sorted, 0.90)
+		<< ", p99 " << Percentile(sorted, 0.99)
+		<< ", max " << (steps ? sorted.back() : 0.0) << std::endl;
+	std::cout << "World us: mean " << (steps ? world_us / steps : 0.0) << std::endl;
+	std::cout << "End state: loop " << game.GetGameLoop() << ", supply " << game.GetFoodUsed() << "/" << game.GetFoodCap()
+		<< ", own units " << game.GetUnits(Unit::Alliance::Self).size()
+		<< ", enemy units killed " << game.EnemyUnitsKilled()
+		<< ", own units lost " << game.OwnUnitsLost()
+		<< (game.IsOver() ? ", game over" : "") << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,336 @@
+#include "replay_game.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace sc2
+{
+	bool ReplayGame::Open(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::in | std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+		std::vector<uint8_t> packed((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		const size_t magic_size = sizeof(RecordingHeader::magic);
+		if (packed.size() < magic_size || memcmp(packed.data(), RecordingHeader::magic, magic_size) != 0)
+		{
+			return false;
+		}
+
+		// Unpack every block up front, the chunks are read from the result
+		ByteReader blocks(packed.data() + magic_size, packed.data() + packed.size());
+		data_.clear();
+		while (!blocks.AtEnd())
+		{
+			if (!UnpackBlock(blocks, data_))
+			{
+				// The recorder was cut off mid-block, play what came before.
+				damaged_ = true;
+				break;
+			}
+		}
+		reader_ = ByteReader(data_.data(), data_.data() + data_.size());
+
+		uint64_t size = reader_.Varint();
+		if (!reader_.Ok() || size > reader_.Remaining())
+		{
+			return false;
+		}
+		ByteReader header(reader_.Position(), reader_.Position() + size);
+		reader_.Skip(static_cast<size_t>(size));
+		return FrameDecoder::DecodeHeader(header, header_);
+	}
+
+	bool ReplayGame::NextFrame()
+	{
+		if (reader_.AtEnd())
+		{
+			return false;
+		}
+		uint64_t size = reader_.Varint();
+		if (!reader_.Ok() || size > reader_.Remaining())
+		{
+			// The recorder was cut off mid-write, play what came before.
+			damaged_ = true;
+			return false;
+		}
+		ByteReader chunk(reader_.Position(), reader_.Position() + size);
+		reader_.Skip(static_cast<size_t>(size));
+		if (!decoder_.Decode(chunk, frame_))
+		{
+			damaged_ = true;
+			return false;
+		}
+
+		// Units missing from the frame are marked dead like the real pool does, the rest take their recorded state.
+		for (const Unit* unit : present_)
+		{
+			const_cast<Unit*>(unit)->is_alive = false;
+		}
+		present_.clear();
+		for (const RecordedUnit& recorded : frame_.units)
+		{
+			Unit& unit = PoolUnit(recorded.tag);
+			frame_.Restore(recorded, unit);
+			unit.last_seen_game_loop = frame_.game_loop;
+			present_.push_back(&unit);
+		}
+
+		// Event units are as the callback saw them, a destroyed unit is only in its event.
+		events_.clear();
+		for (const RecordedEvent& event : frame_.events)
+		{
+			Unit& unit = PoolUnit(event.unit.tag);
+			frame_.Restore(event.unit, unit);
+			events_.push_back(&unit);
+		}
+
+		upgrades_.assign(frame_.upgrades.begin(), frame_.upgrades.end());
+		queries_ = ByteReader(frame_.queries.data(), frame_.queries.data() + frame_.queries.size());
+		queries_lost_ = false;
+		commanded_.clear();
+		frames_played_++;
+		return true;
+	}
+
+	void ReplayGame::DispatchEvents(Client& client)
+	{
+		for (size_t i = 0; i < frame_.events.size(); i++)
+		{
+			const Unit* unit = events_[i];
+			switch (frame_.events[i].kind)
+			{
+			case RecordedEvent::Kind::UnitDestroyed: client.OnUnitDestroyed(unit); break;
+			case RecordedEvent::Kind::UnitCreated: client.OnUnitCreated(unit); break;
+			case RecordedEvent::Kind::UnitIdle: client.OnUnitIdle(unit); break;
+			case RecordedEvent::Kind::BuildingConstructionComplete: client.OnBuildingConstructionComplete(unit); break;
+			case RecordedEvent::Kind::UnitEnterVision: client.OnUnitEnterVision(unit); break;
+			}
+		}
+	}
+
+	Unit& ReplayGame::PoolUnit(Tag tag)
+	{
+		auto found = pool_index_.find(tag);
+		if (found != pool_index_.end())
+		{
+			return pool_[found->second];
+		}
+		pool_index_[tag] = pool_.size();
+		pool_.emplace_back();
+		return pool_.back();
+	}
+
+	//
+	// ObservationInterface
+	//
+
+	Units ReplayGame::GetUnits() const
+	{
+		return present_;
+	}
+
+	Units ReplayGame::GetUnits(Unit::Alliance alliance, Filter filter) const
+	{
+		Units units;
+		for (const Unit* unit : present_)
+		{
+			if (unit->alliance == alliance && (!filter || filter(*unit)))
+			{
+				units.push_back(unit);
+			}
+		}
+		return units;
+	}
+
+	Units ReplayGame::GetUnits(Filter filter) const
+	{
+		Units units;
+		for (const Unit* unit : present_)
+		{
+			if (!filter || filter(*unit))
+			{
+				units.push_back(unit);
+			}
+		}
+		return units;
+	}
+
+	const Unit* ReplayGame::GetUnit(Tag tag) const
+	{
+		auto found = pool_index_.find(tag);
+		return found != pool_index_.end() ? &pool_[found->second] : nullptr;
+	}
+
+	bool ReplayGame::IsPathable(const Point2D& point) const
+	{
+		return Pathable(header_.game_info, point);
+	}
+
+	bool ReplayGame::IsPlacable(const Point2D& point) const
+	{
+		return sc2::Placement(header_.game_info, point);
+	}
+
+	float ReplayGame::TerrainHeight(const Point2D& point) const
+	{
+		return sc2::TerrainHeight(header_.game_info, point);
+	}
+
+	//
+	// ActionInterface
+	//
+
+	void ReplayGame::UnitCommand(const Unit* unit, AbilityID /*ability*/, bool /*queued_command*/)
+	{
+		commanded_.push_back(unit->tag);
+	}
+
+	void ReplayGame::UnitCommand(const Unit* unit, AbilityID /*ability*/, const Point2D& /*point*/, bool /*queued_command*/)
+	{
+		commanded_.push_back(unit->tag);
+	}
+
+	void ReplayGame::UnitCommand(const Unit* unit, AbilityID /*ability*/, const Unit* /*target*/, bool /*queued_command*/)
+	{
+		commanded_.push_back(unit->tag);
+	}
+
+	void ReplayGame::UnitCommand(const Units& units, AbilityID /*ability*/, bool /*queued_move*/)
+	{
+		for (const Unit* unit : units)
+		{
+			commanded_.push_back(unit->tag);
+		}
+	}
+
+	void ReplayGame::UnitCommand(const Units& units, AbilityID /*ability*/, const Point2D& /*point*/, bool /*queued_command*/)
+	{
+		for (const Unit* unit : units)
+		{
+			commanded_.push_back(unit->tag);
+		}
+	}
+
+	void ReplayGame::UnitCommand(const Units& units, AbilityID /*ability*/, const Unit* /*target*/, bool /*queued_command*/)
+	{
+		for (const Unit* unit : units)
+		{
+			commanded_.push_back(unit->tag);
+		}
+	}
+
+	//
+	// QueryInterface
+	//
+
+	bool ReplayGame::NextQuery(RecordedFrame::QueryKind kind)
+	{
+		if (queries_lost_ || queries_.AtEnd() || queries_.Byte() != static_cast<uint8_t>(kind))
+		{
+			queries_lost_ = true;
+			query_mismatches_++;
+			return false;
+		}
+		return true;
+	}
+
+	AvailableAbilities ReplayGame::ReadAbilities()
+	{
+		AvailableAbilities abilities;
+		uint64_t count = queries_.Varint();
+		for (uint64_t i = 0; i < count && queries_.Ok(); i++)
+		{
+			AvailableAbility ability;
+			ability.ability_id = static_cast<uint32_t>(queries_.Varint());
+			ability.requires_point = queries_.Byte() != 0;
+			abilities.abilities.push_back(ability);
+		}
+		return abilities;
+	}
+
+	AvailableAbilities ReplayGame::GetAbilitiesForUnit(const Unit* /*unit*/, bool /*ignore_resource_requirements*/)
+	{
+		if (!NextQuery(RecordedFrame::QueryKind::AbilitiesForUnit))
+		{
+			return AvailableAbilities();
+		}
+		return ReadAbilities();
+	}
+
+	std::vector<AvailableAbilities> ReplayGame::GetAbilitiesForUnits(const Units& units, bool /*ignore_resource_requirements*/)
+	{
+		std::vector<AvailableAbilities> abilities(units.size());
+		if (!NextQuery(RecordedFrame::QueryKind::AbilitiesForUnits))
+		{
+			return abilities;
+		}
+		uint64_t count = queries_.Varint();
+		for (uint64_t i = 0; i < count && queries_.Ok(); i++)
+		{
+			AvailableAbilities recorded = ReadAbilities();
+			if (i < abilities.size())
+			{
+				abilities[static_cast<size_t>(i)] = recorded;
+			}
+		}
+		return abilities;
+	}
+
+	float ReplayGame::PathingDistance(const Point2D& /*start*/, const Point2D& /*end*/)
+	{
+		return NextQuery(RecordedFrame::QueryKind::PathingDistance) ? queries_.Float() : 0.0f;
+	}
+
+	float ReplayGame::PathingDistance(const Unit* /*start*/, const Point2D& /*end*/)
+	{
+		return NextQuery(RecordedFrame::QueryKind::PathingDistance) ? queries_.Float() : 0.0f;
+	}
+
+	std::vector<float> ReplayGame::PathingDistance(const std::vector<PathingQuery>& queries)
+	{
+		std::vector<float> distances(queries.size(), 0.0f);
+		if (!NextQuery(RecordedFrame::QueryKind::PathingDistances))
+		{
+			return distances;
+		}
+		uint64_t count = queries_.Varint();
+		for (uint64_t i = 0; i < count && queries_.Ok(); i++)
+		{
+			float distance = queries_.Float();
+			if (i < distances.size())
+			{
+				distances[static_cast<size_t>(i)] = distance;
+			}
+		}
+		return distances;
+	}
+
+	bool ReplayGame::Placement(const AbilityID& /*ability*/, const Point2D& /*target_pos*/, const Unit* /*unit*/)
+	{
+		return NextQuery(RecordedFrame::QueryKind::Placement) && queries_.Byte() != 0;
+	}
+
+	std::vector<bool> ReplayGame::Placement(const std::vector<PlacementQuery>& queries)
+	{
+		std::vector<bool> placeable(queries.size(), false);
+		if (!NextQuery(RecordedFrame::QueryKind::Placements))
+		{
+			return placeable;
+		}
+		uint64_t count = queries_.Varint();
+		for (uint64_t i = 0; i < count && queries_.Ok(); i++)
+		{
+			bool result = queries_.Byte() != 0;
+			if (i < placeable.size())
+			{
+				placeable[static_cast<size_t>(i)] = result;
+			}
+		}
+		return placeable;
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+#include "recording_format.h"
+
+namespace sc2
+{
+	// Plays a recording made by ObservationRecorder back to the bot: each frame's units, economy and events
+	// through the observation calls, and queries answered with the recorded results in the order they were asked.
+	// Commands are accepted and dropped, the world follows the recording whatever the bot does. Once the bot
+	// asks different queries than it did when recorded, the answers no longer line up; those are counted.
+	class ReplayGame : public ObservationInterface, public ActionInterface, public QueryInterface
+	{
+	public:
+		// Reads the whole recording, false if it cannot be read or is not a recording.
+		bool Open(const std::string& path);
+
+		const RecordingHeader& Header() const { return header_; }
+
+		// Moves to the next frame, false at the end of the recording or at a damaged frame.
+		// The first frame is the one OnGameStart saw.
+		bool NextFrame();
+
+		// Hands the frame's events to the client in the order they were recorded.
+		void DispatchEvents(Client& client);
+
+		size_t FramesPlayed() const { return frames_played_; }
+		bool Damaged() const { return damaged_; }
+
+		// Queries asked that the recording had no matching answer for (a different kind, or past the last one).
+		size_t QueryMismatches() const { return query_mismatches_; }
+
+		// ObservationInterface
+		uint32_t GetPlayerID() const override { return header_.player_id; }
+		uint32_t GetGameLoop() const override { return frame_.game_loop; }
+		Units GetUnits() const override;
+		Units GetUnits(Unit::Alliance alliance, Filter filter = {}) const override;
+		Units GetUnits(Filter filter) const override;
+		const Unit* GetUnit(Tag tag) const override;
+		const RawActions& GetRawActions() const override { return raw_actions_; }
+		const SpatialActions& GetFeatureLayerActions() const override { return spatial_actions_; }
+		const SpatialActions& GetRenderedActions() const override { return spatial_actions_; }
+		const std::vector<ChatMessage>& GetChatMessages() const override { return chat_messages_; }
+		const std::vector<PowerSource>& GetPowerSources() const override { return power_sources_; }
+		const std::vector<UpgradeID>& GetUpgrades() const override { return upgrades_; }
+		const Score& GetScore() const override { return score_; }
+		const Abilities& GetAbilityData(bool /*force_refresh*/ = false) const override { return ability_data_; }
+		const UnitTypes& GetUnitTypeData(bool /*force_refresh*/ = false) const override { return header_.unit_types; }
+		const Upgrades& GetUpgradeData(bool /*force_refresh*/ = false) const override { return upgrade_data_; }
+		const Buffs& GetBuffData(bool /*force_refresh*/ = false) const override { return buff_data_; }
+		const GameInfo& GetGameInfo() const override { return header_.game_info; }
+		int32_t GetMinerals() const override { return frame_.economy[RecordedFrame::Minerals]; }
+		int32_t GetVespene() const override { return frame_.economy[RecordedFrame::Vespene]; }
+		int32_t GetFoodCap() const override { return frame_.economy[RecordedFrame::FoodCap]; }
+		int32_t GetFoodUsed() const override { return frame_.economy[RecordedFrame::FoodUsed]; }
+		int32_t GetFoodArmy() const override { return frame_.economy[RecordedFrame::FoodArmy]; }
+		int32_t GetFoodWorkers() const override { return frame_.economy[RecordedFrame::FoodWorkers]; }
+		int32_t GetIdleWorkerCount() const override { return frame_.economy[RecordedFrame::IdleWorkers]; }
+		int32_t GetArmyCount() const override { return frame_.economy[RecordedFrame::ArmyCount]; }
+		int32_t GetWarpGateCount() const override { return frame_.economy[RecordedFrame::WarpGates]; }
+		Point2D GetCameraPos() const override { return header_.start_location; }
+		Point3D GetStartLocation() const override { return header_.start_location; }
+		const std::vector<PlayerResult>& GetResults() const override { return results_; }
+		bool HasCreep(const Point2D& /*point*/) const override { return false; }
+		Visibility GetVisibility(const Point2D& /*point*/) const override { return Visibility::Visible; }
+		bool IsPathable(const Point2D& point) const override;
+		bool IsPlacable(const Point2D& point) const override;
+		float TerrainHeight(const Point2D& point) const override;
+		const SC2APIProtocol::Observation* GetRawObservation() const override { return nullptr; }
+
+		// Not present in every API release, declared without override so either header compiles.
+		virtual const std::vector<Effect>& GetEffects() const { return effects_; }
+		virtual const Effects& GetEffectData(bool /*force_refresh*/ = false) const { return effect_data_; }
+		virtual int32_t GetLarvaCount() const { return 0; }
+
+		// ActionInterface
+		void UnitCommand(const Unit* unit, AbilityID ability, bool queued_command = false) override;
+		void UnitCommand(const Unit* unit, AbilityID ability, const Point2D& point, bool queued_command = false) override;
+		void UnitCommand(const Unit* unit, AbilityID ability, const Unit* target, bool queued_command = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, bool queued_move = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, const Point2D& point, bool queued_command = false) override;
+		void UnitCommand(const Units& units, AbilityID ability, const Unit* target, bool queued_command = false) override;
+		const std::vector<Tag>& Commands() const override { return commanded_; }
+		void ToggleAutocast(Tag /*unit_tag*/, AbilityID /*ability*/) override {}
+		void ToggleAutocast(const std::vector<Tag>& /*unit_tags*/, AbilityID /*ability*/) override {}
+		void SendChat(const std::string& /*message*/, ChatChannel /*channel*/ = ChatChannel::All) override {}
+		void SendActions() override {}
+
+		// QueryInterface
+		AvailableAbilities GetAbilitiesForUnit(const Unit* unit, bool ignore_resource_requirements = false) override;
+		std::vector<AvailableAbilities> GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements = false) override;
+		float PathingDistance(const Point2D& start, const Point2D& end) override;
+		float PathingDistance(const Unit* start, const Point2D& end) override;
+		std::vector<float> PathingDistance(const std::vector<PathingQuery>& queries) override;
+		bool Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* unit = nullptr) override;
+		std::vector<bool> Placement(const std::vector<PlacementQuery>& queries) override;
+
+	private:
+		// The pooled Unit for a tag, created on first sight. Pointers stay valid for the whole replay.
+		Unit& PoolUnit(Tag tag);
+
+		// Positions the query reader on the next recorded answer, false (and counted) if it is not of this kind.
+		bool NextQuery(RecordedFrame::QueryKind kind);
+		AvailableAbilities ReadAbilities();
+
+		std::vector<uint8_t> data_;
+		ByteReader reader_ = ByteReader(nullptr, nullptr);
+		ByteReader queries_ = ByteReader(nullptr, nullptr);
+		bool queries_lost_ = false; // A mismatch leaves the reader mid-answer, the rest of the frame's are unusable
+
+		RecordingHeader header_;
+		FrameDecoder decoder_;
+		RecordedFrame frame_;
+		size_t frames_played_ = 0;
+		size_t query_mismatches_ = 0;
+		bool damaged_ = false;
+
+		// Deque so Unit pointers handed to the bot stay valid, like the real unit pool.
+		std::deque<Unit> pool_;
+		std::unordered_map<Tag, size_t> pool_index_;
+		Units present_; // This frame's units in GetUnits order
+		std::vector<const Unit*> events_;
+		std::vector<Tag> commanded_;
+		std::vector<UpgradeID> upgrades_;
+
+		// Data the recording does not carry but the interfaces hand out by reference
+		Abilities ability_data_;
+		Upgrades upgrade_data_;
+		Buffs buff_data_;
+		Effects effect_data_;
+		RawActions raw_actions_;
+		SpatialActions spatial_actions_;
+		std::vector<ChatMessage> chat_messages_;
+		std::vector<PowerSource> power_sources_;
+		std::vector<Effect> effects_;
+		std::vector<PlayerResult> results_;
+		Score score_;
+	};
+}
@@ -0,0 +1,147 @@
+// Replays a recording made with BOT_RECORD through Bot, with no game process, as fast as it will go.
+// Usage: bot_replay <recording> [--passes N] [--actions path]
+// Each pass prints OnStep timings and a hash of every command the bot issued; a deterministic bot prints the
+// same hash every pass. --actions writes the first pass's commands, one per line, to diff two builds of the bot.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "action_log.h"
+#include "bot_examples.h"
+#include "bot_hooks.h"
+#include "replay_game.h"
+#include "utils.h"
+
+using namespace sc2;
+
+namespace
+{
+	double Percentile(const std::vector<double>& sorted, double fraction)
+	{
+		if (sorted.empty())
+		{
+			return 0.0;
+		}
+		size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+		return sorted[std::min(index, sorted.size() - 1)];
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string recording_path;
+	std::string actions_path;
+	uint32_t passes = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (!strcmp(argv[i], "--passes") && has_value)
+		{
+			passes = std::max<uint32_t>(1, static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)));
+		}
+		else if (!strcmp(argv[i], "--actions") && has_value)
+		{
+			actions_path = argv[++i];
+		}
+		else if (recording_path.empty() && argv[i][0] != '-')
+		{
+			recording_path = argv[i];
+		}
+		else
+		{
+			recording_path.clear();
+			break;
+		}
+	}
+	if (recording_path.empty())
+	{
+		std::cerr << "Usage: " << argv[0] << " <recording> [--passes N] [--actions path]" << std::endl;
+		return 1;
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	uint64_t first_hash = 0;
+	bool deterministic = true;
+
+	for (uint32_t pass = 0; pass < passes; pass++)
+	{
+		ReplayGame game;
+		if (!game.Open(recording_path))
+		{
+			std::cerr << "Cannot read recording " << recording_path << std::endl;
+			return 1;
+		}
+
+		std::ofstream actions_file;
+		if (pass == 0 && !actions_path.empty())
+		{
+			actions_file.open(actions_path);
+		}
+
+		// Same seed as the recorded game, so the bot makes the same random choices it made then.
+		setRandomSeed(game.Header().random_seed);
+		std::unique_ptr<MultiplayerBot> bot(CreateBot());
+		ActionLog actions(&game, &game, actions_file.is_open() ? &actions_file : nullptr);
+		bot->SetInterfaces(&game, &actions, &game);
+		bot->DisableMapCache();
+
+		if (!game.NextFrame())
+		{
+			std::cerr << "Recording has no frames" << std::endl;
+			return 1;
+		}
+		bot->OnGameStart();
+		DisableStepBudget(bot.get());
+
+		std::vector<double> step_us;
+		Clock::time_point run_start = Clock::now();
+		while (game.NextFrame())
+		{
+			Clock::time_point bot_start = Clock::now();
+			game.DispatchEvents(*bot);
+			bot->OnStep();
+			step_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - bot_start).count());
+		}
+		double run_seconds = std::chrono::duration<double>(Clock::now() - run_start).count();
+		bot->OnGameEnd();
+
+		std::vector<double> sorted = step_us;
+		std::sort(sorted.begin(), sorted.end());
+		double total_us = 0.0;
+		for (double us : step_us)
+		{
+			total_us += us;
+		}
+		size_t steps = step_us.size();
+
+		if (pass == 0)
+		{
+			first_hash = actions.Hash();
+		}
+		deterministic &= actions.Hash() == first_hash;
+
+		std::cout << "pass " << pass + 1 << ": " << steps << " steps to loop " << game.GetGameLoop() << " in " << run_seconds << " s ("
+			<< (run_seconds > 0.0 ? steps / run_seconds : 0.0) << " steps/s)" << (game.Damaged() ? ", recording cut short" : "") << std::endl;
+		std::cout << "OnStep us: mean " << (steps ? total_us / steps : 0.0)
+			<< ", p50 " << Percentile(sorted, 0.50)
+			<< ", p90 " << Percentile(sorted, 0.90)
+			<< ", p99 " << Percentile(sorted, 0.99)
+			<< ", max " << (steps ? sorted.back() : 0.0) << std::endl;
+		std::cout << "commands " << actions.CommandCount() << ", hash " << std::hex << actions.Hash() << std::dec
+			<< ", unanswered queries " << game.QueryMismatches() << std::endl;
+	}
+
+	if (passes > 1)
+	{
+		std::cout << (deterministic ? "all passes issued the same commands" : "passes issued different commands") << std::endl;
+	}
+	return deterministic ? 0 : 2;
+}
@@ -0,0 +1,162 @@
+#include "kd_tree.h"
+
+#include <algorithm>
+
+namespace sc2
+{
+	void PointKDTree::Build(const Units& units)
+	{
+		nodes_.clear();
+		index_of_.clear();
+		for (const Unit* unit : units)
+		{
+			nodes_.push_back({ unit->pos, unit->tag, false });
+		}
+
+		alive_in_range_.assign(nodes_.size(), 0);
+		BuildRange(0, nodes_.size(), 0);
+
+		for (size_t i = 0; i < nodes_.size(); i++)
+		{
+			index_of_[nodes_[i].tag] = i;
+		}
+		alive_count_ = nodes_.size();
+	}
+
+	bool PointKDTree::Remove(Tag tag)
+	{
+		auto found = index_of_.find(tag);
+		if (found == index_of_.end() || nodes_[found->second].removed)
+		{
+			return false;
+		}
+
+		size_t index = found->second;
+		nodes_[index].removed = true;
+		alive_count_--;
+
+		// Walk down from the root to the node, every range on the way lost one live point.
+		size_t begin = 0;
+		size_t end = nodes_.size();
+		while (begin < end)
+		{
+			size_t mid = (begin + end) / 2;
+			alive_in_range_[mid]--;
+			if (index == mid)
+			{
+				break;
+			}
+			if (index < mid)
+			{
+				end = mid;
+			}
+			else
+			{
+				begin = mid + 1;
+			}
+		}
+		return true;
+	}
+
+	Tag PointKDTree::Nearest(const Point2D& point) const
+	{
+		std::vector<Tag> nearest = KNearest(point, 1);
+		return nearest.empty() ? NullTag : nearest.front();
+	}
+
+	std::vector<Tag> PointKDTree::KNearest(const Point2D& point, size_t k) const
+	{
+		std::vector<std::pair<float, Tag>> best;
+		if (k > 0)
+		{
+			best.reserve(k);
+			SearchRange(0, nodes_.size(), 0, point, k, best);
+		}
+
+		// best is a max-heap on distance, sort_heap leaves it closest first.
+		std::sort_heap(best.begin(), best.end());
+
+		std::vector<Tag> tags;
+		tags.reserve(best.size());
+		for (const auto& entry : best)
+		{
+			tags.push_back(entry.second);
+		}
+		return tags;
+	}
+
+	void PointKDTree::BuildRange(size_t begin, size_t end, int axis)
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+
+		size_t mid = (begin + end) / 2;
+		std::nth_element(nodes_.begin() + begin, nodes_.begin() + mid, nodes_.begin() + end,
+			[axis](const Node& a, const Node& b) {
+				return axis == 0 ? a.pos.x < b.pos.x : a.pos.y < b.pos.y;
+			});
+		alive_in_range_[mid] = end - begin;
+
+		BuildRange(begin, mid, axis ^ 1);
+		BuildRange(mid + 1, end, axis ^ 1);
+	}
+
+	void PointKDTree::SearchRange(size_t begin, size_t end, int axis, const Point2D& point, size_t k,
+		std::vector<std::pair<float, Tag>>& best) const
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+
+		size_t mid = (begin + end) / 2;
+		if (alive_in_range_[mid] == 0)
+		{
+			return;
+		}
+
+		const Node& node = nodes_[mid];
+		if (!node.removed)
+		{
+			float distance = DistanceSquared2D(node.pos, point);
+			if (best.size() < k)
+			{
+				best.emplace_back(distance, node.tag);
+				std::push_heap(best.begin(), best.end());
+			}
+			else if (distance < best.front().first)
+			{
+				std::pop_heap(best.begin(), best.end());
+				best.back() = std::make_pair(distance, node.tag);
+				std::push_heap(best.begin(), best.end());
+			}
+		}
+
+		float diff = axis == 0 ? point.x - node.pos.x : point.y - node.pos.y;
+		bool left_first = diff < 0;
+
+		if (left_first)
+		{
+			SearchRange(begin, mid, axis ^ 1, point, k, best);
+		}
+		else
+		{
+			SearchRange(mid + 1, end, axis ^ 1, point, k, best);
+		}
+
+		// Only cross the split if the far side could still hold something closer.
+		if (best.size() < k || diff * diff < best.front().first)
+		{
+			if (left_first)
+			{
+				SearchRange(mid + 1, end, axis ^ 1, point, k, best);
+			}
+			else
+			{
+				SearchRange(begin, mid, axis ^ 1, point, k, best);
+			}
+		}
+	}
+}
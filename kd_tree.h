@@ -0,0 +1,47 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Static 2D KD-tree over tagged points, ie mineral fields which never move.
+	// Built once, points can only be removed (lazily) afterwards.
+	class PointKDTree
+	{
+	public:
+		void Build(const Units& units);
+
+		// Marks the point with this tag as gone. Returns false if it was not in the tree.
+		bool Remove(Tag tag);
+
+		// Tag of the closest remaining point, or NullTag if the tree is empty.
+		Tag Nearest(const Point2D& point) const;
+
+		// Tags of the k closest remaining points, closest first.
+		std::vector<Tag> KNearest(const Point2D& point, size_t k) const;
+
+		size_t Size() const { return alive_count_; }
+
+	private:
+		struct Node
+		{
+			Point2D pos;
+			Tag tag;
+			bool removed;
+		};
+
+		void BuildRange(size_t begin, size_t end, int axis);
+		void SearchRange(size_t begin, size_t end, int axis, const Point2D& point, size_t k,
+			std::vector<std::pair<float, Tag>>& best) const;
+
+		// Nodes are stored implicitly: the median of [begin, end) splits that range.
+		std::vector<Node> nodes_;
+		// Live points in [begin, end), stored at the range's median index.
+		std::vector<size_t> alive_in_range_;
+		std::unordered_map<Tag, size_t> index_of_;
+		size_t alive_count_ = 0;
+	};
+}
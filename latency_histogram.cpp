@@ -0,0 +1,87 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace sc2
+{
+	LatencyHistogram::LatencyHistogram()
+	{
+		memset(buckets_, 0, sizeof(buckets_));
+	}
+
+	void LatencyHistogram::Record(uint64_t ns)
+	{
+		buckets_[BucketOf(ns)]++;
+		count_++;
+		sum_ += ns;
+		max_ = std::max(max_, ns);
+	}
+
+	uint64_t LatencyHistogram::Percentile(double fraction) const
+	{
+		if (count_ == 0)
+		{
+			return 0;
+		}
+
+		uint64_t rank = static_cast<uint64_t>(fraction * count_ + 0.5);
+		rank = std::min(std::max<uint64_t>(rank, 1), count_);
+
+		uint64_t seen = 0;
+		for (size_t bucket = 0; bucket < bucket_count; bucket++)
+		{
+			seen += buckets_[bucket];
+			if (seen >= rank)
+			{
+				return std::min(UpperBoundOf(bucket), max_);
+			}
+		}
+		return max_;
+	}
+
+	std::string LatencyHistogram::ToJson() const
+	{
+		char json[192];
+		snprintf(json, sizeof(json), "{\"count\":%llu,\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f}",
+			static_cast<unsigned long long>(count_), Percentile(0.5) / 1000.0, Percentile(0.9) / 1000.0,
+			Percentile(0.99) / 1000.0, max_ / 1000.0);
+		return json;
+	}
+
+	size_t LatencyHistogram::BucketOf(uint64_t ns)
+	{
+		// Values below one sub-bucket span map one to one onto the first buckets.
+		if (ns < sub_buckets)
+		{
+			return static_cast<size_t>(ns);
+		}
+
+		int exponent = 63;
+		while (!(ns >> exponent))
+		{
+			exponent--;
+		}
+		if (exponent > max_exponent)
+		{
+			return bucket_count - 1;
+		}
+
+		size_t sub_bucket = static_cast<size_t>(ns >> (exponent - sub_bucket_bits)) & (sub_buckets - 1);
+		return (exponent - sub_bucket_bits + 1) * sub_buckets + sub_bucket;
+	}
+
+	uint64_t LatencyHistogram::UpperBoundOf(size_t bucket)
+	{
+		if (bucket < sub_buckets)
+		{
+			return bucket;
+		}
+
+		int exponent = static_cast<int>(bucket / sub_buckets) + sub_bucket_bits - 1;
+		uint64_t sub_bucket = bucket % sub_buckets;
+		uint64_t width = 1ull << (exponent - sub_bucket_bits);
+		return (1ull << exponent) + (sub_bucket + 1) * width - 1;
+	}
+}
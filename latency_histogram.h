@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace sc2
+{
+	// Fixed-size log-linear histogram of durations in nanoseconds.
+	// Each power of two is split into 16 linear buckets, so a percentile is within 1/16 (~6%) of the true
+	// value, from 1ns up to ~18 minutes, in under 2.5KB and without allocating after construction.
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram();
+
+		void Record(uint64_t ns);
+
+		uint64_t Count() const { return count_; }
+		uint64_t Max() const { return max_; }
+		double Mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+		// Upper bound of the bucket holding the given fraction (0..1) of the recorded values.
+		uint64_t Percentile(double fraction) const;
+
+		// {"count":..,"p50_us":..,"p90_us":..,"p99_us":..,"max_us":..}
+		std::string ToJson() const;
+
+	private:
+		static const int sub_bucket_bits = 4;
+		static const int sub_buckets = 1 << sub_bucket_bits;
+		static const int max_exponent = 40; // Values from 2^40ns are counted in the last bucket
+		static const int bucket_count = (max_exponent - sub_bucket_bits + 2) * sub_buckets;
+
+		static size_t BucketOf(uint64_t ns);
+		static uint64_t UpperBoundOf(size_t bucket);
+
+		uint32_t buckets_[bucket_count];
+		uint64_t count_ = 0;
+		uint64_t sum_ = 0;
+		uint64_t max_ = 0;
+	};
+
+	// Records the time from construction to destruction into a histogram.
+	class ScopedLatency
+	{
+	public:
+		explicit ScopedLatency(LatencyHistogram& histogram) :
+			histogram_(histogram), start_(std::chrono::steady_clock::now())
+		{
+		}
+
+		~ScopedLatency()
+		{
+			auto elapsed = std::chrono::steady_clock::now() - start_;
+			histogram_.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+		}
+
+	private:
+		LatencyHistogram& histogram_;
+		std::chrono::steady_clock::time_point start_;
+	};
+}
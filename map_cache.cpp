@@ -0,0 +1,318 @@
+#include "map_cache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sc2
+{
+	namespace
+	{
+		const char magic[8] = { 'S', 'C', '2', 'M', 'A', 'P', 'C', 'A' };
+		const uint32_t version = 1;
+
+		// Fixed size and 8 byte aligned, so the payload after it keeps the alignment of its floats and fields.
+		struct FileHeader
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t header_bytes;
+			uint64_t key;
+			uint64_t checksum; // Of the payload
+			uint64_t payload_bytes;
+			uint32_t expansion_count;
+			uint32_t start_location_count;
+			uint32_t field_count;
+			int32_t field_width;
+			int32_t field_height;
+			uint32_t reserved;
+		};
+
+		// FNV-1a, a word at a time where it can.
+		uint64_t Hash(uint64_t hash, const void* data, size_t bytes)
+		{
+			const uint8_t* at = static_cast<const uint8_t*>(data);
+			for (; bytes >= 8; at += 8, bytes -= 8)
+			{
+				uint64_t word;
+				memcpy(&word, at, sizeof(word));
+				hash = (hash ^ word) * 1099511628211ull;
+			}
+			for (; bytes > 0; at++, bytes--)
+			{
+				hash = (hash ^ *at) * 1099511628211ull;
+			}
+			return hash;
+		}
+
+		uint64_t HashImage(uint64_t hash, const ImageData& image)
+		{
+			int32_t shape[3] = { image.width, image.height, image.bits_per_pixel };
+			hash = Hash(hash, shape, sizeof(shape));
+			return Hash(hash, image.data.data(), image.data.size());
+		}
+
+		size_t PayloadBytes(size_t expansions, size_t start_locations, size_t fields, size_t cells)
+		{
+			return expansions * 3 * sizeof(float) + start_locations * 2 * sizeof(float) + fields * cells * sizeof(uint16_t);
+		}
+
+		// A temporary name no other writer uses, games started side by side can write the same map at once.
+		std::string TemporaryPath(const std::string& path)
+		{
+			static std::atomic<unsigned> counter(0);
+#ifdef _WIN32
+			unsigned long process = GetCurrentProcessId();
+#else
+			unsigned long process = static_cast<unsigned long>(getpid());
+#endif
+			char suffix[48];
+			snprintf(suffix, sizeof(suffix), ".%lu.%u.tmp", process, counter++);
+			return path + suffix;
+		}
+
+		// Puts the finished file in place in one step, readers see the old file or the new one and never no file.
+		bool Replace(const std::string& from, const std::string& to)
+		{
+#ifdef _WIN32
+			return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+			return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+		}
+
+		void AppendFloats(std::vector<uint8_t>& out, const float* values, size_t count)
+		{
+			size_t at = out.size();
+			out.resize(at + count * sizeof(float));
+			memcpy(&out[at], values, count * sizeof(float));
+		}
+	}
+
+	MapCache::~MapCache()
+	{
+		Close();
+	}
+
+	uint64_t MapCache::Key(const GameInfo& info, const Point2D& start_location)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		hash = HashImage(hash, info.pathing_grid);
+		hash = HashImage(hash, info.placement_grid);
+		hash = HashImage(hash, info.terrain_height);
+		for (const Point2D& location : info.start_locations)
+		{
+			hash = Hash(hash, &location.x, sizeof(float));
+			hash = Hash(hash, &location.y, sizeof(float));
+		}
+		hash = Hash(hash, &start_location.x, sizeof(float));
+		return Hash(hash, &start_location.y, sizeof(float));
+	}
+
+	std::string MapCache::Path(const std::string& directory, uint64_t key)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "map_%016llx.bin", static_cast<unsigned long long>(key));
+		if (directory.empty())
+		{
+			return name;
+		}
+		char last = directory.back();
+		return directory + (last == '/' || last == '\\' ? "" : "/") + name;
+	}
+
+	bool MapCache::Map(const std::string& path)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (!view)
+		{
+			if (mapping)
+			{
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			return false;
+		}
+		file_ = file;
+		mapping_ = mapping;
+		view_ = static_cast<const uint8_t*>(view);
+		size_ = static_cast<size_t>(size.QuadPart);
+		return true;
+#else
+		int file = open(path.c_str(), O_RDONLY);
+		if (file < 0)
+		{
+			return false;
+		}
+		struct stat status;
+		if (fstat(file, &status) != 0 || status.st_size == 0)
+		{
+			close(file);
+			return false;
+		}
+		// The mapping stays valid after the descriptor is closed.
+		void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (view == MAP_FAILED)
+		{
+			return false;
+		}
+		view_ = static_cast<const uint8_t*>(view);
+		size_ = static_cast<size_t>(status.st_size);
+		return true;
+#endif
+	}
+
+	void MapCache::Close()
+	{
+		if (view_)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(view_);
+			CloseHandle(static_cast<HANDLE>(mapping_));
+			CloseHandle(static_cast<HANDLE>(file_));
+			mapping_ = nullptr;
+			file_ = nullptr;
+#else
+			munmap(const_cast<uint8_t*>(view_), size_);
+#endif
+		}
+		view_ = nullptr;
+		size_ = 0;
+		expansions_.clear();
+		start_locations_.clear();
+		field_count_ = 0;
+		field_width_ = 0;
+		field_height_ = 0;
+		fields_ = nullptr;
+	}
+
+	bool MapCache::Open(const std::string& path, uint64_t key)
+	{
+		Close();
+		if (!Map(path))
+		{
+			return false;
+		}
+
+		FileHeader header;
+		if (size_ < sizeof(header))
+		{
+			Close();
+			return false;
+		}
+		memcpy(&header, view_, sizeof(header));
+		size_t cells = header.field_width > 0 && header.field_height > 0 ? static_cast<size_t>(header.field_width) * header.field_height : 0;
+		bool valid = memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == version &&
+			header.header_bytes == sizeof(header) && header.key == key &&
+			header.payload_bytes == size_ - sizeof(header) &&
+			header.payload_bytes == PayloadBytes(header.expansion_count, header.start_location_count, header.field_count, cells);
+		if (!valid || Hash(14695981039346656037ull, view_ + sizeof(header), header.payload_bytes) != header.checksum)
+		{
+			Close();
+			return false;
+		}
+
+		const uint8_t* at = view_ + sizeof(header);
+		expansions_.resize(header.expansion_count);
+		for (Point3D& expansion : expansions_)
+		{
+			float values[3];
+			memcpy(values, at, sizeof(values));
+			expansion = Point3D(values[0], values[1], values[2]);
+			at += sizeof(values);
+		}
+		start_locations_.resize(header.start_location_count);
+		for (Point2D& location : start_locations_)
+		{
+			float values[2];
+			memcpy(values, at, sizeof(values));
+			location = Point2D(values[0], values[1]);
+			at += sizeof(values);
+		}
+		field_count_ = header.field_count;
+		field_width_ = header.field_width;
+		field_height_ = header.field_height;
+		fields_ = reinterpret_cast<const uint16_t*>(at);
+		return true;
+	}
+
+	bool MapCache::Write(const std::string& path, uint64_t key, const std::vector<Point3D>& expansions,
+		const std::vector<Point2D>& start_locations, const DistanceFields& fields)
+	{
+		size_t cells = static_cast<size_t>(fields.Width()) * fields.Height();
+		size_t field_count = fields.Data() ? fields.Size() : 0;
+
+		std::vector<uint8_t> payload;
+		payload.reserve(PayloadBytes(expansions.size(), start_locations.size(), field_count, cells));
+		for (const Point3D& expansion : expansions)
+		{
+			float values[3] = { expansion.x, expansion.y, expansion.z };
+			AppendFloats(payload, values, 3);
+		}
+		for (const Point2D& location : start_locations)
+		{
+			float values[2] = { location.x, location.y };
+			AppendFloats(payload, values, 2);
+		}
+		const uint8_t* field_bytes = reinterpret_cast<const uint8_t*>(fields.Data());
+		payload.insert(payload.end(), field_bytes, field_bytes + field_count * cells * sizeof(uint16_t));
+
+		FileHeader header = {};
+		memcpy(header.magic, magic, sizeof(magic));
+		header.version = version;
+		header.header_bytes = sizeof(header);
+		header.key = key;
+		header.checksum = Hash(14695981039346656037ull, payload.data(), payload.size());
+		header.payload_bytes = payload.size();
+		header.expansion_count = static_cast<uint32_t>(expansions.size());
+		header.start_location_count = static_cast<uint32_t>(start_locations.size());
+		header.field_count = static_cast<uint32_t>(field_count);
+		header.field_width = field_count ? fields.Width() : 0;
+		header.field_height = field_count ? fields.Height() : 0;
+
+		std::string temporary = TemporaryPath(path);
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+			if (!file)
+			{
+				file.close();
+				std::remove(temporary.c_str());
+				return false;
+			}
+		}
+		if (!Replace(temporary, path))
+		{
+			std::remove(temporary.c_str());
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+#include "distance_fields.h"
+
+namespace sc2
+{
+	// Map analysis that only depends on the map and where we start on it, saved after the first game and memory
+	// mapped on later ones: the expansion locations (a round of queries to work out), the start locations and the
+	// ground distance fields. A file is named after a hash of the map's grids and start locations and its checksum
+	// is verified when opened, so a changed map or a damaged file only means the analysis is done again.
+	// Numbers are stored as the host lays them out, the cache is not meant to move between machines.
+	class MapCache
+	{
+	public:
+		MapCache() = default;
+		~MapCache();
+
+		MapCache(const MapCache&) = delete;
+		MapCache& operator=(const MapCache&) = delete;
+
+		// Identifies the analysis: the map's pathing, placement and height grids, its start locations and ours.
+		static uint64_t Key(const GameInfo& info, const Point2D& start_location);
+
+		// The file in directory that holds the analysis for key.
+		static std::string Path(const std::string& directory, uint64_t key);
+
+		// Maps the file and checks it is a complete analysis for key. False if not, the cache is then closed.
+		bool Open(const std::string& path, uint64_t key);
+		void Close();
+
+		bool IsOpen() const { return view_ != nullptr; }
+
+		// What the open file holds. Fields() points into the mapping, it is only valid until Close.
+		const std::vector<Point3D>& Expansions() const { return expansions_; }
+		const std::vector<Point2D>& StartLocations() const { return start_locations_; }
+		size_t FieldCount() const { return field_count_; }
+		int FieldWidth() const { return field_width_; }
+		int FieldHeight() const { return field_height_; }
+		const uint16_t* Fields() const { return fields_; }
+
+		// Saves an analysis, through a temporary file so a reader never maps half of one. False if it could not be written.
+		static bool Write(const std::string& path, uint64_t key, const std::vector<Point3D>& expansions,
+			const std::vector<Point2D>& start_locations, const DistanceFields& fields);
+
+	private:
+		bool Map(const std::string& path);
+
+		const uint8_t* view_ = nullptr;
+		size_t size_ = 0;
+#ifdef _WIN32
+		void* file_ = nullptr;    // HANDLE
+		void* mapping_ = nullptr; // HANDLE
+#endif
+
+		std::vector<Point3D> expansions_;
+		std::vector<Point2D> start_locations_;
+		size_t field_count_ = 0;
+		int field_width_ = 0;
+		int field_height_ = 0;
+		const uint16_t* fields_ = nullptr;
+	};
+}
@@ -0,0 +1,360 @@
+#include "observation_recorder.h"
+
+#include "api_counters.h"
+
+namespace sc2
+{
+	namespace
+	{
+		void WriteAbilities(ByteWriter& writer, const AvailableAbilities& abilities)
+		{
+			writer.Varint(abilities.abilities.size());
+			for (const AvailableAbility& ability : abilities.abilities)
+			{
+				writer.Varint(ability.ability_id);
+				writer.Byte(ability.requires_point);
+			}
+		}
+	}
+
+	ObservationRecorder::ObservationRecorder()
+	{
+	}
+
+	ObservationRecorder::~ObservationRecorder()
+	{
+		Close();
+	}
+
+	bool ObservationRecorder::Open(const std::string& path, const ObservationInterface* observation, uint32_t random_seed)
+	{
+		Close();
+
+		file_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file_)
+		{
+			return false;
+		}
+
+		RecordingHeader header;
+		header.random_seed = random_seed;
+		header.player_id = observation->GetPlayerID();
+		header.start_location = observation->GetStartLocation();
+		header.game_info = observation->GetGameInfo();
+		header.unit_types = observation->GetUnitTypeData();
+
+		file_.write(RecordingHeader::magic, sizeof(RecordingHeader::magic));
+		bytes_written_ = sizeof(RecordingHeader::magic);
+		raw_.clear();
+		chunk_.clear();
+		FrameEncoder::EncodeHeader(header, chunk_);
+		ByteWriter(raw_).Varint(chunk_.size());
+		raw_.insert(raw_.end(), chunk_.begin(), chunk_.end());
+		WriteBlock();
+
+		encoder_ = FrameEncoder();
+		known_slot_.clear();
+		known_.clear();
+		last_slots_.clear();
+		upgrades_.clear();
+		ring_.resize(ring_frames);
+		captured_ = 0;
+		written_ = 0;
+		frame_ = &ring_[0];
+		frame_->Clear();
+		stopping_ = false;
+		frames_ = 0;
+		enabled_ = true;
+		writer_ = std::thread(&ObservationRecorder::WriterLoop, this);
+		return true;
+	}
+
+	void ObservationRecorder::Close()
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		enabled_ = false;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		wake_.notify_all();
+		writer_.join();
+		file_.close();
+	}
+
+	uint64_t ObservationRecorder::BytesWritten() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return bytes_written_;
+	}
+
+	void ObservationRecorder::RecordEvent(RecordedEvent::Kind kind, const Unit* unit)
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		frame_->events.emplace_back();
+		RecordedEvent& event = frame_->events.back();
+		event.kind = kind;
+		frame_->Capture(*unit, event.unit);
+	}
+
+	void ObservationRecorder::EndFrame(const ObservationInterface* observation, const Units& units)
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		RecordedFrame& frame = *frame_;
+		frame.game_loop = observation->GetGameLoop();
+
+		const std::vector<UpgradeID>& upgrades = observation->GetUpgrades();
+		frame.upgrades_changed = upgrades.size() != upgrades_.size();
+		for (size_t i = 0; i < upgrades.size() && !frame.upgrades_changed; i++)
+		{
+			frame.upgrades_changed = static_cast<uint32_t>(upgrades[i]) != upgrades_[i];
+		}
+		if (frame.upgrades_changed)
+		{
+			upgrades_.clear();
+			for (UpgradeID upgrade : upgrades)
+			{
+				upgrades_.push_back(static_cast<uint32_t>(upgrade));
+			}
+			frame.upgrades = upgrades_;
+		}
+
+		// Units mostly come in last frame's order, so a unit's slot is usually the one after the previous unit's.
+		// Only units whose fingerprint moved are copied, the encoder takes the rest as they were.
+		slots_.clear();
+		size_t next = 0;
+		for (size_t i = 0; i < units.size(); i++)
+		{
+			const Unit& unit = *units[i];
+			uint32_t slot;
+			if (next < last_slots_.size() && known_[last_slots_[next]].tag == unit.tag)
+			{
+				slot = last_slots_[next];
+			}
+			else
+			{
+				auto found = known_slot_.find(unit.tag);
+				if (found == known_slot_.end())
+				{
+					slot = static_cast<uint32_t>(known_.size());
+					known_slot_.emplace(unit.tag, slot);
+					known_.emplace_back();
+				}
+				else
+				{
+					slot = found->second;
+				}
+			}
+			slots_.push_back(slot);
+
+			Known& known = known_[slot];
+			next = known.index + 1;
+			known.index = static_cast<uint32_t>(i);
+			uint64_t fingerprint = RecordedFrame::Fingerprint(unit);
+			if (known.tag == unit.tag && known.fingerprint == fingerprint)
+			{
+				continue;
+			}
+			known.tag = unit.tag;
+			known.fingerprint = fingerprint;
+			frame.units.emplace_back();
+			frame.Capture(unit, frame.units.back());
+		}
+
+		// The full list only when units came, went or moved
+		frame.same_units = slots_ == last_slots_;
+		if (!frame.same_units)
+		{
+			for (const Unit* unit : units)
+			{
+				frame.tags.push_back(unit->tag);
+			}
+			last_slots_.swap(slots_);
+		}
+
+		// Hand the frame over by moving captured_ past it, the writer is only woken once per batch of frames
+		size_t captured = captured_.load(std::memory_order_relaxed) + 1;
+		captured_.store(captured, std::memory_order_release);
+		if (captured % frames_per_wake == 0)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			wake_.notify_all();
+		}
+		frames_++;
+
+		// The next slot is free once the writer is less than a ring behind
+		if (captured - written_.load(std::memory_order_acquire) >= ring_frames)
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.notify_all();
+			space_.wait(lock, [this, captured] { return captured - written_.load(std::memory_order_acquire) < ring_frames; });
+		}
+		frame_ = &ring_[captured % ring_frames];
+		frame_->Clear();
+	}
+
+	void ObservationRecorder::WriterLoop()
+	{
+		size_t written = 0;
+		for (;;)
+		{
+			bool stopping;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wake_.wait(lock, [this, written] { return captured_.load(std::memory_order_acquire) - written >= frames_per_wake || stopping_; });
+				stopping = stopping_;
+			}
+
+			size_t captured = captured_.load(std::memory_order_acquire);
+			for (; written < captured; written++)
+			{
+				chunk_.clear();
+				encoder_.Encode(ring_[written % ring_frames], chunk_);
+				ByteWriter(raw_).Varint(chunk_.size());
+				raw_.insert(raw_.end(), chunk_.begin(), chunk_.end());
+			}
+			{
+				// Under the lock, a bot thread that just found the ring full cannot miss it
+				std::lock_guard<std::mutex> lock(mutex_);
+				written_.store(written, std::memory_order_release);
+			}
+			space_.notify_all();
+
+			WriteBlock();
+			file_.flush();
+
+			if (stopping)
+			{
+				return;
+			}
+		}
+	}
+
+	void ObservationRecorder::WriteBlock()
+	{
+		if (raw_.empty())
+		{
+			return;
+		}
+		packed_.clear();
+		PackBlock(raw_, packed_);
+		raw_.clear();
+		file_.write(reinterpret_cast<const char*>(packed_.data()), packed_.size());
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		bytes_written_ += packed_.size();
+	}
+
+	//
+	// RecordingObservation
+	//
+
+	const std::vector<Effect>& RecordingObservation::GetEffects() const
+	{
+		return optional_observation::EffectsOf(observation_, 0);
+	}
+
+	const Effects& RecordingObservation::GetEffectData(bool force_refresh) const
+	{
+		return optional_observation::EffectDataOf(observation_, force_refresh, 0);
+	}
+
+	int32_t RecordingObservation::GetLarvaCount() const
+	{
+		return optional_observation::LarvaCountOf(observation_, 0);
+	}
+
+	//
+	// RecordingQuery
+	//
+
+	RecordingQuery::RecordingQuery(QueryInterface* query, ObservationRecorder& recorder) :
+		query_(query), recorder_(recorder)
+	{
+	}
+
+	AvailableAbilities RecordingQuery::GetAbilitiesForUnit(const Unit* unit, bool ignore_resource_requirements)
+	{
+		AvailableAbilities abilities = query_->GetAbilitiesForUnit(unit, ignore_resource_requirements);
+		ByteWriter writer = recorder_.Queries();
+		writer.Byte(static_cast<uint8_t>(RecordedFrame::QueryKind::AbilitiesForUnit));
+		WriteAbilities(writer, abilities);
+		return abilities;
+	}
+
+	std::vector<AvailableAbilities> RecordingQuery::GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements)
+	{
+		std::vector<AvailableAbilities> abilities = query_->GetAbilitiesForUnits(units, ignore_resource_requirements);
+		ByteWriter writer = recorder_.Queries();
+		writer.Byte(static_cast<uint8_t>(RecordedFrame::QueryKind::AbilitiesForUnits));
+		writer.Varint(abilities.size());
+		for (const AvailableAbilities& unit_abilities : abilities)
+		{
+			WriteAbilities(writer, unit_abilities);
+		}
+		return abilities;
+	}
+
+	float RecordingQuery::PathingDistance(const Point2D& start, const Point2D& end)
+	{
+		float distance = query_->PathingDistance(start, end);
+		ByteWriter writer = recorder_.Queries();
+		writer.Byte(static_cast<uint8_t>(RecordedFrame::QueryKind::PathingDistance));
+		writer.Float(distance);
+		return distance;
+	}
+
+	float RecordingQuery::PathingDistance(const Unit* start, const Point2D& end)
+	{
+		float distance = query_->PathingDistance(start, end);
+		ByteWriter writer = recorder_.Queries();
+		writer.Byte(static_cast<uint8_t>(RecordedFrame::QueryKind::PathingDistance));
+		writer.Float(distance);
+		return distance;
+	}
+
+	std::vector<float> RecordingQuery::PathingDistance(const std::vector<PathingQuery>& queries)
+	{
+		std::vector<float> distances = query_->PathingDistance(queries);
+		ByteWriter writer = recorder_.Queries();
+		writer.Byte(static_cast<uint8_t>(RecordedFrame::QueryKind::PathingDistances));
+		writer.Varint(distances.size());
+		for (float distance : distances)
+		{
+			writer.Float(distance);
+		}
+		return distances;
+	}
+
+	bool RecordingQuery::Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* unit)
+	{
+		bool placeable = query_->Placement(ability, target_pos, unit);
+		ByteWriter writer = recorder_.Queries();
+		writer.Byte(static_cast<uint8_t>(RecordedFrame::QueryKind::Placement));
+		writer.Byte(placeable);
+		return placeable;
+	}
+
+	std::vector<bool> RecordingQuery::Placement(const std::vector<PlacementQuery>& queries)
+	{
+		std::vector<bool> placeable = query_->Placement(queries);
+		ByteWriter writer = recorder_.Queries();
+		writer.Byte(static_cast<uint8_t>(RecordedFrame::QueryKind::Placements));
+		writer.Varint(placeable.size());
+		for (bool result : placeable)
+		{
+			writer.Byte(result);
+		}
+		return placeable;
+	}
+}
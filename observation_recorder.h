@@ -0,0 +1,186 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+#include "recording_format.h"
+
+namespace sc2
+{
+	// Opt-in recorder of everything the bot observes, for replaying a game offline (headless/replay_main.cpp).
+	// Each step the units that changed since they were last captured are copied into a flat frame on the bot's
+	// thread, the rest are passed on by tag. Delta encoding, compression and writing happen on a background thread.
+	// Unlike the trace writer nothing is ever dropped, a frame missing from the delta chain would spoil the rest:
+	// when the writer falls a whole ring behind, the bot's thread waits for it.
+	class ObservationRecorder
+	{
+	public:
+		ObservationRecorder();
+		~ObservationRecorder();
+
+		// Starts recording to path: writes the map, unit type data and random seed. False if the file cannot be opened.
+		bool Open(const std::string& path, const ObservationInterface* observation, uint32_t random_seed);
+
+		// Writes what is left and stops the writer thread.
+		void Close();
+
+		bool Enabled() const { return enabled_; }
+
+		// Call from the event handlers, the event goes into the next frame.
+		void RecordEvent(RecordedEvent::Kind kind, const Unit* unit);
+
+		// Query results, in the order the bot got them. RecordingQuery calls these.
+		ByteWriter Queries() { return ByteWriter(frame_->queries); }
+
+		// An economy value the bot read, RecordingObservation calls this. Values nobody reads are not recorded.
+		void Economy(RecordedFrame::Economy value, int32_t amount)
+		{
+			frame_->economy[value] = amount;
+			frame_->economy_read |= 1u << value;
+		}
+
+		// Closes the frame: units (all of them, in GetUnits order) and upgrades, with the economy values, events and
+		// queries since the last call. Called once at the end of OnGameStart and once at the end of every OnStep.
+		void EndFrame(const ObservationInterface* observation, const Units& units);
+
+		size_t Frames() const { return frames_; }
+		uint64_t BytesWritten() const;
+
+	private:
+		static const size_t frames_per_wake = 64;
+		static const size_t ring_frames = 2 * frames_per_wake;
+
+		// Each unit ever seen, to tell whether it changed since it was last captured
+		struct Known
+		{
+			Tag tag = NullTag;
+			uint64_t fingerprint = 0; // RecordedFrame::Fingerprint when last captured
+			uint32_t index = 0;       // Where it was in the last frame it was in
+		};
+
+		void WriterLoop();
+		void WriteBlock();
+
+		bool enabled_ = false;
+		size_t frames_ = 0;
+
+		// Only touched by the bot's thread
+		RecordedFrame* frame_ = nullptr; // The ring slot being filled
+		std::unordered_map<Tag, uint32_t> known_slot_;
+		std::vector<Known> known_;
+		std::vector<uint32_t> last_slots_; // Slots in the last frame's GetUnits order
+		std::vector<uint32_t> slots_;      // Scratch, this frame's
+		std::vector<uint32_t> upgrades_;
+
+		// Frames [written_, captured_) are the writer's, the rest of the ring the bot's thread fills.
+		// The bot's thread takes mutex_ only to wake the writer once per batch, or when the ring is full.
+		std::vector<RecordedFrame> ring_;
+		std::atomic<size_t> captured_{ 0 };
+		std::atomic<size_t> written_{ 0 };
+		mutable std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable space_;
+		bool stopping_ = false;         // Guarded by mutex_
+		uint64_t bytes_written_ = 0;    // Guarded by mutex_
+
+		// Only touched by the writer thread
+		FrameEncoder encoder_;
+		std::vector<uint8_t> raw_;    // Chunks waiting to be packed into a block
+		std::vector<uint8_t> packed_;
+		std::vector<uint8_t> chunk_;
+		std::ofstream file_;
+		std::thread writer_;
+	};
+
+	// Forwards every call to another ObservationInterface and records the economy values the bot reads,
+	// so a frame carries the few the bot looks at instead of all of them every step.
+	class RecordingObservation : public ObservationInterface
+	{
+	public:
+		RecordingObservation(const ObservationInterface* observation, ObservationRecorder& recorder) :
+			observation_(observation), recorder_(recorder)
+		{
+		}
+
+		Units GetUnits() const override { return observation_->GetUnits(); }
+		Units GetUnits(Unit::Alliance alliance, Filter filter = {}) const override { return observation_->GetUnits(alliance, filter); }
+		Units GetUnits(Filter filter) const override { return observation_->GetUnits(filter); }
+
+		uint32_t GetPlayerID() const override { return observation_->GetPlayerID(); }
+		uint32_t GetGameLoop() const override { return observation_->GetGameLoop(); }
+		const Unit* GetUnit(Tag tag) const override { return observation_->GetUnit(tag); }
+		const RawActions& GetRawActions() const override { return observation_->GetRawActions(); }
+		const SpatialActions& GetFeatureLayerActions() const override { return observation_->GetFeatureLayerActions(); }
+		const SpatialActions& GetRenderedActions() const override { return observation_->GetRenderedActions(); }
+		const std::vector<ChatMessage>& GetChatMessages() const override { return observation_->GetChatMessages(); }
+		const std::vector<PowerSource>& GetPowerSources() const override { return observation_->GetPowerSources(); }
+		const std::vector<UpgradeID>& GetUpgrades() const override { return observation_->GetUpgrades(); }
+		const Score& GetScore() const override { return observation_->GetScore(); }
+		const Abilities& GetAbilityData(bool force_refresh = false) const override { return observation_->GetAbilityData(force_refresh); }
+		const UnitTypes& GetUnitTypeData(bool force_refresh = false) const override { return observation_->GetUnitTypeData(force_refresh); }
+		const Upgrades& GetUpgradeData(bool force_refresh = false) const override { return observation_->GetUpgradeData(force_refresh); }
+		const Buffs& GetBuffData(bool force_refresh = false) const override { return observation_->GetBuffData(force_refresh); }
+		const GameInfo& GetGameInfo() const override { return observation_->GetGameInfo(); }
+		int32_t GetMinerals() const override { return Recorded(RecordedFrame::Minerals, observation_->GetMinerals()); }
+		int32_t GetVespene() const override { return Recorded(RecordedFrame::Vespene, observation_->GetVespene()); }
+		int32_t GetFoodCap() const override { return Recorded(RecordedFrame::FoodCap, observation_->GetFoodCap()); }
+		int32_t GetFoodUsed() const override { return Recorded(RecordedFrame::FoodUsed, observation_->GetFoodUsed()); }
+		int32_t GetFoodArmy() const override { return Recorded(RecordedFrame::FoodArmy, observation_->GetFoodArmy()); }
+		int32_t GetFoodWorkers() const override { return Recorded(RecordedFrame::FoodWorkers, observation_->GetFoodWorkers()); }
+		int32_t GetIdleWorkerCount() const override { return Recorded(RecordedFrame::IdleWorkers, observation_->GetIdleWorkerCount()); }
+		int32_t GetArmyCount() const override { return Recorded(RecordedFrame::ArmyCount, observation_->GetArmyCount()); }
+		int32_t GetWarpGateCount() const override { return Recorded(RecordedFrame::WarpGates, observation_->GetWarpGateCount()); }
+		Point2D GetCameraPos() const override { return observation_->GetCameraPos(); }
+		Point3D GetStartLocation() const override { return observation_->GetStartLocation(); }
+		const std::vector<PlayerResult>& GetResults() const override { return observation_->GetResults(); }
+		bool HasCreep(const Point2D& point) const override { return observation_->HasCreep(point); }
+		Visibility GetVisibility(const Point2D& point) const override { return observation_->GetVisibility(point); }
+		bool IsPathable(const Point2D& point) const override { return observation_->IsPathable(point); }
+		bool IsPlacable(const Point2D& point) const override { return observation_->IsPlacable(point); }
+		float TerrainHeight(const Point2D& point) const override { return observation_->TerrainHeight(point); }
+		const SC2APIProtocol::Observation* GetRawObservation() const override { return observation_->GetRawObservation(); }
+
+		// Not present in every API release, see CountedObservation
+		virtual const std::vector<Effect>& GetEffects() const;
+		virtual const Effects& GetEffectData(bool force_refresh = false) const;
+		virtual int32_t GetLarvaCount() const;
+
+	private:
+		int32_t Recorded(RecordedFrame::Economy value, int32_t amount) const
+		{
+			recorder_.Economy(value, amount);
+			return amount;
+		}
+
+		const ObservationInterface* observation_;
+		ObservationRecorder& recorder_;
+	};
+
+	// Forwards every call to another QueryInterface and records the result, so a replay can answer the same
+	// queries without the game.
+	class RecordingQuery : public QueryInterface
+	{
+	public:
+		RecordingQuery(QueryInterface* query, ObservationRecorder& recorder);
+
+		AvailableAbilities GetAbilitiesForUnit(const Unit* unit, bool ignore_resource_requirements = false) override;
+		std::vector<AvailableAbilities> GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements = false) override;
+		float PathingDistance(const Point2D& start, const Point2D& end) override;
+		float PathingDistance(const Unit* start, const Point2D& end) override;
+		std::vector<float> PathingDistance(const std::vector<PathingQuery>& queries) override;
+		bool Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* unit = nullptr) override;
+		std::vector<bool> Placement(const std::vector<PlacementQuery>& queries) override;
+
+	private:
+		QueryInterface* query_;
+		ObservationRecorder& recorder_;
+	};
+}
@@ -0,0 +1,308 @@
+#include "placement_validator.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace sc2
+{
+	namespace
+	{
+		struct Shape
+		{
+			int size;    // Square footprint, cells a side
+			bool add_on; // Needs the 2x2 beside it free for a tech lab or reactor
+		};
+
+		// Footprints by build ability, abilities not listed are left to the game.
+		bool ShapeOf(AbilityID ability, Shape& shape)
+		{
+			switch (static_cast<ABILITY_ID>(static_cast<uint32_t>(ability)))
+			{
+			case ABILITY_ID::BUILD_COMMANDCENTER:
+			case ABILITY_ID::BUILD_NEXUS:
+			case ABILITY_ID::BUILD_HATCHERY:
+				shape = { 5, false };
+				return true;
+			case ABILITY_ID::BUILD_BARRACKS:
+			case ABILITY_ID::BUILD_FACTORY:
+			case ABILITY_ID::BUILD_STARPORT:
+				shape = { 3, true };
+				return true;
+			case ABILITY_ID::BUILD_ENGINEERINGBAY:
+			case ABILITY_ID::BUILD_ARMORY:
+			case ABILITY_ID::BUILD_BUNKER:
+			case ABILITY_ID::BUILD_GHOSTACADEMY:
+			case ABILITY_ID::BUILD_FUSIONCORE:
+			case ABILITY_ID::BUILD_GATEWAY:
+			case ABILITY_ID::BUILD_FORGE:
+			case ABILITY_ID::BUILD_CYBERNETICSCORE:
+			case ABILITY_ID::BUILD_TWILIGHTCOUNCIL:
+			case ABILITY_ID::BUILD_ROBOTICSFACILITY:
+			case ABILITY_ID::BUILD_STARGATE:
+			case ABILITY_ID::BUILD_TEMPLARARCHIVE:
+			case ABILITY_ID::BUILD_ROBOTICSBAY:
+			case ABILITY_ID::BUILD_FLEETBEACON:
+			case ABILITY_ID::BUILD_SPAWNINGPOOL:
+			case ABILITY_ID::BUILD_EVOLUTIONCHAMBER:
+			case ABILITY_ID::BUILD_ROACHWARREN:
+			case ABILITY_ID::BUILD_BANELINGNEST:
+			case ABILITY_ID::BUILD_HYDRALISKDEN:
+			case ABILITY_ID::BUILD_INFESTATIONPIT:
+			case ABILITY_ID::BUILD_ULTRALISKCAVERN:
+			case ABILITY_ID::BUILD_NYDUSNETWORK:
+			case ABILITY_ID::BUILD_LURKERDENMP:
+				shape = { 3, false };
+				return true;
+			case ABILITY_ID::BUILD_SUPPLYDEPOT:
+			case ABILITY_ID::BUILD_MISSILETURRET:
+			case ABILITY_ID::BUILD_PYLON:
+			case ABILITY_ID::BUILD_PHOTONCANNON:
+			case ABILITY_ID::BUILD_SHIELDBATTERY:
+			case ABILITY_ID::BUILD_DARKSHRINE:
+			case ABILITY_ID::BUILD_SPIRE:
+			case ABILITY_ID::BUILD_SPINECRAWLER:
+			case ABILITY_ID::BUILD_SPORECRAWLER:
+				shape = { 2, false };
+				return true;
+			case ABILITY_ID::BUILD_SENSORTOWER:
+				shape = { 1, false };
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// Mineral fields are two cells wide and one high, unlike the square footprint their radius suggests.
+		bool IsMineralField(UnitTypeID unit_type)
+		{
+			switch (static_cast<UNIT_TYPEID>(static_cast<uint32_t>(unit_type)))
+			{
+			case UNIT_TYPEID::NEUTRAL_MINERALFIELD:
+			case UNIT_TYPEID::NEUTRAL_MINERALFIELD750:
+			case UNIT_TYPEID::NEUTRAL_RICHMINERALFIELD:
+			case UNIT_TYPEID::NEUTRAL_RICHMINERALFIELD750:
+			case UNIT_TYPEID::NEUTRAL_LABMINERALFIELD:
+			case UNIT_TYPEID::NEUTRAL_LABMINERALFIELD750:
+			case UNIT_TYPEID::NEUTRAL_PURIFIERMINERALFIELD:
+			case UNIT_TYPEID::NEUTRAL_PURIFIERMINERALFIELD750:
+			case UNIT_TYPEID::NEUTRAL_PURIFIERRICHMINERALFIELD:
+			case UNIT_TYPEID::NEUTRAL_PURIFIERRICHMINERALFIELD750:
+			case UNIT_TYPEID::NEUTRAL_BATTLESTATIONMINERALFIELD:
+			case UNIT_TYPEID::NEUTRAL_BATTLESTATIONMINERALFIELD750:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		bool TakesAddOn(UnitTypeID unit_type)
+		{
+			return unit_type == UNIT_TYPEID::TERRAN_BARRACKS || unit_type == UNIT_TYPEID::TERRAN_FACTORY ||
+				unit_type == UNIT_TYPEID::TERRAN_STARPORT;
+		}
+
+		// Lowest cell of a footprint the game centres near coordinate: odd sizes on a cell centre, even ones on a corner.
+		int FootprintMin(float coordinate, int size)
+		{
+			int centre = size % 2 ? static_cast<int>(floor(coordinate)) : static_cast<int>(lround(coordinate));
+			return centre - size / 2;
+		}
+	}
+
+	void PlacementValidator::Init(const ImageData& placement_grid)
+	{
+		width_ = 0;
+		height_ = 0;
+		footprints_.clear();
+		add_on_spots_.clear();
+		rejected_ = 0;
+
+		int width = placement_grid.width;
+		int height = placement_grid.height;
+		bool packed = placement_grid.bits_per_pixel == 1;
+		if (width <= 0 || height <= 0 || (!packed && placement_grid.bits_per_pixel != 8))
+		{
+			return;
+		}
+		size_t cells = static_cast<size_t>(width) * height;
+		if (placement_grid.data.size() < (packed ? (cells + 7) / 8 : cells))
+		{
+			return;
+		}
+
+		// The image's first row is the top of the map. One bit per cell is set where buildable,
+		// the older byte-per-cell grids mark buildable cells with 255.
+		grid_.assign(cells, 0);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				size_t index = static_cast<size_t>(height - 1 - y) * width + x;
+				uint8_t value = static_cast<uint8_t>(placement_grid.data[packed ? index / 8 : index]);
+				grid_[y * width + x] = packed ? (value >> (7 - index % 8)) & 1 : value == 255;
+			}
+		}
+
+		width_ = width;
+		height_ = height;
+		occupied_.assign(cells, 0);
+		reserved_.assign(cells, 0);
+		free_ = grid_;
+	}
+
+	void PlacementValidator::AddStructure(const Unit* unit)
+	{
+		if (!Ready() || unit->is_flying || footprints_.count(unit->tag))
+		{
+			return;
+		}
+
+		// Footprints are whole cells, a 2.75 radius command centre covers 5x5 and a 1.375 supply depot 2x2.
+		// A mineral field is centred on the edge between its two cells and in the middle of its row.
+		float half = floor(unit->radius * 2.0f) / 2.0f;
+		if (half <= 0.0f)
+		{
+			return;
+		}
+		Rect footprint;
+		if (IsMineralField(unit->unit_type))
+		{
+			footprint.min_x = std::max(0, static_cast<int>(lround(unit->pos.x)) - 1);
+			footprint.min_y = std::max(0, static_cast<int>(floor(unit->pos.y)));
+			footprint.max_x = std::min(width_ - 1, static_cast<int>(lround(unit->pos.x)));
+			footprint.max_y = std::min(height_ - 1, static_cast<int>(floor(unit->pos.y)));
+		}
+		else
+		{
+			footprint.min_x = std::max(0, static_cast<int>(lround(unit->pos.x - half)));
+			footprint.min_y = std::max(0, static_cast<int>(lround(unit->pos.y - half)));
+			footprint.max_x = std::min(width_ - 1, static_cast<int>(lround(unit->pos.x + half)) - 1);
+			footprint.max_y = std::min(height_ - 1, static_cast<int>(lround(unit->pos.y + half)) - 1);
+		}
+
+		SetOccupied(footprint, 1);
+		footprints_[unit->tag] = footprint;
+
+		// The add-on's spot is kept whether it has one yet or not, an add-on standing there adds its own footprint.
+		if (TakesAddOn(unit->unit_type))
+		{
+			Rect add_on = AddOnFootprint(unit->pos);
+			add_on.min_x = std::max(0, add_on.min_x);
+			add_on.min_y = std::max(0, add_on.min_y);
+			add_on.max_x = std::min(width_ - 1, add_on.max_x);
+			add_on.max_y = std::min(height_ - 1, add_on.max_y);
+			SetReserved(add_on, 1);
+			add_on_spots_[unit->tag] = add_on;
+		}
+	}
+
+	void PlacementValidator::RemoveStructure(Tag tag)
+	{
+		auto found = footprints_.find(tag);
+		if (found == footprints_.end())
+		{
+			return;
+		}
+		SetOccupied(found->second, -1);
+		footprints_.erase(found);
+
+		auto add_on = add_on_spots_.find(tag);
+		if (add_on != add_on_spots_.end())
+		{
+			SetReserved(add_on->second, -1);
+			add_on_spots_.erase(add_on);
+		}
+	}
+
+	void PlacementValidator::SetOccupied(const Rect& rect, int change)
+	{
+		for (int y = rect.min_y; y <= rect.max_y; y++)
+		{
+			for (int x = rect.min_x; x <= rect.max_x; x++)
+			{
+				size_t cell = y * width_ + x;
+				occupied_[cell] = static_cast<uint8_t>(occupied_[cell] + change);
+				free_[cell] = grid_[cell] && !occupied_[cell];
+			}
+		}
+	}
+
+	void PlacementValidator::SetReserved(const Rect& rect, int change)
+	{
+		for (int y = rect.min_y; y <= rect.max_y; y++)
+		{
+			for (int x = rect.min_x; x <= rect.max_x; x++)
+			{
+				size_t cell = y * width_ + x;
+				reserved_[cell] = static_cast<uint8_t>(reserved_[cell] + change);
+			}
+		}
+	}
+
+	bool PlacementValidator::Free(const Rect& rect, bool reserved) const
+	{
+		if (rect.min_x < 0 || rect.min_y < 0 || rect.max_x >= width_ || rect.max_y >= height_)
+		{
+			return false;
+		}
+		for (int y = rect.min_y; y <= rect.max_y; y++)
+		{
+			const uint8_t* row = &free_[y * width_];
+			const uint8_t* kept = &reserved_[y * width_];
+			for (int x = rect.min_x; x <= rect.max_x; x++)
+			{
+				if (!row[x] || (reserved && kept[x]))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool PlacementValidator::CanPlace(AbilityID ability, const Point2D& location)
+	{
+		Shape shape;
+		if (!Ready() || !ShapeOf(ability, shape))
+		{
+			return true;
+		}
+
+		Rect footprint;
+		footprint.min_x = FootprintMin(location.x, shape.size);
+		footprint.min_y = FootprintMin(location.y, shape.size);
+		footprint.max_x = footprint.min_x + shape.size - 1;
+		footprint.max_y = footprint.min_y + shape.size - 1;
+		if (!Free(footprint, true) || (shape.add_on && !Free(AddOnFootprint(location), true)))
+		{
+			rejected_++;
+			return false;
+		}
+		return true;
+	}
+
+	bool PlacementValidator::CanPlaceAddOn(const Point2D& location)
+	{
+		if (!Ready())
+		{
+			return true;
+		}
+		if (!Free(AddOnFootprint(location), false))
+		{
+			rejected_++;
+			return false;
+		}
+		return true;
+	}
+
+	PlacementValidator::Rect PlacementValidator::AddOnFootprint(const Point2D& location)
+	{
+		// The add-on's 2x2 sits against the structure's right side, level with its lower two rows.
+		Rect add_on;
+		add_on.min_x = FootprintMin(location.x, 3) + 3;
+		add_on.min_y = FootprintMin(location.y, 3);
+		add_on.max_x = add_on.min_x + 1;
+		add_on.max_y = add_on.min_y + 1;
+		return add_on;
+	}
+}
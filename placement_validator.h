@@ -0,0 +1,66 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Building placement checked in process: the map's placement grid with the structures we know of laid over it.
+	// A spot it rejects would be refused by the game, a spot it accepts still goes to the game to confirm, since
+	// units standing there, creep and power are not in the grid. Barracks, factories and starports are only
+	// accepted with room for their add-on, and the ones standing keep that room free of other structures.
+	class PlacementValidator
+	{
+	public:
+		// Unpacks the grid, 1 or 8 bits per cell with the top row first as the game sends it.
+		// A grid that does not match its size leaves the validator empty, it then accepts every spot.
+		void Init(const ImageData& placement_grid);
+
+		bool Ready() const { return width_ > 0; }
+
+		// Covers the cells under a structure's footprint, or frees them. Minerals and geysers count as structures,
+		// mineral fields 2x1. A barracks, factory or starport also reserves the 2x2 its add-on goes on.
+		void AddStructure(const Unit* unit);
+		void RemoveStructure(Tag tag);
+
+		// Whether the structure ability builds could go at location, where the game would centre it.
+		// Abilities it does not know the footprint of, refineries among them, are left to the game.
+		bool CanPlace(AbilityID ability, const Point2D& location);
+
+		// Whether an add-on fits beside a barracks, factory or starport standing at location.
+		// The spot its own structure reserved counts as free.
+		bool CanPlaceAddOn(const Point2D& location);
+
+		// Spots rejected without asking the game, since Init.
+		size_t Rejected() const { return rejected_; }
+
+	private:
+		struct Rect
+		{
+			int min_x;
+			int min_y;
+			int max_x;
+			int max_y;
+		};
+
+		static Rect AddOnFootprint(const Point2D& location);
+
+		// With reserved set, add-on spots kept for standing structures count as taken.
+		bool Free(const Rect& rect, bool reserved) const;
+		void SetOccupied(const Rect& rect, int change);
+		void SetReserved(const Rect& rect, int change);
+
+		int width_ = 0;
+		int height_ = 0;
+		std::vector<uint8_t> grid_;     // 1 where the game's grid allows building, row 0 at the bottom like map y
+		std::vector<uint8_t> occupied_; // Structures covering the cell
+		std::vector<uint8_t> free_;     // Buildable and not covered
+		std::vector<uint8_t> reserved_; // Add-on spots of standing structures over the cell
+		std::unordered_map<Tag, Rect> footprints_;
+		std::unordered_map<Tag, Rect> add_on_spots_;
+
+		size_t rejected_ = 0;
+	};
+}
@@ -0,0 +1,94 @@
+#include "query_broker.h"
+
+namespace sc2
+{
+	void QueryBroker::Request::PathingDistance(const Unit* start, const Point2D& end)
+	{
+		// A unit start is the more accurate query, the game paths from wherever the unit actually is.
+		QueryInterface::PathingQuery query;
+		query.start_unit_tag_ = start->tag;
+		query.start_ = start->pos;
+		query.end_ = end;
+		pathing.push_back(query);
+	}
+
+	void QueryBroker::Request::PathingDistance(const Point2D& start, const Point2D& end)
+	{
+		QueryInterface::PathingQuery query;
+		query.start_ = start;
+		query.end_ = end;
+		pathing.push_back(query);
+	}
+
+	void QueryBroker::Request::Placement(AbilityID ability, const Point2D& target, const Unit* unit)
+	{
+		QueryInterface::PlacementQuery query(ability, target);
+		if (unit)
+		{
+			query.placing_unit_tag = unit->tag;
+		}
+		placement.push_back(query);
+	}
+
+	void QueryBroker::Submit(const Request& request, Continuation then)
+	{
+		pending_.push_back({ std::move(then), pathing_.size(), request.pathing.size(), placement_.size(), request.placement.size() });
+		pathing_.insert(pathing_.end(), request.pathing.begin(), request.pathing.end());
+		placement_.insert(placement_.end(), request.placement.begin(), request.placement.end());
+	}
+
+	size_t QueryBroker::Flush(QueryInterface* query)
+	{
+		if (pending_.empty())
+		{
+			return 0;
+		}
+
+		flushing_.swap(pending_);
+		flushing_pathing_.swap(pathing_);
+		flushing_placement_.swap(placement_);
+
+		size_t round_trips = 0;
+		std::vector<float> distances;
+		std::vector<bool> placeable;
+		if (!flushing_pathing_.empty())
+		{
+			distances = query->PathingDistance(flushing_pathing_);
+			round_trips++;
+		}
+		if (!flushing_placement_.empty())
+		{
+			placeable = query->Placement(flushing_placement_);
+			round_trips++;
+		}
+
+		// The game answers one per query; should it come back short, the missing ones read as unpathable/unplaceable.
+		distances.resize(flushing_pathing_.size(), 0.0f);
+		placeable.resize(flushing_placement_.size(), false);
+
+		for (const Queued& request : flushing_)
+		{
+			results_.distances.assign(distances.begin() + request.pathing_begin,
+				distances.begin() + request.pathing_begin + request.pathing_count);
+			results_.placeable.assign(placeable.begin() + request.placement_begin,
+				placeable.begin() + request.placement_begin + request.placement_count);
+			request.then(results_);
+		}
+
+		requests_answered_ += flushing_.size();
+		queries_sent_ += flushing_pathing_.size() + flushing_placement_.size();
+		round_trips_ += round_trips;
+
+		flushing_.clear();
+		flushing_pathing_.clear();
+		flushing_placement_.clear();
+		return round_trips;
+	}
+
+	void QueryBroker::Clear()
+	{
+		pending_.clear();
+		pathing_.clear();
+		placement_.clear();
+	}
+}
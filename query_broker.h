@@ -0,0 +1,79 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Collects a step's pathing and placement checks and sends them as one batched PathingDistance and one
+	// batched Placement call, instead of a blocking round trip per check. Each request carries a continuation
+	// that gets its answers when the broker is flushed, so the decision that needed them is made there.
+	class QueryBroker
+	{
+	public:
+		// The queries of one request, answered in the order they were added.
+		struct Request
+		{
+			void PathingDistance(const Unit* start, const Point2D& end);
+			void PathingDistance(const Point2D& start, const Point2D& end);
+			void Placement(AbilityID ability, const Point2D& target, const Unit* unit = nullptr);
+
+			bool Empty() const { return pathing.empty() && placement.empty(); }
+
+			std::vector<QueryInterface::PathingQuery> pathing;
+			std::vector<QueryInterface::PlacementQuery> placement;
+		};
+
+		// Answers to a request, distances[i] for its i-th pathing query and placeable[i] for its i-th placement query.
+		struct Results
+		{
+			std::vector<float> distances;
+			std::vector<bool> placeable;
+		};
+
+		typedef std::function<void(const Results&)> Continuation;
+
+		// Queues the request, then runs with its answers at the next Flush.
+		void Submit(const Request& request, Continuation then);
+
+		// Sends everything queued in at most two round trips and runs the continuations in submission order.
+		// Requests a continuation submits are left for the next Flush. Returns the round trips taken.
+		size_t Flush(QueryInterface* query);
+
+		// Drops everything queued without sending it or running the continuations.
+		void Clear();
+
+		size_t Pending() const { return pending_.size(); }
+
+		// Totals over the game, for the end-of-game report.
+		size_t RequestsAnswered() const { return requests_answered_; }
+		size_t QueriesSent() const { return queries_sent_; }
+		size_t RoundTrips() const { return round_trips_; }
+
+	private:
+		struct Queued
+		{
+			Continuation then;
+			size_t pathing_begin;
+			size_t pathing_count;
+			size_t placement_begin;
+			size_t placement_count;
+		};
+
+		std::vector<Queued> pending_;
+		std::vector<QueryInterface::PathingQuery> pathing_;
+		std::vector<QueryInterface::PlacementQuery> placement_;
+
+		// Swapped with the above at flush, so continuations can submit while their batch is being answered
+		std::vector<Queued> flushing_;
+		std::vector<QueryInterface::PathingQuery> flushing_pathing_;
+		std::vector<QueryInterface::PlacementQuery> flushing_placement_;
+		Results results_;
+
+		size_t requests_answered_ = 0;
+		size_t queries_sent_ = 0;
+		size_t round_trips_ = 0;
+	};
+}
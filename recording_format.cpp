@@ -0,0 +1,1224 @@
+#include "recording_format.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace sc2
+{
+	namespace
+	{
+		// Which RecordedUnit fields a unit record carries
+		enum Field : uint32_t
+		{
+			TypeField = 1 << 0,
+			StateField = 1 << 1,         // Alliance, display type and flags
+			PositionGridField = 1 << 2,  // Deltas in 1/4096 of a cell
+			PositionRawField = 1 << 3,
+			RadiusField = 1 << 4,
+			BuildProgressField = 1 << 5,
+			HealthField = 1 << 6,
+			HealthMaxField = 1 << 7,
+			ShieldField = 1 << 8,
+			EnergyField = 1 << 9,
+			ContentsField = 1 << 10,
+			HarvestersField = 1 << 11,
+			AddOnField = 1 << 12,
+			OrdersField = 1 << 13,
+			BuffsField = 1 << 14,
+		};
+
+		enum OrderFlags : uint8_t { OrderTarget = 1, OrderPosition = 2 };
+
+		const double grid_scale = 4096.0;
+
+		// Bitwise, so a value that went from 0 to -0 is still written.
+		bool Same(float a, float b)
+		{
+			return memcmp(&a, &b, sizeof(float)) == 0;
+		}
+
+		int64_t GridOf(float value)
+		{
+			return static_cast<int64_t>(std::llround(value * grid_scale));
+		}
+
+		bool OnGrid(float value)
+		{
+			return Same(static_cast<float>(GridOf(value) / grid_scale), value);
+		}
+
+		bool SameOrders(const RecordedOrder* orders, uint32_t count, const std::vector<RecordedOrder>& previous)
+		{
+			if (count != previous.size())
+			{
+				return false;
+			}
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const RecordedOrder& a = orders[i];
+				const RecordedOrder& b = previous[i];
+				if (a.ability != b.ability || a.target_unit_tag != b.target_unit_tag || !Same(a.x, b.x) || !Same(a.y, b.y) ||
+					!Same(a.progress, b.progress))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool SameBuffs(const uint32_t* buffs, uint32_t count, const std::vector<uint32_t>& previous)
+		{
+			return count == previous.size() && (count == 0 || memcmp(buffs, previous.data(), count * sizeof(uint32_t)) == 0);
+		}
+
+		uint32_t ChangedFields(const RecordedUnit& unit, const RecordedOrder* orders, const uint32_t* buffs,
+			const RecordedUnit& previous, const std::vector<RecordedOrder>& previous_orders, const std::vector<uint32_t>& previous_buffs)
+		{
+			uint32_t fields = 0;
+			if (unit.unit_type != previous.unit_type)
+			{
+				fields |= TypeField;
+			}
+			if (unit.alliance != previous.alliance || unit.display_type != previous.display_type || unit.flags != previous.flags)
+			{
+				fields |= StateField;
+			}
+			if (!Same(unit.x, previous.x) || !Same(unit.y, previous.y) || !Same(unit.z, previous.z))
+			{
+				fields |= OnGrid(unit.x) && OnGrid(unit.y) && OnGrid(unit.z) ? PositionGridField : PositionRawField;
+			}
+			if (!Same(unit.radius, previous.radius))
+			{
+				fields |= RadiusField;
+			}
+			if (!Same(unit.build_progress, previous.build_progress))
+			{
+				fields |= BuildProgressField;
+			}
+			if (!Same(unit.health, previous.health))
+			{
+				fields |= HealthField;
+			}
+			if (!Same(unit.health_max, previous.health_max))
+			{
+				fields |= HealthMaxField;
+			}
+			if (!Same(unit.shield, previous.shield) || !Same(unit.shield_max, previous.shield_max))
+			{
+				fields |= ShieldField;
+			}
+			if (!Same(unit.energy, previous.energy) || !Same(unit.energy_max, previous.energy_max))
+			{
+				fields |= EnergyField;
+			}
+			if (unit.mineral_contents != previous.mineral_contents || unit.vespene_contents != previous.vespene_contents)
+			{
+				fields |= ContentsField;
+			}
+			if (unit.assigned_harvesters != previous.assigned_harvesters || unit.ideal_harvesters != previous.ideal_harvesters)
+			{
+				fields |= HarvestersField;
+			}
+			if (unit.add_on_tag != previous.add_on_tag)
+			{
+				fields |= AddOnField;
+			}
+			if (!SameOrders(orders, unit.order_count, previous_orders))
+			{
+				fields |= OrdersField;
+			}
+			if (!SameBuffs(buffs, unit.buff_count, previous_buffs))
+			{
+				fields |= BuffsField;
+			}
+			return fields;
+		}
+
+		void WriteFields(ByteWriter& writer, uint32_t fields, const RecordedUnit& unit, const RecordedOrder* orders,
+			const uint32_t* buffs, const RecordedUnit& previous)
+		{
+			writer.Varint(fields);
+			if (fields & TypeField)
+			{
+				writer.Varint(unit.unit_type);
+			}
+			if (fields & StateField)
+			{
+				writer.Byte(unit.alliance);
+				writer.Byte(unit.display_type);
+				writer.Byte(unit.flags);
+			}
+			if (fields & PositionGridField)
+			{
+				writer.Signed(GridOf(unit.x) - GridOf(previous.x));
+				writer.Signed(GridOf(unit.y) - GridOf(previous.y));
+				writer.Signed(GridOf(unit.z) - GridOf(previous.z));
+			}
+			if (fields & PositionRawField)
+			{
+				writer.Float(unit.x);
+				writer.Float(unit.y);
+				writer.Float(unit.z);
+			}
+			if (fields & RadiusField)
+			{
+				writer.Float(unit.radius);
+			}
+			if (fields & BuildProgressField)
+			{
+				writer.Float(unit.build_progress);
+			}
+			if (fields & HealthField)
+			{
+				writer.Float(unit.health);
+			}
+			if (fields & HealthMaxField)
+			{
+				writer.Float(unit.health_max);
+			}
+			if (fields & ShieldField)
+			{
+				writer.Float(unit.shield);
+				writer.Float(unit.shield_max);
+			}
+			if (fields & EnergyField)
+			{
+				writer.Float(unit.energy);
+				writer.Float(unit.energy_max);
+			}
+			if (fields & ContentsField)
+			{
+				writer.Signed(unit.mineral_contents);
+				writer.Signed(unit.vespene_contents);
+			}
+			if (fields & HarvestersField)
+			{
+				writer.Signed(unit.assigned_harvesters);
+				writer.Signed(unit.ideal_harvesters);
+			}
+			if (fields & AddOnField)
+			{
+				writer.Varint(unit.add_on_tag);
+			}
+			if (fields & OrdersField)
+			{
+				writer.Varint(unit.order_count);
+				for (uint32_t i = 0; i < unit.order_count; i++)
+				{
+					const RecordedOrder& order = orders[i];
+					uint8_t flags = (order.target_unit_tag != NullTag ? OrderTarget : 0) |
+						(order.x != 0.0f || order.y != 0.0f ? OrderPosition : 0);
+					writer.Varint(order.ability);
+					writer.Byte(flags);
+					if (flags & OrderTarget)
+					{
+						writer.Varint(order.target_unit_tag);
+					}
+					if (flags & OrderPosition)
+					{
+						writer.Float(order.x);
+						writer.Float(order.y);
+					}
+					writer.Float(order.progress);
+				}
+			}
+			if (fields & BuffsField)
+			{
+				writer.Varint(unit.buff_count);
+				for (uint32_t i = 0; i < unit.buff_count; i++)
+				{
+					writer.Varint(buffs[i]);
+				}
+			}
+		}
+
+		// Applies a unit record on top of the unit's previous state, orders and buffs are replaced when present.
+		void ReadFields(ByteReader& reader, RecordedUnit& unit, std::vector<RecordedOrder>& orders, std::vector<uint32_t>& buffs)
+		{
+			uint32_t fields = static_cast<uint32_t>(reader.Varint());
+			if (fields & TypeField)
+			{
+				unit.unit_type = static_cast<uint32_t>(reader.Varint());
+			}
+			if (fields & StateField)
+			{
+				unit.alliance = reader.Byte();
+				unit.display_type = reader.Byte();
+				unit.flags = reader.Byte();
+			}
+			if (fields & PositionGridField)
+			{
+				unit.x = static_cast<float>((GridOf(unit.x) + reader.Signed()) / grid_scale);
+				unit.y = static_cast<float>((GridOf(unit.y) + reader.Signed()) / grid_scale);
+				unit.z = static_cast<float>((GridOf(unit.z) + reader.Signed()) / grid_scale);
+			}
+			if (fields & PositionRawField)
+			{
+				unit.x = reader.Float();
+				unit.y = reader.Float();
+				unit.z = reader.Float();
+			}
+			if (fields & RadiusField)
+			{
+				unit.radius = reader.Float();
+			}
+			if (fields & BuildProgressField)
+			{
+				unit.build_progress = reader.Float();
+			}
+			if (fields & HealthField)
+			{
+				unit.health = reader.Float();
+			}
+			if (fields & HealthMaxField)
+			{
+				unit.health_max = reader.Float();
+			}
+			if (fields & ShieldField)
+			{
+				unit.shield = reader.Float();
+				unit.shield_max = reader.Float();
+			}
+			if (fields & EnergyField)
+			{
+				unit.energy = reader.Float();
+				unit.energy_max = reader.Float();
+			}
+			if (fields & ContentsField)
+			{
+				unit.mineral_contents = static_cast<int32_t>(reader.Signed());
+				unit.vespene_contents = static_cast<int32_t>(reader.Signed());
+			}
+			if (fields & HarvestersField)
+			{
+				unit.assigned_harvesters = static_cast<int32_t>(reader.Signed());
+				unit.ideal_harvesters = static_cast<int32_t>(reader.Signed());
+			}
+			if (fields & AddOnField)
+			{
+				unit.add_on_tag = reader.Varint();
+			}
+			if (fields & OrdersField)
+			{
+				orders.resize(static_cast<size_t>(reader.Varint()));
+				for (RecordedOrder& order : orders)
+				{
+					order = RecordedOrder();
+					order.ability = static_cast<uint32_t>(reader.Varint());
+					uint8_t flags = reader.Byte();
+					if (flags & OrderTarget)
+					{
+						order.target_unit_tag = reader.Varint();
+					}
+					if (flags & OrderPosition)
+					{
+						order.x = reader.Float();
+						order.y = reader.Float();
+					}
+					order.progress = reader.Float();
+					if (!reader.Ok())
+					{
+						orders.clear();
+						break;
+					}
+				}
+			}
+			if (fields & BuffsField)
+			{
+				buffs.resize(static_cast<size_t>(reader.Varint()));
+				for (uint32_t& buff : buffs)
+				{
+					buff = static_cast<uint32_t>(reader.Varint());
+					if (!reader.Ok())
+					{
+						buffs.clear();
+						break;
+					}
+				}
+			}
+		}
+
+		// A decoded unit as it goes into a frame, its orders and buffs are appended to the frame's shared lists.
+		RecordedUnit Placed(RecordedFrame& frame, const RecordedUnit& unit, const std::vector<RecordedOrder>& orders,
+			const std::vector<uint32_t>& buffs)
+		{
+			RecordedUnit placed = unit;
+			placed.first_order = static_cast<uint32_t>(frame.orders.size());
+			placed.order_count = static_cast<uint32_t>(orders.size());
+			frame.orders.insert(frame.orders.end(), orders.begin(), orders.end());
+			placed.first_buff = static_cast<uint32_t>(frame.buffs.size());
+			placed.buff_count = static_cast<uint32_t>(buffs.size());
+			frame.buffs.insert(frame.buffs.end(), buffs.begin(), buffs.end());
+			return placed;
+		}
+
+		void WritePoint(ByteWriter& writer, const Point2D& point)
+		{
+			writer.Float(point.x);
+			writer.Float(point.y);
+		}
+
+		Point2D ReadPoint(ByteReader& reader)
+		{
+			float x = reader.Float();
+			return Point2D(x, reader.Float());
+		}
+
+		void WriteImage(ByteWriter& writer, const ImageData& image)
+		{
+			writer.Signed(image.width);
+			writer.Signed(image.height);
+			writer.Signed(image.bits_per_pixel);
+			writer.String(image.data);
+		}
+
+		void ReadImage(ByteReader& reader, ImageData& image)
+		{
+			image.width = static_cast<int>(reader.Signed());
+			image.height = static_cast<int>(reader.Signed());
+			image.bits_per_pixel = static_cast<int>(reader.Signed());
+			image.data = reader.String();
+		}
+
+		const std::vector<RecordedOrder> no_orders;
+		const std::vector<uint32_t> no_buffs;
+
+		// PackBlock: matches shorter than this are left as literals, positions are hashed on their first bytes
+		const size_t min_match = 4;
+		const int hash_bits = 12;
+		const size_t max_block = size_t(1) << 30;
+
+		uint32_t Load32(const uint8_t* at)
+		{
+			uint32_t value;
+			memcpy(&value, at, sizeof(value));
+			return value;
+		}
+
+		uint32_t HashOf(uint32_t value)
+		{
+			return (value * 2654435761u) >> (32 - hash_bits);
+		}
+
+		// Fingerprint helpers, floats go in by their bits like the encoder compares them
+		uint32_t Bits(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		uint64_t Pack(uint32_t low, uint32_t high)
+		{
+			return low | static_cast<uint64_t>(high) << 32;
+		}
+
+		// Odd, otherwise arbitrary
+		const uint64_t fingerprint_keys[12] =
+		{
+			0x9e3779b97f4a7c15ull, 0xbf58476d1ce4e5b9ull, 0x94d049bb133111ebull, 0xd6e8feb86659fd93ull,
+			0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull,
+			0x1d8e4e27c47d124full, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0x27d4eb2f165667c5ull,
+		};
+		const uint64_t fingerprint_key_step = 0x5851f42d4c957f2eull;
+	}
+
+	const char RecordingHeader::magic[8] = { 'S', 'C', '2', 'B', 'R', 'E', 'C', '2' };
+
+	//
+	// ByteWriter / ByteReader
+	//
+
+	void ByteWriter::Varint(uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out_.push_back(static_cast<uint8_t>(value) | 0x80);
+			value >>= 7;
+		}
+		out_.push_back(static_cast<uint8_t>(value));
+	}
+
+	void ByteWriter::Float(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		for (int i = 0; i < 4; i++)
+		{
+			out_.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+		}
+	}
+
+	void ByteWriter::String(const std::string& value)
+	{
+		Varint(value.size());
+		out_.insert(out_.end(), value.begin(), value.end());
+	}
+
+	uint8_t ByteReader::Byte()
+	{
+		if (at_ >= end_)
+		{
+			ok_ = false;
+			return 0;
+		}
+		return *at_++;
+	}
+
+	uint64_t ByteReader::Varint()
+	{
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			uint8_t byte = Byte();
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+			{
+				return value;
+			}
+		}
+		ok_ = false;
+		return 0;
+	}
+
+	int64_t ByteReader::Signed()
+	{
+		uint64_t value = Varint();
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+
+	float ByteReader::Float()
+	{
+		uint32_t bits = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			bits |= static_cast<uint32_t>(Byte()) << (8 * i);
+		}
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	std::string ByteReader::String()
+	{
+		uint64_t size = Varint();
+		if (size > static_cast<uint64_t>(end_ - at_))
+		{
+			ok_ = false;
+			return std::string();
+		}
+		std::string value(reinterpret_cast<const char*>(at_), static_cast<size_t>(size));
+		at_ += size;
+		return value;
+	}
+
+	//
+	// RecordedFrame
+	//
+
+	void RecordedFrame::Clear()
+	{
+		game_loop = 0;
+		economy_read = 0;
+		upgrades_changed = false;
+		same_units = false;
+		upgrades.clear();
+		units.clear();
+		tags.clear();
+		orders.clear();
+		buffs.clear();
+		events.clear();
+		queries.clear();
+	}
+
+	void RecordedFrame::Capture(const Unit& unit, RecordedUnit& out)
+	{
+		out.tag = unit.tag;
+		out.unit_type = unit.unit_type;
+		out.alliance = static_cast<uint8_t>(unit.alliance);
+		out.display_type = static_cast<uint8_t>(unit.display_type);
+		out.flags = (unit.is_flying ? RecordedUnit::Flying : 0) | (unit.is_burrowed ? RecordedUnit::Burrowed : 0) |
+			(unit.is_alive ? RecordedUnit::Alive : 0) | (unit.is_powered ? RecordedUnit::Powered : 0);
+		out.x = unit.pos.x;
+		out.y = unit.pos.y;
+		out.z = unit.pos.z;
+		out.radius = unit.radius;
+		out.build_progress = unit.build_progress;
+		out.health = unit.health;
+		out.health_max = unit.health_max;
+		out.shield = unit.shield;
+		out.shield_max = unit.shield_max;
+		out.energy = unit.energy;
+		out.energy_max = unit.energy_max;
+		out.mineral_contents = unit.mineral_contents;
+		out.vespene_contents = unit.vespene_contents;
+		out.assigned_harvesters = unit.assigned_harvesters;
+		out.ideal_harvesters = unit.ideal_harvesters;
+		out.add_on_tag = unit.add_on_tag;
+
+		out.first_order = static_cast<uint32_t>(orders.size());
+		out.order_count = static_cast<uint32_t>(unit.orders.size());
+		for (const UnitOrder& order : unit.orders)
+		{
+			orders.push_back({ order.ability_id, order.target_unit_tag, order.target_pos.x, order.target_pos.y, order.progress });
+		}
+
+		out.first_buff = static_cast<uint32_t>(buffs.size());
+		out.buff_count = static_cast<uint32_t>(unit.buffs.size());
+		for (BuffID buff : unit.buffs)
+		{
+			buffs.push_back(buff);
+		}
+	}
+
+	void RecordedFrame::Restore(const RecordedUnit& recorded, Unit& out) const
+	{
+		out.tag = recorded.tag;
+		out.unit_type = recorded.unit_type;
+		out.alliance = static_cast<Unit::Alliance>(recorded.alliance);
+		out.display_type = static_cast<Unit::DisplayType>(recorded.display_type);
+		out.is_flying = (recorded.flags & RecordedUnit::Flying) != 0;
+		out.is_burrowed = (recorded.flags & RecordedUnit::Burrowed) != 0;
+		out.is_alive = (recorded.flags & RecordedUnit::Alive) != 0;
+		out.is_powered = (recorded.flags & RecordedUnit::Powered) != 0;
+		out.pos = Point3D(recorded.x, recorded.y, recorded.z);
+		out.radius = recorded.radius;
+		out.build_progress = recorded.build_progress;
+		out.health = recorded.health;
+		out.health_max = recorded.health_max;
+		out.shield = recorded.shield;
+		out.shield_max = recorded.shield_max;
+		out.energy = recorded.energy;
+		out.energy_max = recorded.energy_max;
+		out.mineral_contents = recorded.mineral_contents;
+		out.vespene_contents = recorded.vespene_contents;
+		out.assigned_harvesters = recorded.assigned_harvesters;
+		out.ideal_harvesters = recorded.ideal_harvesters;
+		out.add_on_tag = recorded.add_on_tag;
+
+		out.orders.resize(recorded.order_count);
+		for (uint32_t i = 0; i < recorded.order_count; i++)
+		{
+			const RecordedOrder& order = orders[recorded.first_order + i];
+			UnitOrder& restored = out.orders[i];
+			restored.ability_id = order.ability;
+			restored.target_unit_tag = order.target_unit_tag;
+			restored.target_pos = Point2D(order.x, order.y);
+			restored.progress = order.progress;
+		}
+
+		out.buffs.resize(recorded.buff_count);
+		for (uint32_t i = 0; i < recorded.buff_count; i++)
+		{
+			out.buffs[i] = buffs[recorded.first_buff + i];
+		}
+	}
+
+	uint64_t RecordedFrame::Fingerprint(const Unit& unit)
+	{
+		uint32_t flags = (unit.is_flying ? RecordedUnit::Flying : 0) | (unit.is_burrowed ? RecordedUnit::Burrowed : 0) |
+			(unit.is_alive ? RecordedUnit::Alive : 0) | (unit.is_powered ? RecordedUnit::Powered : 0);
+		uint32_t state = static_cast<uint32_t>(unit.alliance) | static_cast<uint32_t>(unit.display_type) << 8 | flags << 16;
+
+		// Each word times its own odd key, summed. The products do not wait on each other, and a change
+		// to one word always changes the sum.
+		uint64_t sum = unit.tag * fingerprint_keys[0] +
+			Pack(static_cast<uint32_t>(unit.unit_type), state) * fingerprint_keys[1] +
+			Pack(Bits(unit.pos.x), Bits(unit.pos.y)) * fingerprint_keys[2] +
+			Pack(Bits(unit.pos.z), Bits(unit.radius)) * fingerprint_keys[3] +
+			Pack(Bits(unit.build_progress), Bits(unit.health)) * fingerprint_keys[4] +
+			Pack(Bits(unit.health_max), Bits(unit.shield)) * fingerprint_keys[5] +
+			Pack(Bits(unit.shield_max), Bits(unit.energy)) * fingerprint_keys[6] +
+			Pack(Bits(unit.energy_max), unit.mineral_contents) * fingerprint_keys[7] +
+			Pack(unit.vespene_contents, unit.assigned_harvesters) * fingerprint_keys[8] +
+			Pack(unit.ideal_harvesters, static_cast<uint32_t>(unit.orders.size() | unit.buffs.size() << 16)) * fingerprint_keys[9] +
+			unit.add_on_tag * fingerprint_keys[10];
+
+		// Keys for the lists step by an even amount, so each position gets a different odd key
+		uint64_t key = fingerprint_keys[11];
+		for (const UnitOrder& order : unit.orders)
+		{
+			sum += Pack(static_cast<uint32_t>(order.ability_id), Bits(order.progress)) * key +
+				order.target_unit_tag * (key + 2) +
+				Pack(Bits(order.target_pos.x), Bits(order.target_pos.y)) * (key + 4);
+			key += fingerprint_key_step;
+		}
+		for (BuffID buff : unit.buffs)
+		{
+			sum += static_cast<uint32_t>(buff) * key;
+			key += fingerprint_key_step;
+		}
+		return sum;
+	}
+
+	//
+	// PackBlock / UnpackBlock
+	//
+
+	void PackBlock(const std::vector<uint8_t>& raw, std::vector<uint8_t>& out)
+	{
+		// Sequences of a literal count, the literals, then a match (length - min_match, distance back) while input is left
+		std::vector<uint8_t> packed;
+		packed.reserve(raw.size() / 2 + 16);
+		ByteWriter writer(packed);
+
+		const uint8_t* data = raw.data();
+		size_t size = raw.size();
+		uint32_t table[1 << hash_bits] = {}; // Last position + 1 of each hash, 0 when none
+		size_t literals = 0;
+		size_t at = 0;
+		while (at + min_match <= size)
+		{
+			uint32_t word = Load32(data + at);
+			uint32_t& entry = table[HashOf(word)];
+			size_t candidate = entry;
+			entry = static_cast<uint32_t>(at + 1);
+			if (candidate == 0 || Load32(data + candidate - 1) != word)
+			{
+				at++;
+				continue;
+			}
+
+			size_t from = candidate - 1;
+			size_t length = min_match;
+			while (at + length < size && data[from + length] == data[at + length])
+			{
+				length++;
+			}
+			writer.Varint(at - literals);
+			packed.insert(packed.end(), data + literals, data + at);
+			writer.Varint(length - min_match);
+			writer.Varint(at - from);
+			at += length;
+			literals = at;
+		}
+		writer.Varint(size - literals);
+		packed.insert(packed.end(), data + literals, data + size);
+
+		ByteWriter block(out);
+		block.Varint(size);
+		block.Varint(packed.size());
+		out.insert(out.end(), packed.begin(), packed.end());
+	}
+
+	bool UnpackBlock(ByteReader& reader, std::vector<uint8_t>& out)
+	{
+		uint64_t raw_size = reader.Varint();
+		uint64_t packed_size = reader.Varint();
+		if (!reader.Ok() || raw_size > max_block || packed_size > reader.Remaining())
+		{
+			return false;
+		}
+		ByteReader packed(reader.Position(), reader.Position() + packed_size);
+		reader.Skip(static_cast<size_t>(packed_size));
+
+		size_t start = out.size();
+		size_t end = start + static_cast<size_t>(raw_size);
+		out.reserve(end);
+		for (;;)
+		{
+			uint64_t literals = packed.Varint();
+			if (!packed.Ok() || literals > packed.Remaining() || literals > end - out.size())
+			{
+				break;
+			}
+			out.insert(out.end(), packed.Position(), packed.Position() + literals);
+			packed.Skip(static_cast<size_t>(literals));
+			if (out.size() == end)
+			{
+				if (packed.AtEnd())
+				{
+					return true;
+				}
+				break;
+			}
+
+			uint64_t length = packed.Varint() + min_match;
+			uint64_t distance = packed.Varint();
+			if (!packed.Ok() || distance == 0 || distance > out.size() - start || length > end - out.size())
+			{
+				break;
+			}
+			// Byte by byte, a match may overlap what it is copying
+			size_t from = out.size() - static_cast<size_t>(distance);
+			for (uint64_t i = 0; i < length; i++)
+			{
+				uint8_t byte = out[from + static_cast<size_t>(i)];
+				out.push_back(byte);
+			}
+		}
+		out.resize(start);
+		return false;
+	}
+
+	//
+	// FrameEncoder
+	//
+
+	void FrameEncoder::EncodeHeader(const RecordingHeader& header, std::vector<uint8_t>& out)
+	{
+		ByteWriter writer(out);
+		writer.Varint(header.random_seed);
+		writer.Varint(header.player_id);
+		writer.Float(header.start_location.x);
+		writer.Float(header.start_location.y);
+		writer.Float(header.start_location.z);
+
+		const GameInfo& info = header.game_info;
+		writer.Signed(info.width);
+		writer.Signed(info.height);
+		WriteImage(writer, info.pathing_grid);
+		WriteImage(writer, info.placement_grid);
+		WriteImage(writer, info.terrain_height);
+		WritePoint(writer, info.playable_min);
+		WritePoint(writer, info.playable_max);
+		writer.Varint(info.start_locations.size());
+		for (const Point2D& location : info.start_locations)
+		{
+			WritePoint(writer, location);
+		}
+		writer.Varint(info.enemy_start_locations.size());
+		for (const Point2D& location : info.enemy_start_locations)
+		{
+			WritePoint(writer, location);
+		}
+		writer.String(info.map_name);
+		writer.String(info.local_map_path);
+
+		writer.Varint(header.unit_types.size());
+		for (const UnitTypeData& data : header.unit_types)
+		{
+			writer.Varint(data.unit_type_id);
+			writer.String(data.name);
+			writer.Byte(data.available);
+			writer.Varint(data.cargo_size);
+			writer.Signed(data.mineral_cost);
+			writer.Signed(data.vespene_cost);
+			writer.Float(data.food_required);
+			writer.Float(data.food_provided);
+			writer.Varint(data.ability_id);
+			writer.Byte(static_cast<uint8_t>(data.race));
+			writer.Float(data.build_time);
+			writer.Byte(data.has_vespene);
+			writer.Byte(data.has_minerals);
+			writer.Float(data.sight_range);
+			writer.Varint(data.tech_alias.size());
+			for (UnitTypeID alias : data.tech_alias)
+			{
+				writer.Varint(alias);
+			}
+			writer.Varint(data.unit_alias);
+			writer.Varint(data.tech_requirement);
+			writer.Byte(data.require_attached);
+			writer.Varint(data.attributes.size());
+			for (Attribute attribute : data.attributes)
+			{
+				writer.Byte(static_cast<uint8_t>(attribute));
+			}
+			writer.Float(data.movement_speed);
+			writer.Float(data.armor);
+			writer.Varint(data.weapons.size());
+			for (const Weapon& weapon : data.weapons)
+			{
+				writer.Byte(static_cast<uint8_t>(weapon.type));
+				writer.Float(weapon.damage_);
+				writer.Varint(weapon.damage_bonus.size());
+				for (const DamageBonus& bonus : weapon.damage_bonus)
+				{
+					writer.Byte(static_cast<uint8_t>(bonus.attribute));
+					writer.Float(bonus.bonus);
+				}
+				writer.Varint(weapon.attacks);
+				writer.Float(weapon.range);
+				writer.Float(weapon.speed);
+			}
+		}
+	}
+
+	void FrameEncoder::Encode(const RecordedFrame& frame, std::vector<uint8_t>& out)
+	{
+		ByteWriter writer(out);
+		frame_++;
+
+		writer.Signed(static_cast<int64_t>(frame.game_loop) - game_loop_);
+		game_loop_ = frame.game_loop;
+
+		// The economy values the bot read, against the last time each was written
+		writer.Varint(frame.economy_read);
+		for (int i = 0; i < RecordedFrame::EconomyValues; i++)
+		{
+			if (frame.economy_read & (1u << i))
+			{
+				writer.Signed(static_cast<int64_t>(frame.economy[i]) - economy_[i]);
+				economy_[i] = frame.economy[i];
+			}
+		}
+
+		// Upgrades only when the list changed, 0 otherwise
+		if (frame.upgrades_changed)
+		{
+			writer.Varint(frame.upgrades.size() + 1);
+			for (uint32_t upgrade : frame.upgrades)
+			{
+				writer.Varint(upgrade);
+			}
+		}
+		else
+		{
+			writer.Varint(0);
+		}
+
+		// Slots of this frame's units, new tags get the next slot
+		if (frame.same_units)
+		{
+			current_ = order_;
+		}
+		else
+		{
+			current_.clear();
+			for (Tag tag : frame.tags)
+			{
+				auto found = slot_of_.find(tag);
+				if (found == slot_of_.end())
+				{
+					slot_of_[tag] = static_cast<uint32_t>(previous_.size());
+					current_.push_back(static_cast<uint32_t>(previous_.size()));
+					previous_.emplace_back();
+					previous_.back().unit.tag = tag;
+				}
+				else
+				{
+					current_.push_back(found->second);
+				}
+			}
+		}
+
+		// The recorder captured the units that changed since their last frame, in the same order.
+		// The others are as the encoder last had them.
+		captured_.clear();
+		size_t next = 0;
+		for (uint32_t slot : current_)
+		{
+			Previous& previous = previous_[slot];
+			previous.seen = frame_;
+			bool changed = next < frame.units.size() && frame.units[next].tag == previous.unit.tag;
+			captured_.push_back(changed ? &frame.units[next++] : nullptr);
+		}
+
+		// Units gone since the last frame
+		expected_.clear();
+		changed_.clear();
+		for (uint32_t slot : order_)
+		{
+			if (previous_[slot].seen != frame_)
+			{
+				changed_.push_back(slot);
+				previous_[slot].present = false;
+			}
+			else
+			{
+				expected_.push_back(slot);
+			}
+		}
+		writer.Varint(changed_.size());
+		for (uint32_t slot : changed_)
+		{
+			writer.Varint(slot);
+		}
+
+		// Units that are new, back, or changed. The count goes first, so each unit's fields are kept for the write.
+		size_t changed_count = 0;
+		fields_.resize(current_.size());
+		for (size_t i = 0; i < current_.size(); i++)
+		{
+			const RecordedUnit* unit = captured_[i];
+			const Previous& previous = previous_[current_[i]];
+			fields_[i] = unit ? ChangedFields(*unit, frame.orders.data() + unit->first_order, frame.buffs.data() + unit->first_buff,
+				previous.unit, previous.orders, previous.buffs) : 0;
+			if (!previous.present || fields_[i])
+			{
+				changed_count++;
+			}
+		}
+		writer.Varint(changed_count);
+		uint32_t known_slots = known_slots_;
+		for (size_t i = 0; i < current_.size(); i++)
+		{
+			uint32_t slot = current_[i];
+			Previous& previous = previous_[slot];
+			uint32_t fields = fields_[i];
+			if (previous.present && !fields)
+			{
+				continue;
+			}
+
+			writer.Varint(slot);
+			if (slot >= known_slots)
+			{
+				writer.Varint(previous.unit.tag);
+				known_slots = slot + 1;
+			}
+			if (!previous.present)
+			{
+				expected_.push_back(slot);
+				previous.present = true;
+			}
+			const RecordedUnit* unit = captured_[i];
+			if (!unit)
+			{
+				// Back as it was when it left, no fields
+				writer.Varint(0);
+				continue;
+			}
+			const RecordedOrder* orders = frame.orders.data() + unit->first_order;
+			const uint32_t* buffs = frame.buffs.data() + unit->first_buff;
+			WriteFields(writer, fields, *unit, orders, buffs, previous.unit);
+			previous.unit = *unit;
+			previous.orders.assign(orders, orders + unit->order_count);
+			previous.buffs.assign(buffs, buffs + unit->buff_count);
+		}
+		known_slots_ = known_slots;
+
+		// GetUnits order, only written when it is not the previous one with arrivals at the end
+		if (current_ != expected_)
+		{
+			writer.Varint(current_.size() + 1);
+			for (uint32_t slot : current_)
+			{
+				writer.Varint(slot);
+			}
+		}
+		else
+		{
+			writer.Varint(0);
+		}
+		order_.swap(current_);
+
+		// Event units are written whole, the unit may be gone from the frame (destroyed) or not in it yet.
+		RecordedUnit none;
+		writer.Varint(frame.events.size());
+		for (const RecordedEvent& event : frame.events)
+		{
+			const RecordedOrder* orders = frame.orders.data() + event.unit.first_order;
+			const uint32_t* buffs = frame.buffs.data() + event.unit.first_buff;
+			writer.Byte(static_cast<uint8_t>(event.kind));
+			writer.Varint(event.unit.tag);
+			WriteFields(writer, ChangedFields(event.unit, orders, buffs, none, no_orders, no_buffs), event.unit, orders, buffs, none);
+		}
+
+		writer.Varint(frame.queries.size());
+		out.insert(out.end(), frame.queries.begin(), frame.queries.end());
+	}
+
+	//
+	// FrameDecoder
+	//
+
+	bool FrameDecoder::DecodeHeader(ByteReader& reader, RecordingHeader& header)
+	{
+		header.random_seed = static_cast<uint32_t>(reader.Varint());
+		header.player_id = static_cast<uint32_t>(reader.Varint());
+		header.start_location.x = reader.Float();
+		header.start_location.y = reader.Float();
+		header.start_location.z = reader.Float();
+
+		GameInfo& info = header.game_info;
+		info.width = static_cast<int>(reader.Signed());
+		info.height = static_cast<int>(reader.Signed());
+		ReadImage(reader, info.pathing_grid);
+		ReadImage(reader, info.placement_grid);
+		ReadImage(reader, info.terrain_height);
+		info.playable_min = ReadPoint(reader);
+		info.playable_max = ReadPoint(reader);
+		info.start_locations.resize(static_cast<size_t>(reader.Varint()));
+		for (Point2D& location : info.start_locations)
+		{
+			location = ReadPoint(reader);
+		}
+		info.enemy_start_locations.resize(static_cast<size_t>(reader.Varint()));
+		for (Point2D& location : info.enemy_start_locations)
+		{
+			location = ReadPoint(reader);
+		}
+		info.map_name = reader.String();
+		info.local_map_path = reader.String();
+		if (!reader.Ok())
+		{
+			return false;
+		}
+
+		header.unit_types.resize(static_cast<size_t>(reader.Varint()));
+		for (UnitTypeData& data : header.unit_types)
+		{
+			data.unit_type_id = static_cast<uint32_t>(reader.Varint());
+			data.name = reader.String();
+			data.available = reader.Byte() != 0;
+			data.cargo_size = static_cast<uint32_t>(reader.Varint());
+			data.mineral_cost = static_cast<int>(reader.Signed());
+			data.vespene_cost = static_cast<int>(reader.Signed());
+			data.food_required = reader.Float();
+			data.food_provided = reader.Float();
+			data.ability_id = static_cast<uint32_t>(reader.Varint());
+			data.race = static_cast<Race>(reader.Byte());
+			data.build_time = reader.Float();
+			data.has_vespene = reader.Byte() != 0;
+			data.has_minerals = reader.Byte() != 0;
+			data.sight_range = reader.Float();
+			data.tech_alias.resize(static_cast<size_t>(reader.Varint()));
+			for (UnitTypeID& alias : data.tech_alias)
+			{
+				alias = static_cast<uint32_t>(reader.Varint());
+			}
+			data.unit_alias = static_cast<uint32_t>(reader.Varint());
+			data.tech_requirement = static_cast<uint32_t>(reader.Varint());
+			data.require_attached = reader.Byte() != 0;
+			data.attributes.resize(static_cast<size_t>(reader.Varint()));
+			for (Attribute& attribute : data.attributes)
+			{
+				attribute = static_cast<Attribute>(reader.Byte());
+			}
+			data.movement_speed = reader.Float();
+			data.armor = reader.Float();
+			data.weapons.resize(static_cast<size_t>(reader.Varint()));
+			for (Weapon& weapon : data.weapons)
+			{
+				weapon.type = static_cast<Weapon::TargetType>(reader.Byte());
+				weapon.damage_ = reader.Float();
+				weapon.damage_bonus.resize(static_cast<size_t>(reader.Varint()));
+				for (DamageBonus& bonus : weapon.damage_bonus)
+				{
+					bonus.attribute = static_cast<Attribute>(reader.Byte());
+					bonus.bonus = reader.Float();
+				}
+				weapon.attacks = static_cast<uint32_t>(reader.Varint());
+				weapon.range = reader.Float();
+				weapon.speed = reader.Float();
+			}
+			if (!reader.Ok())
+			{
+				return false;
+			}
+		}
+		return reader.Ok();
+	}
+
+	bool FrameDecoder::Decode(ByteReader& reader, RecordedFrame& frame)
+	{
+		frame.Clear();
+
+		game_loop_ = static_cast<uint32_t>(game_loop_ + reader.Signed());
+		frame.game_loop = game_loop_;
+
+		// Values the bot did not read this frame keep the last recorded one
+		frame.economy_read = static_cast<uint32_t>(reader.Varint());
+		for (int i = 0; i < RecordedFrame::EconomyValues; i++)
+		{
+			if (frame.economy_read & (1u << i))
+			{
+				economy_[i] = static_cast<int32_t>(economy_[i] + reader.Signed());
+			}
+			frame.economy[i] = economy_[i];
+		}
+
+		uint64_t upgrades = reader.Varint();
+		if (upgrades > 0)
+		{
+			upgrades_.resize(static_cast<size_t>(upgrades - 1));
+			for (uint32_t& upgrade : upgrades_)
+			{
+				upgrade = static_cast<uint32_t>(reader.Varint());
+			}
+			frame.upgrades_changed = true;
+		}
+		frame.upgrades = upgrades_;
+
+		uint64_t removed = reader.Varint();
+		for (uint64_t i = 0; i < removed && reader.Ok(); i++)
+		{
+			uint64_t slot = reader.Varint();
+			if (slot >= present_.size())
+			{
+				return false;
+			}
+			present_[static_cast<size_t>(slot)] = 0;
+		}
+		expected_.clear();
+		for (uint32_t slot : order_)
+		{
+			if (present_[slot])
+			{
+				expected_.push_back(slot);
+			}
+		}
+
+		uint64_t changed = reader.Varint();
+		for (uint64_t i = 0; i < changed && reader.Ok(); i++)
+		{
+			uint64_t slot = reader.Varint();
+			if (slot == previous_.size())
+			{
+				previous_.emplace_back();
+				present_.push_back(0);
+				previous_.back().unit.tag = reader.Varint();
+			}
+			else if (slot > previous_.size())
+			{
+				return false;
+			}
+			Previous& previous = previous_[static_cast<size_t>(slot)];
+			ReadFields(reader, previous.unit, previous.orders, previous.buffs);
+			if (!present_[static_cast<size_t>(slot)])
+			{
+				present_[static_cast<size_t>(slot)] = 1;
+				expected_.push_back(static_cast<uint32_t>(slot));
+			}
+		}
+
+		uint64_t order = reader.Varint();
+		if (order > 0)
+		{
+			order_.resize(static_cast<size_t>(order - 1));
+			for (uint32_t& slot : order_)
+			{
+				slot = static_cast<uint32_t>(reader.Varint());
+				if (slot >= previous_.size())
+				{
+					return false;
+				}
+			}
+		}
+		else
+		{
+			order_.swap(expected_);
+		}
+
+		for (uint32_t slot : order_)
+		{
+			const Previous& previous = previous_[slot];
+			frame.units.push_back(Placed(frame, previous.unit, previous.orders, previous.buffs));
+		}
+
+		uint64_t events = reader.Varint();
+		for (uint64_t i = 0; i < events && reader.Ok(); i++)
+		{
+			RecordedEvent event;
+			event.kind = static_cast<RecordedEvent::Kind>(reader.Byte());
+			event.unit.tag = reader.Varint();
+			event_orders_.clear();
+			event_buffs_.clear();
+			ReadFields(reader, event.unit, event_orders_, event_buffs_);
+			event.unit = Placed(frame, event.unit, event_orders_, event_buffs_);
+			frame.events.push_back(event);
+		}
+
+		uint64_t queries = reader.Varint();
+		if (queries > static_cast<uint64_t>(reader.Remaining()))
+		{
+			return false;
+		}
+		frame.queries.assign(reader.Position(), reader.Position() + queries);
+		reader.Skip(static_cast<size_t>(queries));
+
+		return reader.Ok();
+	}
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Game recordings, written by ObservationRecorder and read back by headless/ReplayGame.
+	//
+	// A recording is the magic bytes followed by blocks, each a varint raw size, a varint packed size and the
+	// packed bytes (see PackBlock). Unpacked and put together the blocks are chunks, each a varint byte count and
+	// its payload. The first chunk is the RecordingHeader, every other one a RecordedFrame: frame 0 is what the
+	// bot saw in OnGameStart, frame n the events and observation of its nth OnStep.
+	// Frames are delta encoded against the one before: only units whose fields changed are written, and only
+	// the fields that changed. Numbers are varints (zigzag for signed deltas), positions are deltas in 1/4096
+	// of a cell (the engine's own precision) and fall back to raw floats when a value is not on that grid.
+	// Economy values are only there for frames the bot read them in.
+
+	// Byte order independent varint/float writer, appends to out.
+	class ByteWriter
+	{
+	public:
+		explicit ByteWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+		void Byte(uint8_t value) { out_.push_back(value); }
+		void Varint(uint64_t value);
+		void Signed(int64_t value) { Varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63)); }
+		void Float(float value);
+		void String(const std::string& value);
+
+	private:
+		std::vector<uint8_t>& out_;
+	};
+
+	// Reads what ByteWriter wrote. Reading past the end returns zeros and clears Ok().
+	class ByteReader
+	{
+	public:
+		ByteReader(const uint8_t* begin, const uint8_t* end) : at_(begin), end_(end) {}
+
+		uint8_t Byte();
+		uint64_t Varint();
+		int64_t Signed();
+		float Float();
+		std::string String();
+
+		bool Ok() const { return ok_; }
+		bool AtEnd() const { return at_ >= end_; }
+		const uint8_t* Position() const { return at_; }
+		size_t Remaining() const { return at_ < end_ ? static_cast<size_t>(end_ - at_) : 0; }
+		void Skip(size_t bytes) { at_ += bytes < Remaining() ? bytes : Remaining(); }
+
+	private:
+		const uint8_t* at_;
+		const uint8_t* end_;
+		bool ok_ = true;
+	};
+
+	struct RecordingHeader
+	{
+		static const char magic[8];
+
+		uint32_t random_seed = 0; // What the bot's generator was seeded with, see setRandomSeed
+		uint32_t player_id = 0;
+		Point3D start_location;
+		GameInfo game_info;
+		UnitTypes unit_types;
+	};
+
+	// A unit as recorded, flat so capturing a frame does not allocate per unit.
+	struct RecordedUnit
+	{
+		enum Flags : uint8_t { Flying = 1, Burrowed = 2, Alive = 4, Powered = 8 };
+
+		Tag tag = NullTag;
+		uint32_t unit_type = 0;
+		uint8_t alliance = 0;
+		uint8_t display_type = 0;
+		uint8_t flags = 0;
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+		float radius = 0.0f;
+		float build_progress = 0.0f;
+		float health = 0.0f;
+		float health_max = 0.0f;
+		float shield = 0.0f;
+		float shield_max = 0.0f;
+		float energy = 0.0f;
+		float energy_max = 0.0f;
+		int32_t mineral_contents = 0;
+		int32_t vespene_contents = 0;
+		int32_t assigned_harvesters = 0;
+		int32_t ideal_harvesters = 0;
+		Tag add_on_tag = NullTag;
+		uint32_t first_order = 0; // Into RecordedFrame::orders
+		uint32_t order_count = 0;
+		uint32_t first_buff = 0;  // Into RecordedFrame::buffs
+		uint32_t buff_count = 0;
+	};
+
+	struct RecordedOrder
+	{
+		uint32_t ability = 0;
+		Tag target_unit_tag = NullTag;
+		float x = 0.0f;
+		float y = 0.0f;
+		float progress = 0.0f;
+	};
+
+	struct RecordedEvent
+	{
+		// The Client callbacks Bot handles, in the order the client raises them
+		enum class Kind : uint8_t { UnitDestroyed, UnitCreated, UnitIdle, BuildingConstructionComplete, UnitEnterVision };
+
+		Kind kind = Kind::UnitIdle;
+		RecordedUnit unit; // As the callback saw it
+	};
+
+	struct RecordedFrame
+	{
+		enum Economy { Minerals, Vespene, FoodCap, FoodUsed, FoodArmy, FoodWorkers, IdleWorkers, ArmyCount, WarpGates, EconomyValues };
+
+		enum class QueryKind : uint8_t { AbilitiesForUnit, AbilitiesForUnits, PathingDistance, PathingDistances, Placement, Placements };
+
+		uint32_t game_loop = 0;
+		int32_t economy[EconomyValues] = {};
+		uint32_t economy_read = 0;      // Bits (1 << Economy) of the values the bot read this frame, the rest are stale
+		bool upgrades_changed = false;  // Set when upgrades differs from the frame before, it is left empty otherwise
+		std::vector<uint32_t> upgrades; // Decoded frames always have the list
+		std::vector<RecordedUnit> units; // In GetUnits order. From the recorder only the units that changed, see tags
+		std::vector<Tag> tags;           // From the recorder: every unit in GetUnits order, empty in decoded frames
+		bool same_units = false;         // From the recorder: the last frame's units in the same order, tags is left empty
+		std::vector<RecordedOrder> orders;
+		std::vector<uint32_t> buffs;
+		std::vector<RecordedEvent> events;
+		std::vector<uint8_t> queries; // Query results in the order they were asked, see RecordingQuery
+
+		// Keeps the capacity, frames are reused.
+		void Clear();
+
+		// Copies unit into out, its orders and buffs are appended to this frame.
+		void Capture(const Unit& unit, RecordedUnit& out);
+
+		// Copies a recorded unit (with its orders and buffs from this frame) back into a Unit.
+		void Restore(const RecordedUnit& recorded, Unit& out) const;
+
+		// 64 bit hash of everything Capture copies, so the recorder can tell a unit changed without keeping a copy.
+		static uint64_t Fingerprint(const Unit& unit);
+	};
+
+	// Compresses raw (LZ77, byte aligned) and appends the block to out: varint raw size, varint packed size,
+	// packed bytes. Fast rather than small, it runs on the recorder's writer thread.
+	void PackBlock(const std::vector<uint8_t>& raw, std::vector<uint8_t>& out);
+
+	// Reads a block PackBlock wrote and appends its raw bytes to out. False if the block is cut off or damaged.
+	bool UnpackBlock(ByteReader& reader, std::vector<uint8_t>& out);
+
+	// Writes the header and frames. Keeps the previous frame's units to delta encode against.
+	class FrameEncoder
+	{
+	public:
+		static void EncodeHeader(const RecordingHeader& header, std::vector<uint8_t>& out);
+
+		void Encode(const RecordedFrame& frame, std::vector<uint8_t>& out);
+
+	private:
+		// Previous state of each unit ever recorded, indexed by slot (tags are assigned slots in order seen).
+		struct Previous
+		{
+			RecordedUnit unit;
+			std::vector<RecordedOrder> orders;
+			std::vector<uint32_t> buffs;
+			uint32_t seen = 0;    // Last frame the unit was in
+			bool present = false; // In the previous frame, as far as the decoder knows
+		};
+
+		std::unordered_map<Tag, uint32_t> slot_of_;
+		std::vector<Previous> previous_;
+		std::vector<uint32_t> order_;    // Slots in the previous frame's GetUnits order
+		std::vector<uint32_t> expected_; // Scratch, the order if nothing moved
+		std::vector<uint32_t> current_;  // Scratch, this frame's order
+		std::vector<const RecordedUnit*> captured_; // Scratch, each unit's record in the frame, null if it did not change
+		std::vector<uint32_t> changed_;
+		std::vector<uint32_t> fields_;   // Scratch, ChangedFields of each of this frame's units
+		uint32_t known_slots_ = 0; // Slots the decoder has been told the tag of
+		uint32_t frame_ = 0;
+		uint32_t game_loop_ = 0;
+		int32_t economy_[RecordedFrame::EconomyValues] = {};
+	};
+
+	// Mirror of FrameEncoder, rebuilds complete frames.
+	class FrameDecoder
+	{
+	public:
+		static bool DecodeHeader(ByteReader& reader, RecordingHeader& header);
+
+		bool Decode(ByteReader& reader, RecordedFrame& frame);
+
+	private:
+		struct Previous
+		{
+			RecordedUnit unit;
+			std::vector<RecordedOrder> orders;
+			std::vector<uint32_t> buffs;
+		};
+
+		std::vector<Previous> previous_;
+		std::vector<uint32_t> order_;
+		std::vector<uint32_t> expected_;
+		std::vector<uint8_t> present_;
+		std::vector<RecordedOrder> event_orders_;
+		std::vector<uint32_t> event_buffs_;
+		uint32_t game_loop_ = 0;
+		int32_t economy_[RecordedFrame::EconomyValues] = {};
+		std::vector<uint32_t> upgrades_;
+	};
+}
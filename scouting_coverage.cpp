@@ -0,0 +1,195 @@
+#include "scouting_coverage.h"
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+
+#include "utils.h"
+
+namespace sc2
+{
+	namespace
+	{
+		const int32_t outside = -1;
+
+		// A cell seen more recently than this is not stamped again. Units in sight of the same cells step after step
+		// would otherwise sink those cells down the heap every step, for ages no scout cares about.
+		const uint32_t restamp_loops = 22;
+
+		// Without SSE4.1 floor and ceil are library calls, these are a few instructions.
+		int FloorToInt(float value)
+		{
+			int truncated = static_cast<int>(value);
+			return truncated - (value < truncated);
+		}
+
+		int CeilToInt(float value)
+		{
+			int truncated = static_cast<int>(value);
+			return truncated + (value > truncated);
+		}
+	}
+
+	void ScoutingCoverage::Init(const GridPathfinder& grid, float cell_size)
+	{
+		cell_size_ = cell_size;
+		columns_ = std::max(1, static_cast<int>(ceil(grid.Width() / cell_size)));
+		rows_ = std::max(1, static_cast<int>(ceil(grid.Height() / cell_size)));
+		size_t cells = static_cast<size_t>(columns_) * rows_;
+		last_seen_.assign(cells, 0);
+		heap_position_.assign(cells, outside);
+		heap_.clear();
+
+		for (int y = 0; y < rows_; y++)
+		{
+			for (int x = 0; x < columns_; x++)
+			{
+				int centre_x = static_cast<int>((x + 0.5f) * cell_size_);
+				int centre_y = static_cast<int>((y + 0.5f) * cell_size_);
+				if (grid.IsTerrainPathable(centre_x, centre_y))
+				{
+					heap_.push_back(y * columns_ + x);
+				}
+			}
+		}
+
+		// All keys tie at the start, shuffled so the first scouts do not sweep the map from one corner.
+		// A generator of its own off the game's seed, the bot's draws stay as they were.
+		std::mt19937 generator(randomSeed());
+		std::shuffle(heap_.begin(), heap_.end(), generator);
+		for (size_t i = 0; i < heap_.size(); i++)
+		{
+			heap_position_[heap_[i]] = static_cast<int32_t>(i);
+		}
+	}
+
+	int ScoutingCoverage::CellAt(const Point2D& point) const
+	{
+		int x = std::min(columns_ - 1, std::max(0, static_cast<int>(point.x / cell_size_)));
+		int y = std::min(rows_ - 1, std::max(0, static_cast<int>(point.y / cell_size_)));
+		return y * columns_ + x;
+	}
+
+	void ScoutingCoverage::See(const Point2D& point, float radius, uint32_t game_loop)
+	{
+		if (last_seen_.empty())
+		{
+			return;
+		}
+
+		// The unit's own cell always counts, its centre can be out of reach of a short sight range.
+		Stamp(CellAt(point), game_loop);
+
+		// Row by row, the span of cell centres inside the circle.
+		float radius_squared = radius * radius;
+		float inverse_cell = 1.0f / cell_size_;
+		int min_y = std::max(0, CeilToInt((point.y - radius) * inverse_cell - 0.5f));
+		int max_y = std::min(rows_ - 1, FloorToInt((point.y + radius) * inverse_cell - 0.5f));
+		for (int y = min_y; y <= max_y; y++)
+		{
+			float dy = (y + 0.5f) * cell_size_ - point.y;
+			float half = sqrtf(std::max(0.0f, radius_squared - dy * dy));
+			int min_x = std::max(0, CeilToInt((point.x - half) * inverse_cell - 0.5f));
+			int max_x = std::min(columns_ - 1, FloorToInt((point.x + half) * inverse_cell - 0.5f));
+			for (int x = min_x; x <= max_x; x++)
+			{
+				Stamp(y * columns_ + x, game_loop);
+			}
+		}
+	}
+
+	void ScoutingCoverage::Stamp(int cell, uint32_t game_loop)
+	{
+		if (last_seen_[cell] != 0 && game_loop - last_seen_[cell] < restamp_loops)
+		{
+			return;
+		}
+		last_seen_[cell] = game_loop;
+		if (heap_position_[cell] != outside)
+		{
+			SiftDown(heap_position_[cell]);
+		}
+	}
+
+	Point2D ScoutingCoverage::TakeOldest(uint32_t game_loop)
+	{
+		int cell = heap_.front();
+		Stamp(cell, game_loop);
+		return Point2D(((cell % columns_) + 0.5f) * cell_size_, ((cell / columns_) + 0.5f) * cell_size_);
+	}
+
+	void ScoutingCoverage::Exclude(const Point2D& point)
+	{
+		if (last_seen_.empty())
+		{
+			return;
+		}
+		int cell = CellAt(point);
+		int32_t position = heap_position_[cell];
+		if (position == outside)
+		{
+			return;
+		}
+
+		// The last cell fills the hole and moves whichever way its key says.
+		Swap(position, heap_.size() - 1);
+		heap_.pop_back();
+		heap_position_[cell] = outside;
+		if (static_cast<size_t>(position) < heap_.size())
+		{
+			int32_t moved = heap_[position];
+			SiftUp(position);
+			SiftDown(heap_position_[moved]);
+		}
+	}
+
+	uint32_t ScoutingCoverage::LastSeen(const Point2D& point) const
+	{
+		return last_seen_.empty() ? 0 : last_seen_[CellAt(point)];
+	}
+
+	void ScoutingCoverage::SiftUp(size_t position)
+	{
+		while (position > 0)
+		{
+			size_t parent = (position - 1) / 2;
+			if (last_seen_[heap_[parent]] <= last_seen_[heap_[position]])
+			{
+				break;
+			}
+			Swap(parent, position);
+			position = parent;
+		}
+	}
+
+	void ScoutingCoverage::SiftDown(size_t position)
+	{
+		for (;;)
+		{
+			size_t oldest = position;
+			size_t left = position * 2 + 1;
+			size_t right = left + 1;
+			if (left < heap_.size() && last_seen_[heap_[left]] < last_seen_[heap_[oldest]])
+			{
+				oldest = left;
+			}
+			if (right < heap_.size() && last_seen_[heap_[right]] < last_seen_[heap_[oldest]])
+			{
+				oldest = right;
+			}
+			if (oldest == position)
+			{
+				break;
+			}
+			Swap(oldest, position);
+			position = oldest;
+		}
+	}
+
+	void ScoutingCoverage::Swap(size_t a, size_t b)
+	{
+		std::swap(heap_[a], heap_[b]);
+		heap_position_[heap_[a]] = static_cast<int32_t>(a);
+		heap_position_[heap_[b]] = static_cast<int32_t>(b);
+	}
+}
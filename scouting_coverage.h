@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+#include "grid_pathfinder.h"
+
+namespace sc2
+{
+	// When each part of the map was last in sight of one of our units, on a coarse grid.
+	// Sight circles are filled in cell by cell, a cell seen again within a second is left as it was.
+	// The cells a ground unit could walk to sit in an indexed heap keyed on that loop, oldest on top, so the stalest
+	// place to scout is always at hand. Seeing a cell again only makes it younger, which moves it down the heap
+	// in O(log cells).
+	class ScoutingCoverage
+	{
+	public:
+		// Cells whose centre is pathable terrain go in the heap, all of them unseen.
+		void Init(const GridPathfinder& grid, float cell_size);
+
+		bool Empty() const { return heap_.empty(); }
+
+		// Marks the cells with their centres within radius of point as seen at game_loop.
+		void See(const Point2D& point, float radius, uint32_t game_loop);
+
+		// The centre of the cell seen longest ago, and stamps it as seen at game_loop so the next caller gets another.
+		// If the scout never gets there the cell ages again. The heap must not be empty.
+		Point2D TakeOldest(uint32_t game_loop);
+
+		// Takes the cell holding point out of the heap for good, for targets the terrain keeps every scout from.
+		void Exclude(const Point2D& point);
+
+		uint32_t LastSeen(const Point2D& point) const;
+
+	private:
+		int CellAt(const Point2D& point) const;
+		void Stamp(int cell, uint32_t game_loop);
+		void SiftUp(size_t position);
+		void SiftDown(size_t position);
+		void Swap(size_t a, size_t b);
+
+		int columns_ = 0;
+		int rows_ = 0;
+		float cell_size_ = 1.0f;
+		std::vector<uint32_t> last_seen_;    // Per cell
+		std::vector<int32_t> heap_;          // Cells, the one seen longest ago first
+		std::vector<int32_t> heap_position_; // Per cell, where it is in heap_ or -1
+	};
+}
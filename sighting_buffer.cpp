@@ -0,0 +1,96 @@
+#include "sighting_buffer.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace sc2
+{
+	namespace
+	{
+		const int32_t none = -1;
+	}
+
+	void SightingBuffer::Init(int map_width, int map_height, float cell_size, size_t capacity, uint32_t merge_window_loops)
+	{
+		cell_size_ = cell_size;
+		columns_ = std::max(1, static_cast<int>(ceil(map_width / cell_size)));
+		rows_ = std::max(1, static_cast<int>(ceil(map_height / cell_size)));
+		merge_window_ = merge_window_loops;
+		entries_.assign(std::max<size_t>(1, capacity), Entry());
+		open_.assign(static_cast<size_t>(columns_) * rows_, none);
+		Clear();
+	}
+
+	void SightingBuffer::Clear()
+	{
+		std::fill(open_.begin(), open_.end(), none);
+		head_ = 0;
+		size_ = 0;
+		merged_ = 0;
+		flushed_early_ = 0;
+	}
+
+	void SightingBuffer::Add(const Point2D& point, uint32_t game_loop, SightingHeatmap& heatmap)
+	{
+		if (entries_.empty())
+		{
+			return;
+		}
+
+		int x = std::min(columns_ - 1, std::max(0, static_cast<int>(point.x / cell_size_)));
+		int y = std::min(rows_ - 1, std::max(0, static_cast<int>(point.y / cell_size_)));
+		int32_t cell = y * columns_ + x;
+
+		int32_t open = open_[cell];
+		if (open != none && game_loop - entries_[open].first_loop < merge_window_)
+		{
+			Entry& entry = entries_[open];
+			entry.pos = point;
+			entry.weight += 1.0f;
+			merged_++;
+			return;
+		}
+
+		if (size_ == entries_.size())
+		{
+			const Entry& oldest = entries_[head_];
+			heatmap.Add(oldest.pos, game_loop, oldest.weight);
+			PopFront();
+			flushed_early_++;
+		}
+		size_t index = (head_ + size_) % entries_.size();
+		Entry& entry = entries_[index];
+		entry.pos = point;
+		entry.first_loop = game_loop;
+		entry.weight = 1.0f;
+		entry.cell = cell;
+		open_[cell] = static_cast<int32_t>(index);
+		size_++;
+	}
+
+	void SightingBuffer::FlushInto(SightingHeatmap& heatmap, uint32_t game_loop, bool flush_all)
+	{
+		// Entries are in the order they were opened, so the closed ones are all at the front.
+		while (size_ > 0)
+		{
+			const Entry& entry = entries_[head_];
+			if (!flush_all && game_loop - entry.first_loop < merge_window_)
+			{
+				break;
+			}
+			heatmap.Add(entry.pos, game_loop, entry.weight);
+			PopFront();
+		}
+	}
+
+	void SightingBuffer::PopFront()
+	{
+		const Entry& entry = entries_[head_];
+		if (open_[entry.cell] == static_cast<int32_t>(head_))
+		{
+			open_[entry.cell] = none;
+		}
+		head_ = (head_ + 1) % entries_.size();
+		size_--;
+	}
+}
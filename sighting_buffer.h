@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+#include "sighting_heatmap.h"
+
+namespace sc2
+{
+	// Enemy sightings waiting to go into the heatmap, in a ring of fixed capacity.
+	// Sightings in the same cell within the merge window become one entry weighted by their count, so a mass of units
+	// moving in and out of vision costs one entry per cell rather than one per event. A per-cell index finds the open
+	// entry in O(1). When the ring is full the oldest entry goes into the heatmap early, so no sighting is lost and
+	// memory never grows past what Init sized.
+	class SightingBuffer
+	{
+	public:
+		void Init(int map_width, int map_height, float cell_size, size_t capacity, uint32_t merge_window_loops);
+
+		void Clear();
+
+		// A sighting at point, as of game_loop. Loops must not go backwards. With the ring full, the oldest entry is
+		// flushed into the heatmap to make room.
+		void Add(const Point2D& point, uint32_t game_loop, SightingHeatmap& heatmap);
+
+		// Moves the entries whose merge window has closed by game_loop into the heatmap, all of them if flush_all.
+		void FlushInto(SightingHeatmap& heatmap, uint32_t game_loop, bool flush_all = false);
+
+		size_t Size() const { return size_; }
+		size_t Merged() const { return merged_; }
+		size_t FlushedEarly() const { return flushed_early_; }
+
+	private:
+		struct Entry
+		{
+			Point2D pos;          // Latest sighting merged in
+			uint32_t first_loop;
+			float weight;
+			int32_t cell;
+		};
+
+		void PopFront();
+
+		int columns_ = 0;
+		int rows_ = 0;
+		float cell_size_ = 1.0f;
+		uint32_t merge_window_ = 0;
+
+		std::vector<Entry> entries_;  // Ring, oldest at head_
+		size_t head_ = 0;
+		size_t size_ = 0;
+		std::vector<int32_t> open_;   // Per cell, the entry still taking merges, or -1
+		size_t merged_ = 0;
+		size_t flushed_early_ = 0;    // Entries flushed to make room, before their window closed
+	};
+}
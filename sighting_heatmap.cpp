@@ -0,0 +1,119 @@
+#include "sighting_heatmap.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace sc2
+{
+	namespace
+	{
+		// Stored weights are rebased before a fresh sighting would weigh more than this.
+		const double max_scale = 1e30;
+	}
+
+	void SightingHeatmap::Init(int map_width, int map_height, float cell_size, uint32_t half_life_loops)
+	{
+		cell_size_ = cell_size;
+		columns_ = std::max(1, static_cast<int>(ceil(map_width / cell_size)));
+		rows_ = std::max(1, static_cast<int>(ceil(map_height / cell_size)));
+		decay_per_loop_ = log(2.0) / std::max<uint32_t>(1, half_life_loops);
+		Clear();
+	}
+
+	void SightingHeatmap::Clear()
+	{
+		size_t cells = static_cast<size_t>(columns_) * rows_;
+		weights_.assign(cells, 0.0);
+		tree_.assign(cells + 1, 0.0);
+		last_seen_.assign(cells, Point2D());
+		tree_total_ = 0.0;
+		base_loop_ = 0;
+		tree_top_ = 1;
+		while (tree_top_ * 2 <= cells)
+		{
+			tree_top_ *= 2;
+		}
+	}
+
+	void SightingHeatmap::Add(const Point2D& point, uint32_t game_loop, double weight)
+	{
+		if (weights_.empty())
+		{
+			return;
+		}
+
+		double scale = exp(decay_per_loop_ * (game_loop > base_loop_ ? game_loop - base_loop_ : 0));
+		if (scale > max_scale)
+		{
+			Rebase(game_loop);
+			scale = 1.0;
+		}
+		scale *= weight;
+
+		int x = std::min(columns_ - 1, std::max(0, static_cast<int>(point.x / cell_size_)));
+		int y = std::min(rows_ - 1, std::max(0, static_cast<int>(point.y / cell_size_)));
+		size_t cell = static_cast<size_t>(y) * columns_ + x;
+		weights_[cell] += scale;
+		AddToTree(cell, scale);
+		last_seen_[cell] = point;
+	}
+
+	void SightingHeatmap::AddToTree(size_t cell, double weight)
+	{
+		for (size_t i = cell + 1; i < tree_.size(); i += i & (~i + 1))
+		{
+			tree_[i] += weight;
+		}
+		tree_total_ += weight;
+	}
+
+	void SightingHeatmap::Rebase(uint32_t game_loop)
+	{
+		// Every weight fades by the same factor, the tree is rebuilt from them in one pass.
+		double fade = exp(-decay_per_loop_ * (game_loop > base_loop_ ? game_loop - base_loop_ : 0));
+		base_loop_ = game_loop;
+		tree_total_ = 0.0;
+		std::fill(tree_.begin(), tree_.end(), 0.0);
+		for (size_t cell = 0; cell < weights_.size(); cell++)
+		{
+			weights_[cell] *= fade;
+			tree_total_ += weights_[cell];
+			size_t i = cell + 1;
+			tree_[i] += weights_[cell];
+			size_t parent = i + (i & (~i + 1));
+			if (parent < tree_.size())
+			{
+				tree_[parent] += tree_[i];
+			}
+		}
+	}
+
+	double SightingHeatmap::Weight(uint32_t game_loop) const
+	{
+		return tree_total_ * exp(-decay_per_loop_ * (game_loop > base_loop_ ? game_loop - base_loop_ : 0));
+	}
+
+	Point2D SightingHeatmap::Sample(float fraction) const
+	{
+		// Descends the tree to the cell where the running sum passes fraction of the total.
+		double target = fraction * tree_total_;
+		size_t position = 0;
+		for (size_t step = tree_top_; step > 0; step /= 2)
+		{
+			size_t next = position + step;
+			if (next < tree_.size() && tree_[next] <= target)
+			{
+				position = next;
+				target -= tree_[next];
+			}
+		}
+
+		// A fraction of 1, or rounding in the sums, can land past the last cell with weight.
+		size_t cell = std::min(position, weights_.size() - 1);
+		while (cell > 0 && weights_[cell] <= 0.0)
+		{
+			cell--;
+		}
+		return last_seen_[cell];
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Where enemies have been seen, as a coarse grid of weights that fade with a fixed half-life.
+	// Decay is never applied cell by cell: a sighting is added with its weight grown by the time since a base loop,
+	// which keeps every cell in proportion, and weights are rebased now and then before they outgrow a double.
+	// A Fenwick tree over the cells draws a cell in proportion to its weight in O(log cells) without changing anything,
+	// and each cell remembers the last sighting in it to hand out as the target.
+	class SightingHeatmap
+	{
+	public:
+		void Init(int map_width, int map_height, float cell_size, uint32_t half_life_loops);
+
+		void Clear();
+
+		// A sighting at point, as of game_loop. Loops must not go backwards.
+		void Add(const Point2D& point, uint32_t game_loop, double weight = 1.0);
+
+		// Sum of the faded weights as of game_loop, a lone sighting counts 1 when fresh and 0.5 one half-life later.
+		double Weight(uint32_t game_loop) const;
+
+		// The last sighting in a cell drawn in proportion to the cells' weights, fraction picks where in [0, 1].
+		// The heatmap must not be empty.
+		Point2D Sample(float fraction) const;
+
+		bool Empty() const { return weights_.empty() || tree_total_ <= 0.0; }
+
+	private:
+		void Rebase(uint32_t game_loop);
+		void AddToTree(size_t cell, double weight);
+
+		int columns_ = 0;
+		int rows_ = 0;
+		float cell_size_ = 1.0f;
+		double decay_per_loop_ = 0.0; // ln 2 / half-life
+
+		uint32_t base_loop_ = 0;           // Stored weights are as of this loop, scaled up for later sightings
+		std::vector<double> weights_;      // Per cell
+		std::vector<double> tree_;         // Fenwick tree of weights_, 1-based
+		double tree_total_ = 0.0;
+		std::vector<Point2D> last_seen_;   // Per cell
+		size_t tree_top_ = 0;              // Highest power of two not above the cell count, for the descent
+	};
+}
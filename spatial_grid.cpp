@@ -0,0 +1,117 @@
+#include "spatial_grid.h"
+
+#include <math.h>
+
+namespace sc2
+{
+	SpatialGrid::SpatialGrid(float cell_size) :
+		cell_size_(cell_size),
+		inverse_cell_size_(1.0f / cell_size)
+	{
+	}
+
+	void SpatialGrid::Build(const Units& units)
+	{
+		// Keep the bucket table a power of two with roughly one bucket per unit.
+		size_t bucket_count = 16;
+		while (bucket_count < units.size())
+		{
+			bucket_count *= 2;
+		}
+		bucket_start_.assign(bucket_count + 1, 0);
+
+		scratch_.clear();
+		for (const Unit* unit : units)
+		{
+			Entry entry;
+			entry.unit = unit;
+			entry.pos = unit->pos;
+			entry.cell_x = CellOf(unit->pos.x);
+			entry.cell_y = CellOf(unit->pos.y);
+			entry.is_flying = unit->is_flying;
+			scratch_.push_back(entry);
+
+			bucket_start_[BucketOf(entry.cell_x, entry.cell_y) + 1]++;
+		}
+
+		for (size_t i = 1; i <= bucket_count; i++)
+		{
+			bucket_start_[i] += bucket_start_[i - 1];
+		}
+
+		entries_.resize(scratch_.size());
+		std::vector<size_t>& next = bucket_start_;
+		for (const Entry& entry : scratch_)
+		{
+			entries_[next[BucketOf(entry.cell_x, entry.cell_y)]++] = entry;
+		}
+
+		// The scatter above advanced every start to the following bucket's start, shift them back.
+		for (size_t i = bucket_count; i > 0; i--)
+		{
+			bucket_start_[i] = bucket_start_[i - 1];
+		}
+		bucket_start_[0] = 0;
+	}
+
+	size_t SpatialGrid::CountInRadius(const Point2D& point, float radius, Layer layer, size_t limit) const
+	{
+		size_t count = 0;
+		if (entries_.empty() || limit == 0)
+		{
+			return count;
+		}
+
+		float radius_squared = radius * radius;
+		int min_x = CellOf(point.x - radius);
+		int max_x = CellOf(point.x + radius);
+		int min_y = CellOf(point.y - radius);
+		int max_y = CellOf(point.y + radius);
+
+		for (int cell_x = min_x; cell_x <= max_x; cell_x++)
+		{
+			for (int cell_y = min_y; cell_y <= max_y; cell_y++)
+			{
+				size_t bucket = BucketOf(cell_x, cell_y);
+				for (size_t i = bucket_start_[bucket]; i < bucket_start_[bucket + 1]; i++)
+				{
+					const Entry& entry = entries_[i];
+
+					// Other cells can hash into the same bucket, only count each unit from its own cell.
+					if (entry.cell_x != cell_x || entry.cell_y != cell_y)
+					{
+						continue;
+					}
+					if ((layer == Layer::Air && !entry.is_flying) || (layer == Layer::Ground && entry.is_flying))
+					{
+						continue;
+					}
+					if (DistanceSquared2D(entry.pos, point) < radius_squared)
+					{
+						if (++count >= limit)
+						{
+							return count;
+						}
+					}
+				}
+			}
+		}
+		return count;
+	}
+
+	bool SpatialGrid::AnyInRadius(const Point2D& point, float radius, Layer layer) const
+	{
+		return CountInRadius(point, radius, layer, 1) > 0;
+	}
+
+	int SpatialGrid::CellOf(float coordinate) const
+	{
+		return static_cast<int>(floor(coordinate * inverse_cell_size_));
+	}
+
+	size_t SpatialGrid::BucketOf(int cell_x, int cell_y) const
+	{
+		size_t hash = static_cast<size_t>(static_cast<unsigned>(cell_x) * 73856093u ^ static_cast<unsigned>(cell_y) * 19349663u);
+		return hash & (bucket_start_.size() - 2);
+	}
+}
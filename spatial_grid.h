@@ -0,0 +1,50 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Uniform-grid spatial hash over a set of units, used for "what is near this point" checks.
+	// Units are counting-sorted into hashed cell buckets so a rebuild does not allocate once warmed up.
+	class SpatialGrid
+	{
+	public:
+		enum class Layer { Any, Ground, Air };
+
+		explicit SpatialGrid(float cell_size = 8.0f);
+
+		void Build(const Units& units);
+
+		// Number of units strictly within radius of point, stops counting at limit.
+		size_t CountInRadius(const Point2D& point, float radius, Layer layer = Layer::Any,
+			size_t limit = std::numeric_limits<size_t>::max()) const;
+
+		bool AnyInRadius(const Point2D& point, float radius, Layer layer = Layer::Any) const;
+
+		size_t Size() const { return entries_.size(); }
+
+	private:
+		struct Entry
+		{
+			const Unit* unit;
+			Point2D pos;
+			int cell_x;
+			int cell_y;
+			bool is_flying;
+		};
+
+		int CellOf(float coordinate) const;
+		size_t BucketOf(int cell_x, int cell_y) const;
+
+		float cell_size_;
+		float inverse_cell_size_;
+
+		// bucket_start_[b] .. bucket_start_[b + 1] are the entries hashed to bucket b.
+		std::vector<size_t> bucket_start_;
+		std::vector<Entry> entries_;
+		std::vector<Entry> scratch_;
+	};
+}
@@ -0,0 +1,113 @@
+#include "task_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace sc2
+{
+	TaskScheduler::TaskScheduler(double frame_budget_ms) :
+		frame_budget_ms_(frame_budget_ms)
+	{
+	}
+
+	size_t TaskScheduler::Add(const std::string& name, std::function<void()> task, size_t period, int priority, double budget_ms)
+	{
+		Task entry;
+		entry.run = std::move(task);
+		entry.period = std::max<size_t>(period, 1);
+		entry.priority = priority;
+		entry.budget_ms = budget_ms;
+		// Offset each task's first run by its index so tasks sharing a period start on different steps.
+		entry.next_due = entry.period + tasks_.size() % entry.period;
+		entry.stats.name = name;
+		if (tracer_ != nullptr)
+		{
+			entry.trace_name = tracer_->Name(name);
+		}
+
+		tasks_.push_back(std::move(entry));
+		return tasks_.size() - 1;
+	}
+
+	void TaskScheduler::SetTracer(TraceWriter* tracer)
+	{
+		tracer_ = tracer;
+		for (Task& task : tasks_)
+		{
+			task.trace_name = tracer_ != nullptr ? tracer_->Name(task.stats.name) : 0;
+		}
+	}
+
+	double TaskScheduler::Step(size_t step)
+	{
+		due_.clear();
+		for (size_t i = 0; i < tasks_.size(); i++)
+		{
+			if (tasks_[i].next_due <= step)
+			{
+				due_.push_back(i);
+			}
+		}
+
+		if (due_.empty())
+		{
+			return 0.0;
+		}
+
+		// Highest priority first, then whichever has been waiting longest.
+		std::sort(due_.begin(), due_.end(), [this](size_t a, size_t b) {
+			if (tasks_[a].priority != tasks_[b].priority)
+			{
+				return tasks_[a].priority > tasks_[b].priority;
+			}
+			return tasks_[a].next_due < tasks_[b].next_due;
+		});
+
+		double spent_ms = 0.0;
+		bool ran_any = false;
+		for (size_t index : due_)
+		{
+			Task& task = tasks_[index];
+
+			// A task that has slipped a whole period runs regardless, so low priorities cannot starve.
+			bool starved = step - task.next_due >= task.period;
+			if (ran_any && !starved && spent_ms + task.stats.average_ms > frame_budget_ms_)
+			{
+				// Leave next_due alone so it stays due and moves up the queue next step.
+				task.stats.deferrals++;
+				continue;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			task.run();
+			auto end = std::chrono::steady_clock::now();
+			auto elapsed = end - start;
+			if (tracer_ != nullptr && tracer_->Enabled())
+			{
+				tracer_->Complete(task.trace_name, TraceWriter::Category::Manager, start, end);
+			}
+			double elapsed_ms = std::chrono::duration<double, std::milli>(elapsed).count();
+
+			TaskStats& stats = task.stats;
+			stats.latency[phase_].Record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+			stats.average_ms = stats.runs == 0 ? elapsed_ms : stats.average_ms * 0.8 + elapsed_ms * 0.2;
+			stats.runs++;
+			stats.last_ms = elapsed_ms;
+			stats.max_ms = std::max(stats.max_ms, elapsed_ms);
+			if (elapsed_ms > task.budget_ms)
+			{
+				stats.overruns++;
+			}
+
+			task.next_due = step + task.period;
+			spent_ms += elapsed_ms;
+			ran_any = true;
+		}
+
+		if (spent_ms > frame_budget_ms_)
+		{
+			frame_overruns_++;
+		}
+		return spent_ms;
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "latency_histogram.h"
+#include "trace_writer.h"
+
+namespace sc2
+{
+	// Runs periodic tasks (the Bot managers) while keeping each step under a time budget.
+	// Every task is measured with a steady clock; when the due tasks would blow the frame budget the
+	// lower priority ones slip to a later step, which also spreads out tasks whose periods line up.
+	class TaskScheduler
+	{
+	public:
+		static const size_t max_phases = 4;
+
+		struct TaskStats
+		{
+			std::string name;
+			size_t runs = 0;
+			size_t overruns = 0;  // Runs that took longer than the task's own budget
+			size_t deferrals = 0; // Steps the task was due but slipped to stay inside the frame budget
+			double last_ms = 0.0;
+			double average_ms = 0.0; // Exponential moving average, used to predict the next run
+			double max_ms = 0.0;
+			LatencyHistogram latency[max_phases]; // Every run, by the phase it ran in
+		};
+
+		explicit TaskScheduler(double frame_budget_ms = 10.0);
+
+		// Registers a task to run every period steps, higher priority runs first when steps are crowded.
+		// budget_ms is what a single run is expected to stay under. Returns the task id.
+		size_t Add(const std::string& name, std::function<void()> task, size_t period, int priority, double budget_ms);
+
+		void SetFrameBudget(double frame_budget_ms) { frame_budget_ms_ = frame_budget_ms; }
+
+		// Each run is also recorded as a span in tracer while it is enabled.
+		void SetTracer(TraceWriter* tracer);
+
+		// Runs from now on are recorded under this phase (below max_phases), e.g. early/mid/late game.
+		void SetPhase(size_t phase) { phase_ = phase < max_phases ? phase : max_phases - 1; }
+
+		// Runs the tasks due at step, returns the time spent in milliseconds.
+		double Step(size_t step);
+
+		size_t Size() const { return tasks_.size(); }
+		const TaskStats& Stats(size_t task) const { return tasks_[task].stats; }
+		size_t FrameOverruns() const { return frame_overruns_; }
+
+	private:
+		struct Task
+		{
+			std::function<void()> run;
+			size_t period;
+			int priority;
+			double budget_ms;
+			size_t next_due;
+			uint32_t trace_name = 0;
+			TaskStats stats;
+		};
+
+		std::vector<Task> tasks_;
+		std::vector<size_t> due_;
+		double frame_budget_ms_;
+		size_t frame_overruns_ = 0;
+		size_t phase_ = 0;
+		TraceWriter* tracer_ = nullptr;
+	};
+}
@@ -0,0 +1,199 @@
+#include "trace_writer.h"
+
+#include <cstdio>
+
+namespace sc2
+{
+	namespace
+	{
+		const char* category_names[] = { "step", "manager", "event", "query" };
+	}
+
+	TraceWriter::TraceWriter()
+	{
+	}
+
+	TraceWriter::~TraceWriter()
+	{
+		Close();
+	}
+
+	bool TraceWriter::Open(const std::string& path, size_t buffer_events)
+	{
+		Close();
+
+		file_.open(path, std::ios::out | std::ios::trunc);
+		if (!file_)
+		{
+			return false;
+		}
+		file_ << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		first_span_ = true;
+
+		capacity_ = buffer_events > 0 ? buffer_events : 1;
+		active_.clear();
+		active_.reserve(capacity_);
+		spare_.clear();
+		spare_.reserve(capacity_);
+		has_spare_ = true;
+		has_full_ = false;
+		stopping_ = false;
+		dropped_ = 0;
+
+		epoch_ = Clock::now();
+		enabled_ = true;
+		writer_ = std::thread(&TraceWriter::WriterLoop, this);
+		return true;
+	}
+
+	void TraceWriter::Close()
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		enabled_ = false;
+
+		// Hand over what is left, waiting for the writer this once since the game is over.
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this] { return !has_full_; });
+			full_.swap(active_);
+			has_full_ = true;
+			stopping_ = true;
+		}
+		wake_.notify_all();
+		writer_.join();
+
+		file_ << "\n]}\n";
+		file_.close();
+		active_.clear();
+	}
+
+	uint32_t TraceWriter::Name(const char* literal)
+	{
+		auto found = literal_names_.find(literal);
+		if (found != literal_names_.end())
+		{
+			return found->second;
+		}
+		uint32_t id = Name(std::string(literal));
+		literal_names_[literal] = id;
+		return id;
+	}
+
+	uint32_t TraceWriter::Name(const std::string& name)
+	{
+		auto found = string_names_.find(name);
+		if (found != string_names_.end())
+		{
+			return found->second;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		uint32_t id = static_cast<uint32_t>(names_.size());
+		names_.push_back(name);
+		string_names_[name] = id;
+		return id;
+	}
+
+	void TraceWriter::SetContext(uint32_t game_loop, uint32_t own_units, uint32_t enemy_units)
+	{
+		game_loop_ = game_loop;
+		own_units_ = own_units;
+		enemy_units_ = enemy_units;
+	}
+
+	void TraceWriter::Complete(uint32_t name, Category category, Clock::time_point start, Clock::time_point end)
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		if (active_.size() >= capacity_)
+		{
+			SwapBuffers();
+			if (active_.size() >= capacity_)
+			{
+				dropped_++;
+				return;
+			}
+		}
+
+		Span span;
+		span.name = name;
+		span.game_loop = game_loop_;
+		span.own_units = own_units_;
+		span.enemy_units = enemy_units_;
+		span.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch_).count();
+		span.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		span.category = category;
+		active_.push_back(span);
+	}
+
+	void TraceWriter::SwapBuffers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (has_full_ || !has_spare_)
+			{
+				// Writer still busy with the last buffer, the caller drops this span.
+				return;
+			}
+			full_.swap(active_);
+			active_.swap(spare_);
+			has_full_ = true;
+			has_spare_ = false;
+		}
+		wake_.notify_all();
+	}
+
+	void TraceWriter::WriterLoop()
+	{
+		std::vector<Span> spans;
+		std::vector<std::string> names;
+		for (;;)
+		{
+			bool stopping;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wake_.wait(lock, [this] { return has_full_ || stopping_; });
+				spans.swap(full_);
+				has_full_ = false;
+				stopping = stopping_;
+				// Names are only ever appended, copy the new ones.
+				names.insert(names.end(), names_.begin() + names.size(), names_.end());
+			}
+			wake_.notify_all();
+
+			WriteSpans(spans, names);
+			spans.clear();
+
+			if (stopping)
+			{
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			spare_.swap(spans);
+			has_spare_ = true;
+		}
+	}
+
+	void TraceWriter::WriteSpans(const std::vector<Span>& spans, std::vector<std::string>& names)
+	{
+		char line[512];
+		for (const Span& span : spans)
+		{
+			const char* name = span.name < names.size() ? names[span.name].c_str() : "";
+			snprintf(line, sizeof(line),
+				"%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+				"\"args\":{\"game_loop\":%u,\"own_units\":%u,\"enemy_units\":%u}}",
+				first_span_ ? "" : ",\n", name, category_names[static_cast<size_t>(span.category)],
+				span.start_ns / 1000.0, span.duration_ns / 1000.0, span.game_loop, span.own_units, span.enemy_units);
+			file_ << line;
+			first_span_ = false;
+		}
+		file_.flush();
+	}
+}
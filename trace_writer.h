@@ -0,0 +1,123 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sc2
+{
+	// Opt-in writer of Chrome/Perfetto trace-event JSON (load it in chrome://tracing or ui.perfetto.dev).
+	// Spans are stored as fixed-size records in an in-memory buffer; a full buffer is swapped for a spare
+	// and formatted and written by a background thread, so recording a span is a couple of stores.
+	// If the writer falls a whole buffer behind, new spans are dropped (and counted) rather than waited on.
+	class TraceWriter
+	{
+	public:
+		enum class Category : uint8_t { Step, Manager, Event, Query };
+
+		typedef std::chrono::steady_clock Clock;
+
+		TraceWriter();
+		~TraceWriter();
+
+		// Starts tracing to path, returns false if the file cannot be opened.
+		bool Open(const std::string& path, size_t buffer_events = 1 << 14);
+
+		// Writes what is buffered, finishes the JSON and stops the writer thread.
+		void Close();
+
+		bool Enabled() const { return enabled_; }
+
+		// Id for a span name. The const char* overload caches by pointer, meant for string literals.
+		uint32_t Name(const char* literal);
+		uint32_t Name(const std::string& name);
+
+		// Game state every span recorded from now on is tagged with.
+		void SetContext(uint32_t game_loop, uint32_t own_units, uint32_t enemy_units);
+
+		void Complete(uint32_t name, Category category, Clock::time_point start, Clock::time_point end);
+
+		size_t Dropped() const { return dropped_; }
+
+	private:
+		struct Span
+		{
+			uint32_t name;
+			uint32_t game_loop;
+			uint32_t own_units;
+			uint32_t enemy_units;
+			int64_t start_ns; // Since Open
+			int64_t duration_ns;
+			Category category;
+		};
+
+		void SwapBuffers();
+		void WriterLoop();
+		void WriteSpans(const std::vector<Span>& spans, std::vector<std::string>& names);
+
+		bool enabled_ = false;
+		Clock::time_point epoch_;
+		uint32_t game_loop_ = 0;
+		uint32_t own_units_ = 0;
+		uint32_t enemy_units_ = 0;
+		size_t dropped_ = 0;
+
+		// Only touched by the bot's thread
+		std::vector<Span> active_;
+		size_t capacity_ = 0;
+		std::unordered_map<const char*, uint32_t> literal_names_;
+		std::unordered_map<std::string, uint32_t> string_names_;
+
+		// Shared with the writer thread, guarded by mutex_
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::vector<std::string> names_;
+		std::vector<Span> full_;  // Waiting to be written
+		std::vector<Span> spare_; // Written and ready for reuse
+		bool has_full_ = false;
+		bool has_spare_ = false;
+		bool stopping_ = false;
+
+		// Only touched by the writer thread
+		std::ofstream file_;
+		bool first_span_ = true;
+		std::thread writer_;
+	};
+
+	// Records a span from construction to destruction, costs nothing while the writer is disabled.
+	class TraceSpan
+	{
+	public:
+		TraceSpan(TraceWriter& writer, const char* name, TraceWriter::Category category) :
+			writer_(writer), enabled_(writer.Enabled())
+		{
+			if (enabled_)
+			{
+				name_ = writer.Name(name);
+				category_ = category;
+				start_ = TraceWriter::Clock::now();
+			}
+		}
+
+		~TraceSpan()
+		{
+			if (enabled_)
+			{
+				writer_.Complete(name_, category_, start_, TraceWriter::Clock::now());
+			}
+		}
+
+	private:
+		TraceWriter& writer_;
+		bool enabled_;
+		uint32_t name_ = 0;
+		TraceWriter::Category category_ = TraceWriter::Category::Step;
+		TraceWriter::Clock::time_point start_;
+	};
+}
@@ -0,0 +1,51 @@
+#include "traced_query.h"
+
+namespace sc2
+{
+	TracedQuery::TracedQuery(QueryInterface* query, TraceWriter& tracer) :
+		query_(query), tracer_(tracer)
+	{
+	}
+
+	AvailableAbilities TracedQuery::GetAbilitiesForUnit(const Unit* unit, bool ignore_resource_requirements)
+	{
+		TraceSpan span(tracer_, "Query::GetAbilitiesForUnit", TraceWriter::Category::Query);
+		return query_->GetAbilitiesForUnit(unit, ignore_resource_requirements);
+	}
+
+	std::vector<AvailableAbilities> TracedQuery::GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements)
+	{
+		TraceSpan span(tracer_, "Query::GetAbilitiesForUnits", TraceWriter::Category::Query);
+		return query_->GetAbilitiesForUnits(units, ignore_resource_requirements);
+	}
+
+	float TracedQuery::PathingDistance(const Point2D& start, const Point2D& end)
+	{
+		TraceSpan span(tracer_, "Query::PathingDistance", TraceWriter::Category::Query);
+		return query_->PathingDistance(start, end);
+	}
+
+	float TracedQuery::PathingDistance(const Unit* start, const Point2D& end)
+	{
+		TraceSpan span(tracer_, "Query::PathingDistance", TraceWriter::Category::Query);
+		return query_->PathingDistance(start, end);
+	}
+
+	std::vector<float> TracedQuery::PathingDistance(const std::vector<PathingQuery>& queries)
+	{
+		TraceSpan span(tracer_, "Query::PathingDistance (batch)", TraceWriter::Category::Query);
+		return query_->PathingDistance(queries);
+	}
+
+	bool TracedQuery::Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* unit)
+	{
+		TraceSpan span(tracer_, "Query::Placement", TraceWriter::Category::Query);
+		return query_->Placement(ability, target_pos, unit);
+	}
+
+	std::vector<bool> TracedQuery::Placement(const std::vector<PlacementQuery>& queries)
+	{
+		TraceSpan span(tracer_, "Query::Placement (batch)", TraceWriter::Category::Query);
+		return query_->Placement(queries);
+	}
+}
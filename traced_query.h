@@ -0,0 +1,28 @@
+#pragma once
+
+#include "sc2api/sc2_api.h"
+
+#include "trace_writer.h"
+
+namespace sc2
+{
+	// Forwards every call to another QueryInterface inside a trace span.
+	// Each call is a synchronous round trip to the game, so these tend to be the widest spans in a step.
+	class TracedQuery : public QueryInterface
+	{
+	public:
+		TracedQuery(QueryInterface* query, TraceWriter& tracer);
+
+		AvailableAbilities GetAbilitiesForUnit(const Unit* unit, bool ignore_resource_requirements = false) override;
+		std::vector<AvailableAbilities> GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements = false) override;
+		float PathingDistance(const Point2D& start, const Point2D& end) override;
+		float PathingDistance(const Unit* start, const Point2D& end) override;
+		std::vector<float> PathingDistance(const std::vector<PathingQuery>& queries) override;
+		bool Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* unit = nullptr) override;
+		std::vector<bool> Placement(const std::vector<PlacementQuery>& queries) override;
+
+	private:
+		QueryInterface* query_;
+		TraceWriter& tracer_;
+	};
+}
@@ -0,0 +1,195 @@
+#include "unit_counter.h"
+
+namespace sc2
+{
+	static uint64_t ProductionKey(uint32_t production_building, uint32_t ability)
+	{
+		return (static_cast<uint64_t>(production_building) << 32) | ability;
+	}
+
+	void UnitCounter::OnUnitCreated(const Unit* unit)
+	{
+		if (tracked_.count(unit->tag))
+		{
+			OnUnitChanged(unit);
+			return;
+		}
+
+		bool under_construction = unit->build_progress < 1.0f;
+		tracked_[unit->tag] = { static_cast<uint32_t>(unit->unit_type), under_construction, verify_stamp_ };
+		Add(unit->unit_type, under_construction);
+	}
+
+	void UnitCounter::OnBuildingConstructionComplete(const Unit* unit)
+	{
+		auto found = tracked_.find(unit->tag);
+		if (found == tracked_.end())
+		{
+			OnUnitCreated(unit);
+			return;
+		}
+
+		Tracked& tracked = found->second;
+		Subtract(tracked.unit_type, tracked.under_construction);
+		tracked.unit_type = unit->unit_type;
+		tracked.under_construction = false;
+		Add(tracked.unit_type, false);
+	}
+
+	void UnitCounter::OnUnitDestroyed(const Unit* unit)
+	{
+		auto found = tracked_.find(unit->tag);
+		if (found == tracked_.end())
+		{
+			return;
+		}
+
+		Subtract(found->second.unit_type, found->second.under_construction);
+		tracked_.erase(found);
+	}
+
+	void UnitCounter::OnUnitChanged(const Unit* unit)
+	{
+		auto found = tracked_.find(unit->tag);
+		if (found == tracked_.end())
+		{
+			OnUnitCreated(unit);
+			return;
+		}
+
+		Tracked& tracked = found->second;
+		uint32_t unit_type = unit->unit_type;
+		bool under_construction = unit->build_progress < 1.0f;
+		if (tracked.unit_type == unit_type && tracked.under_construction == under_construction)
+		{
+			return;
+		}
+
+		Subtract(tracked.unit_type, tracked.under_construction);
+		tracked.unit_type = unit_type;
+		tracked.under_construction = under_construction;
+		Add(unit_type, under_construction);
+	}
+
+	size_t UnitCounter::Alive(UNIT_TYPEID unit_type) const
+	{
+		const Counts* counts = Find(static_cast<uint32_t>(unit_type));
+		return counts ? counts->alive : 0;
+	}
+
+	size_t UnitCounter::UnderConstruction(UNIT_TYPEID unit_type) const
+	{
+		const Counts* counts = Find(static_cast<uint32_t>(unit_type));
+		return counts ? counts->under_construction : 0;
+	}
+
+	size_t UnitCounter::InProduction(UNIT_TYPEID production_building, ABILITY_ID ability) const
+	{
+		auto found = in_production_.find(ProductionKey(static_cast<uint32_t>(production_building), static_cast<uint32_t>(ability)));
+		return found == in_production_.end() ? 0 : found->second;
+	}
+
+	void UnitCounter::UpdateProduction(const ObservationInterface* observation)
+	{
+		uint32_t game_loop = observation->GetGameLoop();
+		if (production_counted_ && game_loop == production_loop_)
+		{
+			return;
+		}
+		production_loop_ = game_loop;
+		production_counted_ = true;
+
+		for (auto& entry : in_production_)
+		{
+			entry.second = 0;
+		}
+
+		for (const Unit* unit : observation->GetUnits(Unit::Alliance::Self))
+		{
+			for (const auto& order : unit->orders)
+			{
+				in_production_[ProductionKey(unit->unit_type, order.ability_id)]++;
+			}
+		}
+	}
+
+	size_t UnitCounter::Verify(const ObservationInterface* observation)
+	{
+		size_t drift = 0;
+		verify_stamp_++;
+
+		for (const Unit* unit : observation->GetUnits(Unit::Alliance::Self))
+		{
+			auto found = tracked_.find(unit->tag);
+			if (found == tracked_.end())
+			{
+				drift++;
+				OnUnitCreated(unit);
+				continue;
+			}
+
+			Tracked& tracked = found->second;
+			if (tracked.unit_type != static_cast<uint32_t>(unit->unit_type) || tracked.under_construction != (unit->build_progress < 1.0f))
+			{
+				drift++;
+				OnUnitChanged(unit);
+			}
+			tracked.verify_stamp = verify_stamp_;
+		}
+
+		// Units not in the scan may only be hidden (ie SCVs inside a refinery), drop those that are really gone.
+		for (auto it = tracked_.begin(); it != tracked_.end();)
+		{
+			if (it->second.verify_stamp != verify_stamp_)
+			{
+				const Unit* unit = observation->GetUnit(it->first);
+				if (unit == nullptr || !unit->is_alive)
+				{
+					drift++;
+					Subtract(it->second.unit_type, it->second.under_construction);
+					it = tracked_.erase(it);
+					continue;
+				}
+			}
+			++it;
+		}
+
+		return drift;
+	}
+
+	void UnitCounter::Add(uint32_t unit_type, bool under_construction)
+	{
+		if (unit_type >= counts_.size())
+		{
+			counts_.resize(unit_type + 1);
+		}
+
+		if (under_construction)
+		{
+			counts_[unit_type].under_construction++;
+		}
+		else
+		{
+			counts_[unit_type].alive++;
+		}
+	}
+
+	void UnitCounter::Subtract(uint32_t unit_type, bool under_construction)
+	{
+		if (unit_type >= counts_.size())
+		{
+			return;
+		}
+
+		size_t& count = under_construction ? counts_[unit_type].under_construction : counts_[unit_type].alive;
+		if (count > 0)
+		{
+			count--;
+		}
+	}
+
+	const UnitCounter::Counts* UnitCounter::Find(uint32_t unit_type) const
+	{
+		return unit_type < counts_.size() ? &counts_[unit_type] : nullptr;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Per-type counts of our own units, kept current from unit lifecycle events instead of rescanning.
+	// Tracks units alive, structures under construction and units in production (from producer orders).
+	class UnitCounter
+	{
+	public:
+		// Lifecycle events, all idempotent so duplicate or late events do not double count.
+		void OnUnitCreated(const Unit* unit);
+		void OnBuildingConstructionComplete(const Unit* unit);
+		void OnUnitDestroyed(const Unit* unit);
+
+		// Picks up morphs (siege/unsiege, viking modes, orbital) that change a unit's type in place.
+		void OnUnitChanged(const Unit* unit);
+
+		size_t Alive(UNIT_TYPEID unit_type) const;
+		size_t UnderConstruction(UNIT_TYPEID unit_type) const;
+		size_t InProduction(UNIT_TYPEID production_building, ABILITY_ID ability) const;
+
+		// Recounts orders on our producers, only does work once per game loop.
+		void UpdateProduction(const ObservationInterface* observation);
+
+		// Compares the table against a full scan and resets it to the truth.
+		// Returns how many entries had drifted.
+		size_t Verify(const ObservationInterface* observation);
+
+	private:
+		struct Counts
+		{
+			size_t alive = 0;
+			size_t under_construction = 0;
+		};
+
+		struct Tracked
+		{
+			uint32_t unit_type;
+			bool under_construction;
+			uint32_t verify_stamp;
+		};
+
+		void Add(uint32_t unit_type, bool under_construction);
+		void Subtract(uint32_t unit_type, bool under_construction);
+		const Counts* Find(uint32_t unit_type) const;
+
+		// Dense table indexed by unit type id.
+		std::vector<Counts> counts_;
+		std::unordered_map<Tag, Tracked> tracked_;
+		std::unordered_map<uint64_t, size_t> in_production_;
+
+		uint32_t production_loop_ = 0;
+		bool production_counted_ = false;
+		uint32_t verify_stamp_ = 0;
+	};
+}
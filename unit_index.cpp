@@ -0,0 +1,97 @@
+#include "unit_index.h"
+
+namespace sc2
+{
+	size_t UnitIndex::AddGroup(const std::vector<UNIT_TYPEID>& unit_types)
+	{
+		size_t group = group_count_++;
+		for (UNIT_TYPEID unit_type : unit_types)
+		{
+			group_members_[static_cast<uint32_t>(unit_type)].push_back(group);
+		}
+
+		for (AllianceBuckets& buckets : buckets_)
+		{
+			buckets.by_group.resize(group_count_);
+		}
+		return group;
+	}
+
+	void UnitIndex::Update(const ObservationInterface* observation)
+	{
+		uint32_t game_loop = observation->GetGameLoop();
+		if (built_ && game_loop == game_loop_)
+		{
+			return;
+		}
+		game_loop_ = game_loop;
+		built_ = true;
+
+		// Clear rather than rebuild the containers so their capacity carries over between steps.
+		all_.clear();
+		for (AllianceBuckets& buckets : buckets_)
+		{
+			buckets.all.clear();
+			for (auto& entry : buckets.by_type)
+			{
+				entry.second.clear();
+			}
+			for (Units& group : buckets.by_group)
+			{
+				group.clear();
+			}
+		}
+
+		for (const Unit* unit : observation->GetUnits())
+		{
+			AllianceBuckets& buckets = buckets_[AllianceSlot(unit->alliance)];
+			uint32_t unit_type = unit->unit_type;
+
+			all_.push_back(unit);
+			buckets.all.push_back(unit);
+			buckets.by_type[unit_type].push_back(unit);
+
+			auto members = group_members_.find(unit_type);
+			if (members != group_members_.end())
+			{
+				for (size_t group : members->second)
+				{
+					buckets.by_group[group].push_back(unit);
+				}
+			}
+		}
+	}
+
+	const Units& UnitIndex::GetUnits(Unit::Alliance alliance) const
+	{
+		return buckets_[AllianceSlot(alliance)].all;
+	}
+
+	const Units& UnitIndex::GetUnits(Unit::Alliance alliance, UNIT_TYPEID unit_type) const
+	{
+		const AllianceBuckets& buckets = buckets_[AllianceSlot(alliance)];
+		auto found = buckets.by_type.find(static_cast<uint32_t>(unit_type));
+		return found == buckets.by_type.end() ? empty_ : found->second;
+	}
+
+	const Units& UnitIndex::GetGroup(Unit::Alliance alliance, size_t group) const
+	{
+		return buckets_[AllianceSlot(alliance)].by_group.at(group);
+	}
+
+	size_t UnitIndex::Count(Unit::Alliance alliance, UNIT_TYPEID unit_type) const
+	{
+		return GetUnits(alliance, unit_type).size();
+	}
+
+	size_t UnitIndex::CountGroup(Unit::Alliance alliance, size_t group) const
+	{
+		return GetGroup(alliance, group).size();
+	}
+
+	size_t UnitIndex::AllianceSlot(Unit::Alliance alliance)
+	{
+		// Unit::Alliance runs Self = 1 .. Enemy = 4.
+		return static_cast<size_t>(alliance) - 1;
+	}
+}
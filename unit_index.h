@@ -0,0 +1,53 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Per-step index of observed units, bucketed by alliance and unit type.
+	// Built from one GetUnits call so managers share a single pass over the observation.
+	class UnitIndex
+	{
+	public:
+		// Registers an "any of" type group (ie barrack_types) and returns its id.
+		// Groups must be registered before the first Update.
+		size_t AddGroup(const std::vector<UNIT_TYPEID>& unit_types);
+
+		// Rebuilds the buckets if the game loop has moved on since the last build.
+		void Update(const ObservationInterface* observation);
+
+		// Every unit, in GetUnits order.
+		const Units& GetUnits() const { return all_; }
+		const Units& GetUnits(Unit::Alliance alliance) const;
+		const Units& GetUnits(Unit::Alliance alliance, UNIT_TYPEID unit_type) const;
+		const Units& GetGroup(Unit::Alliance alliance, size_t group) const;
+
+		size_t Count(Unit::Alliance alliance, UNIT_TYPEID unit_type) const;
+		size_t CountGroup(Unit::Alliance alliance, size_t group) const;
+
+	private:
+		static const int alliance_count = 4;
+
+		struct AllianceBuckets
+		{
+			Units all;
+			std::unordered_map<uint32_t, Units> by_type;
+			std::vector<Units> by_group;
+		};
+
+		static size_t AllianceSlot(Unit::Alliance alliance);
+
+		Units all_;
+		AllianceBuckets buckets_[alliance_count];
+		std::unordered_map<uint32_t, std::vector<size_t>> group_members_;
+		size_t group_count_ = 0;
+
+		uint32_t game_loop_ = 0;
+		bool built_ = false;
+
+		Units empty_;
+	};
+}
@@ -0,0 +1,49 @@
+#include "unit_type_table.h"
+
+#include <algorithm>
+
+namespace sc2
+{
+	void UnitTypeTable::Build(const UnitTypes& unit_types)
+	{
+		table_.assign(unit_types.size(), UnitTypeInfo());
+
+		for (const UnitTypeData& data : unit_types)
+		{
+			uint32_t id = data.unit_type_id;
+			if (id >= table_.size())
+			{
+				table_.resize(id + 1);
+			}
+
+			UnitTypeInfo& info = table_[id];
+			for (Attribute attribute : data.attributes)
+			{
+				info.attributes |= 1u << static_cast<uint32_t>(attribute);
+			}
+
+			for (const Weapon& weapon : data.weapons)
+			{
+				// Speed is the weapon cooldown in game seconds.
+				float dps = weapon.speed > 0.0f ? weapon.damage_ * weapon.attacks / weapon.speed : 0.0f;
+
+				if (weapon.type == Weapon::TargetType::Ground || weapon.type == Weapon::TargetType::Any)
+				{
+					info.ground_range = std::max(info.ground_range, weapon.range);
+					info.ground_dps = std::max(info.ground_dps, dps);
+				}
+				if (weapon.type == Weapon::TargetType::Air || weapon.type == Weapon::TargetType::Any)
+				{
+					info.air_range = std::max(info.air_range, weapon.range);
+					info.air_dps = std::max(info.air_dps, dps);
+				}
+			}
+
+			info.sight_range = data.sight_range;
+			info.food_required = data.food_required;
+			info.mineral_cost = data.mineral_cost;
+			info.vespene_cost = data.vespene_cost;
+			info.build_ability = data.ability_id;
+		}
+	}
+}
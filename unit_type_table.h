@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+#include "sc2api/sc2_api.h"
+
+namespace sc2
+{
+	// Flattened copy of the fields we read from UnitTypeData.
+	struct UnitTypeInfo
+	{
+		uint32_t attributes = 0; // Bit (1 << Attribute) per attribute
+		float ground_range = 0.0f;
+		float air_range = 0.0f;
+		float ground_dps = 0.0f;
+		float air_dps = 0.0f;
+		float sight_range = 0.0f;
+		float food_required = 0.0f;
+		int mineral_cost = 0;
+		int vespene_cost = 0;
+		AbilityID build_ability; // Ability that produces this type, ie BUILD_SUPPLYDEPOT
+
+		bool HasAttribute(Attribute attribute) const
+		{
+			return (attributes & (1u << static_cast<uint32_t>(attribute))) != 0;
+		}
+	};
+
+	// Dense table of UnitTypeInfo indexed by unit type id, built once at game start.
+	// Lookups are a single indexed load instead of a walk over the attribute and weapon vectors.
+	class UnitTypeTable
+	{
+	public:
+		void Build(const UnitTypes& unit_types);
+
+		// Unknown types read as an all-zero entry.
+		const UnitTypeInfo& Get(UnitTypeID unit_type) const
+		{
+			uint32_t id = unit_type;
+			return id < table_.size() ? table_[id] : empty_;
+		}
+
+		bool IsStructure(UnitTypeID unit_type) const
+		{
+			return Get(unit_type).HasAttribute(Attribute::Structure);
+		}
+
+	private:
+		std::vector<UnitTypeInfo> table_;
+		UnitTypeInfo empty_;
+	};
+}
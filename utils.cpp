@@ -1,12 +1,30 @@
 #include <math.h>
+#include <stdlib.h>
+#include <random>
+#include <string>
 
 #include "sc2api/sc2_api.h"
 #include "sc2lib/sc2_lib.h"
 
-
-
 namespace sc2
 {
+	namespace
+	{
+		struct BotRandom
+		{
+			BotRandom() : seed(std::random_device()()), generator(seed) {}
+
+			uint32_t seed;
+			std::mt19937 generator;
+		};
+
+		BotRandom& botRandom()
+		{
+			static BotRandom random;
+			return random;
+		}
+	}
+
 	Point2D getMapCenter(const ObservationInterface* obs)
 	{
 		float width = obs->GetGameInfo().width / 2;
@@ -34,6 +52,55 @@ namespace sc2
 		return sqrt(x * x + y * y);
 	}
 
-	
+	bool getEnvironment(const char* name, std::string& value)
+	{
+#ifdef _MSC_VER
+		// getenv is flagged unsafe by the SDL checks
+		char* buffer = nullptr;
+		size_t size = 0;
+		if (_dupenv_s(&buffer, &size, name) != 0 || buffer == nullptr)
+		{
+			return false;
+		}
+		value = buffer;
+		free(buffer);
+		return true;
+#else
+		const char* found = getenv(name);
+		if (found == nullptr)
+		{
+			return false;
+		}
+		value = found;
+		return true;
+#endif
+	}
+
+	void setRandomSeed(uint32_t seed)
+	{
+		botRandom().seed = seed;
+		botRandom().generator.seed(seed);
+	}
+
+	uint32_t randomSeed()
+	{
+		return botRandom().seed;
+	}
+
+	float randomScalar()
+	{
+		return std::uniform_real_distribution<float>(-1.0f, 1.0f)(botRandom().generator);
+	}
+
+	float randomFraction()
+	{
+		return std::uniform_real_distribution<float>(0.0f, 1.0f)(botRandom().generator);
+	}
+
+	int randomInteger(int min, int max)
+	{
+		return std::uniform_int_distribution<int>(min, max)(botRandom().generator);
+	}
+
 
 }
@@ -1,10 +1,30 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace sc2 
 {
 	Point2D getMapCenter(const ObservationInterface* obs);
 	Point2D pointTowards(Point2D cur, Point2D dest);
 	double distanceTo(Point2D cur, Point2D& dest);
+	// Reads an environment variable, returns false if it is not set.
+	bool getEnvironment(const char* name, std::string& value);
+
+	// The bot's random numbers come from one generator with a known seed, so a recorded game replays with the same draws.
+	// Seeded from std::random_device until setRandomSeed is called.
+	void setRandomSeed(uint32_t seed);
+	uint32_t randomSeed();
+	float randomScalar();   // -1 to 1
+	float randomFraction(); // 0 to 1
+	int randomInteger(int min, int max);
+
+	template <class T>
+	const T& randomEntry(const std::vector<T>& entries)
+	{
+		return entries[randomInteger(0, static_cast<int>(entries.size()) - 1)];
+	}
 
 }
 